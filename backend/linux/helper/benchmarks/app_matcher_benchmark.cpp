@@ -0,0 +1,184 @@
+// Compares the split tunneling app matching on a synthetic stream of process events:
+//   - old: every fork/exec/exit event reads the exe of the process and compares it with every app
+//     (a reproduction of the previous ProcessMonitor::compareCmd);
+//   - new: AppMatcher, the apps are indexed and the decisions are cached per pid and inherited on fork.
+// The events use the pids of the running processes, so the exe links are real. 60% fork, 30% exec, 10% exit.
+//
+// Usage: app_matcher_benchmark [events] [apps]
+
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "../split_tunneling/app_matcher.h"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+enum EventType { kFork, kExec, kExit };
+
+struct Event
+{
+    EventType type;
+    pid_t parentPid;
+    pid_t pid;
+};
+
+std::string getCmdByPid(pid_t pid)
+{
+    char buf[PATH_MAX];
+    memset(buf, 0, PATH_MAX);
+    int ret = readlink((std::string("/proc/") + std::to_string(pid) + "/exe").c_str(), buf, PATH_MAX - 1);
+    if (ret < 0) {
+        return std::string();
+    }
+    return buf;
+}
+
+bool compareCmd(pid_t pid, const std::vector<std::string> &exes)
+{
+    std::string cmd = getCmdByPid(pid);
+
+    for (auto exe : exes) {
+        if (cmd == exe) {
+            return true;
+        }
+
+        // handle snap
+        size_t idx = exe.find("/snap/");
+        if (idx != std::string::npos) {
+            std::string prefix = exe.substr(0, idx + 6);
+            std::string suffix = exe.substr(exe.rfind("/"));
+            if (cmd.rfind(prefix, 0) == 0 && cmd.find(suffix, cmd.size() - suffix.length()) == cmd.size() - suffix.length()) {
+                return true;
+            }
+        }
+
+        // handle flatpak
+        if (cmd.rfind("/app/", 0) == 0 && exe.rfind("/app/", 0) == 0) {
+            std::string suffix = exe.substr(exe.rfind("/"));
+            if (cmd.find(suffix, cmd.size() - suffix.length()) == cmd.size() - suffix.length()) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+std::vector<pid_t> runningPids()
+{
+    std::vector<pid_t> pids;
+    DIR *dp = opendir("/proc");
+    if (dp == NULL) {
+        return pids;
+    }
+    struct dirent *ep;
+    while ((ep = readdir(dp))) {
+        if (ep->d_type == DT_DIR && ep->d_name[0] >= '0' && ep->d_name[0] <= '9') {
+            pids.push_back(atoi(ep->d_name));
+        }
+    }
+    closedir(dp);
+    return pids;
+}
+
+std::vector<std::string> makeApps(int count)
+{
+    // the benchmark itself is one of the apps, so some of the events match
+    std::vector<std::string> apps = { getCmdByPid(getpid()) };
+    for (int i = 1; i < count; ++i) {
+        if (i % 5 == 0) {
+            apps.push_back("/snap/app" + std::to_string(i) + "/123/usr/bin/app" + std::to_string(i));
+        } else if (i % 5 == 1) {
+            apps.push_back("/app/bin/app" + std::to_string(i));
+        } else {
+            apps.push_back("/usr/bin/app" + std::to_string(i));
+        }
+    }
+    return apps;
+}
+
+std::vector<Event> makeEvents(int count, const std::vector<pid_t> &pids)
+{
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<size_t> pidDist(0, pids.size() - 1);
+    std::uniform_int_distribution<int> typeDist(0, 9);
+
+    std::vector<Event> events;
+    events.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        int type = typeDist(rng);
+        Event event;
+        event.type = type < 6 ? kFork : (type < 9 ? kExec : kExit);
+        event.parentPid = pids[pidDist(rng)];
+        event.pid = pids[pidDist(rng)];
+        events.push_back(event);
+    }
+    return events;
+}
+
+double eventsPerSec(size_t count, Clock::time_point start)
+{
+    return count / std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    int count = argc > 1 ? std::stoi(argv[1]) : 200000;
+    int appCount = argc > 2 ? std::stoi(argv[2]) : 50;
+
+    const std::vector<pid_t> pids = runningPids();
+    if (pids.empty()) {
+        printf("no processes found in /proc\n");
+        return 1;
+    }
+    const std::vector<std::string> apps = makeApps(appCount);
+    const std::vector<Event> events = makeEvents(count, pids);
+
+    size_t oldMatches = 0;
+    Clock::time_point start = Clock::now();
+    for (const auto &event : events) {
+        oldMatches += compareCmd(event.pid, apps);
+    }
+    double oldResult = eventsPerSec(events.size(), start);
+
+    AppMatcher matcher;
+    std::vector<pid_t> added;
+    std::vector<pid_t> removed;
+    start = Clock::now();
+    matcher.setApps(apps, added, removed);
+    double scanMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    size_t newMatches = 0;
+    start = Clock::now();
+    for (const auto &event : events) {
+        switch (event.type) {
+            case kFork:
+                newMatches += matcher.onFork(event.parentPid, event.pid);
+                break;
+            case kExec:
+                newMatches += matcher.onExec(event.pid);
+                break;
+            case kExit:
+                newMatches += matcher.onExit(event.pid);
+                break;
+        }
+    }
+    double newResult = eventsPerSec(events.size(), start);
+
+    printf("%zu processes, %zu apps, %zu events\n", pids.size(), apps.size(), events.size());
+    printf("%-36s %12.0f events/s, %zu matched\n", "old (readlink + compare per event):", oldResult, oldMatches);
+    printf("%-36s %12.0f events/s, %zu matched\n", "new (indexed, cached per pid):", newResult, newMatches);
+    printf("%-36s %12.2f ms, %zu processes added\n", "new initial /proc scan:", scanMs, added.size());
+    return 0;
+}
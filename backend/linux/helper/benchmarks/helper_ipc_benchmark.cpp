@@ -0,0 +1,260 @@
+// Compares the client <-> helper IPC protocols over a Unix socket:
+//   - old: boost text archives, the client does 4 writes per command and waits for the answer before sending the next one
+//     (a reproduction of the previous implementation);
+//   - new: the binary framing of helper_protocol.h, one gather write per command, up to <depth> commands in flight.
+// The server side only decodes the commands and encodes the answers, so the numbers show the protocol overhead.
+// The commands alternate between HELPER_CMD_GET_WIREGUARD_STATUS (polled by the client every second while connected)
+// and HELPER_CMD_SET_FIREWALL_RULES with a realistic set of rules.
+//
+// Usage: helper_ipc_benchmark [commands] [depth]
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/archive/text_iarchive.hpp>
+#include <boost/archive/text_oarchive.hpp>
+#include <boost/asio.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include "helper_protocol.h"
+
+using boost::asio::local::stream_protocol;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Result
+{
+    double commandsPerSec = 0;
+    double p50Us = 0;
+    double p99Us = 0;
+};
+
+CMD_SET_FIREWALL_RULES makeFirewallRules()
+{
+    CMD_SET_FIREWALL_RULES cmd;
+    cmd.ipVersion = kIpv4;
+    cmd.table = "filter";
+    cmd.group = "windscribe_input";
+    std::string rules = "*filter\n:windscribe_input - [0:0]\n:windscribe_output - [0:0]\n";
+    for (int i = 0; i < 100; ++i) {
+        rules += "-A windscribe_input -s 10." + std::to_string(i) + ".0.0/16 -j ACCEPT -m comment --comment \"Windscribe client rule\"\n";
+    }
+    cmd.rules = rules + "COMMIT\n";
+    return cmd;
+}
+
+CMD_ANSWER handleCommand(int cmdId, const CMD_SET_FIREWALL_RULES &rules)
+{
+    CMD_ANSWER answer;
+    answer.executed = 1;
+    if (cmdId == HELPER_CMD_GET_WIREGUARD_STATUS) {
+        answer.cmdId = kWgStateActive;
+        answer.customInfoValue[0] = 123456789;
+        answer.customInfoValue[1] = 987654321;
+    } else {
+        answer.exitCode = rules.rules.empty() ? 1 : 0;
+    }
+    return answer;
+}
+
+int commandId(int i)
+{
+    return i % 2 ? HELPER_CMD_SET_FIREWALL_RULES : HELPER_CMD_GET_WIREGUARD_STATUS;
+}
+
+Result makeResult(std::vector<double> &latenciesUs, Clock::duration total)
+{
+    Result result;
+    std::sort(latenciesUs.begin(), latenciesUs.end());
+    result.commandsPerSec = latenciesUs.size() / std::chrono::duration<double>(total).count();
+    result.p50Us = latenciesUs[latenciesUs.size() / 2];
+    result.p99Us = latenciesUs[std::min(latenciesUs.size() - 1, latenciesUs.size() * 99 / 100)];
+    return result;
+}
+
+double sinceUs(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+// old protocol
+
+void oldServer(stream_protocol::socket &sock)
+{
+    boost::system::error_code ec;
+    while (true) {
+        int header[3];
+        boost::asio::read(sock, boost::asio::buffer(header, sizeof(header)), ec);
+        if (ec) {
+            return;
+        }
+        std::vector<char> body(header[2]);
+        boost::asio::read(sock, boost::asio::buffer(body.data(), body.size()), ec);
+
+        CMD_SET_FIREWALL_RULES cmd;
+        if (header[0] == HELPER_CMD_SET_FIREWALL_RULES) {
+            std::istringstream stream(std::string(body.begin(), body.end()));
+            boost::archive::text_iarchive ia(stream, boost::archive::no_header);
+            ia >> cmd;
+        }
+
+        std::stringstream stream;
+        boost::archive::text_oarchive oa(stream, boost::archive::no_header);
+        oa << handleCommand(header[0], cmd);
+        std::string str = stream.str();
+        int length = (int)str.length();
+        boost::asio::write(sock, boost::asio::buffer(&length, sizeof(length)), ec);
+        boost::asio::write(sock, boost::asio::buffer(str.data(), str.length()), ec);
+    }
+}
+
+Result oldClient(stream_protocol::socket &sock, int count, const CMD_SET_FIREWALL_RULES &rules)
+{
+    std::vector<double> latenciesUs;
+    auto start = Clock::now();
+    for (int i = 0; i < count; ++i) {
+        auto cmdStart = Clock::now();
+        int cmdId = commandId(i);
+        std::string data;
+        if (cmdId == HELPER_CMD_SET_FIREWALL_RULES) {
+            std::stringstream stream;
+            boost::archive::text_oarchive oa(stream, boost::archive::no_header);
+            oa << rules;
+            data = stream.str();
+        }
+
+        int length = (int)data.size();
+        pid_t pid = getpid();
+        boost::asio::write(sock, boost::asio::buffer(&cmdId, sizeof(cmdId)));
+        boost::asio::write(sock, boost::asio::buffer(&pid, sizeof(pid)));
+        boost::asio::write(sock, boost::asio::buffer(&length, sizeof(length)));
+        boost::asio::write(sock, boost::asio::buffer(data.data(), length));
+
+        boost::asio::read(sock, boost::asio::buffer(&length, sizeof(length)));
+        std::vector<char> buff(length);
+        boost::asio::read(sock, boost::asio::buffer(buff.data(), length));
+        std::istringstream stream(std::string(buff.begin(), buff.end()));
+        boost::archive::text_iarchive ia(stream, boost::archive::no_header);
+        CMD_ANSWER answer;
+        ia >> answer;
+        latenciesUs.push_back(sinceUs(cmdStart));
+    }
+    return makeResult(latenciesUs, Clock::now() - start);
+}
+
+// new protocol, the same steps as in Server::receiveCmdHandle() and Helper_posix::runCommand()
+
+void newServer(stream_protocol::socket &sock)
+{
+    boost::asio::streambuf buf;
+    boost::system::error_code ec;
+    while (true) {
+        boost::asio::read(sock, buf, boost::asio::transfer_at_least(1), ec);
+        if (ec) {
+            return;
+        }
+
+        std::string answers;
+        HELPER_FRAME_HEADER header;
+        while (helper_protocol::parseFrame(boost::asio::buffer_cast<const char *>(buf.data()), buf.size(), header) ==
+               helper_protocol::FrameStatus::kComplete) {
+            std::string body(boost::asio::buffer_cast<const char *>(buf.data()) + sizeof(header), header.length);
+            buf.consume(sizeof(header) + header.length);
+
+            CMD_SET_FIREWALL_RULES cmd;
+            if (header.cmdId == HELPER_CMD_SET_FIREWALL_RULES) {
+                helper_protocol::BinaryIArchive ia(body.data(), body.size());
+                ia >> cmd;
+            }
+            helper_protocol::appendFrame(answers, header.requestId, header.cmdId, 0, helper_protocol::serialize(handleCommand(header.cmdId, cmd)));
+        }
+        boost::asio::write(sock, boost::asio::buffer(answers), ec);
+    }
+}
+
+Result newClient(stream_protocol::socket &sock, int count, int depth, const CMD_SET_FIREWALL_RULES &rules)
+{
+    std::vector<double> latenciesUs;
+    std::map<uint32_t, Clock::time_point> inFlight;
+    int sent = 0;
+    auto start = Clock::now();
+    while ((int)latenciesUs.size() < count) {
+        while (sent < count && (int)inFlight.size() < depth) {
+            uint32_t requestId = sent + 1;
+            inFlight[requestId] = Clock::now();
+            int cmdId = commandId(sent++);
+            std::string data = cmdId == HELPER_CMD_SET_FIREWALL_RULES ? helper_protocol::serialize(rules) : std::string();
+            HELPER_FRAME_HEADER header = helper_protocol::makeHeader(requestId, cmdId, getpid(), data.size());
+            std::array<boost::asio::const_buffer, 2> buffers = { boost::asio::buffer(&header, sizeof(header)), boost::asio::buffer(data) };
+            boost::asio::write(sock, buffers);
+        }
+
+        HELPER_FRAME_HEADER header;
+        boost::asio::read(sock, boost::asio::buffer(&header, sizeof(header)));
+        std::string body(header.length, '\0');
+        boost::asio::read(sock, boost::asio::buffer(&body[0], body.size()));
+        helper_protocol::BinaryIArchive ia(body.data(), body.size());
+        CMD_ANSWER answer;
+        ia >> answer;
+
+        auto it = inFlight.find(header.requestId);
+        latenciesUs.push_back(sinceUs(it->second));
+        inFlight.erase(it);
+    }
+    return makeResult(latenciesUs, Clock::now() - start);
+}
+
+template<typename ServerFunc, typename ClientFunc>
+Result run(const std::string &path, ServerFunc serverFunc, ClientFunc clientFunc)
+{
+    boost::asio::io_context io;
+    ::unlink(path.c_str());
+    stream_protocol::acceptor acceptor(io, stream_protocol::endpoint(path));
+    std::thread server([&]() {
+        stream_protocol::socket sock(io);
+        acceptor.accept(sock);
+        serverFunc(sock);
+    });
+
+    Result result;
+    {
+        stream_protocol::socket sock(io);
+        sock.connect(stream_protocol::endpoint(path));
+        result = clientFunc(sock);
+    }
+    server.join();
+    ::unlink(path.c_str());
+    return result;
+}
+
+void print(const char *name, const Result &result)
+{
+    printf("%-36s %10.0f cmd/s, p50 %8.1f us, p99 %8.1f us\n", name, result.commandsPerSec, result.p50Us, result.p99Us);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    int count = argc > 1 ? std::stoi(argv[1]) : 20000;
+    int depth = argc > 2 ? std::stoi(argv[2]) : 8;
+    const std::string path = "/tmp/helper_ipc_benchmark." + std::to_string(getpid()) + ".sock";
+    const CMD_SET_FIREWALL_RULES rules = makeFirewallRules();
+
+    Result oldResult = run(path, oldServer, [&](stream_protocol::socket &sock) { return oldClient(sock, count, rules); });
+    Result newResult = run(path, newServer, [&](stream_protocol::socket &sock) { return newClient(sock, count, 1, rules); });
+    Result pipelinedResult = run(path, newServer, [&](stream_protocol::socket &sock) { return newClient(sock, count, depth, rules); });
+
+    print("old (text archive, 4 writes):", oldResult);
+    print("new (binary, depth 1):", newResult);
+    std::string name = "new (binary, depth " + std::to_string(depth) + "):";
+    print(name.c_str(), pipelinedResult);
+    return 0;
+}
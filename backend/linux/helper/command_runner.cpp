@@ -0,0 +1,231 @@
+#include "command_runner.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <spdlog/spdlog.h>
+
+extern char **environ;
+
+pid_t CommandRunner::spawn(const std::vector<std::string> &argv, bool appendFromStdErr, int *outFd)
+{
+    if (argv.empty()) {
+        return -1;
+    }
+
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0) {
+        spdlog::error("pipe2 failed ({})", errno);
+        return -1;
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+    if (appendFromStdErr) {
+        posix_spawn_file_actions_adddup2(&actions, fds[1], STDERR_FILENO);
+    } else {
+        posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+    }
+
+    std::vector<char *> args;
+    for (const auto &arg : argv) {
+        args.push_back(const_cast<char *>(arg.c_str()));
+    }
+    args.push_back(nullptr);
+
+    pid_t pid;
+    int ret = posix_spawnp(&pid, args[0], &actions, nullptr, args.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[1]);
+    if (ret != 0) {
+        spdlog::debug("Couldn't start {} ({})", argv[0], ret);
+        close(fds[0]);
+        return -1;
+    }
+
+    *outFd = fds[0];
+    return pid;
+}
+
+int CommandRunner::run(const std::vector<std::string> &argv, std::string *pOutputStr, bool appendFromStdErr)
+{
+    std::vector<Command> commands(1);
+    commands[0].argv = argv;
+    commands[0].appendFromStdErr = appendFromStdErr;
+    runParallel(commands);
+
+    if (pOutputStr) {
+        *pOutputStr = std::move(commands[0].output);
+    }
+    return commands[0].status;
+}
+
+void CommandRunner::runParallel(std::vector<Command> &commands)
+{
+    struct Running
+    {
+        size_t index;
+        pid_t pid;
+        int fd;     // -1 when the output is closed and the process is not reaped yet
+        std::chrono::steady_clock::time_point startTime;
+        int reapRetryIntervalMs;
+    };
+    std::vector<Running> running;
+    std::vector<pollfd> pfds;
+    std::vector<size_t> polled;     // the indexes in running of pfds
+    size_t next = 0;
+
+    while (next < commands.size() || !running.empty()) {
+        while (next < commands.size() && running.size() < kMaxParallel) {
+            Command &command = commands[next];
+            int fd;
+            const auto startTime = std::chrono::steady_clock::now();
+            pid_t pid = spawn(command.argv, command.appendFromStdErr, &fd);
+            if (pid < 0) {
+                command.status = -1;
+            } else {
+                running.push_back({next, pid, fd, startTime, 1});
+            }
+            next++;
+        }
+        if (running.empty()) {
+            break;
+        }
+
+        pfds.clear();
+        polled.clear();
+        // usually the process exits right after it has closed the output, so retry reaping soon and then less often
+        int timeoutMs = -1;
+        for (size_t i = 0; i < running.size(); ++i) {
+            if (running[i].fd < 0) {
+                if (timeoutMs < 0 || running[i].reapRetryIntervalMs < timeoutMs) {
+                    timeoutMs = running[i].reapRetryIntervalMs;
+                }
+                running[i].reapRetryIntervalMs = std::min(running[i].reapRetryIntervalMs * 2, kMaxReapRetryIntervalMs);
+                continue;
+            }
+            pfds.push_back({running[i].fd, POLLIN, 0});
+            polled.push_back(i);
+        }
+        if (poll(pfds.data(), pfds.size(), timeoutMs) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            spdlog::error("poll failed ({})", errno);
+            break;
+        }
+
+        for (size_t i = 0; i < pfds.size(); ++i) {
+            if (pfds[i].revents == 0) {
+                continue;
+            }
+            Running &r = running[polled[i]];
+            Command &command = commands[r.index];
+            char buf[4096];
+            ssize_t len = read(r.fd, buf, sizeof(buf));
+            if (len > 0) {
+                command.output.append(buf, len);
+                continue;
+            }
+            if (len < 0 && errno == EINTR) {
+                continue;
+            }
+            // the output is closed, the command has finished or is about to; it's reaped below or on a later iteration
+            close(r.fd);
+            r.fd = -1;
+        }
+
+        // a command which has closed the output but keeps running must not hold up the others
+        for (size_t i = 0; i < running.size();) {
+            int status = 0;
+            pid_t res = 0;
+            if (running[i].fd < 0) {
+                while ((res = waitpid(running[i].pid, &status, WNOHANG)) < 0 && errno == EINTR) {
+                }
+            }
+            if (res == 0) {
+                ++i;
+                continue;
+            }
+
+            Command &command = commands[running[i].index];
+            command.status = res < 0 ? -1 : status;
+            // the callers read the output line by line
+            if (!command.output.empty() && command.output.back() != '\n') {
+                command.output += '\n';
+            }
+            record(command.argv, std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - running[i].startTime).count());
+            running.erase(running.begin() + i);
+        }
+    }
+
+    // only if poll failed, the commands are abandoned; kill them so reaping does not block
+    for (const auto &r : running) {
+        if (r.fd >= 0) {
+            close(r.fd);
+        }
+        kill(r.pid, SIGKILL);
+        while (waitpid(r.pid, nullptr, 0) < 0 && errno == EINTR) {
+        }
+    }
+}
+
+void CommandRunner::record(const std::vector<std::string> &argv, uint64_t elapsedUs)
+{
+    std::string name = argv[0];
+    // a shell command line is counted by its first word
+    if (argv.size() > 2 && name == "/bin/sh" && argv[1] == "-c") {
+        name = argv[2].substr(0, argv[2].find(' '));
+    }
+    name = name.substr(name.rfind('/') + 1);
+
+    int bucket = 0;
+    while (bucket < kHistogramBuckets - 1 && elapsedUs >= bucketLimitMs(bucket) * 1000) {
+        bucket++;
+    }
+
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    Stats &stats = stats_[name];
+    stats.count++;
+    stats.totalUs += elapsedUs;
+    stats.maxUs = std::max(stats.maxUs, elapsedUs);
+    stats.histogram[bucket]++;
+}
+
+void CommandRunner::logStats()
+{
+    std::map<std::string, Stats> stats;
+    {
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        stats.swap(stats_);
+    }
+
+    for (const auto &it : stats) {
+        std::string histogram;
+        for (int i = 0; i < kHistogramBuckets; ++i) {
+            if (it.second.histogram[i] == 0) {
+                continue;
+            }
+            if (!histogram.empty()) {
+                histogram += ", ";
+            }
+            if (i == kHistogramBuckets - 1) {
+                // the rest, i.e. not below the limit of the previous bucket
+                histogram += ">=" + std::to_string(bucketLimitMs(i - 1)) + "ms: ";
+            } else {
+                histogram += "<" + std::to_string(bucketLimitMs(i)) + "ms: ";
+            }
+            histogram += std::to_string(it.second.histogram[i]);
+        }
+        spdlog::info("Command {}: {} runs, {} ms total, {} ms max ({})", it.first, it.second.count, it.second.totalUs / 1000,
+                     it.second.maxUs / 1000, histogram);
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+// Runs external commands with posix_spawn. The arguments are passed to the executable as they are, without a shell.
+// The time of every command is recorded per executable, logStats() logs it as a histogram.
+class CommandRunner
+{
+public:
+    static CommandRunner &instance()
+    {
+        static CommandRunner i;
+        return i;
+    }
+
+    struct Command
+    {
+        std::vector<std::string> argv;
+        bool appendFromStdErr = true;
+
+        // the wait status (0 on success), or -1 if the command could not be started
+        int status = -1;
+        std::string output;
+    };
+
+    // Blocking, returns the wait status as above and the stdout (and stderr) in pOutputStr if not null.
+    int run(const std::vector<std::string> &argv, std::string *pOutputStr = nullptr, bool appendFromStdErr = true);
+    // Runs the commands, which must not depend on each other, up to kMaxParallel at a time. Blocks until all finished.
+    void runParallel(std::vector<Command> &commands);
+
+    // Starts the command with stdout (and stderr) redirected to the returned pipe in outFd, returns the pid or -1.
+    static pid_t spawn(const std::vector<std::string> &argv, bool appendFromStdErr, int *outFd);
+
+    void logStats();
+
+private:
+    static constexpr size_t kMaxParallel = 8;
+    // bucket i counts the commands which took less than 2^i ms, the last one the rest
+    static constexpr int kHistogramBuckets = 14;
+    // the longest retry interval of the commands which have closed the output but have not exited yet
+    static constexpr int kMaxReapRetryIntervalMs = 50;
+
+    // the upper bound of the bucket i, except the last one
+    static constexpr uint64_t bucketLimitMs(int i) { return 1ull << i; }
+
+    struct Stats
+    {
+        uint64_t count = 0;
+        uint64_t totalUs = 0;
+        uint64_t maxUs = 0;
+        uint64_t histogram[kHistogramBuckets] = {};
+    };
+
+    std::mutex statsMutex_;
+    std::map<std::string, Stats> stats_;    // by executable
+
+    CommandRunner() {}
+    void record(const std::vector<std::string> &argv, uint64_t elapsedUs);
+};
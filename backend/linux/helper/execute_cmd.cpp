@@ -1,111 +1,217 @@
 #include "execute_cmd.h"
-#include <boost/thread.hpp>
-#include <syslog.h>
 
-unsigned long ExecuteCmd::execute(const std::string &cmd, const std::string &cwd, bool deleteOnFinish)
+#include <cerrno>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <spdlog/spdlog.h>
+
+#include "command_runner.h"
+
+ExecuteCmd::ExecuteCmd() : curCmdId_(0), isStopping_(false)
 {
-    mutex_.lock();
-    curCmdId_++;
-    CmdDescr *cmdDescr = new CmdDescr();
-    cmdDescr->bFinished = false;
-    cmdDescr->bSuccess = false;
-    cmdDescr->cmdId = curCmdId_;
-    executingCmds_.push_back(cmdDescr);
-    mutex_.unlock();
-
-    if (!cwd.empty()) {
-        boost::thread(runCmd, curCmdId_, "cd \"" + cwd + "\" && " + cmd, deleteOnFinish);
-    } else {
-        boost::thread(runCmd, curCmdId_, cmd, deleteOnFinish);
+    wakeFd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    thread_ = std::thread(&ExecuteCmd::run, this);
+}
+
+ExecuteCmd::~ExecuteCmd()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        isStopping_ = true;
+    }
+    uint64_t value = 1;
+    if (write(wakeFd_, &value, sizeof(value)) < 0) {
+        spdlog::error("Couldn't stop the command thread ({})", errno);
+    }
+    thread_.join();
+    close(wakeFd_);
+}
+
+unsigned long ExecuteCmd::execute(const std::string &cmd, const std::string &cwd, bool deleteOnFinish, FinishedCallback onFinished)
+{
+    const std::string cmdLine = cwd.empty() ? cmd : "cd \"" + cwd + "\" && " + cmd;
+    int fd = -1;
+    pid_t pid = CommandRunner::spawn({"/bin/sh", "-c", cmdLine}, false, &fd);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    const unsigned long cmdId = ++curCmdId_;
+    CmdDescr &cmdDescr = executingCmds_[cmdId];
+    cmdDescr.deleteOnFinish = deleteOnFinish;
+
+    if (pid < 0) {
+        spdlog::error("Couldn't start the command");
+        cmdFinished(cmdId, false);
+        lock.unlock();
+        if (onFinished) {
+            onFinished(cmdId, false, std::string());
+        }
+        return cmdId;
     }
 
-    return curCmdId_;
+    processes_.push_back({cmdId, pid, fd, onFinished});
+    uint64_t value = 1;
+    if (write(wakeFd_, &value, sizeof(value)) < 0) {
+        spdlog::error("Couldn't wake up the command thread ({})", errno);
+    }
+    return cmdId;
 }
 
 void ExecuteCmd::getStatus(unsigned long cmdId, bool &bFinished, std::string &log)
 {
-    mutex_.lock();
-    for (auto it = executingCmds_.begin(); it != executingCmds_.end(); ++it) {
-        if ((*it)->cmdId == cmdId) {
-            bFinished = (*it)->bFinished;
-            log = (*it)->log;
-
-            if ((*it)->bFinished) {
-                delete (*it);
-                executingCmds_.erase(it);
-            }
-            break;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = executingCmds_.find(cmdId);
+    if (it != executingCmds_.end()) {
+        bFinished = it->second.bFinished;
+        log = it->second.log;
+
+        if (it->second.bFinished) {
+            executingCmds_.erase(it);
         }
     }
-    mutex_.unlock();
 }
 
 void ExecuteCmd::clearCmds()
 {
-    mutex_.lock();
-    for (auto it = executingCmds_.begin(); it != executingCmds_.end(); ++it) {
-        delete (*it);
-    }
+    std::lock_guard<std::mutex> lock(mutex_);
     executingCmds_.clear();
-    mutex_.unlock();
 }
 
-
-ExecuteCmd::ExecuteCmd() : curCmdId_(0)
+void ExecuteCmd::run()
 {
-}
+    std::vector<pollfd> pfds;
+    std::vector<Process> processes;
+    std::vector<size_t> polledProcesses;    // the indexes in processes of pfds[1..]
 
-void ExecuteCmd::runCmd(unsigned long cmdId, std::string cmd, bool deleteOnFinish)
-{
-    std::string strReply;
-
-    // run openvpn command
-    FILE *file = popen(cmd.c_str(), "r");
-    if (file) {
-        char szLine[4096];
-        while(fgets(szLine, sizeof(szLine), file) != 0) {
-            if (instance().isCmdExist(cmdId)) {
-                strReply += szLine;
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (isStopping_) {
+                break;
+            }
+            processes = processes_;
+        }
+
+        pfds.assign(1, {wakeFd_, POLLIN, 0});
+        polledProcesses.clear();
+        bool isReapPending = false;
+        for (size_t i = 0; i < processes.size(); ++i) {
+            if (processes[i].fd < 0) {
+                isReapPending = true;
+                continue;
+            }
+            pfds.push_back({processes[i].fd, POLLIN, 0});
+            polledProcesses.push_back(i);
+        }
+        if (poll(pfds.data(), pfds.size(), isReapPending ? kReapRetryIntervalMs : -1) < 0) {
+            if (errno != EINTR) {
+                spdlog::error("poll failed in the command thread ({})", errno);
+                break;
+            }
+            continue;
+        }
+
+        if (pfds[0].revents) {
+            uint64_t value;
+            while (read(wakeFd_, &value, sizeof(value)) > 0) {
+            }
+        }
+
+        for (size_t i = 0; i < polledProcesses.size(); ++i) {
+            if (pfds[i + 1].revents == 0) {
+                continue;
+            }
+            Process &process = processes[polledProcesses[i]];
+            char buf[4096];
+            ssize_t len = read(process.fd, buf, sizeof(buf));
+            if (len < 0 && errno == EINTR) {
+                continue;
+            }
+
+            if (len > 0) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = executingCmds_.find(process.cmdId);
+                if (it != executingCmds_.end()) {
+                    it->second.log.append(buf, len);
+                }
+                continue;
+            }
+
+            // the output is closed, the command has finished or is about to; it's reaped below or on a later iteration
+            close(process.fd);
+            process.fd = -1;
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (auto &it : processes_) {
+                if (it.cmdId == process.cmdId) {
+                    it.fd = -1;
+                    break;
+                }
+            }
+        }
+
+        for (const auto &process : processes) {
+            if (process.fd >= 0 || !tryReap(process)) {
+                continue;
+            }
+
+            std::string log;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                for (auto it = processes_.begin(); it != processes_.end(); ++it) {
+                    if (it->cmdId == process.cmdId) {
+                        processes_.erase(it);
+                        break;
+                    }
+                }
+                auto it = executingCmds_.find(process.cmdId);
+                if (it != executingCmds_.end()) {
+                    log = it->second.log;
+                    cmdFinished(process.cmdId, true);
+                }
+            }
+            if (process.onFinished) {
+                process.onFinished(process.cmdId, true, log);
             }
         }
-        pclose(file);
-        instance().cmdFinished(cmdId, true, strReply, deleteOnFinish);
-    } else {
-        instance().cmdFinished(cmdId, false, std::string(), deleteOnFinish);
     }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto &process : processes_) {
+        if (process.fd >= 0) {
+            close(process.fd);
+        }
+    }
+    processes_.clear();
 }
 
-void ExecuteCmd::cmdFinished(unsigned long cmdId, bool bSuccess, std::string log, bool del)
+bool ExecuteCmd::tryReap(const Process &process)
 {
-    mutex_.lock();
-    for (auto it = executingCmds_.begin(); it != executingCmds_.end(); ++it) {
-        if ((*it)->cmdId == cmdId) {
-            if (del) {
-                delete(*it);
-                executingCmds_.erase(it);
-            } else {
-                (*it)->bFinished = true;
-                (*it)->bSuccess = bSuccess;
-                (*it)->log = log;
-            }
-            break;
-        }
+    int status = 0;
+    pid_t res;
+    while ((res = waitpid(process.pid, &status, WNOHANG)) < 0 && errno == EINTR) {
     }
-    mutex_.unlock();
+    if (res == 0) {
+        return false;
+    }
+    if (res < 0) {
+        // reaped elsewhere, e.g. by a SIGCHLD handler, there is nothing to wait for
+        spdlog::warn("waitpid failed for the command {} ({})", process.cmdId, errno);
+    }
+    return true;
 }
 
-bool ExecuteCmd::isCmdExist(unsigned long cmdId)
+void ExecuteCmd::cmdFinished(unsigned long cmdId, bool bSuccess)
 {
-    mutex_.lock();
-    bool bFound = false;
-    for (auto it = executingCmds_.begin(); it != executingCmds_.end(); ++it)
-    {
-        if ((*it)->cmdId == cmdId)
-        {
-            bFound = true;
-            break;
-        }
+    // the mutex is locked by the caller
+    auto it = executingCmds_.find(cmdId);
+    if (it == executingCmds_.end()) {
+        return;
+    }
+    if (it->second.deleteOnFinish) {
+        executingCmds_.erase(it);
+    } else {
+        it->second.bFinished = true;
+        it->second.bSuccess = bSuccess;
     }
-    mutex_.unlock();
-    return bFound;
 }
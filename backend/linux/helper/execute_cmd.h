@@ -1,40 +1,69 @@
 #pragma once
 
 #include <stdio.h>
-#include <string>
-#include <list>
+#include <functional>
+#include <map>
 #include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <thread>
+#include <vector>
 
+// Runs the long-lived commands (OpenVPN, WireGuard, stunnel) in the background and keeps their output.
+// One thread collects the output and reaps all the commands; the owner is notified with the callback given
+// to execute() when its command finishes, the client polls getStatus().
 class ExecuteCmd
 {
 public:
+    typedef std::function<void(unsigned long cmdId, bool bSuccess, const std::string &log)> FinishedCallback;
+
     static ExecuteCmd &instance()
     {
         static ExecuteCmd i;
         return i;
     }
 
-    unsigned long execute(const std::string &cmd, const std::string &cwd = "", bool deleteOnFinish = false);
+    // onFinished is called on the thread of ExecuteCmd when the command exits, also after clearCmds()
+    unsigned long execute(const std::string &cmd, const std::string &cwd = "", bool deleteOnFinish = false,
+                          FinishedCallback onFinished = nullptr);
     void getStatus(unsigned long cmdId, bool &bFinished, std::string &log);
     void clearCmds();
 
 private:
     ExecuteCmd();
-
-    unsigned long curCmdId_;
-
-    static void runCmd(unsigned long cmdId, std::string cmd, bool deleteOnFinish);
-    void cmdFinished(unsigned long cmdId, bool bSuccess, std::string log, bool del);
-    bool isCmdExist(unsigned long cmdId);
+    ~ExecuteCmd();
 
     struct CmdDescr
     {
-        unsigned long cmdId;
         std::string log;
-        bool bFinished;
-        bool bSuccess;
+        bool bFinished = false;
+        bool bSuccess = false;
+        bool deleteOnFinish = false;
     };
 
-    std::list<CmdDescr *> executingCmds_;
+    // a started command, kept after clearCmds() until it exits
+    struct Process
+    {
+        unsigned long cmdId;
+        pid_t pid;
+        int fd;     // -1 when the output is closed and the process is not reaped yet
+        FinishedCallback onFinished;
+    };
+
+    // the retry interval of the processes which have closed the output but have not exited yet
+    static constexpr int kReapRetryIntervalMs = 50;
+
+    unsigned long curCmdId_;
+    std::map<unsigned long, CmdDescr> executingCmds_;
+    std::vector<Process> processes_;
     std::mutex mutex_;
+
+    int wakeFd_;    // eventfd, wakes the thread up for new commands or to stop
+    bool isStopping_;
+    std::thread thread_;
+
+    void run();
+    // returns false if the process has not exited yet, doesn't block
+    bool tryReap(const Process &process);
+    void cmdFinished(unsigned long cmdId, bool bSuccess);
 };
@@ -4,14 +4,46 @@
 #include <fcntl.h>
 #include <fstream>
 #include <sstream>
+#include <unistd.h>
 #include <spdlog/spdlog.h>
 
 #include "split_tunneling/cgroups.h"
 #include "utils.h"
 
+namespace
+{
+
+// the split tunneling rules for our chains, in the filter table
+bool isOwnChain(const std::vector<std::string> &args)
+{
+    return !args.empty() && args[0].rfind("windscribe_", 0) == 0 && std::find(args.begin(), args.end(), "-t") == args.end();
+}
+
+} // namespace
+
 FirewallController::FirewallController() : connected_(false), splitTunnelEnabled_(false), splitTunnelExclude_(true)
 {
+    isIpsetAvailable_ = Utils::executeCommand("ipset", {"version"}) == 0;
+    if (!isIpsetAvailable_) {
+        spdlog::info("ipset is not available, the firewall address lists are kept as separate rules");
+    }
+
+    isNftables_ = isNftablesSelected();
+    spdlog::info("Firewall backend: {}", isNftables_ ? "nftables" : "iptables");
+
     // If firewall on boot is enabled, restore boot rules
+    if (isNftables_) {
+        for (bool ipv6 : {false, true}) {
+            std::ifstream file(ipv6 ? "/etc/windscribe/boot_rules.v6" : "/etc/windscribe/boot_rules.v4");
+            std::stringstream rules;
+            rules << file.rdbuf();
+            FirewallRuleset ruleset;
+            if (file && ruleset.parse(rules.str(), ipv6)) {
+                enableNftables(ipv6, ruleset);
+            }
+        }
+        return;
+    }
     if (Utils::isFileExists("/etc/windscribe/boot_rules.v4")) {
         Utils::executeCommand("iptables-restore", {"-n", "/etc/windscribe/boot_rules.v4"});
     }
@@ -26,38 +58,75 @@ FirewallController::~FirewallController()
 
 bool FirewallController::enable(bool ipv6, const std::string &rules)
 {
-    int fd;
+    FirewallRuleset &appliedRules = ipv6 ? appliedRulesV6_ : appliedRulesV4_;
+
+    FirewallRuleset ruleset;
+    if (!ruleset.parse(rules, ipv6)) {
+        // not a complete ruleset (e.g. the commands which remove our rules), apply it as is
+        bool ret = restoreRules(ipv6, rules);
+        destroySets(appliedRules);
+        appliedRules = FirewallRuleset();
+        setSplitTunnelIpExceptions(splitTunnelIps_);
+        setSplitTunnelAppExceptions();
+        setSplitTunnelIngressRules(defaultAdapterIp_);
+        return !ret;
+    }
 
-    if (ipv6) {
-        fd = open("/etc/windscribe/rules.v6", O_CREAT | O_WRONLY | O_TRUNC, S_IRWXU | S_IRGRP | S_IROTH);
-    } else {
-        fd = open("/etc/windscribe/rules.v4", O_CREAT | O_WRONLY | O_TRUNC, S_IRWXU | S_IRGRP | S_IROTH);
+    if (isNftables_) {
+        if (enableNftables(ipv6, ruleset)) {
+            return 0;
+        }
+        // the other family was applied with nftables too, move it to iptables as well
+        spdlog::error("Could not apply the firewall rules with nftables, switching to iptables");
+        FirewallRuleset otherRules = ipv6 ? appliedRulesV4_ : appliedRulesV6_;
+        nftables_.clear();
+        isNftables_ = false;
+        appliedRulesV4_ = FirewallRuleset();
+        appliedRulesV6_ = FirewallRuleset();
+        if (!otherRules.isEmpty()) {
+            enable(!ipv6, otherRules.toRestoreFormat());
+        }
+        ruleset.parse(rules, ipv6);
     }
 
-    if (fd < 0) {
-        spdlog::error("Could not open firewall rules for writing");
-        return 1;
+    if (isIpsetAvailable_) {
+        ruleset.moveAddressesToSets(ipv6 ? "windscribe6_" : "windscribe4_", kMinSetSize);
     }
 
-    int bytes = write(fd, rules.c_str(), rules.length());
-    close(fd);
-    if (bytes <= 0) {
-        spdlog::error("Could not write rules");
-        return 1;
+    // Only the address lists changed, which is the usual case when the allowed IPs are updated.
+    // Update the sets in place, the rules and the split tunneling rules in our chains stay as they are.
+    if (!appliedRules.isEmpty() && ruleset.hasSameRules(appliedRules) && isRulesetActive(appliedRules)) {
+        if (updateSets(appliedRules, ruleset)) {
+            appliedRules = ruleset;
+            return 0;
+        }
+        spdlog::warn("Could not update the firewall address sets, reloading the rules");
     }
 
-    if (ipv6) {
-        Utils::executeCommand("ip6tables-restore", {"-n", "/etc/windscribe/rules.v6"});
-    } else {
-        Utils::executeCommand("iptables-restore", {"-n", "/etc/windscribe/rules.v4"});
+    if (!ruleset.sets().empty() && !fillSets(ruleset)) {
+        spdlog::warn("Could not create the firewall address sets, falling back to separate rules");
+        isIpsetAvailable_ = false;
+        ruleset.parse(rules, ipv6);
     }
 
+    bool ret = restoreRules(ipv6, ruleset.toRestoreFormat());
+    if (!ret && !ruleset.sets().empty()) {
+        // most likely the kernel has no set match
+        spdlog::warn("Could not apply the firewall rules with address sets, falling back to separate rules");
+        isIpsetAvailable_ = false;
+        destroySets(ruleset);
+        ruleset.parse(rules, ipv6);
+        ret = restoreRules(ipv6, ruleset.toRestoreFormat());
+    }
+    destroySets(appliedRules, ruleset);
+    appliedRules = ret ? ruleset : FirewallRuleset();
+
     // reapply split tunneling rules if necessary
     setSplitTunnelIpExceptions(splitTunnelIps_);
     setSplitTunnelAppExceptions();
     setSplitTunnelIngressRules(defaultAdapterIp_);
 
-    return 0;
+    return !ret;
 }
 
 void FirewallController::getRules(bool ipv6, std::string *outRules)
@@ -80,13 +149,25 @@ void FirewallController::getRules(bool ipv6, std::string *outRules)
 
 bool FirewallController::enabled(const std::string &tag)
 {
+    if (isNftables_) {
+        return nftables_.isActive();
+    }
     return Utils::executeCommand("iptables", {"--check", "INPUT", "-j", "windscribe_input", "-m", "comment", "--comment", tag.c_str()}) == 0;
 }
 
 void FirewallController::disable()
 {
-    Utils::executeCommand("rm", {"-f", "/etc/windscribe/rules.v4"});
-    Utils::executeCommand("rm", {"-f", "/etc/windscribe/rules.v6"});
+    if (isNftables_) {
+        nftables_.clear();
+    }
+    // the rules which match the sets have been removed by the client at this point
+    destroySets(appliedRulesV4_);
+    destroySets(appliedRulesV6_);
+    appliedRulesV4_ = FirewallRuleset();
+    appliedRulesV6_ = FirewallRuleset();
+
+    unlink("/etc/windscribe/rules.v4");
+    unlink("/etc/windscribe/rules.v6");
 }
 
 void FirewallController::setSplitTunnelingEnabled(bool isConnected, bool isEnabled, bool isExclude, const std::string &defaultAdapter, const std::string &defaultAdapterIp)
@@ -289,6 +370,12 @@ void FirewallController::setSplitTunnelIpExceptions(const std::vector<std::strin
 
 void FirewallController::addRule(const std::vector<std::string> &args, bool ipv6, bool append)
 {
+    // with nftables our chains are in the nftables table, the other tables are still handled by iptables
+    if (isNftables_ && isOwnChain(args)) {
+        nftables_.addRule(ipv6, args, append);
+        return;
+    }
+
     std::vector<std::string> checkArgs = args;
     checkArgs.insert(checkArgs.begin(), "-C");
     int ret = Utils::executeCommand(ipv6 ? "ip6tables" : "iptables", checkArgs);
@@ -301,7 +388,171 @@ void FirewallController::addRule(const std::vector<std::string> &args, bool ipv6
 
 void FirewallController::removeRule(const std::vector<std::string> &args, bool ipv6)
 {
+    if (isNftables_ && isOwnChain(args)) {
+        nftables_.removeRule(ipv6, args);
+        return;
+    }
+
     std::vector<std::string> deleteArgs = args;
     deleteArgs.insert(deleteArgs.begin(), "-D");
     Utils::executeCommand(ipv6 ? "ip6tables" : "iptables", deleteArgs);
 }
+
+bool FirewallController::isNftablesSelected()
+{
+    // /etc/windscribe/firewall_backend may contain "iptables" or "nftables", by default iptables is used if it is installed
+    std::string backend;
+    std::ifstream file("/etc/windscribe/firewall_backend");
+    file >> backend;
+    if (backend == "iptables") {
+        return false;
+    }
+    if (backend != "nftables" && Utils::executeCommand("iptables", {"--version"}) == 0) {
+        return false;
+    }
+    if (!NftablesFirewall::isAvailable()) {
+        spdlog::warn("nftables is not available, using iptables");
+        return false;
+    }
+    return true;
+}
+
+bool FirewallController::enableNftables(bool ipv6, FirewallRuleset &ruleset)
+{
+    FirewallRuleset &appliedRules = ipv6 ? appliedRulesV6_ : appliedRulesV4_;
+    const FirewallRuleset rules = ruleset;
+    ruleset.moveAddressesToSets(ipv6 ? "windscribe6_" : "windscribe4_", kMinSetSize);
+    bool isReloaded = false;
+    if (!nftables_.apply(ruleset, &isReloaded)) {
+        return false;
+    }
+    // keep the rules without the sets, for the case we need to move them to iptables
+    appliedRules = rules;
+
+    // the split tunneling rules in our chains are gone after a reload
+    if (isReloaded) {
+        setSplitTunnelIpExceptions(splitTunnelIps_);
+        setSplitTunnelAppExceptions();
+        setSplitTunnelIngressRules(defaultAdapterIp_);
+    }
+    return true;
+}
+
+bool FirewallController::restoreRules(bool ipv6, const std::string &rules)
+{
+    const std::string path = ipv6 ? "/etc/windscribe/rules.v6" : "/etc/windscribe/rules.v4";
+    int fd = open(path.c_str(), O_CREAT | O_WRONLY | O_TRUNC, S_IRWXU | S_IRGRP | S_IROTH);
+    if (fd < 0) {
+        spdlog::error("Could not open firewall rules for writing");
+        return false;
+    }
+
+    int bytes = write(fd, rules.c_str(), rules.length());
+    close(fd);
+    if (bytes <= 0) {
+        spdlog::error("Could not write rules");
+        return false;
+    }
+
+    std::string output;
+    if (Utils::executeCommand(ipv6 ? "ip6tables-restore" : "iptables-restore", {"-n", path}, &output) != 0) {
+        spdlog::error("Could not restore firewall rules: {}", output);
+        return false;
+    }
+    return true;
+}
+
+bool FirewallController::isRulesetActive(const FirewallRuleset &ruleset)
+{
+    // the last rule of a chain is gone if the rules were flushed by someone else
+    for (const auto &table : ruleset.tables()) {
+        for (auto it = table.commands.rbegin(); it != table.commands.rend(); ++it) {
+            if (!it->isAppend) {
+                continue;
+            }
+            std::vector<std::string> args = {"-t", table.name, "-C", it->chain};
+            for (auto arg : FirewallRuleset::splitSpec(it->spec)) {
+                arg.erase(std::remove(arg.begin(), arg.end(), '"'), arg.end());
+                args.push_back(arg);
+            }
+            return Utils::executeCommand(ruleset.isIpv6() ? "ip6tables" : "iptables", args) == 0;
+        }
+    }
+    return false;
+}
+
+bool FirewallController::updateSets(const FirewallRuleset &from, const FirewallRuleset &to)
+{
+    // add the new addresses first, so that the addresses present in both lists are never missing
+    std::string adds;
+    std::string dels;
+    for (size_t i = 0; i < to.sets().size(); ++i) {
+        const auto &oldAddresses = from.sets()[i].addresses;
+        const auto &newAddresses = to.sets()[i].addresses;
+        for (const auto &address : newAddresses) {
+            if (oldAddresses.find(address) == oldAddresses.end()) {
+                adds += "add " + to.sets()[i].name + " " + address + "\n";
+            }
+        }
+        for (const auto &address : oldAddresses) {
+            if (newAddresses.find(address) == newAddresses.end()) {
+                dels += "del " + to.sets()[i].name + " " + address + "\n";
+            }
+        }
+    }
+    if (adds.empty() && dels.empty()) {
+        return true;
+    }
+    spdlog::debug("Updating firewall address sets: {} changes", std::count(adds.begin(), adds.end(), '\n') + std::count(dels.begin(), dels.end(), '\n'));
+    return runIpsetRestore(to.isIpv6(), adds + dels);
+}
+
+bool FirewallController::fillSets(const FirewallRuleset &ruleset)
+{
+    // fill a temporary set and swap it with the used one, so the rules never see a partially filled set
+    const std::string type = std::string(" hash:net family ") + (ruleset.isIpv6() ? "inet6" : "inet");
+    std::string commands;
+    for (const auto &set : ruleset.sets()) {
+        const std::string tmpName = set.name + "_tmp";
+        commands += "create " + set.name + type + "\n";
+        commands += "create " + tmpName + type + "\n";
+        commands += "flush " + tmpName + "\n";
+        for (const auto &address : set.addresses) {
+            commands += "add " + tmpName + " " + address + "\n";
+        }
+        commands += "swap " + tmpName + " " + set.name + "\n";
+        commands += "destroy " + tmpName + "\n";
+    }
+    return runIpsetRestore(ruleset.isIpv6(), commands);
+}
+
+void FirewallController::destroySets(const FirewallRuleset &ruleset, const FirewallRuleset &keep)
+{
+    for (const auto &set : ruleset.sets()) {
+        bool isKept = std::any_of(keep.sets().begin(), keep.sets().end(), [&](const FirewallRuleset::AddressSet &it) {
+            return it.name == set.name;
+        });
+        if (!isKept) {
+            Utils::executeCommand("ipset", {"destroy", set.name});
+        }
+    }
+}
+
+bool FirewallController::runIpsetRestore(bool ipv6, const std::string &commands)
+{
+    const std::string path = ipv6 ? "/etc/windscribe/ipsets.v6" : "/etc/windscribe/ipsets.v4";
+    std::ofstream file(path, std::ios::trunc);
+    file << commands;
+    file.close();
+    if (!file) {
+        spdlog::error("Could not write ipset commands");
+        return false;
+    }
+
+    std::string output;
+    if (Utils::executeCommand("ipset", {"restore", "-exist", "-file", path}, &output) != 0) {
+        spdlog::error("ipset restore failed: {}", output);
+        return false;
+    }
+    return true;
+}
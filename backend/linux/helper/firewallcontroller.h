@@ -2,6 +2,8 @@
 
 #include <string>
 #include <vector>
+#include "firewallruleset.h"
+#include "nftablesfirewall.h"
 
 class FirewallController
 {
@@ -40,6 +42,23 @@ private:
     std::string prevAdapter_;
     std::string netclassid_;
 
+    // the address lists of at least this size are moved to ipsets
+    static constexpr size_t kMinSetSize = 8;
+    bool isIpsetAvailable_;
+    bool isNftables_;
+    NftablesFirewall nftables_;
+    FirewallRuleset appliedRulesV4_;
+    FirewallRuleset appliedRulesV6_;
+
+    static bool isNftablesSelected();
+    bool enableNftables(bool ipv6, FirewallRuleset &ruleset);
+    bool restoreRules(bool ipv6, const std::string &rules);
+    bool isRulesetActive(const FirewallRuleset &ruleset);
+    bool updateSets(const FirewallRuleset &from, const FirewallRuleset &to);
+    bool fillSets(const FirewallRuleset &ruleset);
+    void destroySets(const FirewallRuleset &ruleset, const FirewallRuleset &keep = FirewallRuleset());
+    bool runIpsetRestore(bool ipv6, const std::string &commands);
+
     void removeExclusiveIpRules();
     void removeInclusiveIpRules();
     void removeExclusiveAppRules();
@@ -109,7 +109,7 @@ bool FirewallOnBootManager::enable(bool allowLanTraffic) {
 
 bool FirewallOnBootManager::disable()
 {
-    Utils::executeCommand("rm", {"-f", "/etc/windscribe/boot_rules.v4"});
-    Utils::executeCommand("rm", {"-f", "/etc/windscribe/boot_rules.v6"});
+    unlink("/etc/windscribe/boot_rules.v4");
+    unlink("/etc/windscribe/boot_rules.v6");
     return true;
 }
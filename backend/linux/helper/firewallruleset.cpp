@@ -0,0 +1,244 @@
+#include "firewallruleset.h"
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include <boost/algorithm/string.hpp>
+
+namespace
+{
+
+// index of the address in the args, if the rule matches exactly one address and nothing else differs from rule to rule
+bool findAddress(const std::vector<std::string> &args, bool ipv6, size_t &outIndex, bool &outIsSource)
+{
+    bool isFound = false;
+    for (size_t i = 0; i < args.size(); ++i) {
+        const bool isSource = args[i] == "-s" || args[i] == "--source";
+        const bool isDestination = args[i] == "-d" || args[i] == "--destination";
+        if (!isSource && !isDestination) {
+            continue;
+        }
+        // negated, a list of addresses or more than one address match
+        if (isFound || i + 1 >= args.size() || (i > 0 && args[i - 1] == "!") || args[i + 1].find(',') != std::string::npos) {
+            return false;
+        }
+        // the sets of type hash:net can not contain the zero prefix
+        if (boost::algorithm::ends_with(args[i + 1], "/0")) {
+            return false;
+        }
+        if ((args[i + 1].find(':') != std::string::npos) != ipv6) {
+            return false;
+        }
+        isFound = true;
+        outIndex = i;
+        outIsSource = isSource;
+    }
+    return isFound;
+}
+
+std::string normalizeAddress(const std::string &address, bool ipv6)
+{
+    const std::string hostPrefix = ipv6 ? "/128" : "/32";
+    if (boost::algorithm::ends_with(address, hostPrefix)) {
+        return address.substr(0, address.size() - hostPrefix.size());
+    }
+    return address;
+}
+
+} // namespace
+
+bool FirewallRuleset::parse(const std::string &rules, bool ipv6)
+{
+    ipv6_ = ipv6;
+    tables_.clear();
+    sets_.clear();
+
+    std::istringstream stream(rules);
+    std::string line;
+    Table *table = nullptr;
+    while (std::getline(stream, line)) {
+        boost::algorithm::trim(line);
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        if (line[0] == '*') {
+            tables_.push_back(Table());
+            table = &tables_.back();
+            table->name = line.substr(1);
+        } else if (line == "COMMIT") {
+            table = nullptr;
+        } else if (table && line[0] == ':') {
+            table->chains.push_back(line);
+        } else if (table && (boost::algorithm::starts_with(line, "-A ") || boost::algorithm::starts_with(line, "-I "))) {
+            Command command;
+            command.isAppend = line[1] == 'A';
+            const size_t chainEnd = line.find(' ', 3);
+            command.chain = line.substr(3, chainEnd - 3);
+            if (chainEnd != std::string::npos) {
+                command.spec = boost::algorithm::trim_copy(line.substr(chainEnd));
+            }
+            table->commands.push_back(command);
+        } else {
+            tables_.clear();
+            return false;
+        }
+    }
+
+    // a table without COMMIT is not applied by iptables-restore
+    if (table) {
+        tables_.clear();
+        return false;
+    }
+    return !tables_.empty();
+}
+
+void FirewallRuleset::moveAddressesToSets(const std::string &setPrefix, size_t minSetSize)
+{
+    struct Run
+    {
+        std::string key;        // the chain and the rule without the address
+        std::vector<size_t> commandIndexes;
+        std::vector<std::string> addresses;
+    };
+
+    for (auto &table : tables_) {
+        std::map<std::string, Run> currentRuns;    // per chain
+        std::vector<Run> runs;
+        auto finishRun = [&](Run &run) {
+            if (run.commandIndexes.size() >= minSetSize) {
+                runs.push_back(run);
+            }
+            run = Run();
+        };
+
+        for (size_t i = 0; i < table.commands.size(); ++i) {
+            const Command &command = table.commands[i];
+            // the inserted rules go to the head of the chain, they do not break the runs of the appended ones
+            if (!command.isAppend) {
+                continue;
+            }
+            Run &run = currentRuns[command.chain];
+            std::vector<std::string> args = splitSpec(command.spec);
+            size_t addressIndex;
+            bool isSource;
+            if (!findAddress(args, ipv6_, addressIndex, isSource)) {
+                finishRun(run);
+                continue;
+            }
+            const std::string address = normalizeAddress(args[addressIndex + 1], ipv6_);
+            args[addressIndex + 1].clear();
+            const std::string key = command.chain + " " + boost::algorithm::join(args, " ");
+            if (run.key != key) {
+                finishRun(run);
+                run.key = key;
+            }
+            run.commandIndexes.push_back(i);
+            run.addresses.push_back(address);
+        }
+        for (auto &it : currentRuns) {
+            finishRun(it.second);
+        }
+
+        // keep the numbering of the sets stable for the same rules
+        std::sort(runs.begin(), runs.end(), [](const Run &a, const Run &b) {
+            return a.commandIndexes.front() < b.commandIndexes.front();
+        });
+
+        std::vector<bool> isRemoved(table.commands.size(), false);
+        for (const auto &run : runs) {
+            AddressSet set;
+            set.name = setPrefix + std::to_string(sets_.size());
+            set.addresses.insert(run.addresses.begin(), run.addresses.end());
+
+            // the first rule of the run matches the set, the rest are removed
+            Command &command = table.commands[run.commandIndexes.front()];
+            std::vector<std::string> args = splitSpec(command.spec);
+            size_t addressIndex;
+            bool isSource;
+            findAddress(args, ipv6_, addressIndex, isSource);
+            args[addressIndex] = "-m set --match-set";
+            args[addressIndex + 1] = set.name + (isSource ? " src" : " dst");
+            command.spec = boost::algorithm::join(args, " ");
+            for (size_t i = 1; i < run.commandIndexes.size(); ++i) {
+                isRemoved[run.commandIndexes[i]] = true;
+            }
+            sets_.push_back(set);
+        }
+
+        size_t index = 0;
+        table.commands.erase(std::remove_if(table.commands.begin(), table.commands.end(), [&](const Command &) {
+            return isRemoved[index++];
+        }), table.commands.end());
+    }
+}
+
+std::vector<FirewallRuleset::Command> FirewallRuleset::takeBuiltinChainCommands()
+{
+    std::vector<Command> result;
+    for (auto &table : tables_) {
+        auto it = std::stable_partition(table.commands.begin(), table.commands.end(), [](const Command &command) {
+            return !isBuiltinChain(command.chain);
+        });
+        result.insert(result.end(), it, table.commands.end());
+        table.commands.erase(it, table.commands.end());
+    }
+    return result;
+}
+
+bool FirewallRuleset::hasSameRules(const FirewallRuleset &other) const
+{
+    if (ipv6_ != other.ipv6_ || tables_ != other.tables_ || sets_.size() != other.sets_.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < sets_.size(); ++i) {
+        if (sets_[i].name != other.sets_[i].name) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string FirewallRuleset::toRestoreFormat() const
+{
+    std::string out;
+    for (const auto &table : tables_) {
+        out += "*" + table.name + "\n";
+        for (const auto &chain : table.chains) {
+            out += chain + "\n";
+        }
+        for (const auto &command : table.commands) {
+            out += (command.isAppend ? "-A " : "-I ") + command.chain + (command.spec.empty() ? "" : " " + command.spec) + "\n";
+        }
+        out += "COMMIT\n";
+    }
+    return out;
+}
+
+bool FirewallRuleset::isBuiltinChain(const std::string &chain)
+{
+    return chain == "INPUT" || chain == "OUTPUT" || chain == "FORWARD" || chain == "PREROUTING" || chain == "POSTROUTING";
+}
+
+std::vector<std::string> FirewallRuleset::splitSpec(const std::string &spec)
+{
+    std::vector<std::string> args;
+    std::string arg;
+    bool isQuoted = false;
+    for (char c : spec) {
+        if (c == '"') {
+            isQuoted = !isQuoted;
+        }
+        if (c == ' ' && !isQuoted) {
+            if (!arg.empty()) {
+                args.push_back(arg);
+                arg.clear();
+            }
+        } else {
+            arg += c;
+        }
+    }
+    if (!arg.empty()) {
+        args.push_back(arg);
+    }
+    return args;
+}
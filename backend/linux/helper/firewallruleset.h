@@ -0,0 +1,72 @@
+#pragma once
+
+#include <set>
+#include <string>
+#include <vector>
+
+// Model of a ruleset in the iptables-restore format, as sent by the client.
+// Long runs of rules which differ only by the address (-s/-d) are moved into address sets,
+// so that a change of the address list does not change the rules themselves.
+class FirewallRuleset
+{
+public:
+    struct Command
+    {
+        bool isAppend = true;   // -A or -I
+        std::string chain;
+        std::string spec;       // the rest of the line, as is
+
+        bool operator==(const Command &other) const
+        {
+            return isAppend == other.isAppend && chain == other.chain && spec == other.spec;
+        }
+    };
+
+    struct Table
+    {
+        std::string name;
+        std::vector<std::string> chains;    // ":name policy [packets:bytes]" lines
+        std::vector<Command> commands;
+
+        bool operator==(const Table &other) const
+        {
+            return name == other.name && chains == other.chains && commands == other.commands;
+        }
+    };
+
+    struct AddressSet
+    {
+        std::string name;
+        std::set<std::string> addresses;
+    };
+
+    // Returns false if the text is not a complete ruleset, e.g. the -D/-X commands used to remove the rules.
+    bool parse(const std::string &rules, bool ipv6);
+
+    // Replaces the runs of at least minSetSize consecutive rules of a chain that differ only by the address
+    // with one "-m set --match-set" rule, the sets are named setPrefix + number.
+    void moveAddressesToSets(const std::string &setPrefix, size_t minSetSize);
+
+    // removes the rules of the built-in chains (INPUT, OUTPUT, etc.) and returns them
+    std::vector<Command> takeBuiltinChainCommands();
+
+    // true if the rules are the same, the contents of the sets may differ
+    bool hasSameRules(const FirewallRuleset &other) const;
+
+    bool isEmpty() const { return tables_.empty(); }
+    bool isIpv6() const { return ipv6_; }
+    const std::vector<Table> &tables() const { return tables_; }
+    const std::vector<AddressSet> &sets() const { return sets_; }
+
+    std::string toRestoreFormat() const;
+
+    static bool isBuiltinChain(const std::string &chain);
+
+    // splits a rule spec into arguments, keeps the quoted ones (e.g. the comments) together with the quotes
+    static std::vector<std::string> splitSpec(const std::string &spec);
+
+private:
+    bool ipv6_ = false;
+    std::vector<Table> tables_;
+    std::vector<AddressSet> sets_;
+};
@@ -0,0 +1,308 @@
+// Checks the model of the iptables rulesets sent by the client: the iptables-save text survives parse() and
+// toRestoreFormat(), moveAddressesToSets() moves the address runs to the sets without changing what the rules match
+// (expanding the sets gives the original rules back), and hasSameRules() ignores the contents of the sets only.
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "firewallruleset.h"
+
+namespace {
+
+const std::string kComment = " -m comment --comment \"Windscribe client rule\"";
+
+std::string addressRules(const std::string &chain, const std::string &option, const std::vector<std::string> &addresses)
+{
+    std::string rules;
+    for (const auto &address : addresses) {
+        rules += "-A " + chain + " " + option + " " + address + " -j ACCEPT" + kComment + "\n";
+    }
+    return rules;
+}
+
+std::vector<std::string> makeAddresses(int count, const std::string &suffix = "/32")
+{
+    std::vector<std::string> addresses;
+    for (int i = 1; i <= count; ++i) {
+        addresses.push_back("10.1.0." + std::to_string(i) + suffix);
+    }
+    return addresses;
+}
+
+std::string filterTable(const std::string &commands)
+{
+    return "*filter\n:windscribe_input - [0:0]\n:windscribe_output - [0:0]\n" + commands + "COMMIT\n";
+}
+
+// the rules in the iptables-restore format with the set matches replaced back with the addresses of the sets
+std::vector<std::string> expandSets(const FirewallRuleset &ruleset)
+{
+    const std::string hostPrefix = ruleset.isIpv6() ? "/128" : "/32";
+    std::vector<std::string> rules;
+    for (const auto &table : ruleset.tables()) {
+        for (const auto &command : table.commands) {
+            const std::string prefix = (command.isAppend ? "-A " : "-I ") + command.chain + " ";
+            bool isSetRule = false;
+            for (const auto &set : ruleset.sets()) {
+                for (const auto &direction : { std::string(" src"), std::string(" dst") }) {
+                    const std::string match = "-m set --match-set " + set.name + direction;
+                    const size_t pos = command.spec.find(match);
+                    if (pos == std::string::npos) {
+                        continue;
+                    }
+                    isSetRule = true;
+                    for (const auto &address : set.addresses) {
+                        std::string spec = command.spec;
+                        const std::string network = address.find('/') == std::string::npos ? address + hostPrefix : address;
+                        spec.replace(pos, match.size(), (direction == " src" ? "-s " : "-d ") + network);
+                        rules.push_back(prefix + spec);
+                    }
+                }
+            }
+            if (!isSetRule) {
+                rules.push_back(prefix + command.spec);
+            }
+        }
+    }
+    return rules;
+}
+
+// the commands of the text, without the tables and chains
+std::vector<std::string> commandLines(const std::string &rules)
+{
+    std::vector<std::string> lines;
+    size_t pos = 0;
+    while (pos < rules.size()) {
+        size_t end = rules.find('\n', pos);
+        if (end == std::string::npos) {
+            end = rules.size();
+        }
+        const std::string line = rules.substr(pos, end - pos);
+        if (line.rfind("-A ", 0) == 0 || line.rfind("-I ", 0) == 0) {
+            lines.push_back(line);
+        }
+        pos = end + 1;
+    }
+    return lines;
+}
+
+} // namespace
+
+TEST(FirewallRuleset, ParseRoundTrip)
+{
+    struct TestCase
+    {
+        std::string name;
+        std::string input;
+        bool ipv6;
+        bool isParsed;
+        std::string output;     // toRestoreFormat() if parsed
+    };
+    const std::vector<TestCase> testCases = {
+        { "iptables-save output",
+          "# Generated by iptables-save v1.8.7 on Mon Jan  1 00:00:00 2024\n"
+          "*filter\n"
+          ":INPUT ACCEPT [0:0]\n"
+          ":windscribe_input - [0:0]\n"
+          "-A INPUT -j windscribe_input" + kComment + "\n"
+          "-A windscribe_input -s 10.0.0.1/32 -j ACCEPT" + kComment + "\n"
+          "COMMIT\n"
+          "# Completed on Mon Jan  1 00:00:00 2024\n",
+          false, true,
+          "*filter\n"
+          ":INPUT ACCEPT [0:0]\n"
+          ":windscribe_input - [0:0]\n"
+          "-A INPUT -j windscribe_input" + kComment + "\n"
+          "-A windscribe_input -s 10.0.0.1/32 -j ACCEPT" + kComment + "\n"
+          "COMMIT\n" },
+        { "blank lines and spaces are dropped",
+          "*filter\n\n  :windscribe_output - [0:0]  \n\n-I OUTPUT   -j windscribe_output\n\nCOMMIT\n",
+          false, true,
+          "*filter\n:windscribe_output - [0:0]\n-I OUTPUT -j windscribe_output\nCOMMIT\n" },
+        { "several tables",
+          "*mangle\n-A OUTPUT -j MARK --set-mark 51820\nCOMMIT\n*filter\n-A OUTPUT -o lo -j ACCEPT\nCOMMIT\n",
+          false, true,
+          "*mangle\n-A OUTPUT -j MARK --set-mark 51820\nCOMMIT\n*filter\n-A OUTPUT -o lo -j ACCEPT\nCOMMIT\n" },
+        { "ipv6",
+          "*filter\n-A windscribe_input -s ::1/128 -j ACCEPT\nCOMMIT\n",
+          true, true,
+          "*filter\n-A windscribe_input -s ::1/128 -j ACCEPT\nCOMMIT\n" },
+        { "no COMMIT", "*filter\n-A OUTPUT -o lo -j ACCEPT\n", false, false, "" },
+        { "deletion commands", "*filter\n-D OUTPUT -j windscribe_output\nCOMMIT\n", false, false, "" },
+        { "command outside of a table", "-A OUTPUT -o lo -j ACCEPT\n", false, false, "" },
+        { "empty", "", false, false, "" },
+    };
+
+    for (const auto &testCase : testCases) {
+        SCOPED_TRACE(testCase.name);
+        FirewallRuleset ruleset;
+        ASSERT_EQ(ruleset.parse(testCase.input, testCase.ipv6), testCase.isParsed);
+        if (!testCase.isParsed) {
+            EXPECT_TRUE(ruleset.isEmpty());
+            continue;
+        }
+        EXPECT_EQ(ruleset.isIpv6(), testCase.ipv6);
+        EXPECT_EQ(ruleset.toRestoreFormat(), testCase.output);
+
+        // the output is parsed to the same rules
+        FirewallRuleset reparsed;
+        ASSERT_TRUE(reparsed.parse(ruleset.toRestoreFormat(), testCase.ipv6));
+        EXPECT_TRUE(reparsed.hasSameRules(ruleset));
+    }
+}
+
+TEST(FirewallRuleset, MoveAddressesToSets)
+{
+    struct TestCase
+    {
+        std::string name;
+        std::string rules;
+        bool ipv6;
+        std::vector<std::string> commands;              // after moveAddressesToSets()
+        std::vector<std::vector<std::string>> sets;     // the addresses of windscribe_0, windscribe_1, ...
+    };
+    const std::vector<TestCase> testCases = {
+        { "run of destinations",
+          filterTable("-A windscribe_output -o lo -j ACCEPT\n" + addressRules("windscribe_output", "-d", makeAddresses(3)) +
+                      "-A windscribe_output -j DROP\n"),
+          false,
+          { "-A windscribe_output -o lo -j ACCEPT",
+            "-A windscribe_output -m set --match-set windscribe_0 dst -j ACCEPT" + kComment,
+            "-A windscribe_output -j DROP" },
+          { { "10.1.0.1", "10.1.0.2", "10.1.0.3" } } },
+        { "networks keep the prefix",
+          filterTable(addressRules("windscribe_input", "-s", { "10.1.0.0/16", "10.2.0.1/32", "10.3.0.0/24" })),
+          false,
+          { "-A windscribe_input -m set --match-set windscribe_0 src -j ACCEPT" + kComment },
+          { { "10.1.0.0/16", "10.2.0.1", "10.3.0.0/24" } } },
+        { "run shorter than the minimum",
+          filterTable(addressRules("windscribe_output", "-d", makeAddresses(2))),
+          false,
+          { "-A windscribe_output -d 10.1.0.1/32 -j ACCEPT" + kComment,
+            "-A windscribe_output -d 10.1.0.2/32 -j ACCEPT" + kComment },
+          {} },
+        { "runs of two chains interleaved",
+          filterTable(addressRules("windscribe_input", "-s", { "10.1.0.1/32" }) + addressRules("windscribe_output", "-d", { "10.1.0.1/32" }) +
+                      addressRules("windscribe_input", "-s", { "10.1.0.2/32" }) + addressRules("windscribe_output", "-d", { "10.1.0.2/32" }) +
+                      addressRules("windscribe_input", "-s", { "10.1.0.3/32" }) + addressRules("windscribe_output", "-d", { "10.1.0.3/32" })),
+          false,
+          { "-A windscribe_input -m set --match-set windscribe_0 src -j ACCEPT" + kComment,
+            "-A windscribe_output -m set --match-set windscribe_1 dst -j ACCEPT" + kComment },
+          { { "10.1.0.1", "10.1.0.2", "10.1.0.3" }, { "10.1.0.1", "10.1.0.2", "10.1.0.3" } } },
+        { "inserted rule does not break the run",
+          filterTable(addressRules("windscribe_output", "-d", { "10.1.0.1/32", "10.1.0.2/32" }) + "-I OUTPUT -j windscribe_output\n" +
+                      addressRules("windscribe_output", "-d", { "10.1.0.3/32" })),
+          false,
+          { "-A windscribe_output -m set --match-set windscribe_0 dst -j ACCEPT" + kComment,
+            "-I OUTPUT -j windscribe_output" },
+          { { "10.1.0.1", "10.1.0.2", "10.1.0.3" } } },
+        { "different target breaks the run",
+          filterTable(addressRules("windscribe_output", "-d", makeAddresses(3)) +
+                      "-A windscribe_output -d 10.1.0.4/32 -j DROP\n"),
+          false,
+          { "-A windscribe_output -m set --match-set windscribe_0 dst -j ACCEPT" + kComment,
+            "-A windscribe_output -d 10.1.0.4/32 -j DROP" },
+          { { "10.1.0.1", "10.1.0.2", "10.1.0.3" } } },
+        { "negated, listed and zero prefix addresses are not moved",
+          filterTable("-A windscribe_output ! -d 10.1.0.1/32 -j ACCEPT\n-A windscribe_output ! -d 10.1.0.2/32 -j ACCEPT\n"
+                      "-A windscribe_output ! -d 10.1.0.3/32 -j ACCEPT\n"
+                      "-A windscribe_output -d 10.1.0.1,10.1.0.2 -j ACCEPT\n-A windscribe_output -d 10.1.0.3,10.1.0.4 -j ACCEPT\n"
+                      "-A windscribe_output -d 10.1.0.5,10.1.0.6 -j ACCEPT\n"
+                      "-A windscribe_output -d 0.0.0.0/0 -j ACCEPT\n-A windscribe_output -d 0.0.0.0/0 -j DROP\n"),
+          false,
+          { "-A windscribe_output ! -d 10.1.0.1/32 -j ACCEPT", "-A windscribe_output ! -d 10.1.0.2/32 -j ACCEPT",
+            "-A windscribe_output ! -d 10.1.0.3/32 -j ACCEPT",
+            "-A windscribe_output -d 10.1.0.1,10.1.0.2 -j ACCEPT", "-A windscribe_output -d 10.1.0.3,10.1.0.4 -j ACCEPT",
+            "-A windscribe_output -d 10.1.0.5,10.1.0.6 -j ACCEPT",
+            "-A windscribe_output -d 0.0.0.0/0 -j ACCEPT", "-A windscribe_output -d 0.0.0.0/0 -j DROP" },
+          {} },
+        { "ipv6 addresses",
+          "*filter\n" + addressRules("windscribe_input", "-s", { "::1/128", "fe80::/10", "2001:db8::1/128" }) + "COMMIT\n",
+          true,
+          { "-A windscribe_input -m set --match-set windscribe_0 src -j ACCEPT" + kComment },
+          { { "2001:db8::1", "::1", "fe80::/10" } } },
+        { "ipv4 addresses in the ipv6 ruleset are not moved",
+          "*filter\n" + addressRules("windscribe_input", "-s", makeAddresses(3)) + "COMMIT\n",
+          true,
+          commandLines(addressRules("windscribe_input", "-s", makeAddresses(3))),
+          {} },
+    };
+
+    for (const auto &testCase : testCases) {
+        SCOPED_TRACE(testCase.name);
+        FirewallRuleset ruleset;
+        ASSERT_TRUE(ruleset.parse(testCase.rules, testCase.ipv6));
+        const FirewallRuleset original = ruleset;
+        ruleset.moveAddressesToSets("windscribe_", 3);
+
+        EXPECT_EQ(commandLines(ruleset.toRestoreFormat()), testCase.commands);
+        ASSERT_EQ(ruleset.sets().size(), testCase.sets.size());
+        for (size_t i = 0; i < testCase.sets.size(); ++i) {
+            EXPECT_EQ(ruleset.sets()[i].name, "windscribe_" + std::to_string(i));
+            EXPECT_EQ(std::vector<std::string>(ruleset.sets()[i].addresses.begin(), ruleset.sets()[i].addresses.end()), testCase.sets[i]);
+        }
+
+        // the rules match the same as the original text, only the order within a run may change
+        std::vector<std::string> expanded = expandSets(ruleset);
+        std::vector<std::string> originalCommands = commandLines(original.toRestoreFormat());
+        std::sort(expanded.begin(), expanded.end());
+        std::sort(originalCommands.begin(), originalCommands.end());
+        EXPECT_EQ(expanded, originalCommands);
+    }
+}
+
+TEST(FirewallRuleset, HasSameRules)
+{
+    const std::string rules = filterTable("-I OUTPUT -j windscribe_output\n" + addressRules("windscribe_output", "-d", makeAddresses(4)) +
+                                          "-A windscribe_output -j DROP\n");
+    struct TestCase
+    {
+        std::string name;
+        std::string otherRules;
+        bool otherIpv6;
+        bool isSame;
+    };
+    const std::vector<TestCase> testCases = {
+        { "identical text", rules, false, true },
+        { "other addresses in the set",
+          filterTable("-I OUTPUT -j windscribe_output\n" + addressRules("windscribe_output", "-d", { "10.2.0.1/32", "10.2.0.2/32", "10.2.0.3/32" }) +
+                      "-A windscribe_output -j DROP\n"),
+          false, true },
+        { "address list too short for a set",
+          filterTable("-I OUTPUT -j windscribe_output\n" + addressRules("windscribe_output", "-d", makeAddresses(2)) +
+                      "-A windscribe_output -j DROP\n"),
+          false, false },
+        { "other target",
+          filterTable("-I OUTPUT -j windscribe_output\n" + addressRules("windscribe_output", "-d", makeAddresses(4)) +
+                      "-A windscribe_output -j REJECT\n"),
+          false, false },
+        { "appended instead of inserted",
+          filterTable("-A OUTPUT -j windscribe_output\n" + addressRules("windscribe_output", "-d", makeAddresses(4)) +
+                      "-A windscribe_output -j DROP\n"),
+          false, false },
+        { "other chains",
+          "*filter\n:windscribe_output - [0:0]\n-I OUTPUT -j windscribe_output\n" + addressRules("windscribe_output", "-d", makeAddresses(4)) +
+          "-A windscribe_output -j DROP\nCOMMIT\n",
+          false, false },
+        { "two sets instead of one",
+          filterTable("-I OUTPUT -j windscribe_output\n" + addressRules("windscribe_output", "-d", makeAddresses(4)) +
+                      "-A windscribe_output -j DROP\n" + addressRules("windscribe_input", "-s", makeAddresses(4))),
+          false, false },
+        { "other address family", rules, true, false },
+    };
+
+    FirewallRuleset ruleset;
+    ASSERT_TRUE(ruleset.parse(rules, false));
+    ruleset.moveAddressesToSets("windscribe_", 3);
+
+    for (const auto &testCase : testCases) {
+        SCOPED_TRACE(testCase.name);
+        FirewallRuleset other;
+        ASSERT_TRUE(other.parse(testCase.otherRules, testCase.otherIpv6));
+        other.moveAddressesToSets("windscribe_", 3);
+        EXPECT_EQ(ruleset.hasSameRules(other), testCase.isSame);
+        EXPECT_EQ(other.hasSameRules(ruleset), testCase.isSame);
+    }
+}
@@ -1,3 +1,4 @@
+#include <errno.h>
 #include <limits.h>
 #include <fstream>
 #include <grp.h>
@@ -9,11 +10,13 @@
 
 #include "../../../../client/common/utils/executable_signature/executable_signature.h"
 
+#define CLIENT_EXECUTABLE_PATH "/opt/windscribe/Windscribe"
+
 bool HelperSecurity::verifySignature()
 {
 #if defined(USE_SIGNATURE_CHECK)
     ExecutableSignature sigCheck;
-    bool result = sigCheck.verify("/opt/windscribe/Windscribe");
+    bool result = sigCheck.verify(CLIENT_EXECUTABLE_PATH);
 
     if (!result) {
         spdlog::warn("Signature verification failed for Windscribe: {}", sigCheck.lastError());
@@ -23,3 +26,41 @@ bool HelperSecurity::verifySignature()
     return true;
 #endif
 }
+
+bool HelperSecurity::verifySignature(ConnectionState &state)
+{
+#if defined(USE_SIGNATURE_CHECK)
+    struct stat st;
+    if (stat(CLIENT_EXECUTABLE_PATH, &st) != 0) {
+        spdlog::warn("Signature verification failed for Windscribe: stat failed ({})", errno);
+        state.isVerified = false;
+        return false;
+    }
+
+    if (state.isVerified && state.dev == st.st_dev && state.ino == st.st_ino && state.size == st.st_size &&
+        state.mtime.tv_sec == st.st_mtim.tv_sec && state.mtime.tv_nsec == st.st_mtim.tv_nsec) {
+        cacheHits_++;
+        return true;
+    }
+
+    // the file attributes are taken before the check, so a modification during the check causes another one
+    cacheMisses_++;
+    state.isVerified = verifySignature();
+    state.dev = st.st_dev;
+    state.ino = st.st_ino;
+    state.mtime = st.st_mtim;
+    state.size = st.st_size;
+    return state.isVerified;
+#else
+    (void)state;
+    return true;
+#endif
+}
+
+void HelperSecurity::logCacheStats() const
+{
+#if defined(USE_SIGNATURE_CHECK)
+    unsigned long long total = cacheHits_ + cacheMisses_;
+    spdlog::info("Signature check cache: {} hits, {} verifications, hit rate {}%", cacheHits_, cacheMisses_, total ? cacheHits_ * 100 / total : 0);
+#endif
+}
@@ -1,11 +1,23 @@
 #pragma once
 
 #include <map>
+#include <sys/stat.h>
 #include <unistd.h>
 
 class HelperSecurity
 {
 public:
+    // The result of the signature check of one client connection.
+    // The check is repeated only if the executable file has changed since the last successful one.
+    struct ConnectionState
+    {
+        bool isVerified = false;
+        dev_t dev = 0;
+        ino_t ino = 0;
+        struct timespec mtime = {};
+        off_t size = 0;
+    };
+
     static HelperSecurity &instance()
     {
         static HelperSecurity single_instance;
@@ -14,4 +26,12 @@ public:
 
     // Check if process has the correct signature.
     bool verifySignature();
+    // Same as above, but uses the cached result of the connection while the executable is unchanged.
+    bool verifySignature(ConnectionState &state);
+
+    void logCacheStats() const;
+
+private:
+    unsigned long long cacheHits_ = 0;
+    unsigned long long cacheMisses_ = 0;
 };
@@ -0,0 +1,487 @@
+#include "nftablesfirewall.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <array>
+#include <fstream>
+#include <map>
+#include <boost/algorithm/string.hpp>
+#include <spdlog/spdlog.h>
+
+#include "utils.h"
+
+namespace
+{
+
+std::string unquote(const std::string &str)
+{
+    if (str.size() >= 2 && str.front() == '"' && str.back() == '"') {
+        return str.substr(1, str.size() - 2);
+    }
+    return str;
+}
+
+void addUnique(std::vector<std::string> &list, const std::string &item)
+{
+    if (std::find(list.begin(), list.end(), item) == list.end()) {
+        list.push_back(item);
+    }
+}
+
+std::string joinAddresses(const std::set<std::string> &addresses)
+{
+    return boost::algorithm::join(addresses, ", ");
+}
+
+// an address or a network in the CIDR notation, with the host bits cleared
+struct Network
+{
+    bool ipv6;
+    int prefixLength;
+    std::array<uint8_t, 16> bytes;
+
+    std::string key() const
+    {
+        return std::string(1, ipv6 ? '6' : '4') + std::string(1, (char)prefixLength) + std::string(bytes.begin(), bytes.end());
+    }
+
+    Network masked(int length) const
+    {
+        Network network = *this;
+        network.prefixLength = length;
+        for (int i = 0; i < 16; ++i) {
+            const int bits = std::clamp(length - i * 8, 0, 8);
+            network.bytes[i] &= (uint8_t)(0xFF00 >> bits);
+        }
+        return network;
+    }
+};
+
+bool parseNetwork(const std::string &address, Network &outNetwork)
+{
+    const size_t slash = address.find('/');
+    const std::string ip = address.substr(0, slash);
+    outNetwork.ipv6 = ip.find(':') != std::string::npos;
+    outNetwork.bytes.fill(0);
+    if (inet_pton(outNetwork.ipv6 ? AF_INET6 : AF_INET, ip.c_str(), outNetwork.bytes.data()) != 1) {
+        return false;
+    }
+    const int maxLength = outNetwork.ipv6 ? 128 : 32;
+    outNetwork.prefixLength = maxLength;
+    if (slash != std::string::npos) {
+        char *end = nullptr;
+        const long length = strtol(address.c_str() + slash + 1, &end, 10);
+        if (*end != '\0' || length < 0 || length > maxLength) {
+            return false;
+        }
+        outNetwork.prefixLength = (int)length;
+    }
+    outNetwork = outNetwork.masked(outNetwork.prefixLength);
+    return true;
+}
+
+// The set elements of the addresses: without auto-merge an interval set rejects overlapping elements, so the addresses
+// within a network of the same set are left out, they match the same rules anyway. The sets are not auto-merged because
+// a merged element can't be deleted by the addresses it was merged from.
+std::set<std::string> setElements(const std::set<std::string> &addresses)
+{
+    std::map<std::string, std::string> networks;    // the first address of each network by key
+    std::set<int> prefixLengths[2];
+    std::vector<std::pair<std::string, Network>> parsed;
+    std::set<std::string> elements;
+    for (const auto &address : addresses) {
+        Network network;
+        if (!parseNetwork(address, network)) {
+            // nft reports it when the set is updated
+            elements.insert(address);
+            continue;
+        }
+        networks.emplace(network.key(), address);
+        prefixLengths[network.ipv6].insert(network.prefixLength);
+        parsed.emplace_back(address, network);
+    }
+
+    for (const auto &it : parsed) {
+        const Network &network = it.second;
+        bool isCovered = networks[network.key()] != it.first;
+        for (auto length = prefixLengths[network.ipv6].begin();
+             !isCovered && length != prefixLengths[network.ipv6].end() && *length < network.prefixLength; ++length) {
+            isCovered = networks.count(network.masked(*length).key()) != 0;
+        }
+        if (!isCovered) {
+            elements.insert(it.first);
+        }
+    }
+    return elements;
+}
+
+} // namespace
+
+NftablesFirewall::NftablesFirewall(ScriptRunner runner) : runner_(runner)
+{
+}
+
+bool NftablesFirewall::isAvailable()
+{
+    return Utils::executeCommand("nft", {"list", "tables"}) == 0;
+}
+
+bool NftablesFirewall::apply(const FirewallRuleset &ruleset, bool *outIsReloaded)
+{
+    if (outIsReloaded) {
+        *outIsReloaded = false;
+    }
+
+    Family &family = families_[ruleset.isIpv6() ? 1 : 0];
+    // the client links the built-in chains to ours only when they are not linked yet, these rules are kept separately
+    FirewallRuleset rules = ruleset;
+    const std::vector<FirewallRuleset::Command> baseCommands = rules.takeBuiltinChainCommands();
+
+    // only the address lists changed, update the set elements in place
+    if (!family.ruleset.isEmpty() && rules.hasSameRules(family.ruleset) && isActive()) {
+        bool isBaseRulesChanged = false;
+        for (const auto &command : baseCommands) {
+            std::string rule;
+            isBaseRulesChanged |= !translateRule(FirewallRuleset::splitSpec(command.spec), ruleset.isIpv6(), rule) ||
+                                  std::find(family.baseRules.begin(), family.baseRules.end(), ChainRule(command.chain, rule)) == family.baseRules.end();
+        }
+        const std::string script = setUpdateScript(family.ruleset, rules);
+        if (!isBaseRulesChanged && (script.empty() || runner_(script))) {
+            family.ruleset = rules;
+            return true;
+        }
+        if (!isBaseRulesChanged) {
+            spdlog::warn("Could not update the nftables sets, reloading the table");
+        }
+    }
+
+    Family next[2] = { families_[0], families_[1] };
+    Family &nextFamily = next[ruleset.isIpv6() ? 1 : 0];
+    nextFamily.ruleset = rules;
+    nextFamily.headRules.clear();
+    nextFamily.tailRules.clear();
+
+    for (const auto &command : baseCommands) {
+        std::string rule;
+        if (!translateRule(FirewallRuleset::splitSpec(command.spec), ruleset.isIpv6(), rule)) {
+            spdlog::error("nftables: can not translate the rule: {} {}", command.chain, command.spec);
+            return false;
+        }
+        ChainRule chainRule(command.chain, rule);
+        if (std::find(nextFamily.baseRules.begin(), nextFamily.baseRules.end(), chainRule) == nextFamily.baseRules.end()) {
+            if (command.isAppend) {
+                nextFamily.baseRules.push_back(chainRule);
+            } else {
+                nextFamily.baseRules.insert(nextFamily.baseRules.begin(), chainRule);
+            }
+        }
+    }
+
+    std::string script;
+    if (!tableScript(next, script) || !runner_(script)) {
+        return false;
+    }
+    families_[0] = next[0];
+    families_[1] = next[1];
+    if (outIsReloaded) {
+        *outIsReloaded = true;
+    }
+    return true;
+}
+
+bool NftablesFirewall::isActive()
+{
+    return !isEmpty() && runner_(std::string("list table ") + kTable + "\n");
+}
+
+void NftablesFirewall::clear()
+{
+    // adding the table first makes the delete succeed if there is no table
+    runner_(std::string("table ") + kTable + "\ndelete table " + kTable + "\n");
+    families_[0] = Family();
+    families_[1] = Family();
+}
+
+bool NftablesFirewall::addRule(bool ipv6, const std::vector<std::string> &args, bool append)
+{
+    Family &family = families_[ipv6 ? 1 : 0];
+    // as with iptables, there are no chains to add to without a ruleset
+    if (args.empty() || family.ruleset.isEmpty()) {
+        return false;
+    }
+
+    std::string rule;
+    if (!translateRule(std::vector<std::string>(args.begin() + 1, args.end()), ipv6, rule)) {
+        spdlog::error("nftables: can not translate the rule: {}", boost::algorithm::join(args, " "));
+        return false;
+    }
+    ChainRule chainRule(args[0], rule);
+    if (std::find(family.headRules.begin(), family.headRules.end(), chainRule) != family.headRules.end() ||
+        std::find(family.tailRules.begin(), family.tailRules.end(), chainRule) != family.tailRules.end()) {
+        return true;
+    }
+
+    Family next[2] = { families_[0], families_[1] };
+    Family &nextFamily = next[ipv6 ? 1 : 0];
+    if (append) {
+        nextFamily.tailRules.push_back(chainRule);
+    } else {
+        nextFamily.headRules.insert(nextFamily.headRules.begin(), chainRule);
+    }
+
+    std::string script;
+    if (!tableScript(next, script) || !runner_(script)) {
+        return false;
+    }
+    family = nextFamily;
+    return true;
+}
+
+void NftablesFirewall::removeRule(bool ipv6, const std::vector<std::string> &args)
+{
+    std::string rule;
+    if (args.empty() || !translateRule(std::vector<std::string>(args.begin() + 1, args.end()), ipv6, rule)) {
+        return;
+    }
+    ChainRule chainRule(args[0], rule);
+
+    Family next[2] = { families_[0], families_[1] };
+    Family &nextFamily = next[ipv6 ? 1 : 0];
+    const size_t count = nextFamily.headRules.size() + nextFamily.tailRules.size();
+    nextFamily.headRules.erase(std::remove(nextFamily.headRules.begin(), nextFamily.headRules.end(), chainRule), nextFamily.headRules.end());
+    nextFamily.tailRules.erase(std::remove(nextFamily.tailRules.begin(), nextFamily.tailRules.end(), chainRule), nextFamily.tailRules.end());
+    if (count == nextFamily.headRules.size() + nextFamily.tailRules.size()) {
+        return;
+    }
+
+    std::string script;
+    if (tableScript(next, script) && runner_(script)) {
+        families_[ipv6 ? 1 : 0] = nextFamily;
+    }
+}
+
+bool NftablesFirewall::translateRule(const std::vector<std::string> &args, bool ipv6, std::string &outRule)
+{
+    const std::string ipFamily = ipv6 ? "ip6" : "ip";
+    const bool hasPorts = std::any_of(args.begin(), args.end(), [](const std::string &arg) {
+        return arg == "--sport" || arg == "--dport" || arg == "--source-port" || arg == "--destination-port";
+    });
+
+    std::vector<std::string> statements = { std::string("meta nfproto ") + (ipv6 ? "ipv6" : "ipv4") };
+    std::string protocol;
+    std::string verdict;
+    std::string comment;
+    bool isNegated = false;
+    auto op = [&isNegated]() {
+        std::string result = isNegated ? "!= " : "";
+        isNegated = false;
+        return result;
+    };
+
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string &arg = args[i];
+        if (arg == "!") {
+            isNegated = true;
+            continue;
+        }
+        if (i + 1 >= args.size()) {
+            return false;
+        }
+        const std::string value = unquote(args[++i]);
+
+        if (arg == "-m") {
+            // the match extensions are implied by their options
+            continue;
+        } else if (arg == "-s" || arg == "--source") {
+            statements.push_back(ipFamily + " saddr " + op() + value);
+        } else if (arg == "-d" || arg == "--destination") {
+            statements.push_back(ipFamily + " daddr " + op() + value);
+        } else if (arg == "-i" || arg == "--in-interface") {
+            statements.push_back("iifname " + op() + "\"" + boost::algorithm::replace_all_copy(value, "+", "*") + "\"");
+        } else if (arg == "-o" || arg == "--out-interface") {
+            statements.push_back("oifname " + op() + "\"" + boost::algorithm::replace_all_copy(value, "+", "*") + "\"");
+        } else if (arg == "-p" || arg == "--protocol") {
+            protocol = value;
+            if (!hasPorts || isNegated) {
+                statements.push_back("meta l4proto " + op() + value);
+            }
+        } else if (arg == "--sport" || arg == "--source-port" || arg == "--dport" || arg == "--destination-port") {
+            if (protocol != "tcp" && protocol != "udp") {
+                return false;
+            }
+            const bool isSource = arg == "--sport" || arg == "--source-port";
+            statements.push_back(protocol + (isSource ? " sport " : " dport ") + op() + boost::algorithm::replace_all_copy(value, ":", "-"));
+        } else if (arg == "--uid-owner") {
+            statements.push_back("meta skuid " + op() + value);
+        } else if (arg == "--gid-owner") {
+            statements.push_back("meta skgid " + op() + value);
+        } else if (arg == "--mark") {
+            if (value.find('/') != std::string::npos) {
+                return false;
+            }
+            statements.push_back("meta mark " + op() + value);
+        } else if (arg == "--cgroup") {
+            statements.push_back("meta cgroup " + op() + value);
+        } else if (arg == "--match-set") {
+            if (i + 1 >= args.size() || (args[i + 1] != "src" && args[i + 1] != "dst")) {
+                return false;
+            }
+            const bool isSource = args[++i] == "src";
+            statements.push_back(ipFamily + (isSource ? " saddr " : " daddr ") + op() + "@" + value);
+        } else if (arg == "--comment") {
+            comment = value;
+        } else if (arg == "-j" || arg == "--jump") {
+            if (value == "ACCEPT" || value == "DROP" || value == "RETURN") {
+                verdict = boost::algorithm::to_lower_copy(value);
+            } else if (boost::algorithm::to_lower_copy(value) == value) {
+                // our own chains are in lower case, the upper case targets are iptables extensions
+                verdict = "jump " + value;
+            } else {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+
+    if (isNegated || verdict.empty()) {
+        return false;
+    }
+    outRule = boost::algorithm::join(statements, " ") + " " + verdict;
+    if (!comment.empty()) {
+        outRule += " comment \"" + comment + "\"";
+    }
+    return true;
+}
+
+bool NftablesFirewall::isEmpty() const
+{
+    return families_[0].ruleset.isEmpty() && families_[1].ruleset.isEmpty();
+}
+
+bool NftablesFirewall::tableScript(const Family families[2], std::string &outScript) const
+{
+    std::vector<std::string> sets;
+    std::vector<std::string> baseChains;
+    std::vector<std::string> chains;
+    std::vector<ChainRule> rules;
+
+    for (int ind = 0; ind < 2; ++ind) {
+        const Family &family = families[ind];
+        const bool ipv6 = ind == 1;
+        for (const auto &set : family.ruleset.sets()) {
+            sets.push_back("    set " + set.name + " {\n        type " + (ipv6 ? "ipv6_addr" : "ipv4_addr") +
+                           "; flags interval;\n        elements = { " + joinAddresses(setElements(set.addresses)) + " }\n    }\n");
+        }
+        for (const auto &rule : family.baseRules) {
+            addUnique(baseChains, rule.first);
+        }
+        rules.insert(rules.end(), family.headRules.begin(), family.headRules.end());
+
+        for (const auto &table : family.ruleset.tables()) {
+            if (table.name != "filter") {
+                spdlog::error("nftables: the table {} is not supported", table.name);
+                return false;
+            }
+            for (const auto &chain : table.chains) {
+                // ":name policy [packets:bytes]"
+                std::vector<std::string> parts;
+                boost::algorithm::split(parts, chain.substr(1), boost::is_any_of(" "), boost::token_compress_on);
+                if (FirewallRuleset::isBuiltinChain(parts[0])) {
+                    addUnique(baseChains, parts[0]);
+                    if (parts.size() > 1 && parts[1] == "DROP") {
+                        rules.push_back(ChainRule(parts[0] + ":policy", std::string("meta nfproto ") + (ipv6 ? "ipv6" : "ipv4") + " drop"));
+                    }
+                } else {
+                    addUnique(chains, parts[0]);
+                }
+            }
+            for (const auto &command : table.commands) {
+                std::string rule;
+                if (!translateRule(FirewallRuleset::splitSpec(command.spec), ipv6, rule)) {
+                    spdlog::error("nftables: can not translate the rule: {} {}", command.chain, command.spec);
+                    return false;
+                }
+                addUnique(chains, command.chain);
+                rules.push_back(ChainRule(command.chain, rule));
+            }
+        }
+        rules.insert(rules.end(), family.tailRules.begin(), family.tailRules.end());
+    }
+
+    std::string script = std::string("table ") + kTable + "\ndelete table " + kTable + "\ntable " + kTable + " {\n";
+    for (const auto &set : sets) {
+        script += set;
+    }
+    for (const auto &chain : baseChains) {
+        const std::string hook = boost::algorithm::to_lower_copy(chain);
+        script += "    chain " + hook + " {\n        type filter hook " + hook + " priority filter; policy accept;\n";
+        for (int ind = 0; ind < 2; ++ind) {
+            for (const auto &rule : families[ind].baseRules) {
+                if (rule.first == chain) {
+                    script += "        " + rule.second + "\n";
+                }
+            }
+        }
+        // a DROP policy of the ruleset applies to its family only
+        for (const auto &rule : rules) {
+            if (rule.first == chain + ":policy") {
+                script += "        " + rule.second + "\n";
+            }
+        }
+        script += "    }\n";
+    }
+    for (const auto &chain : chains) {
+        script += "    chain " + chain + " {\n";
+        for (const auto &rule : rules) {
+            if (rule.first == chain) {
+                script += "        " + rule.second + "\n";
+            }
+        }
+        script += "    }\n";
+    }
+    script += "}\n";
+    outScript = script;
+    return true;
+}
+
+std::string NftablesFirewall::setUpdateScript(const FirewallRuleset &from, const FirewallRuleset &to)
+{
+    std::string script;
+    for (size_t i = 0; i < to.sets().size(); ++i) {
+        // the elements in the set are exactly those of the previous ruleset, so each one can be deleted as it was added
+        const auto oldElements = setElements(from.sets()[i].addresses);
+        const auto newElements = setElements(to.sets()[i].addresses);
+        std::set<std::string> added;
+        std::set<std::string> removed;
+        std::set_difference(newElements.begin(), newElements.end(), oldElements.begin(), oldElements.end(), std::inserter(added, added.end()));
+        std::set_difference(oldElements.begin(), oldElements.end(), newElements.begin(), newElements.end(), std::inserter(removed, removed.end()));
+        // deleted first, an added network may overlap a removed one
+        if (!removed.empty()) {
+            script += std::string("delete element ") + kTable + " " + to.sets()[i].name + " { " + joinAddresses(removed) + " }\n";
+        }
+        if (!added.empty()) {
+            script += std::string("add element ") + kTable + " " + to.sets()[i].name + " { " + joinAddresses(added) + " }\n";
+        }
+    }
+    return script;
+}
+
+bool NftablesFirewall::runNft(const std::string &script)
+{
+    const std::string path = "/etc/windscribe/rules.nft";
+    std::ofstream file(path, std::ios::trunc);
+    file << script;
+    file.close();
+    if (!file) {
+        spdlog::error("Could not write nftables rules");
+        return false;
+    }
+
+    std::string output;
+    if (Utils::executeCommand("nft", {"-f", path}, &output) != 0) {
+        spdlog::error("nft failed: {}", output);
+        return false;
+    }
+    return true;
+}
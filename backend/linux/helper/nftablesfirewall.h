@@ -0,0 +1,56 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+#include "firewallruleset.h"
+
+// Programs the firewall rulesets as one nftables table of the inet family, which holds the rules of both IPv4 and IPv6.
+// The rulesets come in the iptables-restore format (see FirewallRuleset) and are translated to nftables,
+// the address lists are native sets with intervals. Every change is one nft transaction.
+class NftablesFirewall
+{
+public:
+    // runs an nft script as one transaction, replaceable for the tests
+    typedef std::function<bool(const std::string &script)> ScriptRunner;
+
+    explicit NftablesFirewall(ScriptRunner runner = runNft);
+
+    static bool isAvailable();
+
+    // Applies the ruleset of one family, the other family keeps its rules.
+    // Returns false if the ruleset can not be translated or nft failed, the table is unchanged then.
+    // outIsReloaded is set if the table was rebuilt rather than only the set elements updated.
+    bool apply(const FirewallRuleset &ruleset, bool *outIsReloaded = nullptr);
+    bool isActive();
+    void clear();
+
+    // Rules added to our chains outside of the rulesets (split tunneling), in the iptables arguments with the chain first.
+    // As with iptables, the rules are removed when the ruleset of the family is applied.
+    bool addRule(bool ipv6, const std::vector<std::string> &args, bool append);
+    void removeRule(bool ipv6, const std::vector<std::string> &args);
+
+    static bool translateRule(const std::vector<std::string> &args, bool ipv6, std::string &outRule);
+
+private:
+    typedef std::pair<std::string, std::string> ChainRule;     // chain, translated rule
+
+    struct Family
+    {
+        FirewallRuleset ruleset;
+        std::vector<ChainRule> baseRules;    // the rules of the built-in chains, kept until clear()
+        std::vector<ChainRule> headRules;    // added by addRule()
+        std::vector<ChainRule> tailRules;
+    };
+
+    static constexpr const char *kTable = "inet windscribe";
+
+    ScriptRunner runner_;
+    Family families_[2];    // IPv4, IPv6
+
+    bool isEmpty() const;
+    bool tableScript(const Family families[2], std::string &outScript) const;
+    static std::string setUpdateScript(const FirewallRuleset &from, const FirewallRuleset &to);
+    static bool runNft(const std::string &script);
+};
@@ -0,0 +1,271 @@
+// Checks that the nftables table generated from the iptables rulesets of the client is equivalent to them:
+// every rule is translated in the same order in the same chain, the address lists are in the sets,
+// and the changes of the address lists are applied as set element updates.
+// The nft scripts are captured instead of being run, so the test does not need root or nftables.
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <spdlog/spdlog.h>
+
+#include "nftablesfirewall.h"
+
+namespace {
+
+const std::string kComment = " -m comment --comment \"Windscribe client rule\"\n";
+
+// the same shape as in FirewallController_linux::firewallOnImpl()
+std::string clientRulesV4(bool isFirstTime, const std::vector<std::string> &ips)
+{
+    std::string rules = "*filter\n\n:windscribe_input - [0:0]\n\n:windscribe_output - [0:0]\n\n";
+    if (isFirstTime) {
+        rules += "-I INPUT -j windscribe_input" + kComment + "\n";
+        rules += "-I OUTPUT -j windscribe_output" + kComment + "\n";
+    }
+    rules += "-A windscribe_input -i lo -j ACCEPT" + kComment + "\n";
+    rules += "-A windscribe_output -o lo -j ACCEPT" + kComment + "\n";
+    rules += "-A windscribe_input -p udp --sport 67:68 --dport 67:68 -j ACCEPT" + kComment + "\n";
+    rules += "-A windscribe_output -d 5.6.7.8/32 -j ACCEPT -m owner ! --uid-owner 0-4294967294" + kComment + "\n";
+    rules += "-A windscribe_output -d 5.6.7.8/32 -j ACCEPT -m mark --mark 51820" + kComment + "\n";
+    for (const auto &ip : ips) {
+        const std::string network = ip.find('/') == std::string::npos ? ip + "/32" : ip;
+        rules += "-A windscribe_input -s " + network + " -j ACCEPT" + kComment + "\n";
+        rules += "-A windscribe_output -d " + network + " -j ACCEPT" + kComment + "\n";
+    }
+    rules += "-A windscribe_input -j DROP" + kComment + "\n";
+    rules += "-A windscribe_output -j DROP" + kComment + "\n";
+    return rules + "COMMIT\n";
+}
+
+std::string clientRulesV6(bool isFirstTime)
+{
+    std::string rules = "*filter\n\n:windscribe_input - [0:0]\n\n:windscribe_output - [0:0]\n\n";
+    if (isFirstTime) {
+        rules += "-A INPUT -j windscribe_input" + kComment + "\n";
+        rules += "-A OUTPUT -j windscribe_output" + kComment + "\n";
+    }
+    rules += "-A windscribe_input -s ::1/128 -j ACCEPT" + kComment + "\n";
+    rules += "-A windscribe_output -d fe80::/10 -j ACCEPT" + kComment + "\n";
+    rules += "-A windscribe_input -j DROP" + kComment + "\n";
+    rules += "-A windscribe_output -j DROP" + kComment + "\n";
+    return rules + "COMMIT\n";
+}
+
+std::vector<std::string> makeIps(int first, int count)
+{
+    std::vector<std::string> ips;
+    for (int i = first; i < first + count; ++i) {
+        ips.push_back("10.1.0." + std::to_string(i));
+    }
+    return ips;
+}
+
+FirewallRuleset parse(const std::string &rules, bool ipv6)
+{
+    FirewallRuleset ruleset;
+    EXPECT_TRUE(ruleset.parse(rules, ipv6));
+    ruleset.moveAddressesToSets(ipv6 ? "windscribe6_" : "windscribe4_", 8);
+    return ruleset;
+}
+
+} // namespace
+
+TEST(NftablesFirewall, TranslateRule)
+{
+    struct Case
+    {
+        std::vector<std::string> args;
+        bool ipv6;
+        const char *expected;
+    };
+    const std::vector<Case> cases = {
+        { { "-i", "lo", "-j", "ACCEPT" }, false, "meta nfproto ipv4 iifname \"lo\" accept" },
+        { { "-o", "tun+", "-j", "DROP" }, false, "meta nfproto ipv4 oifname \"tun*\" drop" },
+        { { "-s", "1.2.3.4/32", "-j", "ACCEPT", "-m", "comment", "--comment", "\"a comment\"" }, false,
+          "meta nfproto ipv4 ip saddr 1.2.3.4/32 accept comment \"a comment\"" },
+        { { "-d", "fe80::/10", "-j", "ACCEPT" }, true, "meta nfproto ipv6 ip6 daddr fe80::/10 accept" },
+        { { "-p", "udp", "--sport", "67:68", "--dport", "67:68", "-j", "ACCEPT" }, false,
+          "meta nfproto ipv4 udp sport 67-68 udp dport 67-68 accept" },
+        { { "-p", "tcp", "-j", "ACCEPT" }, false, "meta nfproto ipv4 meta l4proto tcp accept" },
+        { { "-m", "owner", "--gid-owner", "windscribe", "-j", "ACCEPT" }, false, "meta nfproto ipv4 meta skgid windscribe accept" },
+        { { "-m", "owner", "!", "--uid-owner", "0-4294967294", "-j", "ACCEPT" }, false,
+          "meta nfproto ipv4 meta skuid != 0-4294967294 accept" },
+        { { "-m", "mark", "--mark", "51820", "-j", "ACCEPT" }, false, "meta nfproto ipv4 meta mark 51820 accept" },
+        { { "-m", "cgroup", "--cgroup", "0x00110011", "-j", "ACCEPT" }, false, "meta nfproto ipv4 meta cgroup 0x00110011 accept" },
+        { { "-m", "set", "--match-set", "windscribe4_0", "dst", "-j", "ACCEPT" }, false, "meta nfproto ipv4 ip daddr @windscribe4_0 accept" },
+        { { "-j", "windscribe_input" }, false, "meta nfproto ipv4 jump windscribe_input" },
+    };
+    for (const auto &c : cases) {
+        std::string rule;
+        EXPECT_TRUE(NftablesFirewall::translateRule(c.args, c.ipv6, rule));
+        EXPECT_EQ(rule, c.expected);
+    }
+
+    // not expressible, the ruleset must not be half applied
+    std::string rule;
+    EXPECT_FALSE(NftablesFirewall::translateRule({ "-j", "MASQUERADE" }, false, rule));
+    EXPECT_FALSE(NftablesFirewall::translateRule({ "-m", "state", "--state", "ESTABLISHED", "-j", "ACCEPT" }, false, rule));
+    EXPECT_FALSE(NftablesFirewall::translateRule({ "-s", "1.2.3.4" }, false, rule));
+    EXPECT_FALSE(NftablesFirewall::translateRule({ "--dport", "53", "-j", "ACCEPT" }, false, rule));
+}
+
+TEST(NftablesFirewall, FirewallOn)
+{
+    std::vector<std::string> scripts;
+    NftablesFirewall firewall([&scripts](const std::string &script) {
+        scripts.push_back(script);
+        return true;
+    });
+
+    EXPECT_TRUE(firewall.apply(parse(clientRulesV4(true, makeIps(1, 8)), false)));
+    EXPECT_TRUE(firewall.apply(parse(clientRulesV6(true), true)));
+    ASSERT_EQ(scripts.size(), 2u);
+
+    // one table for both families, replaced in one transaction
+    const std::string c = " comment \"Windscribe client rule\"";
+    const std::string expected =
+        "table inet windscribe\n"
+        "delete table inet windscribe\n"
+        "table inet windscribe {\n"
+        "    set windscribe4_0 {\n"
+        "        type ipv4_addr; flags interval;\n"
+        "        elements = { 10.1.0.1, 10.1.0.2, 10.1.0.3, 10.1.0.4, 10.1.0.5, 10.1.0.6, 10.1.0.7, 10.1.0.8 }\n"
+        "    }\n"
+        "    set windscribe4_1 {\n"
+        "        type ipv4_addr; flags interval;\n"
+        "        elements = { 10.1.0.1, 10.1.0.2, 10.1.0.3, 10.1.0.4, 10.1.0.5, 10.1.0.6, 10.1.0.7, 10.1.0.8 }\n"
+        "    }\n"
+        "    chain output {\n"
+        "        type filter hook output priority filter; policy accept;\n"
+        "        meta nfproto ipv4 jump windscribe_output" + c + "\n"
+        "        meta nfproto ipv6 jump windscribe_output" + c + "\n"
+        "    }\n"
+        "    chain input {\n"
+        "        type filter hook input priority filter; policy accept;\n"
+        "        meta nfproto ipv4 jump windscribe_input" + c + "\n"
+        "        meta nfproto ipv6 jump windscribe_input" + c + "\n"
+        "    }\n"
+        "    chain windscribe_input {\n"
+        "        meta nfproto ipv4 iifname \"lo\" accept" + c + "\n"
+        "        meta nfproto ipv4 udp sport 67-68 udp dport 67-68 accept" + c + "\n"
+        "        meta nfproto ipv4 ip saddr @windscribe4_0 accept" + c + "\n"
+        "        meta nfproto ipv4 drop" + c + "\n"
+        "        meta nfproto ipv6 ip6 saddr ::1/128 accept" + c + "\n"
+        "        meta nfproto ipv6 drop" + c + "\n"
+        "    }\n"
+        "    chain windscribe_output {\n"
+        "        meta nfproto ipv4 oifname \"lo\" accept" + c + "\n"
+        "        meta nfproto ipv4 ip daddr 5.6.7.8/32 meta skuid != 0-4294967294 accept" + c + "\n"
+        "        meta nfproto ipv4 ip daddr 5.6.7.8/32 meta mark 51820 accept" + c + "\n"
+        "        meta nfproto ipv4 ip daddr @windscribe4_1 accept" + c + "\n"
+        "        meta nfproto ipv4 drop" + c + "\n"
+        "        meta nfproto ipv6 ip6 daddr fe80::/10 accept" + c + "\n"
+        "        meta nfproto ipv6 drop" + c + "\n"
+        "    }\n"
+        "}\n";
+    EXPECT_EQ(scripts[1], expected);
+
+    // the next rulesets come without the links of the built-in chains, these must stay
+    scripts.clear();
+    EXPECT_TRUE(firewall.apply(parse(clientRulesV4(false, makeIps(3, 8)), false)));
+    // the set update only: the check that the table exists and one transaction with the element changes
+    ASSERT_EQ(scripts.size(), 2u);
+    EXPECT_EQ(scripts[0], "list table inet windscribe\n");
+    EXPECT_EQ(scripts[1],
+              "delete element inet windscribe windscribe4_0 { 10.1.0.1, 10.1.0.2 }\n"
+              "add element inet windscribe windscribe4_0 { 10.1.0.10, 10.1.0.9 }\n"
+              "delete element inet windscribe windscribe4_1 { 10.1.0.1, 10.1.0.2 }\n"
+              "add element inet windscribe windscribe4_1 { 10.1.0.10, 10.1.0.9 }\n");
+
+    // a changed rule rebuilds the table, with the links of the built-in chains
+    scripts.clear();
+    bool isReloaded = false;
+    EXPECT_TRUE(firewall.apply(parse(clientRulesV4(false, makeIps(3, 2)), false), &isReloaded));
+    EXPECT_TRUE(isReloaded);
+    ASSERT_EQ(scripts.size(), 1u);
+    EXPECT_TRUE(scripts[0].find("set windscribe4_0") == std::string::npos);
+    EXPECT_TRUE(scripts[0].find("meta nfproto ipv4 jump windscribe_input") != std::string::npos);
+    EXPECT_TRUE(scripts[0].find("meta nfproto ipv4 ip saddr 10.1.0.3/32 accept") != std::string::npos);
+    EXPECT_TRUE(scripts[0].find("meta nfproto ipv6 ip6 saddr ::1/128 accept") != std::string::npos);
+
+    // firewall off
+    scripts.clear();
+    firewall.clear();
+    ASSERT_EQ(scripts.size(), 1u);
+    EXPECT_EQ(scripts[0], "table inet windscribe\ndelete table inet windscribe\n");
+    EXPECT_FALSE(firewall.isActive());
+}
+
+TEST(NftablesFirewall, OverlappingNetworks)
+{
+    std::vector<std::string> scripts;
+    NftablesFirewall firewall([&scripts](const std::string &script) {
+        scripts.push_back(script);
+        return true;
+    });
+
+    // the sets are not auto-merged, so an element must not overlap another one; the addresses within a network of the
+    // same set are left out
+    std::vector<std::string> ips = makeIps(1, 6);
+    ips.push_back("10.0.0.0/8");
+    ips.push_back("192.168.1.1");
+    EXPECT_TRUE(firewall.apply(parse(clientRulesV4(true, ips), false)));
+    ASSERT_EQ(scripts.size(), 1u);
+    EXPECT_TRUE(scripts[0].find("    set windscribe4_0 {\n        type ipv4_addr; flags interval;\n"
+                                "        elements = { 10.0.0.0/8, 192.168.1.1 }\n") != std::string::npos);
+
+    // removing the network adds the addresses it covered, each element is deleted as it was added
+    scripts.clear();
+    ips = makeIps(1, 6);
+    ips.push_back("10.2.0.0/16");
+    ips.push_back("192.168.1.1");
+    EXPECT_TRUE(firewall.apply(parse(clientRulesV4(false, ips), false)));
+    ASSERT_EQ(scripts.size(), 2u);
+    EXPECT_EQ(scripts[1],
+              "delete element inet windscribe windscribe4_0 { 10.0.0.0/8 }\n"
+              "add element inet windscribe windscribe4_0 { 10.1.0.1, 10.1.0.2, 10.1.0.3, 10.1.0.4, 10.1.0.5, 10.1.0.6, 10.2.0.0/16 }\n"
+              "delete element inet windscribe windscribe4_1 { 10.0.0.0/8 }\n"
+              "add element inet windscribe windscribe4_1 { 10.1.0.1, 10.1.0.2, 10.1.0.3, 10.1.0.4, 10.1.0.5, 10.1.0.6, 10.2.0.0/16 }\n");
+}
+
+TEST(NftablesFirewall, SplitTunnelingRules)
+{
+    std::vector<std::string> scripts;
+    NftablesFirewall firewall([&scripts](const std::string &script) {
+        scripts.push_back(script);
+        return true;
+    });
+
+    const std::vector<std::string> rule = { "windscribe_input", "-m", "cgroup", "--cgroup", "0x00110011", "-j", "ACCEPT" };
+    // no chains yet
+    EXPECT_FALSE(firewall.addRule(false, rule, false));
+    EXPECT_TRUE(scripts.empty());
+
+    EXPECT_TRUE(firewall.apply(parse(clientRulesV4(true, {}), false)));
+    EXPECT_TRUE(firewall.addRule(false, rule, false));
+    // already added, as iptables -C
+    EXPECT_TRUE(firewall.addRule(false, rule, false));
+    ASSERT_EQ(scripts.size(), 2u);
+    // inserted at the head of the chain
+    EXPECT_TRUE(scripts[1].find("    chain windscribe_input {\n        meta nfproto ipv4 meta cgroup 0x00110011 accept\n") != std::string::npos);
+
+    firewall.removeRule(false, rule);
+    ASSERT_EQ(scripts.size(), 3u);
+    EXPECT_TRUE(scripts[2].find("meta cgroup") == std::string::npos);
+}
+
+TEST(NftablesFirewall, UnsupportedRuleset)
+{
+    std::vector<std::string> scripts;
+    NftablesFirewall firewall([&scripts](const std::string &script) {
+        scripts.push_back(script);
+        return true;
+    });
+
+    FirewallRuleset ruleset;
+    EXPECT_TRUE(ruleset.parse("*nat\n-A POSTROUTING -o eth0 -j MASQUERADE\nCOMMIT\n", false));
+    EXPECT_FALSE(firewall.apply(ruleset));
+    EXPECT_TRUE(scripts.empty());
+    EXPECT_FALSE(firewall.isActive());
+}
+
@@ -6,6 +6,7 @@
 #include <sstream>
 #include <stdlib.h>
 #include <spdlog/spdlog.h>
+#include "command_runner.h"
 #include "execute_cmd.h"
 #include "firewallcontroller.h"
 #include "firewallonboot.h"
@@ -24,13 +25,16 @@ CMD_ANSWER processCommand(int cmdId, const std::string packet)
         return CMD_ANSWER();
     }
 
-    std::istringstream stream(packet);
-    boost::archive::text_iarchive ia(stream, boost::archive::no_header);
-
-    return (command->second)(ia);
+    try {
+        helper_protocol::BinaryIArchive ia(packet.data(), packet.size());
+        return (command->second)(ia);
+    } catch (const std::exception &e) {
+        spdlog::error("Incorrect data for command id {}: {}", cmdId, e.what());
+        return CMD_ANSWER();
+    }
 }
 
-CMD_ANSWER startOpenvpn(boost::archive::text_iarchive &ia)
+CMD_ANSWER startOpenvpn(helper_protocol::BinaryIArchive &ia)
 {
     CMD_ANSWER answer;
     CMD_START_OPENVPN cmd;
@@ -76,7 +80,7 @@ CMD_ANSWER startOpenvpn(boost::archive::text_iarchive &ia)
     return answer;
 }
 
-CMD_ANSWER getCmdStatus(boost::archive::text_iarchive &ia)
+CMD_ANSWER getCmdStatus(helper_protocol::BinaryIArchive &ia)
 {
     CMD_ANSWER answer;
     CMD_GET_CMD_STATUS cmd;
@@ -95,7 +99,7 @@ CMD_ANSWER getCmdStatus(boost::archive::text_iarchive &ia)
     return answer;
 }
 
-CMD_ANSWER clearCmds(boost::archive::text_iarchive &ia)
+CMD_ANSWER clearCmds(helper_protocol::BinaryIArchive &ia)
 {
     CMD_ANSWER answer;
     CMD_CLEAR_CMDS cmd;
@@ -107,7 +111,7 @@ CMD_ANSWER clearCmds(boost::archive::text_iarchive &ia)
     return answer;
 }
 
-CMD_ANSWER splitTunnelingSettings(boost::archive::text_iarchive &ia)
+CMD_ANSWER splitTunnelingSettings(helper_protocol::BinaryIArchive &ia)
 {
     CMD_ANSWER answer;
     CMD_SPLIT_TUNNELING_SETTINGS cmd;
@@ -119,7 +123,7 @@ CMD_ANSWER splitTunnelingSettings(boost::archive::text_iarchive &ia)
     return answer;
 }
 
-CMD_ANSWER sendConnectStatus(boost::archive::text_iarchive &ia)
+CMD_ANSWER sendConnectStatus(helper_protocol::BinaryIArchive &ia)
 {
     CMD_ANSWER answer;
     CMD_SEND_CONNECT_STATUS cmd;
@@ -134,7 +138,7 @@ CMD_ANSWER sendConnectStatus(boost::archive::text_iarchive &ia)
     return answer;
 }
 
-CMD_ANSWER startWireGuard(boost::archive::text_iarchive &ia)
+CMD_ANSWER startWireGuard(helper_protocol::BinaryIArchive &ia)
 {
     CMD_ANSWER answer;
 
@@ -144,7 +148,7 @@ CMD_ANSWER startWireGuard(boost::archive::text_iarchive &ia)
     return answer;
 }
 
-CMD_ANSWER stopWireGuard(boost::archive::text_iarchive &ia)
+CMD_ANSWER stopWireGuard(helper_protocol::BinaryIArchive &ia)
 {
     CMD_ANSWER answer;
     if (WireGuardController::instance().stop()) {
@@ -153,7 +157,7 @@ CMD_ANSWER stopWireGuard(boost::archive::text_iarchive &ia)
     return answer;
 }
 
-CMD_ANSWER configureWireGuard(boost::archive::text_iarchive &ia)
+CMD_ANSWER configureWireGuard(helper_protocol::BinaryIArchive &ia)
 {
     CMD_ANSWER answer;
     CMD_CONFIGURE_WIREGUARD cmd;
@@ -202,14 +206,25 @@ CMD_ANSWER configureWireGuard(boost::archive::text_iarchive &ia)
     return answer;
 }
 
-CMD_ANSWER getWireGuardStatus(boost::archive::text_iarchive &ia)
+CMD_ANSWER getWireGuardStatus(helper_protocol::BinaryIArchive &ia)
+{
+    return currentWireGuardStatus();
+}
+
+CMD_ANSWER currentWireGuardStatus()
 {
-    CMD_ANSWER answer;
     unsigned int errorCode = 0;
     unsigned long long bytesReceived = 0, bytesTransmitted = 0;
+    const unsigned long state = WireGuardController::instance().getStatus(&errorCode, &bytesReceived, &bytesTransmitted);
+    return wireGuardStatusAnswer(state, errorCode, bytesReceived, bytesTransmitted);
+}
 
+CMD_ANSWER wireGuardStatusAnswer(unsigned long state, unsigned int errorCode, unsigned long long bytesReceived,
+                                 unsigned long long bytesTransmitted)
+{
+    CMD_ANSWER answer;
     answer.executed = 1;
-    answer.cmdId = WireGuardController::instance().getStatus(&errorCode, &bytesReceived, &bytesTransmitted);
+    answer.cmdId = state;
     if (answer.cmdId == kWgStateError) {
         if (errorCode) {
             answer.customInfoValue[0] = errorCode;
@@ -223,7 +238,7 @@ CMD_ANSWER getWireGuardStatus(boost::archive::text_iarchive &ia)
     return answer;
 }
 
-CMD_ANSWER changeMtu(boost::archive::text_iarchive &ia)
+CMD_ANSWER changeMtu(helper_protocol::BinaryIArchive &ia)
 {
     CMD_ANSWER answer;
     CMD_CHANGE_MTU cmd;
@@ -235,7 +250,7 @@ CMD_ANSWER changeMtu(boost::archive::text_iarchive &ia)
     return answer;
 }
 
-CMD_ANSWER setDnsLeakProtectEnabled(boost::archive::text_iarchive &ia)
+CMD_ANSWER setDnsLeakProtectEnabled(helper_protocol::BinaryIArchive &ia)
 {
     CMD_ANSWER answer;
     CMD_SET_DNS_LEAK_PROTECT_ENABLED cmd;
@@ -250,7 +265,7 @@ CMD_ANSWER setDnsLeakProtectEnabled(boost::archive::text_iarchive &ia)
     return answer;
 }
 
-CMD_ANSWER clearFirewallRules(boost::archive::text_iarchive &ia)
+CMD_ANSWER clearFirewallRules(helper_protocol::BinaryIArchive &ia)
 {
     CMD_ANSWER answer;
     CMD_CLEAR_FIREWALL_RULES cmd;
@@ -261,7 +276,7 @@ CMD_ANSWER clearFirewallRules(boost::archive::text_iarchive &ia)
     return answer;
 }
 
-CMD_ANSWER checkFirewallState(boost::archive::text_iarchive &ia)
+CMD_ANSWER checkFirewallState(helper_protocol::BinaryIArchive &ia)
 {
     CMD_ANSWER answer;
     CMD_CHECK_FIREWALL_STATE cmd;
@@ -272,7 +287,7 @@ CMD_ANSWER checkFirewallState(boost::archive::text_iarchive &ia)
     return answer;
 }
 
-CMD_ANSWER setFirewallRules(boost::archive::text_iarchive &ia)
+CMD_ANSWER setFirewallRules(helper_protocol::BinaryIArchive &ia)
 {
     CMD_ANSWER answer;
     CMD_SET_FIREWALL_RULES cmd;
@@ -285,7 +300,7 @@ CMD_ANSWER setFirewallRules(boost::archive::text_iarchive &ia)
     return answer;
 }
 
-CMD_ANSWER getFirewallRules(boost::archive::text_iarchive &ia)
+CMD_ANSWER getFirewallRules(helper_protocol::BinaryIArchive &ia)
 {
     CMD_ANSWER answer;
     CMD_GET_FIREWALL_RULES cmd;
@@ -296,7 +311,7 @@ CMD_ANSWER getFirewallRules(boost::archive::text_iarchive &ia)
     return answer;
 }
 
-CMD_ANSWER setFirewallOnBoot(boost::archive::text_iarchive &ia)
+CMD_ANSWER setFirewallOnBoot(helper_protocol::BinaryIArchive &ia)
 {
     CMD_ANSWER answer;
     CMD_SET_FIREWALL_ON_BOOT cmd;
@@ -309,7 +324,7 @@ CMD_ANSWER setFirewallOnBoot(boost::archive::text_iarchive &ia)
     return answer;
 }
 
-CMD_ANSWER setMacAddress(boost::archive::text_iarchive &ia)
+CMD_ANSWER setMacAddress(helper_protocol::BinaryIArchive &ia)
 {
     CMD_ANSWER answer;
     CMD_SET_MAC_ADDRESS cmd;
@@ -346,7 +361,7 @@ CMD_ANSWER setMacAddress(boost::archive::text_iarchive &ia)
     return answer;
 }
 
-CMD_ANSWER taskKill(boost::archive::text_iarchive &ia)
+CMD_ANSWER taskKill(helper_protocol::BinaryIArchive &ia)
 {
     CMD_ANSWER answer;
     CMD_TASK_KILL cmd;
@@ -360,9 +375,11 @@ CMD_ANSWER taskKill(boost::archive::text_iarchive &ia)
     } else if (cmd.target == kTargetOpenVpn) {
         spdlog::info("Killing OpenVPN processes");
         const std::vector<std::string> exes = Utils::getOpenVpnExeNames();
-        for (auto exe : exes) {
-            Utils::executeCommand("pkill", {"-f", exe.c_str()});
+        std::vector<CommandRunner::Command> commands(exes.size());
+        for (size_t i = 0; i < exes.size(); ++i) {
+            commands[i].argv = {"pkill", "-f", exes[i]};
         }
+        CommandRunner::instance().runParallel(commands);
         answer.executed = 1;
     } else if (cmd.target == kTargetStunnel) {
         spdlog::info("Killing Stunnel processes");
@@ -388,7 +405,7 @@ CMD_ANSWER taskKill(boost::archive::text_iarchive &ia)
     return answer;
 }
 
-CMD_ANSWER startCtrld(boost::archive::text_iarchive &ia)
+CMD_ANSWER startCtrld(helper_protocol::BinaryIArchive &ia)
 {
     CMD_ANSWER answer;
     CMD_START_CTRLD cmd;
@@ -450,7 +467,7 @@ CMD_ANSWER startCtrld(boost::archive::text_iarchive &ia)
     return answer;
 }
 
-CMD_ANSWER startStunnel(boost::archive::text_iarchive &ia)
+CMD_ANSWER startStunnel(helper_protocol::BinaryIArchive &ia)
 {
     CMD_ANSWER answer;
     CMD_START_STUNNEL cmd;
@@ -490,7 +507,7 @@ CMD_ANSWER startStunnel(boost::archive::text_iarchive &ia)
     return answer;
 }
 
-CMD_ANSWER startWstunnel(boost::archive::text_iarchive &ia)
+CMD_ANSWER startWstunnel(helper_protocol::BinaryIArchive &ia)
 {
     CMD_ANSWER answer;
     CMD_START_WSTUNNEL cmd;
@@ -526,7 +543,7 @@ CMD_ANSWER startWstunnel(boost::archive::text_iarchive &ia)
     return answer;
 }
 
-CMD_ANSWER resetMacAddresses(boost::archive::text_iarchive &ia)
+CMD_ANSWER resetMacAddresses(helper_protocol::BinaryIArchive &ia)
 {
     CMD_ANSWER answer;
     CMD_RESET_MAC_ADDRESSES cmd;
@@ -1,38 +1,37 @@
 #pragma once
 
-#include <boost/archive/text_oarchive.hpp>
-#include <boost/archive/text_iarchive.hpp>
-#include <boost/serialization/vector.hpp>
+#include <functional>
 #include <map>
 #include <string>
 
 #include "helper_commands.h"
 #include "helper_commands_serialize.h"
+#include "helper_protocol.h"
 
-CMD_ANSWER startOpenvpn(boost::archive::text_iarchive &ia);
-CMD_ANSWER getCmdStatus(boost::archive::text_iarchive &ia);
-CMD_ANSWER clearCmds(boost::archive::text_iarchive &ia);
-CMD_ANSWER splitTunnelingSettings(boost::archive::text_iarchive &ia);
-CMD_ANSWER sendConnectStatus(boost::archive::text_iarchive &ia);
-CMD_ANSWER startWireGuard(boost::archive::text_iarchive &ia);
-CMD_ANSWER stopWireGuard(boost::archive::text_iarchive &ia);
-CMD_ANSWER configureWireGuard(boost::archive::text_iarchive &ia);
-CMD_ANSWER getWireGuardStatus(boost::archive::text_iarchive &ia);
-CMD_ANSWER changeMtu(boost::archive::text_iarchive &ia);
-CMD_ANSWER setDnsLeakProtectEnabled(boost::archive::text_iarchive &ia);
-CMD_ANSWER clearFirewallRules(boost::archive::text_iarchive &ia);
-CMD_ANSWER checkFirewallState(boost::archive::text_iarchive &ia);
-CMD_ANSWER setFirewallRules(boost::archive::text_iarchive &ia);
-CMD_ANSWER getFirewallRules(boost::archive::text_iarchive &ia);
-CMD_ANSWER setFirewallOnBoot(boost::archive::text_iarchive &ia);
-CMD_ANSWER setMacAddress(boost::archive::text_iarchive &ia);
-CMD_ANSWER taskKill(boost::archive::text_iarchive &ia);
-CMD_ANSWER startCtrld(boost::archive::text_iarchive &ia);
-CMD_ANSWER startStunnel(boost::archive::text_iarchive &ia);
-CMD_ANSWER startWstunnel(boost::archive::text_iarchive &ia);
-CMD_ANSWER resetMacAddresses(boost::archive::text_iarchive &ia);
+CMD_ANSWER startOpenvpn(helper_protocol::BinaryIArchive &ia);
+CMD_ANSWER getCmdStatus(helper_protocol::BinaryIArchive &ia);
+CMD_ANSWER clearCmds(helper_protocol::BinaryIArchive &ia);
+CMD_ANSWER splitTunnelingSettings(helper_protocol::BinaryIArchive &ia);
+CMD_ANSWER sendConnectStatus(helper_protocol::BinaryIArchive &ia);
+CMD_ANSWER startWireGuard(helper_protocol::BinaryIArchive &ia);
+CMD_ANSWER stopWireGuard(helper_protocol::BinaryIArchive &ia);
+CMD_ANSWER configureWireGuard(helper_protocol::BinaryIArchive &ia);
+CMD_ANSWER getWireGuardStatus(helper_protocol::BinaryIArchive &ia);
+CMD_ANSWER changeMtu(helper_protocol::BinaryIArchive &ia);
+CMD_ANSWER setDnsLeakProtectEnabled(helper_protocol::BinaryIArchive &ia);
+CMD_ANSWER clearFirewallRules(helper_protocol::BinaryIArchive &ia);
+CMD_ANSWER checkFirewallState(helper_protocol::BinaryIArchive &ia);
+CMD_ANSWER setFirewallRules(helper_protocol::BinaryIArchive &ia);
+CMD_ANSWER getFirewallRules(helper_protocol::BinaryIArchive &ia);
+CMD_ANSWER setFirewallOnBoot(helper_protocol::BinaryIArchive &ia);
+CMD_ANSWER setMacAddress(helper_protocol::BinaryIArchive &ia);
+CMD_ANSWER taskKill(helper_protocol::BinaryIArchive &ia);
+CMD_ANSWER startCtrld(helper_protocol::BinaryIArchive &ia);
+CMD_ANSWER startStunnel(helper_protocol::BinaryIArchive &ia);
+CMD_ANSWER startWstunnel(helper_protocol::BinaryIArchive &ia);
+CMD_ANSWER resetMacAddresses(helper_protocol::BinaryIArchive &ia);
 
-static const std::map<const int, std::function<CMD_ANSWER(boost::archive::text_iarchive &)>> kCommands = {
+static const std::map<const int, std::function<CMD_ANSWER(helper_protocol::BinaryIArchive &)>> kCommands = {
     { HELPER_CMD_START_OPENVPN, startOpenvpn },
     { HELPER_CMD_GET_CMD_STATUS, getCmdStatus },
     { HELPER_CMD_CLEAR_CMDS, clearCmds },
@@ -58,3 +57,8 @@ static const std::map<const int, std::function<CMD_ANSWER(boost::archive::text_i
 };
 
 CMD_ANSWER processCommand(int cmdId, const std::string packet);
+// the answer for HELPER_CMD_GET_WIREGUARD_STATUS
+CMD_ANSWER currentWireGuardStatus();
+// the same for the status given by WireGuardController::getStatus()
+CMD_ANSWER wireGuardStatusAnswer(unsigned long state, unsigned int errorCode, unsigned long long bytesReceived,
+                                 unsigned long long bytesTransmitted);
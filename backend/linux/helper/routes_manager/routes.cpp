@@ -1,6 +1,7 @@
 #include "routes.h"
+#include <cstdlib>
 #include <spdlog/spdlog.h>
-#include "../utils.h"
+#include "rtnetlink.h"
 
 void Routes::add(const std::string &ip, const std::string &gateway, const std::string &mask)
 {
@@ -10,9 +11,9 @@ void Routes::add(const std::string &ip, const std::string &gateway, const std::s
     rd.mask = mask;
     routes_.push_back(rd);
 
-    std::string cmd = "ip route add " + ip + "/" + mask + " via " + gateway;
-    spdlog::info("execute: {}", cmd);
-    Utils::executeCommand(cmd);
+    RtNetlink::Route route = toRoute(rd);
+    spdlog::info("add route: {}", route.toString());
+    RtNetlink().addRoute(route);
 }
 
 void Routes::addWithInterface(const std::string &ip, const std::string &interface, const std::string &mask)
@@ -23,28 +24,34 @@ void Routes::addWithInterface(const std::string &ip, const std::string &interfac
     rd.mask = mask;
     routes_.push_back(rd);
 
-    std::string cmd = "ip route add " + ip + "/" + mask + " dev " + interface;
-    spdlog::info("execute: {}", cmd);
-    Utils::executeCommand(cmd);
+    RtNetlink::Route route = toRoute(rd);
+    spdlog::info("add route: {}", route.toString());
+    RtNetlink().addRoute(route);
 }
 
 
 void Routes::clear()
 {
-    for(auto const& rd: routes_)
-    {
-        if (rd.interface.empty())
-        {
-            std::string cmd = "ip route delete " + rd.ip + "/" + rd.mask + " via " + rd.gateway;
-            spdlog::info("execute: {}", cmd);
-            Utils::executeCommand(cmd);
-        }
-        else
-        {
-            std::string cmd = "ip route delete " + rd.ip + "/" + rd.mask + " dev " + rd.interface;
-            spdlog::info("execute: {}", cmd);
-            Utils::executeCommand(cmd);
-        }
+    if (routes_.empty()) {
+        return;
     }
+
+    // delete all the routes in one batch
+    std::vector<RtNetlink::Route> routes;
+    for (auto const& rd: routes_) {
+        routes.push_back(toRoute(rd));
+        spdlog::info("delete route: {}", routes.back().toString());
+    }
+    RtNetlink().removeRoutes(routes);
     routes_.clear();
 }
+
+RtNetlink::Route Routes::toRoute(const RouteDescr &rd)
+{
+    RtNetlink::Route route;
+    route.dst = rd.ip;
+    route.prefixLength = std::atoi(rd.mask.c_str());
+    route.gateway = rd.gateway;
+    route.interface = rd.interface;
+    return route;
+}
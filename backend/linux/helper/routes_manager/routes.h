@@ -2,9 +2,9 @@
 
 #include <string>
 #include <vector>
+#include "rtnetlink.h"
 
-
-// helper for add and clear routes via system "route" command
+// helper for add and clear routes via rtnetlink
 class Routes
 {
 public:
@@ -22,4 +22,6 @@ private:
     };
 
     std::vector<RouteDescr> routes_;
+
+    static RtNetlink::Route toRoute(const RouteDescr &rd);
 };
@@ -0,0 +1,340 @@
+#include "rtnetlink.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <net/if.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <linux/netlink.h>
+#include <spdlog/spdlog.h>
+
+#ifndef NETLINK_CAP_ACK
+#define NETLINK_CAP_ACK 10
+#endif
+
+namespace {
+
+struct RouteRequest
+{
+    nlmsghdr header;
+    rtmsg msg;
+    char attrs[128];
+};
+
+void addAttr(nlmsghdr *header, unsigned short type, const void *data, size_t size)
+{
+    rtattr *attr = reinterpret_cast<rtattr *>(reinterpret_cast<char *>(header) + NLMSG_ALIGN(header->nlmsg_len));
+    attr->rta_type = type;
+    attr->rta_len = RTA_LENGTH(size);
+    memcpy(RTA_DATA(attr), data, size);
+    header->nlmsg_len = NLMSG_ALIGN(header->nlmsg_len) + RTA_ALIGN(attr->rta_len);
+}
+
+uint32_t prefixMask(int prefixLength)
+{
+    return prefixLength <= 0 ? 0 : htonl(~0u << (32 - prefixLength));
+}
+
+} // namespace
+
+bool RtNetlink::Route::matches(const Route &other) const
+{
+    return dst == other.dst && prefixLength == other.prefixLength && table == other.table &&
+           (gateway.empty() || gateway == other.gateway) && (interface.empty() || interface == other.interface);
+}
+
+bool RtNetlink::Route::contains(const Route &other) const
+{
+    in_addr a, b;
+    if (prefixLength > other.prefixLength || inet_pton(AF_INET, dst.c_str(), &a) != 1 || inet_pton(AF_INET, other.dst.c_str(), &b) != 1) {
+        return false;
+    }
+    return (a.s_addr & prefixMask(prefixLength)) == (b.s_addr & prefixMask(prefixLength));
+}
+
+std::string RtNetlink::Route::toString() const
+{
+    std::string str = dst + "/" + std::to_string(prefixLength);
+    if (!gateway.empty()) {
+        str += " via " + gateway;
+    }
+    if (!interface.empty()) {
+        str += " dev " + interface;
+    }
+    if (table != RT_TABLE_MAIN) {
+        str += " table " + std::to_string(table);
+    }
+    return str;
+}
+
+RtNetlink::RtNetlink() : seq_((uint32_t)time(nullptr))
+{
+    socket_ = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (socket_ < 0) {
+        spdlog::error("RtNetlink: socket() failed ({})", errno);
+        return;
+    }
+
+    sockaddr_nl addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    if (bind(socket_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+        spdlog::error("RtNetlink: bind() failed ({})", errno);
+        close(socket_);
+        socket_ = -1;
+        return;
+    }
+
+    // the acks do not need to repeat the requests
+    int one = 1;
+    setsockopt(socket_, SOL_NETLINK, NETLINK_CAP_ACK, &one, sizeof(one));
+    timeval tv = { kReceiveTimeoutMs / 1000, (kReceiveTimeoutMs % 1000) * 1000 };
+    setsockopt(socket_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+}
+
+RtNetlink::~RtNetlink()
+{
+    if (socket_ >= 0) {
+        close(socket_);
+    }
+}
+
+int RtNetlink::addRoutes(const std::vector<Route> &routes)
+{
+    return modifyRoutes(routes, true);
+}
+
+int RtNetlink::removeRoutes(const std::vector<Route> &routes)
+{
+    return modifyRoutes(routes, false);
+}
+
+int RtNetlink::modifyRoutes(const std::vector<Route> &routes, bool isAdd)
+{
+    if (socket_ < 0) {
+        return (int)routes.size();
+    }
+
+    int failed = 0;
+    for (size_t begin = 0; begin < routes.size(); begin += kMaxBatchSize) {
+        failed += sendBatch(routes, begin, std::min(routes.size(), begin + kMaxBatchSize), isAdd);
+    }
+    return failed;
+}
+
+int RtNetlink::sendBatch(const std::vector<Route> &routes, size_t begin, size_t end, bool isAdd)
+{
+    const uint32_t firstSeq = seq_;
+    std::vector<bool> isAcked(end - begin, false);
+    int failed = 0;
+
+    std::string batch;
+    for (size_t i = begin; i < end; ++i) {
+        if (!buildRouteMessage(routes[i], isAdd, seq_++, batch)) {
+            spdlog::error("RtNetlink: incorrect route {}", routes[i].toString());
+            isAcked[i - begin] = true;
+            failed++;
+        }
+    }
+    if (batch.empty()) {
+        return failed;
+    }
+
+    sockaddr_nl kernel;
+    memset(&kernel, 0, sizeof(kernel));
+    kernel.nl_family = AF_NETLINK;
+    if (sendto(socket_, batch.data(), batch.size(), 0, reinterpret_cast<sockaddr *>(&kernel), sizeof(kernel)) < 0) {
+        spdlog::error("RtNetlink: sendto() failed ({})", errno);
+        return (int)(end - begin);
+    }
+
+    // every request is answered with an NLMSG_ERROR message, the error is 0 on success
+    size_t pending = std::count(isAcked.begin(), isAcked.end(), false);
+    char buf[16384];
+    while (pending > 0) {
+        ssize_t len = recv(socket_, buf, sizeof(buf), 0);
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            spdlog::error("RtNetlink: recv() failed ({}), {} requests are not acknowledged", errno, pending);
+            return failed + (int)pending;
+        }
+
+        for (nlmsghdr *header = reinterpret_cast<nlmsghdr *>(buf); NLMSG_OK(header, len); header = NLMSG_NEXT(header, len)) {
+            if (header->nlmsg_type != NLMSG_ERROR || header->nlmsg_seq - firstSeq >= isAcked.size()) {
+                continue;
+            }
+            const size_t ind = header->nlmsg_seq - firstSeq;
+            if (isAcked[ind]) {
+                continue;
+            }
+            isAcked[ind] = true;
+            pending--;
+
+            const int error = -reinterpret_cast<const nlmsgerr *>(NLMSG_DATA(header))->error;
+            if (error == 0 || (isAdd && error == EEXIST) || (!isAdd && error == ESRCH)) {
+                continue;
+            }
+            spdlog::error("RtNetlink: {} route {} failed: {}", isAdd ? "add" : "delete", routes[begin + ind].toString(), strerror(error));
+            failed++;
+        }
+    }
+    return failed;
+}
+
+bool RtNetlink::buildRouteMessage(const Route &route, bool isAdd, uint32_t seq, std::string &out) const
+{
+    RouteRequest req;
+    memset(&req, 0, sizeof(req));
+    req.header.nlmsg_len = NLMSG_LENGTH(sizeof(rtmsg));
+    req.header.nlmsg_type = isAdd ? RTM_NEWROUTE : RTM_DELROUTE;
+    req.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK | (isAdd ? NLM_F_CREATE | NLM_F_EXCL : 0);
+    req.header.nlmsg_seq = seq;
+
+    // the same fields as "ip route add/del" sets
+    req.msg.rtm_family = AF_INET;
+    req.msg.rtm_dst_len = route.prefixLength;
+    req.msg.rtm_table = route.table < 256 ? route.table : RT_TABLE_UNSPEC;
+    if (isAdd) {
+        req.msg.rtm_protocol = RTPROT_BOOT;
+        req.msg.rtm_scope = route.gateway.empty() ? RT_SCOPE_LINK : RT_SCOPE_UNIVERSE;
+        req.msg.rtm_type = RTN_UNICAST;
+    } else {
+        req.msg.rtm_scope = RT_SCOPE_NOWHERE;
+    }
+
+    in_addr addr;
+    if (route.prefixLength < 0 || route.prefixLength > 32 || inet_pton(AF_INET, route.dst.c_str(), &addr) != 1) {
+        return false;
+    }
+    if (route.prefixLength > 0) {
+        addr.s_addr &= prefixMask(route.prefixLength);
+        addAttr(&req.header, RTA_DST, &addr, sizeof(addr));
+    }
+    if (!route.gateway.empty()) {
+        if (inet_pton(AF_INET, route.gateway.c_str(), &addr) != 1) {
+            return false;
+        }
+        addAttr(&req.header, RTA_GATEWAY, &addr, sizeof(addr));
+    }
+    if (!route.interface.empty()) {
+        int index = if_nametoindex(route.interface.c_str());
+        if (index == 0) {
+            return false;
+        }
+        addAttr(&req.header, RTA_OIF, &index, sizeof(index));
+    }
+    uint32_t table = route.table;
+    addAttr(&req.header, RTA_TABLE, &table, sizeof(table));
+
+    out.append(reinterpret_cast<const char *>(&req), NLMSG_ALIGN(req.header.nlmsg_len));
+    return true;
+}
+
+bool RtNetlink::dumpRoutes(std::vector<Route> &outRoutes, uint32_t table)
+{
+    outRoutes.clear();
+    if (socket_ < 0) {
+        return false;
+    }
+
+    struct {
+        nlmsghdr header;
+        rtmsg msg;
+    } req;
+    memset(&req, 0, sizeof(req));
+    req.header.nlmsg_len = NLMSG_LENGTH(sizeof(rtmsg));
+    req.header.nlmsg_type = RTM_GETROUTE;
+    req.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.header.nlmsg_seq = ++seq_;
+    req.msg.rtm_family = AF_INET;
+
+    if (send(socket_, &req, req.header.nlmsg_len, 0) < 0) {
+        spdlog::error("RtNetlink: send() failed ({})", errno);
+        return false;
+    }
+
+    char buf[32768];
+    while (true) {
+        ssize_t len = recv(socket_, buf, sizeof(buf), 0);
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            spdlog::error("RtNetlink: recv() failed ({})", errno);
+            return false;
+        }
+
+        for (nlmsghdr *header = reinterpret_cast<nlmsghdr *>(buf); NLMSG_OK(header, len); header = NLMSG_NEXT(header, len)) {
+            if (header->nlmsg_seq != req.header.nlmsg_seq) {
+                continue;
+            }
+            if (header->nlmsg_type == NLMSG_DONE) {
+                return true;
+            }
+            if (header->nlmsg_type == NLMSG_ERROR) {
+                spdlog::error("RtNetlink: route dump failed: {}", strerror(-reinterpret_cast<const nlmsgerr *>(NLMSG_DATA(header))->error));
+                return false;
+            }
+            if (header->nlmsg_type != RTM_NEWROUTE) {
+                continue;
+            }
+
+            const rtmsg *msg = reinterpret_cast<const rtmsg *>(NLMSG_DATA(header));
+            if (msg->rtm_family != AF_INET || msg->rtm_type != RTN_UNICAST) {
+                continue;
+            }
+
+            Route route;
+            route.dst = "0.0.0.0";
+            route.prefixLength = msg->rtm_dst_len;
+            route.table = msg->rtm_table;
+            char str[INET_ADDRSTRLEN];
+            int attrLen = RTM_PAYLOAD(header);
+            for (const rtattr *attr = RTM_RTA(msg); RTA_OK(attr, attrLen); attr = RTA_NEXT(attr, attrLen)) {
+                switch (attr->rta_type) {
+                case RTA_TABLE:
+                    route.table = *reinterpret_cast<const uint32_t *>(RTA_DATA(attr));
+                    break;
+                case RTA_DST:
+                    route.dst = inet_ntop(AF_INET, RTA_DATA(attr), str, sizeof(str));
+                    break;
+                case RTA_GATEWAY:
+                    route.gateway = inet_ntop(AF_INET, RTA_DATA(attr), str, sizeof(str));
+                    break;
+                case RTA_OIF: {
+                    char name[IF_NAMESIZE];
+                    if (if_indextoname(*reinterpret_cast<const int *>(RTA_DATA(attr)), name)) {
+                        route.interface = name;
+                    }
+                    break;
+                }
+                default:
+                    break;
+                }
+            }
+            if (route.table == table) {
+                outRoutes.push_back(route);
+            }
+        }
+    }
+}
+
+bool RtNetlink::parseRoute(const std::string &str, Route &outRoute)
+{
+    const size_t slash = str.find('/');
+    outRoute.dst = str.substr(0, slash);
+    outRoute.prefixLength = 32;
+    if (slash != std::string::npos) {
+        try {
+            outRoute.prefixLength = std::stoi(str.substr(slash + 1));
+        } catch (...) {
+            return false;
+        }
+    }
+    in_addr addr;
+    return outRoute.prefixLength >= 0 && outRoute.prefixLength <= 32 && inet_pton(AF_INET, outRoute.dst.c_str(), &addr) == 1;
+}
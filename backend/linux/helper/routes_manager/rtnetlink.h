@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <linux/rtnetlink.h>
+
+// Minimal rtnetlink client for the IPv4 routes, used instead of the "ip route" subprocesses.
+// The changes are sent in batches, many requests per sendmsg(), and each request is acknowledged by the kernel.
+// Not thread safe, intended to be created for a batch of operations.
+class RtNetlink
+{
+public:
+    struct Route
+    {
+        std::string dst;            // network address, "0.0.0.0" for the default route
+        int prefixLength = 32;
+        std::string gateway;        // optional
+        std::string interface;      // optional
+        uint32_t table = RT_TABLE_MAIN;
+
+        // empty gateway/interface of this route match any
+        bool matches(const Route &other) const;
+        // true if the network of this route contains the network of other
+        bool contains(const Route &other) const;
+        std::string toString() const;
+    };
+
+    RtNetlink();
+    ~RtNetlink();
+
+    // Return the number of failed routes, the errors are logged.
+    // An already existing route is not a failure for add, a missing one is not a failure for remove.
+    int addRoutes(const std::vector<Route> &routes);
+    int removeRoutes(const std::vector<Route> &routes);
+    bool addRoute(const Route &route) { return addRoutes({ route }) == 0; }
+    bool removeRoute(const Route &route) { return removeRoutes({ route }) == 0; }
+
+    // the unicast IPv4 routes of the table, in one dump request
+    bool dumpRoutes(std::vector<Route> &outRoutes, uint32_t table = RT_TABLE_MAIN);
+
+    // parses "1.2.3.4" (prefix 32) or "1.2.3.0/24"
+    static bool parseRoute(const std::string &str, Route &outRoute);
+
+private:
+    // keeps a batch well below the default socket buffer sizes
+    static constexpr size_t kMaxBatchSize = 128;
+    static constexpr int kReceiveTimeoutMs = 2000;
+
+    int socket_;
+    uint32_t seq_;
+
+    int modifyRoutes(const std::vector<Route> &routes, bool isAdd);
+    int sendBatch(const std::vector<Route> &routes, size_t begin, size_t end, bool isAdd);
+    bool buildRouteMessage(const Route &route, bool isAdd, uint32_t seq, std::string &out) const;
+};
@@ -1,9 +1,7 @@
 #include "server.h"
 
+#include <algorithm>
 #include <boost/bind.hpp>
-#include <boost/archive/text_oarchive.hpp>
-#include <boost/archive/text_iarchive.hpp>
-#include <boost/serialization/vector.hpp>
 #include <codecvt>
 #include <grp.h>
 #include <stdlib.h>
@@ -15,8 +13,10 @@
 #include <unistd.h>
 #include <spdlog/spdlog.h>
 
+#include "command_runner.h"
 #include "execute_cmd.h"
 #include "firewallcontroller.h"
+#include "helper_protocol.h"
 #include "ipc/helper_security.h"
 #include "ovpn.h"
 #include "process_command.h"
@@ -25,7 +25,7 @@
 
 #define SOCK_PATH "/var/run/windscribe/helper.sock"
 
-Server::Server()
+Server::Server() : wireGuardStatsPublisher_(service_), wireGuardStatusWaitCancelRequestId_(0)
 {
     acceptor_ = NULL;
 }
@@ -41,28 +41,14 @@ Server::~Server()
     unlink(SOCK_PATH);
 }
 
-bool Server::readAndHandleCommand(socket_ptr sock, boost::asio::streambuf *buf, CMD_ANSWER &outCmdAnswer)
+helper_protocol::FrameStatus Server::readAndHandleCommand(socket_ptr sock, boost::asio::streambuf *buf, HelperSecurity::ConnectionState &securityState,
+                                                          std::string &outAnswers)
 {
-    // not enough data for read command
-    if (buf->size() < sizeof(int)*3) {
-        return false;
-    }
-
     const char *bufPtr = boost::asio::buffer_cast<const char*>(buf->data());
-    size_t headerSize = 0;
-    int cmdId;
-    memcpy(&cmdId, bufPtr + headerSize, sizeof(cmdId));
-    headerSize += sizeof(cmdId);
-    pid_t pid;
-    memcpy(&pid, bufPtr + headerSize, sizeof(pid));
-    headerSize += sizeof(pid);
-    int length;
-    memcpy(&length, bufPtr + headerSize, sizeof(length));
-    headerSize += sizeof(length);
-
-    // not enough data for read command
-    if (buf->size() < (headerSize + length)) {
-        return false;
+    HELPER_FRAME_HEADER header;
+    helper_protocol::FrameStatus status = helper_protocol::parseFrame(bufPtr, buf->size(), header);
+    if (status != helper_protocol::FrameStatus::kComplete) {
+        return status;
     }
 
     struct ucred peerCred;
@@ -71,47 +57,128 @@ bool Server::readAndHandleCommand(socket_ptr sock, boost::asio::streambuf *buf,
 
     if ((retCode != 0) || (lenPeerCred != sizeof(peerCred))) {
         spdlog::error("getsockopt(SO_PEERCRED) failed ({}).", errno);
-        return false;
+        return helper_protocol::FrameStatus::kInvalid;
     }
 
-    if (!HelperSecurity::instance().verifySignature()) {
-        return false;
+    if (!HelperSecurity::instance().verifySignature(securityState)) {
+        return helper_protocol::FrameStatus::kInvalid;
     }
 
-    std::vector<char> vector(length);
-    memcpy(&vector[0], bufPtr + headerSize, length);
-    std::string str(vector.begin(), vector.end());
-    std::istringstream stream(str);
-    outCmdAnswer = processCommand(cmdId, str);
+    std::string body(bufPtr + sizeof(header), header.length);
+    buf->consume(sizeof(header) + header.length);
 
-    buf->consume(headerSize + length);
+    if (header.cmdId == HELPER_CMD_WAIT_WIREGUARD_STATUS) {
+        // answered later, when the status changes
+        startWireGuardStatusWait(sock, header.requestId, body);
+        return helper_protocol::FrameStatus::kComplete;
+    }
 
-    return true;
+    CMD_ANSWER cmdAnswer;
+    if (header.cmdId == HELPER_CMD_CANCEL_WAIT_WIREGUARD_STATUS) {
+        cancelWireGuardStatusWaits(header.requestId);
+        cmdAnswer.executed = 1;
+    } else {
+        cmdAnswer = processCommand(header.cmdId, body);
+    }
+    helper_protocol::appendFrame(outAnswers, header.requestId, header.cmdId, 0, helper_protocol::serialize(cmdAnswer));
+    return helper_protocol::FrameStatus::kComplete;
 }
 
-void Server::receiveCmdHandle(socket_ptr sock, boost::shared_ptr<boost::asio::streambuf> buf, const boost::system::error_code& ec, std::size_t bytes_transferred)
+void Server::startWireGuardStatusWait(socket_ptr sock, uint32_t requestId, const std::string &body)
 {
-    UNUSED(bytes_transferred);
+    auto sendAnswer = [this, sock, requestId](const CMD_ANSWER &answer) {
+        std::string frame;
+        helper_protocol::appendFrame(frame, requestId, HELPER_CMD_WAIT_WIREGUARD_STATUS, 0, helper_protocol::serialize(answer));
+        sendAnswers(sock, frame);
+    };
+
+    CMD_WAIT_WIREGUARD_STATUS cmd;
+    try {
+        helper_protocol::BinaryIArchive ia(body.data(), body.size());
+        ia >> cmd;
+    } catch (const std::exception &e) {
+        spdlog::error("Incorrect data for the WireGuard status wait: {}", e.what());
+        sendAnswer(CMD_ANSWER());
+        return;
+    }
 
-    if (!ec.value()) {
-        // read and handle commands
-        while (true) {
-            CMD_ANSWER cmdAnswer;
-            if (!readAndHandleCommand(sock, buf.get(), cmdAnswer)) {
-                // goto receive next commands
-                boost::asio::async_read(*sock, *buf, boost::asio::transfer_at_least(1),
-                                        boost::bind(&Server::receiveCmdHandle, this, sock, buf, _1, _2));
-                break;
-            } else {
-                if (!sendAnswerCmd(sock, cmdAnswer)) {
-                    spdlog::info("client app disconnected");
-                    return;
-                }
-            }
+    // the client canceled the wait before it reached us, the request ids of the client increase
+    if (requestId < wireGuardStatusWaitCancelRequestId_) {
+        sendAnswer(wireGuardStatsPublisher_.status());
+        return;
+    }
+
+    for (auto it = wireGuardStatusWaiters_.begin(); it != wireGuardStatusWaiters_.end();) {
+        if (it->second->isFinished()) {
+            it = wireGuardStatusWaiters_.erase(it);
+        } else {
+            ++it;
         }
-    } else {
+    }
+    boost::shared_ptr<WireGuardStatusWaiter> waiter(new WireGuardStatusWaiter(service_, cmd, sendAnswer));
+    wireGuardStatusWaiters_[requestId] = waiter;
+    waiter->start(wireGuardStatsPublisher_.status());
+}
+
+void Server::cancelWireGuardStatusWaits(uint32_t requestId)
+{
+    // the waits sent after the cancel are not canceled
+    auto end = wireGuardStatusWaiters_.lower_bound(requestId);
+    for (auto it = wireGuardStatusWaiters_.begin(); it != end; ++it) {
+        if (!it->second->isFinished()) {
+            it->second->cancel();
+        }
+    }
+    wireGuardStatusWaiters_.erase(wireGuardStatusWaiters_.begin(), end);
+    wireGuardStatusWaitCancelRequestId_ = std::max(wireGuardStatusWaitCancelRequestId_, requestId);
+}
+
+void Server::clientDisconnected()
+{
+    HelperSecurity::instance().logCacheStats();
+    CommandRunner::instance().logStats();
+    // the request ids are of the connection, the client may number the requests of the next one from 1
+    for (const auto &it : wireGuardStatusWaiters_) {
+        if (!it.second->isFinished()) {
+            it.second->cancel();
+        }
+    }
+    wireGuardStatusWaiters_.clear();
+    wireGuardStatusWaitCancelRequestId_ = 0;
+}
+
+void Server::receiveCmdHandle(socket_ptr sock, boost::shared_ptr<boost::asio::streambuf> buf, security_state_ptr securityState,
+                              const boost::system::error_code& ec, std::size_t bytes_transferred)
+{
+    UNUSED(bytes_transferred);
+
+    if (ec.value()) {
+        spdlog::info("client app disconnected");
+        clientDisconnected();
+        return;
+    }
+
+    // handle all the complete commands, the client may send several of them without waiting for the answers
+    std::string answers;
+    helper_protocol::FrameStatus status;
+    while ((status = readAndHandleCommand(sock, buf.get(), *securityState, answers)) == helper_protocol::FrameStatus::kComplete) {
+    }
+
+    if (status == helper_protocol::FrameStatus::kInvalid) {
+        spdlog::error("incorrect command from the client app, disconnecting");
+        clientDisconnected();
+        return;
+    }
+
+    if (!answers.empty() && !sendAnswers(sock, answers)) {
         spdlog::info("client app disconnected");
+        clientDisconnected();
+        return;
     }
+
+    // goto receive next commands
+    boost::asio::async_read(*sock, *buf, boost::asio::transfer_at_least(1),
+                            boost::bind(&Server::receiveCmdHandle, this, sock, buf, securityState, _1, _2));
 }
 
 void Server::acceptHandler(const boost::system::error_code & ec, socket_ptr sock)
@@ -120,8 +187,10 @@ void Server::acceptHandler(const boost::system::error_code & ec, socket_ptr sock
         spdlog::info("client app connected");
 
         boost::shared_ptr<boost::asio::streambuf> buf(new boost::asio::streambuf);
+        // the signature is verified once per connection while the client executable is unchanged
+        security_state_ptr securityState(new HelperSecurity::ConnectionState);
         boost::asio::async_read(*sock, *buf, boost::asio::transfer_at_least(1),
-                                boost::bind(&Server::receiveCmdHandle, this, sock, buf, _1, _2));
+                                boost::bind(&Server::receiveCmdHandle, this, sock, buf, securityState, _1, _2));
     }
 
     startAccept();
@@ -133,25 +202,11 @@ void Server::startAccept()
     acceptor_->async_accept(*sock, boost::bind(&Server::acceptHandler, this, boost::asio::placeholders::error, sock));
 }
 
-bool Server::sendAnswerCmd(socket_ptr sock, const CMD_ANSWER &cmdAnswer)
+bool Server::sendAnswers(socket_ptr sock, const std::string &answers)
 {
-    std::stringstream stream;
-    boost::archive::text_oarchive oa(stream, boost::archive::no_header);
-    oa << cmdAnswer;
-    std::string str = stream.str();
-    int length = (int)str.length();
-    // send answer to client
     boost::system::error_code er;
-    boost::asio::write(*sock, boost::asio::buffer(&length, sizeof(length)), boost::asio::transfer_exactly(sizeof(length)), er);
-    if (er.value()) {
-        return false;
-    } else {
-        boost::asio::write(*sock, boost::asio::buffer(str.data(), str.length()), boost::asio::transfer_exactly(str.length()), er);
-        if (er.value()) {
-            return false;
-        }
-    }
-    return true;
+    boost::asio::write(*sock, boost::asio::buffer(answers), er);
+    return !er.value();
 }
 
 void Server::run()
@@ -176,6 +231,19 @@ void Server::run()
     // Cause the FirewallController to be constructed here, so that on-boot rules are processed, even if the Windscribe app/service does not start.
     FirewallController::instance();
 
+    // the status waits are given the updates of the publisher, so the status is polled once for all of them
+    wireGuardStatsPublisher_.setStatusCallback([this](const CMD_ANSWER &status) {
+        for (const auto &it : wireGuardStatusWaiters_) {
+            it.second->onStatus(status);
+        }
+    });
+    // the client reads the tunnel statistics from the segment, it may run without them
+    wireGuardStatsPublisher_.start();
+    // the commands are handled on the thread of service_, as the updates of the publisher
+    WireGuardController::instance().setStateChangedHandler([this](bool isStarted) {
+        wireGuardStatsPublisher_.setTunnelStarted(isStarted);
+    });
+
     startAccept();
 
     service_.run();
@@ -8,14 +8,20 @@
 #include <boost/asio.hpp>
 #include <boost/thread.hpp>
 #include <list>
+#include <map>
 
 #include "../../posix_common/helper_commands.h"
+#include "../../posix_common/helper_protocol.h"
+#include "ipc/helper_security.h"
 #include "routes_manager/routes_manager.h"
 #include "wireguard/defaultroutemonitor.h"
 #include "wireguard/wireguardadapter.h"
 #include "wireguard/wireguardcontroller.h"
+#include "wireguard/wireguardstatspublisher.h"
+#include "wireguard/wireguardstatuswaiter.h"
 
 typedef boost::shared_ptr<boost::asio::local::stream_protocol::socket> socket_ptr;
+typedef boost::shared_ptr<HelperSecurity::ConnectionState> security_state_ptr;
 
 class Server
 {
@@ -27,13 +33,26 @@ public:
 private:
     boost::asio::io_service service_;
     boost::asio::local::stream_protocol::acceptor *acceptor_;
-
-    bool readAndHandleCommand(socket_ptr sock, boost::asio::streambuf *buf, CMD_ANSWER &outCmdAnswer);
-
-    void receiveCmdHandle(socket_ptr sock, boost::shared_ptr<boost::asio::streambuf> buf, const boost::system::error_code& ec, std::size_t bytes_transferred);
+    WireGuardStatsPublisher wireGuardStatsPublisher_;
+    // by request id
+    std::map<uint32_t, boost::shared_ptr<WireGuardStatusWaiter>> wireGuardStatusWaiters_;
+    // the request id of the last cancel, the waits with an older id that come after it are answered immediately;
+    // 0 if there was no cancel since the client has connected
+    uint32_t wireGuardStatusWaitCancelRequestId_;
+
+    // handles the command at the beginning of buf and appends its answer frame to outAnswers
+    helper_protocol::FrameStatus readAndHandleCommand(socket_ptr sock, boost::asio::streambuf *buf, HelperSecurity::ConnectionState &securityState,
+                                                      std::string &outAnswers);
+
+    void receiveCmdHandle(socket_ptr sock, boost::shared_ptr<boost::asio::streambuf> buf, security_state_ptr securityState,
+                          const boost::system::error_code& ec, std::size_t bytes_transferred);
     void acceptHandler(const boost::system::error_code & ec, socket_ptr sock);
     void startAccept();
 
-    bool sendAnswerCmd(socket_ptr sock, const CMD_ANSWER &cmdAnswer);
+    bool sendAnswers(socket_ptr sock, const std::string &answers);
+
+    void startWireGuardStatusWait(socket_ptr sock, uint32_t requestId, const std::string &body);
+    void cancelWireGuardStatusWaits(uint32_t requestId);
+    void clientDisconnected();
 };
 
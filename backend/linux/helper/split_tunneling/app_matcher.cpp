@@ -0,0 +1,174 @@
+#include "app_matcher.h"
+
+#include <climits>
+#include <cstdlib>
+#include <dirent.h>
+#include <unistd.h>
+#include <spdlog/spdlog.h>
+
+namespace
+{
+
+bool endsWith(const std::string &str, const std::string &suffix)
+{
+    return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+std::string fileName(const std::string &path)
+{
+    size_t pos = path.rfind('/');
+    return pos == std::string::npos ? path : path.substr(pos);
+}
+
+} // namespace
+
+AppMatcher::AppMatcher(const std::string &procPath) : procPath_(procPath)
+{
+}
+
+void AppMatcher::setApps(const std::vector<std::string> &apps, std::vector<pid_t> &outAdded, std::vector<pid_t> &outRemoved)
+{
+    outAdded.clear();
+    outRemoved.clear();
+
+    paths_.clear();
+    prefixesByName_.clear();
+    for (const auto &app : apps) {
+        paths_.insert(app);
+        // the exe of a process is the resolved path, the apps may be given by a symlink
+        char resolved[PATH_MAX];
+        if (realpath(app.c_str(), resolved)) {
+            paths_.insert(resolved);
+        }
+
+        // handle snap
+        size_t idx = app.find("/snap/");
+        if (idx != std::string::npos) {
+            prefixesByName_.emplace(fileName(app), app.substr(0, idx + 6));
+        }
+        // handle flatpak
+        if (app.rfind("/app/", 0) == 0) {
+            prefixesByName_.emplace(fileName(app), "/app/");
+        }
+    }
+
+    // one pass over the running processes for the whole list
+    std::unordered_map<pid_t, bool> decisions;
+    DIR *dp = opendir(procPath_.c_str());
+    if (dp == NULL) {
+        spdlog::error("process monitor could not open /proc filesystem");
+    } else {
+        struct dirent *ep;
+        while ((ep = readdir(dp))) {
+            // numeric directories are pids in /proc
+            if (ep->d_type == DT_DIR && ep->d_name[0] >= '0' && ep->d_name[0] <= '9') {
+                pid_t pid = atoi(ep->d_name);
+                decisions[pid] = classify(pid);
+            }
+        }
+        closedir(dp);
+    }
+
+    for (const auto &it : decisions) {
+        auto prev = decisions_.find(it.first);
+        const bool wasMatched = prev != decisions_.end() && prev->second;
+        if (it.second && !wasMatched) {
+            outAdded.push_back(it.first);
+        } else if (!it.second && wasMatched) {
+            outRemoved.push_back(it.first);
+        }
+    }
+
+    decisions_.clear();
+    for (const auto &it : decisions) {
+        remember(it.first, it.second);
+    }
+}
+
+void AppMatcher::clear()
+{
+    decisions_.clear();
+}
+
+bool AppMatcher::onFork(pid_t parentPid, pid_t childPid)
+{
+    // the child runs the same exe as the parent until it execs
+    auto it = decisions_.find(parentPid);
+    const bool isMatched = it != decisions_.end() ? it->second : classify(childPid);
+    remember(childPid, isMatched);
+    return isMatched;
+}
+
+bool AppMatcher::onExec(pid_t pid)
+{
+    const bool isMatched = classify(pid);
+    remember(pid, isMatched);
+    return isMatched;
+}
+
+bool AppMatcher::onExit(pid_t pid)
+{
+    auto it = decisions_.find(pid);
+    if (it == decisions_.end()) {
+        return false;
+    }
+    const bool isMatched = it->second;
+    decisions_.erase(it);
+    return isMatched;
+}
+
+bool AppMatcher::classify(pid_t pid) const
+{
+    if (paths_.empty() && prefixesByName_.empty()) {
+        return false;
+    }
+    return matchesPath(exePath(pid));
+}
+
+bool AppMatcher::matchesPath(const std::string &path) const
+{
+    if (path.empty()) {
+        return false;
+    }
+    if (paths_.find(path) != paths_.end()) {
+        return true;
+    }
+    auto range = prefixesByName_.equal_range(fileName(path));
+    for (auto it = range.first; it != range.second; ++it) {
+        if (path.rfind(it->second, 0) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void AppMatcher::remember(pid_t pid, bool isMatched)
+{
+    if (decisions_.size() >= kMaxCacheSize) {
+        // the unmatched processes are cheap to classify again
+        for (auto it = decisions_.begin(); it != decisions_.end();) {
+            if (!it->second) {
+                it = decisions_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    decisions_[pid] = isMatched;
+}
+
+std::string AppMatcher::exePath(pid_t pid) const
+{
+    char buf[PATH_MAX];
+    ssize_t ret = readlink((procPath_ + "/" + std::to_string(pid) + "/exe").c_str(), buf, sizeof(buf) - 1);
+    if (ret < 0) {
+        return std::string();
+    }
+    std::string path(buf, ret);
+    // the exe was replaced on disk, e.g. by an update of the app
+    const std::string deleted = " (deleted)";
+    if (endsWith(path, deleted)) {
+        path.resize(path.size() - deleted.size());
+    }
+    return path;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <sys/types.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Decides which processes run one of the split tunneling apps.
+// The apps are indexed by the resolved exe path, the decisions are cached per pid and inherited on fork,
+// so the exe of a process is read once per exec instead of once per event.
+// Not thread safe.
+class AppMatcher
+{
+public:
+    explicit AppMatcher(const std::string &procPath = "/proc");
+
+    // Sets the apps and scans the running processes once.
+    // outAdded/outRemoved are the pids whose decision changed.
+    void setApps(const std::vector<std::string> &apps, std::vector<pid_t> &outAdded, std::vector<pid_t> &outRemoved);
+    // forgets the decisions, e.g. when the events are not monitored anymore
+    void clear();
+
+    // The process events, return true if the process runs one of the apps.
+    bool onFork(pid_t parentPid, pid_t childPid);
+    bool onExec(pid_t pid);
+    bool onExit(pid_t pid);
+
+    size_t cacheSize() const { return decisions_.size(); }
+
+private:
+    // unmatched pids are dropped from the cache beyond this size, the matched ones are always kept
+    static constexpr size_t kMaxCacheSize = 16384;
+
+    std::string procPath_;
+    std::unordered_set<std::string> paths_;
+    // snap and flatpak apps run from a versioned path, they are matched by the file name and the path prefix
+    std::unordered_multimap<std::string, std::string> prefixesByName_;
+    std::unordered_map<pid_t, bool> decisions_;
+
+    bool classify(pid_t pid) const;
+    bool matchesPath(const std::string &path) const;
+    void remember(pid_t pid, bool isMatched);
+    std::string exePath(pid_t pid) const;
+};
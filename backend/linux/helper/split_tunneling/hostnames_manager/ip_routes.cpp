@@ -1,5 +1,6 @@
 #include "ip_routes.h"
 
+#include <algorithm>
 #include <set>
 #include <spdlog/spdlog.h>
 #include "../../utils.h"
@@ -16,58 +17,70 @@ void IpRoutes::setIps(const std::string &defaultRouteIp, const std::vector<std::
         }
     }
 
+    // reconcile against the routes actually present in the kernel, some of ours may have been removed by someone else
+    RtNetlink netlink;
+    std::vector<RtNetlink::Route> kernelRoutes;
+    const bool isDumped = netlink.dumpRoutes(kernelRoutes);
+    auto isInKernel = [&](const RtNetlink::Route &route) {
+        return !isDumped || std::any_of(kernelRoutes.begin(), kernelRoutes.end(), [&](const RtNetlink::Route &it) {
+            return route.matches(it);
+        });
+    };
+
     // find route which need to delete
-    std::set<std::string> ipsDelete;
-    for (auto it = activeRoutes_.begin(); it != activeRoutes_.end(); ++it) {
+    std::vector<RtNetlink::Route> routesDelete;
+    for (auto it = activeRoutes_.begin(); it != activeRoutes_.end();) {
         if (it->second.defaultRouteIp != defaultRouteIp || ipsSet.find(it->first) == ipsSet.end()) {
-            ipsDelete.insert(it->first);
-        }
-    }
-
-    // delete routes
-    for (auto ip = ipsDelete.begin(); ip != ipsDelete.end(); ++ip) {
-        auto fr = activeRoutes_.find(*ip);
-        if (fr != activeRoutes_.end()) {
-            deleteRoute(fr->second);
-            activeRoutes_.erase(fr);
+            RtNetlink::Route route = toRoute(it->second);
+            if (isInKernel(route)) {
+                routesDelete.push_back(route);
+            }
+            it = activeRoutes_.erase(it);
+        } else {
+            ++it;
         }
     }
 
-    // add routes
+    // find routes which need to add, including the ones that disappeared from the kernel
+    std::vector<RtNetlink::Route> routesAdd;
     for (auto ip = ipsSet.begin(); ip != ipsSet.end(); ++ip) {
-        auto ar = activeRoutes_.find(*ip);
-        if (ar != activeRoutes_.end()) {
-            continue;
-        } else {
-            RouteDescr rd;
-            rd.ip = *ip;
-            rd.defaultRouteIp = defaultRouteIp;
-            addRoute(rd);
+        RouteDescr rd;
+        rd.ip = *ip;
+        rd.defaultRouteIp = defaultRouteIp;
+        RtNetlink::Route route = toRoute(rd);
+        if (activeRoutes_.find(*ip) == activeRoutes_.end() || !isInKernel(route)) {
+            routesAdd.push_back(route);
             activeRoutes_[*ip] = rd;
         }
     }
+
+    if (!routesDelete.empty() || !routesAdd.empty()) {
+        spdlog::info("IpRoutes: delete {} routes, add {} routes via {}", routesDelete.size(), routesAdd.size(), defaultRouteIp);
+        netlink.removeRoutes(routesDelete);
+        netlink.addRoutes(routesAdd);
+    }
 }
 
 void IpRoutes::clear()
 {
     std::lock_guard<std::recursive_mutex> guard(mutex_);
+    if (activeRoutes_.empty()) {
+        return;
+    }
+
+    std::vector<RtNetlink::Route> routes;
     for (auto it = activeRoutes_.begin(); it != activeRoutes_.end(); ++it) {
-        deleteRoute(it->second);
+        routes.push_back(toRoute(it->second));
     }
+    spdlog::info("IpRoutes: delete {} routes", routes.size());
+    RtNetlink().removeRoutes(routes);
     activeRoutes_.clear();
 }
 
-void IpRoutes::addRoute(const RouteDescr &rd)
-{
-    std::string cmd = "ip route add " + rd.ip + " via " + rd.defaultRouteIp;
-    spdlog::info("cmd: {}", cmd);
-
-    Utils::executeCommand(cmd);
-}
-
-void IpRoutes::deleteRoute(const RouteDescr &rd)
+RtNetlink::Route IpRoutes::toRoute(const RouteDescr &rd)
 {
-    std::string cmd = "ip route del " + rd.ip + " via " + rd.defaultRouteIp;
-    spdlog::info("cmd: {}", cmd);
-    Utils::executeCommand(cmd);
+    RtNetlink::Route route;
+    route.dst = rd.ip;
+    route.gateway = rd.defaultRouteIp;
+    return route;
 }
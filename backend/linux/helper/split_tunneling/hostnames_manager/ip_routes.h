@@ -4,8 +4,9 @@
 #include <vector>
 #include <mutex>
 #include <map>
+#include "../../routes_manager/rtnetlink.h"
 
-// manage Ip route via "route add" and "route delete" commands
+// manage Ip routes via rtnetlink, the changes are applied in batches
 class IpRoutes
 {
 public:
@@ -23,6 +24,5 @@ private:
 
     std::map<std::string, RouteDescr> activeRoutes_;
 
-    void addRoute(const RouteDescr &rd);
-    void deleteRoute(const RouteDescr &rd);
+    static RtNetlink::Route toRoute(const RouteDescr &rd);
 };
@@ -1,51 +1,79 @@
 #include "process_monitor.h"
 
-#include <algorithm>
+#include <cerrno>
 #include <cstring>
-#include <dirent.h>
-#include <fstream>
-#include <iterator>
 #include <linux/netlink.h>
 #include <linux/connector.h>
 #include <linux/cn_proc.h>
 #include <poll.h>
-#include <sstream>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <unistd.h>
 #include <spdlog/spdlog.h>
 
 #include "cgroups.h"
 #include "../utils.h"
 
+namespace
+{
+
+struct __attribute__ ((aligned(NLMSG_ALIGNTO))) ProcEventMessage {
+    struct nlmsghdr nl_hdr;
+    struct __attribute__ ((__packed__)) {
+        struct cn_msg cn_msg;
+        struct proc_event proc_ev;
+    };
+};
+
+// events read with one recvmmsg() call
+const int kEventBatchSize = 32;
+
+} // namespace
+
 void ProcessMonitor::monitorWorker(void *ctx)
 {
-    int ret;
-    struct __attribute__ ((aligned(NLMSG_ALIGNTO))) {
-        struct nlmsghdr nl_hdr;
-        struct __attribute__ ((__packed__)) {
-            struct cn_msg cn_msg;
-            struct proc_event proc_ev;
-        };
-    } nlcn_msg;
+    ProcEventMessage msgs[kEventBatchSize];
+    struct iovec iovs[kEventBatchSize];
+    struct mmsghdr hdrs[kEventBatchSize];
+
+    memset(hdrs, 0, sizeof(hdrs));
+    for (int i = 0; i < kEventBatchSize; i++) {
+        iovs[i].iov_base = &msgs[i];
+        iovs[i].iov_len = sizeof(msgs[i]);
+        hdrs[i].msg_hdr.msg_iov = &iovs[i];
+        hdrs[i].msg_hdr.msg_iovlen = 1;
+    }
 
     spdlog::debug("process monitor thread started");
     running_ = true;
 
     while (running_) {
-        struct pollfd pfd;
-        pfd.fd = sock_;
-        pfd.events = POLLIN;
-
-        int ret = poll(&pfd, 1, 250);
+        // no timeout, stopMonitoring() wakes us up through stopFd_
+        struct pollfd pfds[2];
+        pfds[0].fd = sock_;
+        pfds[0].events = POLLIN;
+        pfds[1].fd = stopFd_;
+        pfds[1].events = POLLIN;
+
+        int ret = poll(pfds, 2, -1);
         if (ret < 0) {
-            spdlog::error("process monitor poll error {}", ret);
-            return;
-        } else if (ret == 0) {
-            continue;
+            if (errno == EINTR) {
+                continue;
+            }
+            spdlog::error("process monitor poll error {}", errno);
+            break;
+        }
+        if (pfds[1].revents & POLLIN) {
+            break;
         }
 
-        ret = read(sock_, &nlcn_msg, sizeof(nlcn_msg));
+        ret = recvmmsg(sock_, hdrs, kEventBatchSize, MSG_DONTWAIT, nullptr);
         if (ret <= 0) {
+            if (ret < 0 && errno == ENOBUFS) {
+                // the unknown parents of the lost forks are classified by the exe of the child
+                spdlog::warn("process monitor lost events");
+            }
             continue;
         }
 
@@ -53,25 +81,9 @@ void ProcessMonitor::monitorWorker(void *ctx)
             break;
         }
 
-        std::string cmd;
-        switch (nlcn_msg.proc_ev.what) {
-            case 0x00000001: // PROC_EVENT_FORK:
-                if (compareCmd(nlcn_msg.proc_ev.event_data.fork.child_pid, apps_)) {
-                    CGroups::instance().addApp(nlcn_msg.proc_ev.event_data.fork.child_pid);
-                }
-                break;
-            case 0x00000002: // PROC_EVENT_EXEC:
-                if (compareCmd(nlcn_msg.proc_ev.event_data.exec.process_pid, apps_)) {
-                    CGroups::instance().addApp(nlcn_msg.proc_ev.event_data.exec.process_pid);
-                }
-                break;
-            case 0x80000000: // PROC_EVENT_EXIT:
-                if (compareCmd(nlcn_msg.proc_ev.event_data.exit.process_pid, apps_)) {
-                    CGroups::instance().removeApp(nlcn_msg.proc_ev.event_data.exit.process_pid);
-                }
-                break;
-            default:
-                break;
+        std::lock_guard<std::mutex> guard(mutex_);
+        for (int i = 0; i < ret; i++) {
+            handleEvent(msgs[i].proc_ev);
         }
     }
     running_ = false;
@@ -80,33 +92,56 @@ void ProcessMonitor::monitorWorker(void *ctx)
     spdlog::debug("process monitor thread exiting");
 }
 
+void ProcessMonitor::handleEvent(const proc_event &ev)
+{
+    // The events of the threads are skipped, a thread shares the exe and the cgroup of its process.
+    // An exited process leaves the cgroup by itself, only its decision is forgotten.
+    switch (ev.what) {
+        case 0x00000001: // PROC_EVENT_FORK
+            if (ev.event_data.fork.child_pid == ev.event_data.fork.child_tgid &&
+                matcher_.onFork(ev.event_data.fork.parent_tgid, ev.event_data.fork.child_tgid)) {
+                CGroups::instance().addApp(ev.event_data.fork.child_tgid);
+            }
+            break;
+        case 0x00000002: // PROC_EVENT_EXEC
+            if (matcher_.onExec(ev.event_data.exec.process_tgid)) {
+                CGroups::instance().addApp(ev.event_data.exec.process_tgid);
+            }
+            break;
+        case 0x80000000: // PROC_EVENT_EXIT
+            if (ev.event_data.exit.process_pid == ev.event_data.exit.process_tgid) {
+                matcher_.onExit(ev.event_data.exit.process_tgid);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
 ProcessMonitor::ProcessMonitor() : isEnabled_(false), thread_(nullptr), sock_(-1), running_(false), functional_(false), testing_(false)
 {
+    stopFd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (stopFd_ == -1) {
+        spdlog::error("process monitor could not create eventfd");
+        return;
+    }
     selfTest();
 }
 
 ProcessMonitor::~ProcessMonitor()
 {
     stopMonitoring();
+    if (stopFd_ != -1) {
+        close(stopFd_);
+    }
 }
 
 void ProcessMonitor::setApps(const std::vector<std::string> &apps)
 {
+    apps_ = apps;
     if (isEnabled_) {
-        for (auto app : apps) {
-            if (std::find(apps_.begin(), apps_.end(), app) == apps_.end()) {
-                addApp(app);
-            }
-        }
-
-        for (auto app : apps_) {
-            if (std::find(apps.begin(), apps.end(), app) == apps.end()) {
-                removeApp(app);
-            }
-        }
+        updateApps();
     }
-
-    apps_ = apps;
 }
 
 bool ProcessMonitor::enable()
@@ -132,9 +167,7 @@ bool ProcessMonitor::enable()
         return false;
     }
 
-    for (auto app : apps_) {
-        addApp(app);
-    }
+    updateApps();
     isEnabled_ = true;
     return true;
 }
@@ -148,93 +181,30 @@ void ProcessMonitor::disable()
     spdlog::debug("process monitor disable");
 
     stopMonitoring();
-
-    isEnabled_ = false;
-}
-
-void ProcessMonitor::addApp(const std::string &exe) {
-    spdlog::info("process monitor add app: {}", exe);
-    std::vector<pid_t> pids = findPids(exe);
-    for (auto pid : pids) {
-        CGroups::instance().addApp(pid);
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        matcher_.clear();
     }
-}
 
-void ProcessMonitor::removeApp(const std::string &exe) {
-    spdlog::info("process monitor remove app: {}", exe);
-    std::vector<pid_t> pids = findPids(exe);
-    for (auto pid : pids) {
-        CGroups::instance().removeApp(pid);
-    }
+    isEnabled_ = false;
 }
 
-std::vector<pid_t> ProcessMonitor::findPids(const std::string &exe)
+void ProcessMonitor::updateApps()
 {
-    std::vector<pid_t> pids;
-
-    DIR *dp = NULL;
-    struct dirent *ep;
-
-    dp = opendir("/proc");
-    if (dp == NULL) {
-        spdlog::error("process monitor could not open /proc filesystem");
-        return pids;
+    std::vector<pid_t> added;
+    std::vector<pid_t> removed;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        matcher_.setApps(apps_, added, removed);
     }
 
-    while ((ep = readdir(dp))) {
-        // numeric directories are pids in /proc
-        if (ep->d_type == DT_DIR && ep->d_name[0] >= '0' && ep->d_name[0] <= '9') {
-            if (compareCmd(std::stoi(ep->d_name), {exe})) {
-                pids.push_back(std::stoi(ep->d_name));
-            }
-        }
-    }
-    closedir(dp);
-
-    return pids;
-}
-
-bool ProcessMonitor::compareCmd(pid_t pid, const std::vector<std::string> &exes) {
-    std::string cmd = getCmdByPid(pid);
-
-    for (auto exe : exes) {
-        if (cmd == exe) {
-            return true;
-        }
-
-        // handle snap
-        int idx = exe.find("/snap/");
-        if (idx != std::string::npos) {
-            std::string prefix = exe.substr(0, idx + 6);
-            std::string suffix = exe.substr(exe.rfind("/"));
-            if (cmd.rfind(prefix, 0) == 0 && cmd.find(suffix, cmd.size() - suffix.length()) == cmd.size() - suffix.length()) {
-                return true;
-            }
-        }
-
-        // handle flatpak
-        if (cmd.rfind("/app/", 0) == 0 && exe.rfind("/app/", 0) == 0) {
-            std::string suffix = exe.substr(exe.rfind("/"));
-            if (cmd.find(suffix, cmd.size() - suffix.length()) == cmd.size() - suffix.length()) {
-                return true;
-            }
-        }
+    spdlog::info("process monitor apps: {}, processes added: {}, removed: {}", apps_.size(), added.size(), removed.size());
+    for (auto pid : added) {
+        CGroups::instance().addApp(pid);
     }
-
-    return false;
-}
-
-std::string ProcessMonitor::getCmdByPid(pid_t pid)
-{
-    char buf[PATH_MAX];
-
-    memset(buf, 0, PATH_MAX);
-
-    int ret = readlink((std::string("/proc/") + std::to_string(pid) + "/exe").c_str(), buf, PATH_MAX - 1);
-    if (ret < 0) {
-        return std::string();
+    for (auto pid : removed) {
+        CGroups::instance().removeApp(pid);
     }
-    return buf;
 }
 
 bool ProcessMonitor::startMonitoring()
@@ -313,16 +283,18 @@ bool ProcessMonitor::prepareMonitoring()
 
 void ProcessMonitor::stopMonitoring()
 {
-    if (sock_ != -1) {
-        running_ = false;
-    }
-
     if (thread_) {
+        uint64_t value = 1;
+        ssize_t ret = write(stopFd_, &value, sizeof(value));
+        UNUSED(ret);
         if (thread_->joinable()) {
             thread_->join();
         }
         delete thread_;
         thread_ = nullptr;
+        // reset the eventfd for the next start
+        ret = read(stopFd_, &value, sizeof(value));
+        UNUSED(ret);
     }
 }
 
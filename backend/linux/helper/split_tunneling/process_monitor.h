@@ -1,8 +1,12 @@
 #pragma once
 
+#include <mutex>
 #include <string>
 #include <thread>
 #include <vector>
+#include "app_matcher.h"
+
+struct proc_event;
 
 class ProcessMonitor
 {
@@ -22,24 +26,26 @@ private:
     std::vector<std::string> apps_;
     std::thread *thread_;
     int sock_;
+    int stopFd_;
     bool running_;
 
     bool functional_;
     bool testing_;
 
+    // guards matcher_, which is used by the monitor thread
+    std::mutex mutex_;
+    AppMatcher matcher_;
+
     ProcessMonitor();
     ~ProcessMonitor();
 
-    void addApp(const std::string &exe);
-    void removeApp(const std::string &exe);
-    std::vector<pid_t> findPids(const std::string &exe);
-    std::string getCmdByPid(pid_t pid);
+    void updateApps();
 
     void selfTest();
     bool prepareMonitoring();
     bool startMonitoring();
     void stopMonitoring();
     void monitorWorker(void *ctx);
-    bool compareCmd(pid_t pid, const std::vector<std::string> &exes);
+    void handleEvent(const proc_event &ev);
 };
 
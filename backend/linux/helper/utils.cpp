@@ -1,5 +1,5 @@
 #include "utils.h"
-#include "3rdparty/pstream.h"
+#include "command_runner.h"
 
 #include <arpa/inet.h>
 #include <cstring>
@@ -14,49 +14,32 @@
 namespace Utils
 {
 
-// based on 3rd party lib (http://pstreams.sourceforge.net/)
 int executeCommand(const std::string &cmd, const std::vector<std::string> &args,
                    std::string *pOutputStr, bool appendFromStdErr)
 {
-    std::string cmdLine = cmd;
-
-    for (auto it = args.begin(); it != args.end(); ++it) {
-        cmdLine += " \"";
-        cmdLine += *it;
-        cmdLine += "\"";
-    }
-
-    if (pOutputStr) {
-        pOutputStr->clear();
-    }
-
-    redi::ipstream proc(cmdLine, redi::pstreams::pstdout | redi::pstreams::pstderr);
-    std::string line;
-    // read child's stdout
-    while (std::getline(proc.out(), line)) {
-        if (pOutputStr) {
-            *pOutputStr += line + "\n";
+    std::vector<std::string> argv;
+    if (cmd.find_first_of("|&;<>()$`\\\"'*?[]#~{}\n") != std::string::npos) {
+        // a shell command line
+        std::string cmdLine = cmd;
+        for (auto it = args.begin(); it != args.end(); ++it) {
+            cmdLine += " \"";
+            cmdLine += *it;
+            cmdLine += "\"";
         }
-    }
-    // if reading stdout stopped at EOF then reset the state:
-    if (proc.eof() && proc.fail()) {
-        proc.clear();
-    }
-
-    if (appendFromStdErr) {
-        // read child's stderr
-        while (std::getline(proc.err(), line)) {
-            if (pOutputStr) {
-                *pOutputStr += line + "\n";
-            }
+        argv = {"/bin/sh", "-c", cmdLine};
+    } else {
+        std::istringstream stream(cmd);
+        std::string word;
+        while (stream >> word) {
+            argv.push_back(word);
         }
+        argv.insert(argv.end(), args.begin(), args.end());
     }
 
-    proc.close();
-    if (proc.rdbuf()->exited()) {
-        return proc.rdbuf()->status();
+    if (pOutputStr) {
+        pOutputStr->clear();
     }
-    return 0;
+    return CommandRunner::instance().run(argv, pOutputStr, appendFromStdErr);
 }
 
 
@@ -112,21 +95,18 @@ std::string getFullCommandAsUser(const std::string &user, const std::string &exe
 std::vector<std::string> getOpenVpnExeNames()
 {
     std::vector<std::string> ret;
-    std::string list;
-    std::string item;
-    int rc = 0;
 
-    rc = Utils::executeCommand("ls", {"/opt/windscribe"}, &list);
-    if (rc != 0) {
+    DIR *dir = opendir("/opt/windscribe");
+    if (!dir) {
         return ret;
     }
-
-    std::istringstream stream(list);
-    while (std::getline(stream, item)) {
-        if (item.find("openvpn") != std::string::npos) {
-            ret.push_back(item);
+    while (struct dirent *entry = readdir(dir)) {
+        const std::string name = entry->d_name;
+        if (name.find("openvpn") != std::string::npos) {
+            ret.push_back(name);
         }
     }
+    closedir(dir);
     return ret;
 }
 
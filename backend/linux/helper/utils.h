@@ -11,6 +11,7 @@
 namespace Utils
 {
     // execute cmd with args and return output from stdout and stderror to pOutputStr (if pOutputStr != NULL)
+    // cmd may have arguments separated with spaces, it runs without a shell unless it has shell syntax
     int executeCommand(const std::string &cmd,
                        const std::vector<std::string> &args = std::vector<std::string>(),
                        std::string *pOutputStr = nullptr, bool appendFromStdErr = true);
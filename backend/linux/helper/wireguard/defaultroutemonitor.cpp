@@ -1,5 +1,5 @@
 #include "defaultroutemonitor.h"
-#include "../utils.h"
+#include "../routes_manager/rtnetlink.h"
 #include <boost/algorithm/string.hpp>
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/split.hpp>
@@ -90,28 +90,16 @@ bool DefaultRouteMonitor::checkDefaultRoutes()
     return setEndpointDirectRoute();
 }
 
-bool DefaultRouteMonitor::executeCommandWithLogging(const std::string &command) const
-{
-    std::string output;
-    const auto status = Utils::executeCommand(command, {}, &output);
-    if (!output.empty())
-        spdlog::info(output);
-    return status == 0;
-}
-
 std::string DefaultRouteMonitor::getDefaultGateway() const
 {
-    std::string output;
-    const auto status = Utils::executeCommand(
-        "ip route | grep 'default' | awk '{print $3}'", {}, &output);
-    if (status == 0) {
-        std::vector<std::string> gateways;
-        boost::trim(output);
-        boost::split(gateways, output, boost::is_any_of("\n"), boost::token_compress_on);
-        if (!gateways.empty() && !gateways[0].empty())
-            return gateways[0];
+    std::vector<RtNetlink::Route> routes;
+    if (RtNetlink().dumpRoutes(routes)) {
+        for (const auto &route : routes) {
+            if (route.prefixLength == 0 && !route.gateway.empty())
+                return route.gateway;
+        }
     }
-    spdlog::warn("Failed to get default gateway ({})", output);
+    spdlog::warn("Failed to get default gateway");
     return "";
 }
 
@@ -119,15 +107,17 @@ bool DefaultRouteMonitor::setEndpointDirectRoute()
 {
     if (endpoint_.empty() || lastGateway_.empty())
         return false;
-    if (!executeCommandWithLogging(
-        "ip route add " + endpoint_ + "/32 via " + lastGateway_))
-        return false;
-    return true;
+    RtNetlink::Route route;
+    route.dst = endpoint_;
+    route.gateway = lastGateway_;
+    return RtNetlink().addRoute(route);
 }
 
 void DefaultRouteMonitor::unsetEndpointDirectRoute()
 {
     if (endpoint_.empty())
         return;
-    executeCommandWithLogging("ip route del " + endpoint_);
+    RtNetlink::Route route;
+    route.dst = endpoint_;
+    RtNetlink().removeRoute(route);
 }
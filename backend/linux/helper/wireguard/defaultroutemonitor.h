@@ -16,7 +16,6 @@ public:
     bool isActive() const { return !doStopThread_; }
 
 private:
-    bool executeCommandWithLogging(const std::string &command) const;
     std::string getDefaultGateway() const;
     bool setEndpointDirectRoute();
     void unsetEndpointDirectRoute();
@@ -21,5 +21,6 @@ public:
     virtual unsigned long getStatus(
         unsigned int *errorCode,
         unsigned long long *bytesReceived,
-        unsigned long long *bytesTransmitted) = 0;
+        unsigned long long *bytesTransmitted,
+        long long *lastHandshakeSec) = 0;
 };
@@ -202,7 +202,7 @@ bool KernelModuleCommunicator::configure(const std::string &clientPrivateKey,
 }
 
 unsigned long KernelModuleCommunicator::getStatus(unsigned int *errorCode,
-    unsigned long long *bytesReceived, unsigned long long *bytesTransmitted)
+    unsigned long long *bytesReceived, unsigned long long *bytesTransmitted, long long *lastHandshakeSec)
 {
     UNUSED(errorCode);
 
@@ -221,6 +221,8 @@ unsigned long KernelModuleCommunicator::getStatus(unsigned int *errorCode,
         }
         *bytesReceived = device->first_peer->rx_bytes;
         *bytesTransmitted = device->first_peer->tx_bytes;
+        if (lastHandshakeSec)
+            *lastHandshakeSec = device->first_peer->last_handshake_time.tv_sec;
         wg_free_device(device);
         return kWgStateActive;
     }
@@ -25,7 +25,8 @@ public:
     virtual unsigned long getStatus(
         unsigned int *errorCode,
         unsigned long long *bytesReceived,
-        unsigned long long *bytesTransmitted);
+        unsigned long long *bytesTransmitted,
+        long long *lastHandshakeSec);
 
 private:
     bool setPeerAllowedIps(wg_peer *peer, const std::vector<std::string> &ips);
@@ -11,6 +11,7 @@
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/un.h>
+#include <unistd.h>
 #include <spdlog/spdlog.h>
 
 namespace
@@ -144,7 +145,7 @@ bool WireGuardGoCommunicator::start(const std::string &deviceName)
 {
     assert(!deviceName.empty());
 
-    Utils::executeCommand("rm", {"-f", ("/var/run/wireguard/" + deviceName + ".sock").c_str()});
+    unlink(("/var/run/wireguard/" + deviceName + ".sock").c_str());
 
     const std::string fullCmd = Utils::getFullCommand(Utils::getExePath(), "windscribewireguard", "-f " + deviceName);
     if (fullCmd.empty()) {
@@ -159,7 +160,11 @@ bool WireGuardGoCommunicator::start(const std::string &deviceName)
         return false;
     }
 
-    daemonCmdId_ = ExecuteCmd::instance().execute(fullCmd);
+    auto isDaemonRunning = std::make_shared<std::atomic<bool>>(true);
+    isDaemonRunning_ = isDaemonRunning;
+    ExecuteCmd::instance().execute(fullCmd, std::string(), true, [isDaemonRunning](unsigned long, bool, const std::string &) {
+        isDaemonRunning->store(false);
+    });
     deviceName_ = deviceName;
     executable_ = "windscribewireguard";
     return true;
@@ -168,7 +173,7 @@ bool WireGuardGoCommunicator::start(const std::string &deviceName)
 bool WireGuardGoCommunicator::stop()
 {
     if (!deviceName_.empty()) {
-        Utils::executeCommand("rm", {"-f", ("/var/run/wireguard/" + deviceName_ + ".sock").c_str()});
+        unlink(("/var/run/wireguard/" + deviceName_ + ".sock").c_str());
     }
     if (!executable_.empty()) {
         Utils::executeCommand("pkill", {"-f", executable_.c_str()});
@@ -229,12 +234,9 @@ bool WireGuardGoCommunicator::configure(const std::string &clientPrivateKey,
 }
 
 unsigned long WireGuardGoCommunicator::getStatus(unsigned int *errorCode,
-    unsigned long long *bytesReceived, unsigned long long *bytesTransmitted)
+    unsigned long long *bytesReceived, unsigned long long *bytesTransmitted, long long *lastHandshakeSec)
 {
-    bool is_daemon_dead = true;
-    std::string log;
-    ExecuteCmd::instance().getStatus(daemonCmdId_, is_daemon_dead, log);
-    if (is_daemon_dead) {
+    if (!isDaemonRunning_ || !isDaemonRunning_->load()) {
         // Special error code means the daemon is dead.
         *errorCode = 666u;
         return kWgStateError;
@@ -292,6 +294,8 @@ unsigned long WireGuardGoCommunicator::getStatus(unsigned int *errorCode,
             *bytesReceived = stringToValue<unsigned long long>(results["rx_bytes"]);
         if (bytesTransmitted)
             *bytesTransmitted = stringToValue<unsigned long long>(results["tx_bytes"]);
+        if (lastHandshakeSec)
+            *lastHandshakeSec = stringToValue<long long>(results["last_handshake_time_sec"]);
         return kWgStateActive;
     }
 
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <atomic>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -24,7 +26,8 @@ public:
     virtual unsigned long getStatus(
         unsigned int *errorCode,
         unsigned long long *bytesReceived,
-        unsigned long long *bytesTransmitted);
+        unsigned long long *bytesTransmitted,
+        long long *lastHandshakeSec);
 
 private:
     class Connection
@@ -50,5 +53,6 @@ private:
 
     std::string deviceName_;
     std::string executable_;
-    unsigned long daemonCmdId_;
+    // cleared by ExecuteCmd when the daemon exits
+    std::shared_ptr<std::atomic<bool>> isDaemonRunning_;
 };
@@ -1,6 +1,7 @@
 #include "wireguardadapter.h"
 #include "../../../posix_common/helper_commands.h"
 #include "../execute_cmd.h"
+#include "../routes_manager/rtnetlink.h"
 #include "../utils.h"
 #include <boost/algorithm/string.hpp>
 #include <boost/algorithm/string/classification.hpp>
@@ -77,44 +78,63 @@ bool WireGuardAdapter::enableRouting(const std::string &ipAddress, const std::ve
     allowedIps_ = allowedIps;
     fwmark_ = fwmark;
 
-    std::vector<std::string> cmdlist;
+    RtNetlink netlink;
+    std::vector<RtNetlink::Route> routesAdd;
+    std::vector<RtNetlink::Route> deviceRoutes;
+    bool isDeviceRoutesDumped = false;
     for (const auto &ip : allowedIps) {
-        if (boost::algorithm::ends_with(ip, "/0")) {
+        RtNetlink::Route route;
+        if (!RtNetlink::parseRoute(ip, route)) {
+            spdlog::error("WireGuardAdapter::enableRouting: invalid allowed ip {}", ip);
+            return false;
+        }
+        route.interface = getName();
+
+        if (route.prefixLength == 0) {
             has_default_route_ = true;
-            cmdlist.push_back("ip -4 route add " + ip + " dev " + getName() + " table " + std::to_string(fwmark));
+            route.table = fwmark;
+            if (!netlink.addRoute(route))
+            {
+                return false;
+            }
+
+            std::vector<std::string> cmdlist;
             cmdlist.push_back("ip -4 rule add not fwmark " + std::to_string(fwmark) + " table " + std::to_string(fwmark));
             cmdlist.push_back("ip -4 rule add table main suppress_prefixlength 0");
-
             if (!RunBlockingCommands(cmdlist))
             {
                 return false;
             }
-            cmdlist.clear();
 
             if (!addFirewallRules(ipAddress, fwmark))
             {
                 return false;
             }
         } else {
-
-            std::vector<std::string> args;
-            args.push_back("-4");
-            args.push_back("route");
-            args.push_back("show");
-            args.push_back("dev");
-            args.push_back(getName());
-            args.push_back("match");
-            args.push_back(ip);
-
-            std::string output;
-            Utils::executeCommand("ip", args, &output, false);
-            if (output.empty())
+            // the routes of the device are fetched once, skip the networks they already cover
+            if (!isDeviceRoutesDumped) {
+                std::vector<RtNetlink::Route> routes;
+                netlink.dumpRoutes(routes);
+                for (const auto &it : routes) {
+                    if (it.interface == getName())
+                        deviceRoutes.push_back(it);
+                }
+                isDeviceRoutesDumped = true;
+            }
+            bool isCovered = false;
+            for (const auto &it : deviceRoutes) {
+                if (it.contains(route)) {
+                    isCovered = true;
+                    break;
+                }
+            }
+            if (!isCovered)
             {
-                cmdlist.push_back("ip -4 route add " + ip + " dev " + getName());
+                routesAdd.push_back(route);
             }
         }
     }
-    return RunBlockingCommands(cmdlist);
+    return netlink.addRoutes(routesAdd) == 0;
 }
 
 bool WireGuardAdapter::disableRouting()
@@ -4,6 +4,7 @@
 #include "kernelmodule/kernelmodulecommunicator.h"
 #include "defaultroutemonitor.h"
 #include "../../../posix_common/helper_commands.h"
+#include "../command_runner.h"
 #include "../execute_cmd.h"
 #include "../utils.h"
 #include <boost/algorithm/string/classification.hpp>
@@ -31,6 +32,8 @@ bool WireGuardController::start()
 
     if (comm_->start(kDeviceName)) {
         is_initialized_ = true;
+        if (stateChangedHandler_)
+            stateChangedHandler_(true);
         return true;
     }
     return false;
@@ -48,6 +51,8 @@ bool WireGuardController::stop()
     adapter_.reset();
     drm_.reset();
     is_initialized_ = false;
+    if (stateChangedHandler_)
+        stateChangedHandler_(false);
 
     return true;
 }
@@ -74,11 +79,12 @@ bool WireGuardController::configure(
 unsigned long WireGuardController::getStatus(
     unsigned int *errorCode,
     unsigned long long *bytesReceived,
-    unsigned long long *bytesTransmitted) const
+    unsigned long long *bytesTransmitted,
+    long long *lastHandshakeSec) const
 {
     if (!is_initialized_)
         return kWgStateNone;
-    return comm_->getStatus(errorCode, bytesReceived, bytesTransmitted);
+    return comm_->getStatus(errorCode, bytesReceived, bytesTransmitted, lastHandshakeSec);
 }
 
 
@@ -134,19 +140,13 @@ uint32_t WireGuardController::getFwmark()
     // check for the fwmark busy
     while (true)
     {
-        std::vector<std::string> args;
-        args.push_back("-4");
-        args.push_back("route");
-        args.push_back("show");
-        args.push_back("table");
-        args.push_back(std::to_string(fwmark));
-
-        std::string outputIp4, outputIp6;
-        Utils::executeCommand("ip", args, &outputIp4, false);
-        // check the same for ipv6
-        args[0] = "-6";
-        Utils::executeCommand("ip", args, &outputIp6, false);
-        if (outputIp4.empty() && outputIp6.empty())
+        // check ipv4 and ipv6 at once
+        std::vector<CommandRunner::Command> commands(2);
+        commands[0].argv = {"ip", "-4", "route", "show", "table", std::to_string(fwmark)};
+        commands[1].argv = {"ip", "-6", "route", "show", "table", std::to_string(fwmark)};
+        commands[0].appendFromStdErr = commands[1].appendFromStdErr = false;
+        CommandRunner::instance().runParallel(commands);
+        if (commands[0].output.empty() && commands[1].output.empty())
         {
             break;
         }
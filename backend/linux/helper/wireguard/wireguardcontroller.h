@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -31,7 +32,8 @@ public:
     unsigned long getStatus(
         unsigned int *errorCode,
         unsigned long long *bytesReceived,
-        unsigned long long *bytesTransmitted) const;
+        unsigned long long *bytesTransmitted,
+        long long *lastHandshakeSec = nullptr) const;
 
     bool configureAdapter(
         const std::string &ipAddress,
@@ -43,6 +45,8 @@ public:
     bool configureDefaultRouteMonitor(const std::string &peerEndpoint);
 
     bool isInitialized() const { return is_initialized_; }
+    // called from start() and stop() when the tunnel has been started or stopped
+    void setStateChangedHandler(std::function<void(bool isStarted)> handler) { stateChangedHandler_ = handler; }
 
     static std::vector<std::string> splitAndDeduplicateAllowedIps(
         const std::string &allowedIps);
@@ -55,6 +59,7 @@ private:
     std::unique_ptr<DefaultRouteMonitor> drm_;
     std::shared_ptr<IWireGuardCommunicator> comm_;
     bool is_initialized_;
+    std::function<void(bool isStarted)> stateChangedHandler_;
 
     WireGuardController();
 };
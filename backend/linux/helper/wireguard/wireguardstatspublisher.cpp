@@ -0,0 +1,159 @@
+#include "wireguardstatspublisher.h"
+
+#include <fcntl.h>
+#include <grp.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <spdlog/spdlog.h>
+
+#include "../process_command.h"
+#include "wireguardcontroller.h"
+
+namespace {
+
+uint32_t toTunnelState(unsigned long wgState)
+{
+    switch (wgState) {
+    case kWgStateNone:
+        return tunnel_stats::kStateNone;
+    case kWgStateError:
+        return tunnel_stats::kStateError;
+    case kWgStateActive:
+        return tunnel_stats::kStateActive;
+    default:
+        return tunnel_stats::kStateConnecting;
+    }
+}
+
+int64_t monotonicTimeMs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+} // namespace
+
+WireGuardStatsPublisher::WireGuardStatsPublisher(boost::asio::io_service &service) : timer_(service), segment_(nullptr), isTunnelStarted_(false)
+{
+    status_.executed = 1;
+    status_.cmdId = kWgStateNone;
+}
+
+WireGuardStatsPublisher::~WireGuardStatsPublisher()
+{
+    timer_.cancel();
+    if (segment_) {
+        munmap(segment_, sizeof(tunnel_stats::Segment));
+        shm_unlink(TUNNEL_STATS_SHM_NAME);
+    }
+}
+
+bool WireGuardStatsPublisher::start()
+{
+    const bool isCreated = createSegment();
+    if (WireGuardController::instance().isInitialized()) {
+        setTunnelStarted(true);
+    }
+    return isCreated;
+}
+
+bool WireGuardStatsPublisher::createSegment()
+{
+    // a segment left by a previous instance may have another layout, start from a new one
+    shm_unlink(TUNNEL_STATS_SHM_NAME);
+    struct group *grp = getgrnam("windscribe");
+    if (!grp) {
+        spdlog::error("Couldn't create the tunnel stats segment, no windscribe group");
+        return false;
+    }
+    int fd = shm_open(TUNNEL_STATS_SHM_NAME, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        spdlog::error("Couldn't create the tunnel stats segment ({})", errno);
+        return false;
+    }
+    // only the client can read it, it's in the windscribe group as for the helper socket;
+    // the umask may have removed the read permission for the group
+    if (fchown(fd, (uid_t)-1, grp->gr_gid) != 0 || fchmod(fd, 0640) != 0 || ftruncate(fd, sizeof(tunnel_stats::Segment)) != 0) {
+        spdlog::error("Couldn't set up the tunnel stats segment ({})", errno);
+        close(fd);
+        shm_unlink(TUNNEL_STATS_SHM_NAME);
+        return false;
+    }
+    void *addr = mmap(nullptr, sizeof(tunnel_stats::Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        spdlog::error("Couldn't map the tunnel stats segment ({})", errno);
+        shm_unlink(TUNNEL_STATS_SHM_NAME);
+        return false;
+    }
+
+    // ftruncate filled the segment with zeros, which is a valid state for the atomics
+    segment_ = static_cast<tunnel_stats::Segment *>(addr);
+    segment_->version = TUNNEL_STATS_SHM_VERSION;
+    snapshot_.updateTimeMs = monotonicTimeMs();
+    tunnel_stats::write(segment_, snapshot_);
+    segment_->magic.store(TUNNEL_STATS_SHM_MAGIC, std::memory_order_release);
+    return true;
+}
+
+void WireGuardStatsPublisher::setTunnelStarted(bool isStarted)
+{
+    isTunnelStarted_ = isStarted;
+    timer_.cancel();
+    update();
+    if (isStarted) {
+        scheduleUpdate();
+    }
+}
+
+void WireGuardStatsPublisher::update()
+{
+    unsigned int errorCode = 0;
+    unsigned long long bytesReceived = 0, bytesTransmitted = 0;
+    long long lastHandshakeSec = 0;
+    const unsigned long wgState = WireGuardController::instance().getStatus(&errorCode, &bytesReceived, &bytesTransmitted,
+                                                                            &lastHandshakeSec);
+    status_ = wireGuardStatusAnswer(wgState, errorCode, bytesReceived, bytesTransmitted);
+    if (statusCallback_) {
+        statusCallback_(status_);
+    }
+    if (!segment_) {
+        return;
+    }
+
+    const uint32_t state = toTunnelState(wgState);
+
+    tunnel_stats::Snapshot snapshot = snapshot_;
+    snapshot.state = state;
+    if (snapshot_.state == tunnel_stats::kStateNone && state != tunnel_stats::kStateNone) {
+        snapshot.generation++;
+    }
+    // the counters of a stopped tunnel are kept, the readers already counted them
+    if (state != tunnel_stats::kStateNone) {
+        snapshot.bytesReceived = bytesReceived;
+        snapshot.bytesTransmitted = bytesTransmitted;
+        snapshot.lastHandshakeSec = lastHandshakeSec;
+    }
+
+    if (snapshot.state != snapshot_.state || snapshot.generation != snapshot_.generation ||
+        snapshot.bytesReceived != snapshot_.bytesReceived || snapshot.bytesTransmitted != snapshot_.bytesTransmitted ||
+        snapshot.lastHandshakeSec != snapshot_.lastHandshakeSec) {
+        snapshot.updateTimeMs = monotonicTimeMs();
+        tunnel_stats::write(segment_, snapshot);
+        snapshot_ = snapshot;
+    }
+}
+
+void WireGuardStatsPublisher::scheduleUpdate()
+{
+    timer_.expires_after(std::chrono::milliseconds(status_.cmdId == kWgStateActive ? kActiveUpdateIntervalMs : kUpdateIntervalMs));
+    timer_.async_wait([this](const boost::system::error_code &ec) {
+        if (!ec && isTunnelStarted_) {
+            update();
+            scheduleUpdate();
+        }
+    });
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <functional>
+#include <boost/asio.hpp>
+
+#include "../../../posix_common/helper_commands.h"
+#include "../../../posix_common/tunnel_stats_shm.h"
+
+// The only poller of the WireGuard status in the helper. Publishes the state, byte counters and last handshake time
+// in the shared memory segment described in tunnel_stats_shm.h, so the client reads them at its display rate without
+// a command per update, and passes every update to the status callback for the status waits.
+// The status is polled only while the tunnel is started, see setTunnelStarted(); otherwise it changes on start and stop only.
+class WireGuardStatsPublisher
+{
+public:
+    typedef std::function<void(const CMD_ANSWER &status)> StatusCallback;
+
+    explicit WireGuardStatsPublisher(boost::asio::io_service &service);
+    ~WireGuardStatsPublisher();
+
+    // Creates the segment readable by the windscribe group, returns false if the segment could not be created.
+    // The status is polled and passed to the callback without the segment as well.
+    bool start();
+    // Starts the updates when the tunnel has been started; when it has been stopped, publishes the stopped state
+    // and stops them.
+    void setTunnelStarted(bool isStarted);
+
+    // called on every update
+    void setStatusCallback(StatusCallback callback) { statusCallback_ = callback; }
+    // as for HELPER_CMD_GET_WIREGUARD_STATUS, as of the last update
+    const CMD_ANSWER &status() const { return status_; }
+
+private:
+    // the state changes quickly while connecting, the client checked it at the same rates before
+    static constexpr int kUpdateIntervalMs = 100;
+    static constexpr int kActiveUpdateIntervalMs = 500;
+
+    boost::asio::steady_timer timer_;
+    tunnel_stats::Segment *segment_;
+    tunnel_stats::Snapshot snapshot_;
+    bool isTunnelStarted_;
+    CMD_ANSWER status_;
+    StatusCallback statusCallback_;
+
+    bool createSegment();
+    void update();
+    void scheduleUpdate();
+};
@@ -0,0 +1,59 @@
+#include "wireguardstatuswaiter.h"
+
+WireGuardStatusWaiter::WireGuardStatusWaiter(boost::asio::io_service &service, const CMD_WAIT_WIREGUARD_STATUS &cmd, Callback callback)
+    : timeoutTimer_(service), cmd_(cmd), callback_(callback), isFinished_(false)
+{
+}
+
+void WireGuardStatusWaiter::start(const CMD_ANSWER &current)
+{
+    startTime_ = std::chrono::steady_clock::now();
+    lastStatus_ = current;
+    check();
+    if (isFinished_) {
+        return;
+    }
+
+    timeoutTimer_.expires_after(std::chrono::milliseconds(cmd_.timeoutMs));
+    timeoutTimer_.async_wait([self = shared_from_this()](const boost::system::error_code &ec) {
+        if (!ec && !self->isFinished_) {
+            self->finish(self->lastStatus_);
+        }
+    });
+}
+
+void WireGuardStatusWaiter::onStatus(const CMD_ANSWER &status)
+{
+    if (!isFinished_) {
+        lastStatus_ = status;
+        check();
+    }
+}
+
+void WireGuardStatusWaiter::cancel()
+{
+    if (!isFinished_) {
+        finish(lastStatus_);
+    }
+}
+
+void WireGuardStatusWaiter::check()
+{
+    const auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime_).count();
+
+    if (!lastStatus_.executed || lastStatus_.cmdId != (unsigned long)cmd_.state || elapsedMs >= cmd_.timeoutMs) {
+        finish(lastStatus_);
+        return;
+    }
+    if (lastStatus_.cmdId == kWgStateActive && cmd_.statsIntervalMs > 0 && elapsedMs >= cmd_.statsIntervalMs &&
+        (lastStatus_.customInfoValue[0] != cmd_.bytesReceived || lastStatus_.customInfoValue[1] != cmd_.bytesTransmitted)) {
+        finish(lastStatus_);
+    }
+}
+
+void WireGuardStatusWaiter::finish(const CMD_ANSWER &answer)
+{
+    isFinished_ = true;
+    timeoutTimer_.cancel();
+    callback_(answer);
+}
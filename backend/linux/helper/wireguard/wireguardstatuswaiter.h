@@ -0,0 +1,38 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <boost/asio.hpp>
+#include <boost/enable_shared_from_this.hpp>
+
+#include "../../../posix_common/helper_commands.h"
+
+// Handles HELPER_CMD_WAIT_WIREGUARD_STATUS: holds the answer until the WireGuard status has changed as described
+// for CMD_WAIT_WIREGUARD_STATUS. The waiter does not poll, it is given the updates of WireGuardStatsPublisher,
+// so the client does not poll the status over the socket and the helper polls it once for all the waits.
+class WireGuardStatusWaiter : public boost::enable_shared_from_this<WireGuardStatusWaiter>
+{
+public:
+    typedef std::function<void(const CMD_ANSWER &answer)> Callback;
+
+    WireGuardStatusWaiter(boost::asio::io_service &service, const CMD_WAIT_WIREGUARD_STATUS &cmd, Callback callback);
+
+    // the current status is WireGuardStatsPublisher::status()
+    void start(const CMD_ANSWER &current);
+    // called for every status update
+    void onStatus(const CMD_ANSWER &status);
+    // answers right away with the last status
+    void cancel();
+    bool isFinished() const { return isFinished_; }
+
+private:
+    boost::asio::steady_timer timeoutTimer_;
+    CMD_WAIT_WIREGUARD_STATUS cmd_;
+    Callback callback_;
+    std::chrono::steady_clock::time_point startTime_;
+    CMD_ANSWER lastStatus_;
+    bool isFinished_;
+
+    void check();
+    void finish(const CMD_ANSWER &answer);
+};
@@ -44,6 +44,8 @@
 #define HELPER_CMD_HELPER_VERSION                    36
 #define HELPER_CMD_GET_INTERFACE_SSID                37
 #define HELPER_CMD_RESET_MAC_ADDRESSES               38 // Linux only
+#define HELPER_CMD_WAIT_WIREGUARD_STATUS             39 // Linux only
+#define HELPER_CMD_CANCEL_WAIT_WIREGUARD_STATUS      40 // Linux only
 
 // enums
 
@@ -162,6 +164,17 @@ struct CMD_CONFIGURE_WIREGUARD {
     uint16_t listenPort;
 };
 
+// Waits for a change of the WireGuard status, the answer is the same as for HELPER_CMD_GET_WIREGUARD_STATUS.
+// The helper answers when the state differs from the given one, or when the byte counters differ from the given ones
+// and statsIntervalMs has passed, or after timeoutMs anyway.
+struct CMD_WAIT_WIREGUARD_STATUS {
+    CmdWireGuardServiceState state;
+    unsigned long long bytesReceived;
+    unsigned long long bytesTransmitted;
+    unsigned int statsIntervalMs;
+    unsigned int timeoutMs;
+};
+
 struct CMD_START_CTRLD {
     std::string upstream1;
     std::string upstream2;
@@ -100,6 +100,17 @@ void serialize(Archive &ar, CMD_CONFIGURE_WIREGUARD &a, const unsigned int versi
     ar & a.listenPort;
 }
 
+template<class Archive>
+void serialize(Archive &ar, CMD_WAIT_WIREGUARD_STATUS &a, const unsigned int version)
+{
+    UNUSED(version);
+    ar & a.state;
+    ar & a.bytesReceived;
+    ar & a.bytesTransmitted;
+    ar & a.statsIntervalMs;
+    ar & a.timeoutMs;
+}
+
 template<class Archive>
 void serialize(Archive &ar, CMD_START_CTRLD &a, const unsigned int version)
 {
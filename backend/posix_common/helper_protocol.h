@@ -0,0 +1,211 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <unistd.h>
+
+#include "helper_commands.h"
+#include "helper_commands_serialize.h"
+
+// Framing of the helper commands and answers on the Unix socket (Linux).
+// Each command and answer is a HELPER_FRAME_HEADER followed by a body of header.length bytes.
+// The client gives every command a request id, the answer carries the same id, so several commands
+// can be in flight on one connection and their answers can come in any order.
+// The body is the command struct (CMD_ANSWER for the answers) written with helper_protocol::BinaryOArchive.
+
+#define HELPER_PROTOCOL_MAGIC           0x50485357 // "WSHP"
+#define HELPER_PROTOCOL_VERSION         1
+#define HELPER_PROTOCOL_MAX_BODY_SIZE   (64 * 1024 * 1024)
+
+struct HELPER_FRAME_HEADER {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t requestId;
+    int32_t cmdId;      // HELPER_CMD_*, the answer repeats it
+    int32_t pid;        // pid of the client, 0 in the answers
+    uint32_t length;    // size of the body
+};
+
+static_assert(sizeof(HELPER_FRAME_HEADER) == 24, "HELPER_FRAME_HEADER must not have padding");
+
+namespace helper_protocol {
+
+enum class FrameStatus { kComplete, kIncomplete, kInvalid };
+
+inline HELPER_FRAME_HEADER makeHeader(uint32_t requestId, int cmdId, pid_t pid, size_t length)
+{
+    HELPER_FRAME_HEADER header;
+    header.magic = HELPER_PROTOCOL_MAGIC;
+    header.version = HELPER_PROTOCOL_VERSION;
+    header.reserved = 0;
+    header.requestId = requestId;
+    header.cmdId = cmdId;
+    header.pid = pid;
+    header.length = (uint32_t)length;
+    return header;
+}
+
+// Checks the frame at the beginning of data. outHeader is filled for kComplete and kIncomplete (if the header itself is complete).
+inline FrameStatus parseFrame(const char *data, size_t size, HELPER_FRAME_HEADER &outHeader)
+{
+    if (size < sizeof(HELPER_FRAME_HEADER)) {
+        return FrameStatus::kIncomplete;
+    }
+    memcpy(&outHeader, data, sizeof(outHeader));
+    if (outHeader.magic != HELPER_PROTOCOL_MAGIC || outHeader.version != HELPER_PROTOCOL_VERSION ||
+        outHeader.length > HELPER_PROTOCOL_MAX_BODY_SIZE) {
+        return FrameStatus::kInvalid;
+    }
+    if (size < sizeof(HELPER_FRAME_HEADER) + outHeader.length) {
+        return FrameStatus::kIncomplete;
+    }
+    return FrameStatus::kComplete;
+}
+
+inline void appendFrame(std::string &out, uint32_t requestId, int cmdId, pid_t pid, const std::string &body)
+{
+    HELPER_FRAME_HEADER header = makeHeader(requestId, cmdId, pid, body.size());
+    out.append((const char *)&header, sizeof(header));
+    out.append(body);
+}
+
+// Binary archives for the serialize() functions of helper_commands_serialize.h.
+// The numbers are written as is, the client and the helper always run on the same machine.
+// The strings and vectors are prefixed with their size.
+class BinaryOArchive
+{
+public:
+    explicit BinaryOArchive(std::string &out) : out_(out) {}
+
+    template<typename T>
+    BinaryOArchive &operator<<(const T &t)
+    {
+        write(t);
+        return *this;
+    }
+
+    template<typename T>
+    BinaryOArchive &operator&(const T &t)
+    {
+        write(t);
+        return *this;
+    }
+
+private:
+    std::string &out_;
+
+    template<typename T>
+    void write(const T &t)
+    {
+        if constexpr (std::is_arithmetic_v<T> || std::is_enum_v<T>) {
+            out_.append((const char *)&t, sizeof(t));
+        } else {
+            boost::serialization::serialize(*this, const_cast<T &>(t), 0u);
+        }
+    }
+
+    template<typename C>
+    void write(const std::basic_string<C> &s)
+    {
+        write((uint32_t)s.size());
+        out_.append((const char *)s.data(), s.size() * sizeof(C));
+    }
+
+    template<typename T>
+    void write(const std::vector<T> &v)
+    {
+        write((uint32_t)v.size());
+        for (const auto &it : v) {
+            write(it);
+        }
+    }
+};
+
+// Throws std::runtime_error if the data is truncated.
+class BinaryIArchive
+{
+public:
+    BinaryIArchive(const char *data, size_t size) : data_(data), size_(size), pos_(0) {}
+
+    template<typename T>
+    BinaryIArchive &operator>>(T &t)
+    {
+        read(t);
+        return *this;
+    }
+
+    template<typename T>
+    BinaryIArchive &operator&(T &t)
+    {
+        read(t);
+        return *this;
+    }
+
+private:
+    const char *data_;
+    size_t size_;
+    size_t pos_;
+
+    const char *take(size_t size)
+    {
+        if (size > size_ - pos_) {
+            throw std::runtime_error("helper_protocol: truncated data");
+        }
+        const char *p = data_ + pos_;
+        pos_ += size;
+        return p;
+    }
+
+    template<typename T>
+    void read(T &t)
+    {
+        if constexpr (std::is_arithmetic_v<T> || std::is_enum_v<T>) {
+            memcpy(&t, take(sizeof(t)), sizeof(t));
+        } else {
+            boost::serialization::serialize(*this, t, 0u);
+        }
+    }
+
+    template<typename C>
+    void read(std::basic_string<C> &s)
+    {
+        uint32_t size;
+        read(size);
+        if (size > (size_ - pos_) / sizeof(C)) {
+            throw std::runtime_error("helper_protocol: truncated data");
+        }
+        s.resize(size);
+        memcpy((char *)s.data(), take(size * sizeof(C)), size * sizeof(C));
+    }
+
+    template<typename T>
+    void read(std::vector<T> &v)
+    {
+        uint32_t size;
+        read(size);
+        // every element takes at least one byte, do not trust the size blindly
+        if (size > size_ - pos_) {
+            throw std::runtime_error("helper_protocol: truncated data");
+        }
+        v.resize(size);
+        for (auto &it : v) {
+            read(it);
+        }
+    }
+};
+
+template<typename T>
+std::string serialize(const T &t)
+{
+    std::string out;
+    BinaryOArchive oa(out);
+    oa << t;
+    return out;
+}
+
+} // namespace helper_protocol
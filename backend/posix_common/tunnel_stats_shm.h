@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Tunnel statistics the helper publishes in a shared memory segment (Linux), the client maps it read-only
+// and reads it without syscalls.
+// One writer and any number of readers, synchronized with a seqlock: the writer makes the sequence odd, updates
+// the fields and makes the sequence even again; a reader retries if the sequence was odd or changed while it read.
+// The fields are atomics, so the reads which race with a write are well defined and only discarded.
+
+#define TUNNEL_STATS_SHM_NAME       "/windscribe-tunnel-stats"
+#define TUNNEL_STATS_SHM_MAGIC      0x53545357 // "WSTS"
+#define TUNNEL_STATS_SHM_VERSION    1
+
+namespace tunnel_stats {
+
+enum State : uint32_t {
+    kStateNone = 0,
+    kStateConnecting,
+    kStateActive,
+    kStateError
+};
+
+struct Snapshot
+{
+    uint32_t state = kStateNone;
+    uint64_t generation = 0;        // incremented for every new tunnel, the counters restart from 0 then
+    uint64_t bytesReceived = 0;
+    uint64_t bytesTransmitted = 0;
+    int64_t lastHandshakeSec = 0;   // unix time, 0 if no handshake
+    int64_t updateTimeMs = 0;       // CLOCK_MONOTONIC
+};
+
+struct Segment
+{
+    std::atomic<uint32_t> magic;    // set last, once the segment is initialized
+    uint32_t version;
+    std::atomic<uint32_t> sequence;
+    std::atomic<uint32_t> state;
+    std::atomic<uint64_t> generation;
+    std::atomic<uint64_t> bytesReceived;
+    std::atomic<uint64_t> bytesTransmitted;
+    std::atomic<int64_t> lastHandshakeSec;
+    std::atomic<int64_t> updateTimeMs;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+              "the segment is shared between processes, the atomics must not use locks");
+
+inline void write(Segment *segment, const Snapshot &snapshot)
+{
+    const uint32_t sequence = segment->sequence.load(std::memory_order_relaxed);
+    segment->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    segment->state.store(snapshot.state, std::memory_order_relaxed);
+    segment->generation.store(snapshot.generation, std::memory_order_relaxed);
+    segment->bytesReceived.store(snapshot.bytesReceived, std::memory_order_relaxed);
+    segment->bytesTransmitted.store(snapshot.bytesTransmitted, std::memory_order_relaxed);
+    segment->lastHandshakeSec.store(snapshot.lastHandshakeSec, std::memory_order_relaxed);
+    segment->updateTimeMs.store(snapshot.updateTimeMs, std::memory_order_relaxed);
+
+    segment->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+// Returns false if the segment is not initialized, has another version, or the writer kept it busy.
+inline bool read(const Segment *segment, Snapshot &outSnapshot)
+{
+    if (segment->magic.load(std::memory_order_acquire) != TUNNEL_STATS_SHM_MAGIC || segment->version != TUNNEL_STATS_SHM_VERSION) {
+        return false;
+    }
+
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        const uint32_t sequence = segment->sequence.load(std::memory_order_acquire);
+        if (sequence & 1) {
+            continue;
+        }
+
+        outSnapshot.state = segment->state.load(std::memory_order_relaxed);
+        outSnapshot.generation = segment->generation.load(std::memory_order_relaxed);
+        outSnapshot.bytesReceived = segment->bytesReceived.load(std::memory_order_relaxed);
+        outSnapshot.bytesTransmitted = segment->bytesTransmitted.load(std::memory_order_relaxed);
+        outSnapshot.lastHandshakeSec = segment->lastHandshakeSec.load(std::memory_order_relaxed);
+        outSnapshot.updateTimeMs = segment->updateTimeMs.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (segment->sequence.load(std::memory_order_relaxed) == sequence) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace tunnel_stats
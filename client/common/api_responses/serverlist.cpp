@@ -1,16 +1,19 @@
 #include "serverlist.h"
 #include <QJsonDocument>
 #include <QJsonArray>
+#include <QMutex>
+#include <functional>
+#include <string_view>
 
 namespace api_responses {
 
-ServerList::ServerList(const std::string &json)
+ServerList::ServerList(const std::string &json) : hash_(std::hash<std::string_view>()(json))
 {
     if (json.empty())
         return;
 
     QJsonParseError errCode;
-    auto doc = QJsonDocument::fromJson(QByteArray(json.c_str()), &errCode);
+    auto doc = QJsonDocument::fromJson(QByteArray::fromRawData(json.c_str(), json.size()), &errCode);
     auto jsonObject = doc.object();
 
     // get country_override parameter
@@ -34,7 +37,103 @@ ServerList::ServerList(const std::string &json)
             }
         }
     }
+
+    mergeWindflixLocations();
+    buildIndexes();
+}
+
+std::shared_ptr<const ServerList> ServerList::create(const std::string &json)
+{
+    static QMutex mutex;
+    static std::shared_ptr<const ServerList> last;
+    static std::string lastJson;
+
+    // the hash rules out most of the changed payloads without a comparison, the bytes are compared if it matches
+    const size_t hash = std::hash<std::string_view>()(json);
+    QMutexLocker locker(&mutex);
+    if (!last || last->hash() != hash || lastJson != json) {
+        last = std::make_shared<const ServerList>(json);
+        lastJson = json;
+    }
+    return last;
+}
+
+const Location *ServerList::locationById(int id) const
+{
+    auto it = locationById_.constFind(id);
+    return it != locationById_.constEnd() ? &locations_[it.value()] : nullptr;
 }
 
+bool ServerList::groupByHostname(const QString &hostname, GroupIndex &index) const
+{
+    auto it = groupByHostname_.constFind(hostname);
+    if (it == groupByHostname_.constEnd()) {
+        return false;
+    }
+    index = it.value();
+    return true;
+}
+
+void ServerList::mergeWindflixLocations()
+{
+    // Build a new list of server locations to merge, removing them from the old list.
+    // Currently we merge all WindFlix locations into the corresponding global locations.
+    QVector<Location> locationsToMerge;
+    QMutableVectorIterator<Location> it(locations_);
+    while (it.hasNext()) {
+        Location &location = it.next();
+        if (location.getName().startsWith("WINDFLIX")) {
+            locationsToMerge.append(location);
+            it.remove();
+        }
+    }
+    if (!locationsToMerge.size())
+        return;
+
+    // Map city names to locations for faster lookups.
+    QHash<QString, Location *> location_hash;
+    for (auto &location: locations_) {
+        for (int i = 0; i < location.groupsCount(); ++i)
+        {
+            const Group group = location.getGroup(i);
+            location_hash.insert(location.getCountryCode() + group.getCity(), &location);
+        }
+    }
+
+    // Merge the locations.
+    for (const Location &location : std::as_const(locationsToMerge)) {
+        const auto country_code = location.getCountryCode();
+
+        for (int i = 0; i < location.groupsCount(); ++i)
+        {
+            Group group = location.getGroup(i);
+            group.setOverrideDnsHostName(location.getDnsHostName());
+
+            auto target = location_hash.find(country_code + group.getCity());
+            WS_ASSERT(target != location_hash.end());
+            if (target != location_hash.end())
+            {
+                target.value()->addGroup(group);
+            }
+        }
+    }
+}
+
+void ServerList::buildIndexes()
+{
+    for (int l = 0; l < locations_.size(); ++l) {
+        const Location &location = locations_[l];
+        locationById_.insert(location.getId(), l);
+        for (int g = 0; g < location.groupsCount(); ++g) {
+            const Group group = location.getGroup(g);
+            const GroupIndex index = { l, g };
+            pingIps_ << group.getPingIp();
+            groupsByPingIp_[group.getPingIp()] << index;
+            for (int n = 0; n < group.getNodesCount(); ++n) {
+                groupByHostname_.insert(group.getNode(n).getHostname(), index);
+            }
+        }
+    }
+}
 
 } // namespace api_responses
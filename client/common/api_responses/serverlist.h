@@ -1,24 +1,54 @@
 #pragma once
 
+#include <QHash>
 #include <QString>
+#include <memory>
 #include "location.h"
 
 namespace api_responses {
 
+// The server list with the WINDFLIX locations merged into the global ones, and the indexes of its groups.
+// Immutable once built; create() builds it once per payload and shares it while the payload is unchanged.
 class ServerList
 {
 public:
-    ServerList(const std::string &json);
+    struct GroupIndex
+    {
+        int location;
+        int group;
+    };
 
-    QVector<Location> locations() const { return locations_; }
+    explicit ServerList(const std::string &json);
+
+    // thread safe, returns the model of the previous call if the payload is the same
+    static std::shared_ptr<const ServerList> create(const std::string &json);
+
+    const QVector<Location> &locations() const { return locations_; }
     QStringList forceDisconnectNodes() const { return forceDisconnectNodes_; }
     QString countryOverride() const { return countryOverride_; }
+    size_t hash() const { return hash_; }
+
+    // the ping IPs of all the groups
+    const QStringList &pingIps() const { return pingIps_; }
+    // nullptr if there is no location with the id
+    const Location *locationById(int id) const;
+    QVector<GroupIndex> groupsByPingIp(const QString &ip) const { return groupsByPingIp_.value(ip); }
+    // returns false if no group has a node with the hostname
+    bool groupByHostname(const QString &hostname, GroupIndex &index) const;
 
 private:
     QVector<Location> locations_;
     QStringList forceDisconnectNodes_;
     QString countryOverride_;
+    size_t hash_;
+
+    QStringList pingIps_;
+    QHash<int, int> locationById_;
+    QHash<QString, QVector<GroupIndex>> groupsByPingIp_;
+    QHash<QString, GroupIndex> groupByHostname_;
 
+    void mergeWindflixLocations();
+    void buildIndexes();
 };
 
 } //namespace api_responses
@@ -0,0 +1,477 @@
+#include "networkstate_linux.h"
+
+#include <QHostAddress>
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/wireless.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../log/categories.h"
+
+const unsigned int NetworkState_linux::kMonitoredGroups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV4_ROUTE;
+
+namespace {
+
+// sends a dump request and passes the replies to the handler
+bool dumpRequest(int fd, int type, unsigned char family, const std::function<void(const nlmsghdr *)> &handler)
+{
+    // ifinfomsg, ifaddrmsg and rtmsg all start with the family
+    struct {
+        nlmsghdr hdr;
+        union {
+            ifinfomsg ifi;
+            ifaddrmsg ifa;
+            rtmsg rtm;
+        };
+    } req;
+    memset(&req, 0, sizeof(req));
+    size_t payloadSize = type == RTM_GETLINK ? sizeof(ifinfomsg) : (type == RTM_GETADDR ? sizeof(ifaddrmsg) : sizeof(rtmsg));
+    req.hdr.nlmsg_len = NLMSG_LENGTH(payloadSize);
+    req.hdr.nlmsg_type = type;
+    req.hdr.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.hdr.nlmsg_seq = type;
+    req.ifi.ifi_family = family;
+
+    if (send(fd, &req, req.hdr.nlmsg_len, 0) < 0) {
+        return false;
+    }
+
+    std::vector<char> buf(32768);
+    while (true) {
+        ssize_t len = recv(fd, buf.data(), buf.size(), 0);
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        for (const nlmsghdr *hdr = (const nlmsghdr *)buf.data(); NLMSG_OK(hdr, len); hdr = NLMSG_NEXT(hdr, len)) {
+            if (hdr->nlmsg_type == NLMSG_DONE) {
+                return true;
+            }
+            if (hdr->nlmsg_type == NLMSG_ERROR) {
+                return false;
+            }
+            handler(hdr);
+        }
+    }
+}
+
+bool isWirelessByIfName(const QString &ifname)
+{
+    bool ret = false;
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd != -1) {
+        struct iwreq pwrq;
+        memset(&pwrq, 0, sizeof(pwrq));
+        strncpy(pwrq.ifr_name, ifname.toStdString().c_str(), IFNAMSIZ-1);
+        if (ioctl(fd, SIOCGIWNAME, &pwrq) != -1) {
+            ret = true;
+        }
+        close(fd);
+    }
+    return ret;
+}
+
+} // namespace
+
+bool NetworkState_linux::Link::operator==(const Link &other) const
+{
+    return name == other.name && flags == other.flags && operState == other.operState &&
+           physicalAddress == other.physicalAddress && ipv4Addresses == other.ipv4Addresses;
+}
+
+bool NetworkState_linux::DefaultRoute::operator==(const DefaultRoute &other) const
+{
+    return interfaceIndex == other.interfaceIndex && gateway == other.gateway && metric == other.metric;
+}
+
+void NetworkState_linux::startMonitoring()
+{
+    QMutexLocker locker(&mutex_);
+    isMonitored_ = true;
+    dump(false);
+}
+
+void NetworkState_linux::stopMonitoring()
+{
+    QMutexLocker locker(&mutex_);
+    isMonitored_ = false;
+}
+
+bool NetworkState_linux::handleMessage(const nlmsghdr *hdr)
+{
+    QMutexLocker locker(&mutex_);
+    return applyMessage(hdr);
+}
+
+bool NetworkState_linux::resync()
+{
+    QMutexLocker locker(&mutex_);
+    return dump(false);
+}
+
+void NetworkState_linux::getDefaultRoute(QString &outGatewayIp, QString &outInterfaceName, QString &outAdapterIp, bool ignoreTun)
+{
+    QMutexLocker locker(&mutex_);
+    updateIfNotMonitored();
+
+    outInterfaceName.clear();
+    outGatewayIp.clear();
+    outAdapterIp.clear();
+
+    int lowestMetric = INT32_MAX;
+    for (const DefaultRoute &route : qAsConst(defaultRoutes_)) {
+        auto it = links_.constFind(route.interfaceIndex);
+        if (it == links_.constEnd()) {
+            continue;
+        }
+        // if ignoring tun interfaces, remove them from contention
+        if (ignoreTun && (it->name.startsWith("tun") || it->name.startsWith("utun"))) {
+            continue;
+        }
+        if (route.metric < lowestMetric) {
+            lowestMetric = route.metric;
+            outInterfaceName = it->name;
+            outAdapterIp = adapterIp(*it);
+            outGatewayIp = QHostAddress(route.gateway).toString();
+        }
+    }
+}
+
+QString NetworkState_linux::getLocalIP()
+{
+    QMutexLocker locker(&mutex_);
+    updateIfNotMonitored();
+
+    // the first address of the interfaces which are up, as 'hostname -I' lists them
+    for (const Link &link : qAsConst(links_)) {
+        if ((link.flags & IFF_UP) && !(link.flags & IFF_LOOPBACK) && !link.ipv4Addresses.isEmpty()) {
+            return QHostAddress(link.ipv4Addresses.first()).toString();
+        }
+    }
+    return QString();
+}
+
+QList<types::NetworkInterface> NetworkState_linux::currentNetworkInterfaces(bool includeNoInterface)
+{
+    QMutexLocker locker(&mutex_);
+    updateIfNotMonitored();
+    updateNetworkByInterface(locker);
+
+    QList<types::NetworkInterface> interfaces;
+    if (includeNoInterface) {
+        interfaces.push_back(types::NetworkInterface::noNetworkInterface());
+    }
+
+    QList<int> indexes;
+    for (auto it = links_.constBegin(); it != links_.constEnd(); ++it) {
+        // Ignore loopback
+        if (it->name != "lo") {
+            indexes << it.key();
+        }
+    }
+    std::sort(indexes.begin(), indexes.end(), [this](int a, int b) { return links_[a].name < links_[b].name; });
+
+    for (int index : qAsConst(indexes)) {
+        interfaces.push_back(toNetworkInterface(index, links_[index]));
+    }
+    return interfaces;
+}
+
+types::NetworkInterface NetworkState_linux::networkInterfaceByName(const QString &name)
+{
+    types::NetworkInterface interface = types::NetworkInterface::noNetworkInterface();
+    if (name.isEmpty()) {
+        return interface;
+    }
+
+    QMutexLocker locker(&mutex_);
+    updateIfNotMonitored();
+    updateNetworkByInterface(locker);
+
+    for (auto it = links_.constBegin(); it != links_.constEnd(); ++it) {
+        if (it->name == name) {
+            return toNetworkInterface(it.key(), *it);
+        }
+    }
+
+    // the link is gone
+    Link link;
+    link.name = name;
+    return toNetworkInterface(0, link);
+}
+
+void NetworkState_linux::updateIfNotMonitored()
+{
+    if (!isMonitored_) {
+        dump(false);
+    }
+}
+
+bool NetworkState_linux::dump(bool isRoutesOnly)
+{
+    const QMap<int, Link> oldLinks = links_;
+    const QVector<DefaultRoute> oldDefaultRoutes = defaultRoutes_;
+    const quint64 oldLinksRevision = linksRevision_;
+
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd < 0) {
+        qCDebug(LOG_BASIC) << "NetworkState_linux could not open netlink socket:" << errno;
+        return false;
+    }
+
+    defaultRoutes_.clear();
+    if (!isRoutesOnly) {
+        links_.clear();
+    }
+
+    const auto handler = [this](const nlmsghdr *hdr) { applyMessage(hdr); };
+    bool isSuccess = true;
+    if (!isRoutesOnly) {
+        isSuccess = dumpRequest(fd, RTM_GETLINK, AF_UNSPEC, handler) && dumpRequest(fd, RTM_GETADDR, AF_INET, handler);
+    }
+    isSuccess = isSuccess && dumpRequest(fd, RTM_GETROUTE, AF_INET, handler);
+    close(fd);
+
+    if (!isSuccess) {
+        qCDebug(LOG_BASIC) << "NetworkState_linux failed to dump the network state:" << errno;
+    }
+    // the links are added anew by the dump, only a real change makes nmcli run again
+    if (!isRoutesOnly) {
+        linksRevision_ = links_ != oldLinks ? oldLinksRevision + 1 : oldLinksRevision;
+    }
+    return links_ != oldLinks || defaultRoutes_ != oldDefaultRoutes;
+}
+
+bool NetworkState_linux::applyMessage(const nlmsghdr *hdr)
+{
+    switch (hdr->nlmsg_type) {
+    case RTM_NEWLINK:
+    case RTM_DELLINK:
+        return applyLinkMessage(hdr);
+    case RTM_NEWADDR:
+    case RTM_DELADDR:
+        return applyAddressMessage(hdr);
+    case RTM_NEWROUTE:
+    case RTM_DELROUTE:
+        return applyRouteMessage(hdr);
+    default:
+        return false;
+    }
+}
+
+bool NetworkState_linux::applyLinkMessage(const nlmsghdr *hdr)
+{
+    const ifinfomsg *ifi = (const ifinfomsg *)NLMSG_DATA(hdr);
+    int len = hdr->nlmsg_len - NLMSG_LENGTH(sizeof(*ifi));
+    if (len < 0) {
+        return false;
+    }
+
+    auto it = links_.find(ifi->ifi_index);
+    if (hdr->nlmsg_type == RTM_DELLINK) {
+        if (it == links_.end()) {
+            return false;
+        }
+        links_.erase(it);
+        // the kernel drops the routes of the link without notifications
+        defaultRoutes_.erase(std::remove_if(defaultRoutes_.begin(), defaultRoutes_.end(),
+                                            [ifi](const DefaultRoute &route) { return route.interfaceIndex == ifi->ifi_index; }),
+                             defaultRoutes_.end());
+        linksRevision_++;
+        return true;
+    }
+
+    Link link;
+    link.flags = ifi->ifi_flags;
+    unsigned char mac[6] = {};
+    for (const rtattr *rta = IFLA_RTA(ifi); RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+        if (rta->rta_type == IFLA_IFNAME) {
+            link.name = QString::fromUtf8((const char *)RTA_DATA(rta));
+        } else if (rta->rta_type == IFLA_OPERSTATE) {
+            link.operState = *(const unsigned char *)RTA_DATA(rta);
+        } else if (rta->rta_type == IFLA_ADDRESS) {
+            memcpy(mac, RTA_DATA(rta), std::min<size_t>(RTA_PAYLOAD(rta), sizeof(mac)));
+        }
+    }
+    link.physicalAddress = QString::asprintf("%.2X:%.2X:%.2X:%.2X:%.2X:%.2X", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+
+    if (it != links_.end()) {
+        link.ipv4Addresses = it->ipv4Addresses;
+        link.isWireless = it->name == link.name ? it->isWireless : isWirelessByIfName(link.name);
+        if (*it == link) {
+            return false;
+        }
+        if ((it->flags & IFF_UP) && !(link.flags & IFF_UP)) {
+            // the kernel drops the routes of a link going down without notifications
+            defaultRoutes_.erase(std::remove_if(defaultRoutes_.begin(), defaultRoutes_.end(),
+                                                [ifi](const DefaultRoute &route) { return route.interfaceIndex == ifi->ifi_index; }),
+                                 defaultRoutes_.end());
+        }
+        *it = link;
+    } else {
+        link.isWireless = isWirelessByIfName(link.name);
+        links_.insert(ifi->ifi_index, link);
+    }
+    linksRevision_++;
+    return true;
+}
+
+bool NetworkState_linux::applyAddressMessage(const nlmsghdr *hdr)
+{
+    const ifaddrmsg *ifa = (const ifaddrmsg *)NLMSG_DATA(hdr);
+    int len = hdr->nlmsg_len - NLMSG_LENGTH(sizeof(*ifa));
+    if (len < 0 || ifa->ifa_family != AF_INET) {
+        return false;
+    }
+    auto it = links_.find(ifa->ifa_index);
+    if (it == links_.end()) {
+        return false;
+    }
+
+    quint32 address = 0;
+    bool hasAddress = false;
+    for (const rtattr *rta = IFA_RTA(ifa); RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+        // IFA_LOCAL differs from IFA_ADDRESS on point-to-point links, where the latter is the peer
+        if ((rta->rta_type == IFA_LOCAL || (rta->rta_type == IFA_ADDRESS && !hasAddress)) && RTA_PAYLOAD(rta) >= sizeof(quint32)) {
+            address = ntohl(*(const quint32 *)RTA_DATA(rta));
+            hasAddress = true;
+        }
+    }
+    if (!hasAddress) {
+        return false;
+    }
+
+    if (hdr->nlmsg_type == RTM_NEWADDR) {
+        if (it->ipv4Addresses.contains(address)) {
+            return false;
+        }
+        it->ipv4Addresses << address;
+    } else {
+        if (!it->ipv4Addresses.removeOne(address)) {
+            return false;
+        }
+        // the kernel drops the routes through the removed subnet without notifications
+        dump(true);
+    }
+    linksRevision_++;
+    return true;
+}
+
+bool NetworkState_linux::applyRouteMessage(const nlmsghdr *hdr)
+{
+    const rtmsg *rtm = (const rtmsg *)NLMSG_DATA(hdr);
+    int len = hdr->nlmsg_len - NLMSG_LENGTH(sizeof(*rtm));
+    // only the default routes of the main table, as in /proc/net/route
+    if (len < 0 || rtm->rtm_family != AF_INET || rtm->rtm_dst_len != 0 || rtm->rtm_type != RTN_UNICAST) {
+        return false;
+    }
+
+    unsigned int table = rtm->rtm_table;
+    DefaultRoute route;
+    for (const rtattr *rta = RTM_RTA(rtm); RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+        if (rta->rta_type == RTA_TABLE) {
+            table = *(const quint32 *)RTA_DATA(rta);
+        } else if (rta->rta_type == RTA_OIF) {
+            route.interfaceIndex = *(const int *)RTA_DATA(rta);
+        } else if (rta->rta_type == RTA_GATEWAY) {
+            route.gateway = ntohl(*(const quint32 *)RTA_DATA(rta));
+        } else if (rta->rta_type == RTA_PRIORITY) {
+            route.metric = *(const quint32 *)RTA_DATA(rta);
+        }
+    }
+    if (table != RT_TABLE_MAIN) {
+        return false;
+    }
+
+    if (hdr->nlmsg_type == RTM_NEWROUTE) {
+        if (defaultRoutes_.contains(route)) {
+            return false;
+        }
+        defaultRoutes_ << route;
+        return true;
+    }
+    return defaultRoutes_.removeOne(route);
+}
+
+void NetworkState_linux::updateNetworkByInterface(QMutexLocker<QMutex> &locker)
+{
+    if (networkByInterfaceRevision_ == linksRevision_) {
+        return;
+    }
+
+    // nmcli may take a while, the state is not blocked meanwhile; if the links change during the run, the next query runs it again
+    const quint64 revision = linksRevision_;
+    locker.unlock();
+    QHash<QString, QString> networkByInterface = readNetworkByInterface();
+    locker.relock();
+
+    // another query may have stored a newer result meanwhile
+    if (revision >= networkByInterfaceRevision_) {
+        networkByInterface_ = std::move(networkByInterface);
+        networkByInterfaceRevision_ = revision;
+    }
+}
+
+QHash<QString, QString> NetworkState_linux::readNetworkByInterface()
+{
+    QHash<QString, QString> networkByInterface;
+
+    // one call for all the interfaces
+    QString strReply;
+    FILE *file = popen("nmcli -t -f NAME,DEVICE c show", "r");
+    if (file) {
+        char szLine[4096];
+        while(fgets(szLine, sizeof(szLine), file) != 0) {
+            strReply += szLine;
+        }
+        pclose(file);
+    }
+
+    const QStringList lines = strReply.split('\n', Qt::SkipEmptyParts);
+    for (auto &it : lines) {
+        const QStringList pars = it.split(':', Qt::SkipEmptyParts);
+        if (pars.size() == 2 && !networkByInterface.contains(pars[1])) {
+            networkByInterface.insert(pars[1], pars[0]);
+        }
+    }
+    return networkByInterface;
+}
+
+QString NetworkState_linux::adapterIp(const Link &link) const
+{
+    if (link.operState != IF_OPER_UP || link.ipv4Addresses.isEmpty()) {
+        return QString();
+    }
+    return QHostAddress(link.ipv4Addresses.first()).toString();
+}
+
+types::NetworkInterface NetworkState_linux::toNetworkInterface(int index, const Link &link)
+{
+    types::NetworkInterface interface = types::NetworkInterface::noNetworkInterface();
+    interface.interfaceName = link.name;
+    interface.interfaceIndex = index;
+    interface.physicalAddress = index != 0 ? link.physicalAddress : QString();
+    interface.networkOrSsid = networkByInterface_.value(link.name);
+
+    if (link.isWireless) {
+        interface.interfaceType = NETWORK_INTERFACE_WIFI;
+        interface.friendlyName = "Wi-Fi";
+    } else {
+        interface.interfaceType = NETWORK_INTERFACE_ETH;
+        interface.friendlyName = "Ethernet";
+    }
+
+    interface.active = (link.flags & (IFF_UP | IFF_RUNNING)) == (IFF_UP | IFF_RUNNING);
+    return interface;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+#include "types/networkinterface.h"
+
+struct nlmsghdr;
+
+// In-memory state of the network links, their IPv4 addresses and the IPv4 default routes, read over rtnetlink.
+// While monitored, RouteMonitor_linux keeps the state up to date from the multicast messages of kMonitoredGroups,
+// otherwise every query dumps the state from the kernel. The NetworkManager connections are read with nmcli only after
+// the links changed, without holding the mutex. Thread-safe.
+class NetworkState_linux
+{
+public:
+    static NetworkState_linux &instance()
+    {
+        static NetworkState_linux s;
+        return s;
+    }
+
+    static const unsigned int kMonitoredGroups;
+
+    // Dumps the state, the caller must already be subscribed to kMonitoredGroups and pass the messages to handleMessage().
+    void startMonitoring();
+    void stopMonitoring();
+    // Applies a multicast message, returns true if the state changed.
+    bool handleMessage(const nlmsghdr *hdr);
+    // Dumps the state again, e.g. after the socket lost messages. Returns true if the state changed.
+    bool resync();
+
+    void getDefaultRoute(QString &outGatewayIp, QString &outInterfaceName, QString &outAdapterIp, bool ignoreTun);
+    QString getLocalIP();
+    QList<types::NetworkInterface> currentNetworkInterfaces(bool includeNoInterface);
+    types::NetworkInterface networkInterfaceByName(const QString &name);
+
+private:
+    struct Link
+    {
+        QString name;
+        unsigned int flags = 0;
+        int operState = 0;
+        QString physicalAddress;
+        bool isWireless = false;
+        QVector<quint32> ipv4Addresses;     // in the kernel order, the primary address first
+
+        bool operator==(const Link &other) const;
+    };
+
+    struct DefaultRoute
+    {
+        int interfaceIndex = 0;
+        quint32 gateway = 0;
+        int metric = 0;
+
+        bool operator==(const DefaultRoute &other) const;
+    };
+
+    QMutex mutex_;
+    bool isMonitored_ = false;
+    QMap<int, Link> links_;     // by interface index
+    QVector<DefaultRoute> defaultRoutes_;
+    // incremented when the links or their addresses change
+    quint64 linksRevision_ = 1;
+    // the NetworkManager connection of the interfaces, read again when linksRevision_ moves past the revision it was read at
+    QHash<QString, QString> networkByInterface_;
+    quint64 networkByInterfaceRevision_ = 0;
+
+    NetworkState_linux() {}
+
+    void updateIfNotMonitored();
+    bool dump(bool isRoutesOnly);
+    bool applyMessage(const nlmsghdr *hdr);
+    bool applyLinkMessage(const nlmsghdr *hdr);
+    bool applyAddressMessage(const nlmsghdr *hdr);
+    bool applyRouteMessage(const nlmsghdr *hdr);
+    // runs nmcli with the mutex unlocked if the links changed since the last run
+    void updateNetworkByInterface(QMutexLocker<QMutex> &locker);
+    static QHash<QString, QString> readNetworkByInterface();
+    QString adapterIp(const Link &link) const;
+    types::NetworkInterface toNetworkInterface(int index, const Link &link);
+};
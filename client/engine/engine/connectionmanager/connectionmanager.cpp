@@ -10,6 +10,7 @@
 #include "openvpnconnection.h"
 #include "engine/crossplatformobjectfactory.h"
 #include "testvpntunnel.h"
+#include "tunnelstatsprovider.h"
 #include "engine/wireguardconfig/getwireguardconfig.h"
 
 #include "utils/ws_assert.h"
@@ -84,6 +85,9 @@ ConnectionManager::ConnectionManager(QObject *parent, IHelper *helper, INetworkD
     testVPNTunnel_ = new TestVPNTunnel(this);
     connect(testVPNTunnel_, &TestVPNTunnel::testsFinished, this, &ConnectionManager::onTunnelTestsFinished);
 
+    statsProvider_ = new TunnelStatsProvider(this);
+    connect(statsProvider_, &TunnelStatsProvider::statisticsUpdated, this, &ConnectionManager::statisticsUpdated);
+
     makeOVPNFile_ = new MakeOVPNFile();
     makeOVPNFileFromCustom_ = new MakeOVPNFileFromCustom();
 
@@ -372,6 +376,7 @@ void ConnectionManager::onConnectionConnected(const AdapterGatewayInfo &connecti
     timerReconnection_.stop();
     connectingTimer_.stop();
     state_ = STATE_CONNECTED;
+    statsProvider_->start();
     emit connected();
 }
 
@@ -387,6 +392,7 @@ void ConnectionManager::onConnectionDisconnected()
     qCDebug(LOG_CONNECTION) << "ConnectionManager::onConnectionDisconnected(), state_ =" << state_;
 
     testVPNTunnel_->stopTests();
+    statsProvider_->stop();
     doMacRestoreProcedures();
     stunnelManager_->killProcess();
     wstunnelManager_->killProcess();
@@ -1237,7 +1243,7 @@ void ConnectionManager::recreateConnector(types::Protocol protocol)
 
         if (protocol.isOpenVpnProtocol())
         {
-            connector_ = new OpenVPNConnection(this, helper_);
+            connector_ = new OpenVPNConnection(this, helper_, statsProvider_);
         }
         else if (protocol.isIkev2Protocol())
         {
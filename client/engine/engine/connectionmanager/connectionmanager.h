@@ -29,6 +29,7 @@ class INetworkDetectionManager;
 class ISleepEvents;
 class IKEv2Connection;
 class TestVPNTunnel;
+class TunnelStatsProvider;
 enum class WireGuardConfigRetCode;
 class GetWireGuardConfig;
 
@@ -180,6 +181,7 @@ private:
     MakeOVPNFile *makeOVPNFile_;
     MakeOVPNFileFromCustom *makeOVPNFileFromCustom_;
     TestVPNTunnel *testVPNTunnel_;
+    TunnelStatsProvider *statsProvider_;
 
     bool bIgnoreConnectionErrorsForOpenVpn_;
     bool bWasSuccessfullyConnectionAttempt_;
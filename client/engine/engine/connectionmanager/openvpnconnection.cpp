@@ -20,7 +20,8 @@
 #endif
 
 
-OpenVPNConnection::OpenVPNConnection(QObject *parent, IHelper *helper) : IConnection(parent), helper_(helper),
+OpenVPNConnection::OpenVPNConnection(QObject *parent, IHelper *helper, TunnelStatsProvider *statsProvider) : IConnection(parent),
+    helper_(helper), statsProvider_(statsProvider),
     bStopThread_(false), currentState_(STATUS_DISCONNECTED),
     isAllowFirewallAfterCustomConfigConnection_(false), privKeyPassword_("")
 {
@@ -59,6 +60,7 @@ void OpenVPNConnection::startConnect(const QString &config, const QString &ip, c
     isCustomConfig_ = isCustomConfig;
 
     stateVariables_.reset();
+    statsProvider_->resetTotals();
     connectionAdapterInfo_.clear();
     start(LowPriority);
 }
@@ -441,27 +443,16 @@ void OpenVPNConnection::handleRead(const boost::system::error_code &err, size_t
         }
         else if (serverReply.startsWith(">BYTECOUNT:", Qt::CaseInsensitive))
         {
-            QStringList pars = serverReply.split(":");
-            if (pars.count() > 1)
+            // ">BYTECOUNT:{received},{sent}", the totals of the OpenVPN process
+            const int comma = serverReply.indexOf(',', 11);
+            if (comma != -1)
             {
-                QStringList pars2 = pars[1].split(",");
-                if (pars2.count() == 2)
+                bool isInOk = false, isOutOk = false;
+                quint64 bytesIn = QStringView(serverReply).mid(11, comma - 11).toULongLong(&isInOk);
+                quint64 bytesOut = QStringView(serverReply).mid(comma + 1).toULongLong(&isOutOk);
+                if (isInOk && isOutOk)
                 {
-                    quint64 l1 = pars2[0].toULongLong();
-                    quint64 l2 = pars2[1].toULongLong();
-                    if (stateVariables_.bFirstCalcStat)
-                    {
-                        stateVariables_.prevBytesRcved = l1;
-                        stateVariables_.prevBytesXmited = l2;
-                        emit statisticsUpdated(stateVariables_.prevBytesRcved, stateVariables_.prevBytesXmited, false);
-                        stateVariables_.bFirstCalcStat = false;
-                    }
-                    else
-                    {
-                        emit statisticsUpdated(l1 - stateVariables_.prevBytesRcved, l2 - stateVariables_.prevBytesXmited, false);
-                        stateVariables_.prevBytesRcved = l1;
-                        stateVariables_.prevBytesXmited = l2;
-                    }
+                    statsProvider_->setTotals(bytesIn, bytesOut);
                 }
             }
         }
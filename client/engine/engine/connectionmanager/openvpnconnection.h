@@ -6,6 +6,7 @@
 #include <QMutex>
 #include "engine/helper/ihelper.h"
 #include "iconnection.h"
+#include "tunnelstatsprovider.h"
 #include "types/proxysettings.h"
 #include "utils/boost_includes.h"
 #include <atomic>
@@ -15,7 +16,8 @@ class OpenVPNConnection : public IConnection
     Q_OBJECT
 
 public:
-    explicit OpenVPNConnection(QObject *parent, IHelper *helper);
+    // the traffic counters are reported to statsProvider rather than with statisticsUpdated()
+    explicit OpenVPNConnection(QObject *parent, IHelper *helper, TunnelStatsProvider *statsProvider);
     ~OpenVPNConnection() override;
 
     void startConnect(const QString &configOrUrl, const QString &ip, const QString &dnsHostName,
@@ -49,6 +51,7 @@ private:
     static constexpr int MAX_WAIT_OPENVPN_ON_START = 20000;
 
     IHelper *helper_;
+    TunnelStatsProvider *statsProvider_;
     std::atomic<bool> bStopThread_;
 
     boost::asio::io_service io_service_;
@@ -84,10 +87,6 @@ private:
         bool bSigTermSent;
         bool bNeedSendSigTerm;
 
-        bool bFirstCalcStat;
-        quint64 prevBytesRcved;
-        quint64 prevBytesXmited;
-
         unsigned long lastCmdId;
         unsigned int openVpnPort;
 
@@ -107,9 +106,6 @@ private:
             bTapErrorEmited = false;
             bWasStateNotification = false;
             bWasSecondAttemptToStartOpenVpn = false;
-            bFirstCalcStat = true;
-            prevBytesRcved = 0;
-            prevBytesXmited = 0;
             lastCmdId = 0;
             openVpnPort = 0;
             bWasSocketConnected = false;
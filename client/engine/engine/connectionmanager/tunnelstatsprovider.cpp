@@ -0,0 +1,143 @@
+#include "tunnelstatsprovider.h"
+
+#ifdef Q_OS_LINUX
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+#include "utils/log/categories.h"
+
+TunnelStatsProvider::TunnelStatsProvider(QObject *parent) : QObject(parent),
+    totalIn_(0), totalOut_(0), totalsGeneration_(0), sampledTotalsGeneration_(0), sampledTotalIn_(0), sampledTotalOut_(0)
+#ifdef Q_OS_LINUX
+    , segment_(nullptr), isSegmentSampled_(false)
+#endif
+{
+    sampleTimer_.setInterval(kSampleIntervalMs);
+    connect(&sampleTimer_, &QTimer::timeout, this, &TunnelStatsProvider::onSampleTimer);
+}
+
+TunnelStatsProvider::~TunnelStatsProvider()
+{
+#ifdef Q_OS_LINUX
+    if (segment_) {
+        munmap(const_cast<tunnel_stats::Segment *>(segment_), sizeof(tunnel_stats::Segment));
+    }
+#endif
+}
+
+void TunnelStatsProvider::setTotals(quint64 bytesIn, quint64 bytesOut)
+{
+    totalIn_.store(bytesIn, std::memory_order_relaxed);
+    totalOut_.store(bytesOut, std::memory_order_relaxed);
+}
+
+void TunnelStatsProvider::resetTotals()
+{
+    totalIn_.store(0, std::memory_order_relaxed);
+    totalOut_.store(0, std::memory_order_relaxed);
+    totalsGeneration_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void TunnelStatsProvider::start()
+{
+#ifdef Q_OS_LINUX
+    // the helper may have been started after the engine
+    if (!segment_ && mapSegment()) {
+        qCDebug(LOG_CONNECTION) << "Reading the tunnel statistics from the helper's shared memory";
+    }
+#endif
+    if (!sampleTimer_.isActive()) {
+        sampleTimer_.start();
+        onSampleTimer();
+    }
+}
+
+void TunnelStatsProvider::stop()
+{
+    if (sampleTimer_.isActive()) {
+        // report the traffic since the last sample
+        onSampleTimer();
+        sampleTimer_.stop();
+    }
+}
+
+void TunnelStatsProvider::onSampleTimer()
+{
+    quint64 bytesIn = 0;
+    quint64 bytesOut = 0;
+
+    const quint32 totalsGeneration = totalsGeneration_.load(std::memory_order_relaxed);
+    if (totalsGeneration != sampledTotalsGeneration_) {
+        sampledTotalsGeneration_ = totalsGeneration;
+        sampledTotalIn_ = 0;
+        sampledTotalOut_ = 0;
+    }
+    const quint64 totalIn = totalIn_.load(std::memory_order_relaxed);
+    const quint64 totalOut = totalOut_.load(std::memory_order_relaxed);
+    // the counters only go back if the connection restarted without a reset
+    bytesIn += totalIn >= sampledTotalIn_ ? totalIn - sampledTotalIn_ : totalIn;
+    bytesOut += totalOut >= sampledTotalOut_ ? totalOut - sampledTotalOut_ : totalOut;
+    sampledTotalIn_ = totalIn;
+    sampledTotalOut_ = totalOut;
+
+#ifdef Q_OS_LINUX
+    sampleSegment(bytesIn, bytesOut);
+#endif
+
+    if (bytesIn != 0 || bytesOut != 0) {
+        emit statisticsUpdated(bytesIn, bytesOut, false);
+    }
+}
+
+#ifdef Q_OS_LINUX
+
+bool TunnelStatsProvider::mapSegment()
+{
+    int fd = shm_open(TUNNEL_STATS_SHM_NAME, O_RDONLY, 0);
+    if (fd < 0) {
+        return false;
+    }
+    void *addr = mmap(nullptr, sizeof(tunnel_stats::Segment), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        qCDebug(LOG_CONNECTION) << "Couldn't map the tunnel statistics segment:" << errno;
+        return false;
+    }
+    segment_ = static_cast<const tunnel_stats::Segment *>(addr);
+    return true;
+}
+
+void TunnelStatsProvider::sampleSegment(quint64 &bytesIn, quint64 &bytesOut)
+{
+    tunnel_stats::Snapshot snapshot;
+    if (!segment_ || !tunnel_stats::read(segment_, snapshot)) {
+        return;
+    }
+
+    if (!isSegmentSampled_) {
+        // the counters of a finished tunnel were counted by a previous run, a running one is counted from its start
+        isSegmentSampled_ = true;
+        sampledSnapshot_ = snapshot;
+        if (snapshot.state == tunnel_stats::kStateNone) {
+            return;
+        }
+        sampledSnapshot_.bytesReceived = 0;
+        sampledSnapshot_.bytesTransmitted = 0;
+    }
+    if (snapshot.generation != sampledSnapshot_.generation) {
+        sampledSnapshot_.bytesReceived = 0;
+        sampledSnapshot_.bytesTransmitted = 0;
+    }
+
+    if (snapshot.bytesReceived >= sampledSnapshot_.bytesReceived) {
+        bytesIn += snapshot.bytesReceived - sampledSnapshot_.bytesReceived;
+    }
+    if (snapshot.bytesTransmitted >= sampledSnapshot_.bytesTransmitted) {
+        bytesOut += snapshot.bytesTransmitted - sampledSnapshot_.bytesTransmitted;
+    }
+    sampledSnapshot_ = snapshot;
+}
+
+#endif
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <QObject>
+#include <QTimer>
+#include <atomic>
+
+#ifdef Q_OS_LINUX
+    #include "../../../../backend/posix_common/tunnel_stats_shm.h"
+#endif
+
+// Samples the traffic counters of the tunnel at the display rate and reports the traffic since the previous
+// sample with statisticsUpdated(), at most once per sample and only if there was traffic.
+// The connections store their cumulative counters with setTotals() from any thread, without a signal per update.
+// On Linux the WireGuard counters are read from the segment the helper publishes (see tunnel_stats_shm.h).
+class TunnelStatsProvider : public QObject
+{
+    Q_OBJECT
+public:
+    explicit TunnelStatsProvider(QObject *parent);
+    ~TunnelStatsProvider() override;
+
+    // Thread-safe. The counters of a new connection restart from 0 after resetTotals().
+    void setTotals(quint64 bytesIn, quint64 bytesOut);
+    void resetTotals();
+
+    void start();
+    void stop();
+
+signals:
+    void statisticsUpdated(quint64 bytesIn, quint64 bytesOut, bool isTotalBytes);
+
+private slots:
+    void onSampleTimer();
+
+private:
+    static constexpr int kSampleIntervalMs = 500;
+
+    QTimer sampleTimer_;
+
+    std::atomic<quint64> totalIn_;
+    std::atomic<quint64> totalOut_;
+    std::atomic<quint32> totalsGeneration_;
+    quint32 sampledTotalsGeneration_;
+    quint64 sampledTotalIn_;
+    quint64 sampledTotalOut_;
+
+#ifdef Q_OS_LINUX
+    const tunnel_stats::Segment *segment_;
+    bool isSegmentSampled_;
+    tunnel_stats::Snapshot sampledSnapshot_;
+
+    bool mapSegment();
+    void sampleSegment(quint64 &bytesIn, quint64 &bytesOut);
+#endif
+};
@@ -21,6 +21,10 @@ public:
     void configure();
     void disconnect();
     bool getStatus(types::WireGuardStatus *status);
+#ifdef Q_OS_LINUX
+    bool waitStatus(types::WireGuardStatus *status, unsigned int statsIntervalMs, unsigned int timeoutMs);
+    void cancelWaitStatus();
+#endif
     bool stopWireGuard();
 
     QString getAdapterName() const { return adapterName_; }
@@ -94,6 +98,20 @@ bool WireGuardConnectionImpl::getStatus(types::WireGuardStatus *status)
     return isStarted_ && host_->helper_->getWireGuardStatus(status);
 }
 
+#ifdef Q_OS_LINUX
+bool WireGuardConnectionImpl::waitStatus(types::WireGuardStatus *status, unsigned int statsIntervalMs, unsigned int timeoutMs)
+{
+    Helper_linux *helper = dynamic_cast<Helper_linux *>(host_->helper_);
+    return isStarted_ && helper->waitWireGuardStatus(status, statsIntervalMs, timeoutMs);
+}
+
+void WireGuardConnectionImpl::cancelWaitStatus()
+{
+    Helper_linux *helper = dynamic_cast<Helper_linux *>(host_->helper_);
+    helper->cancelWaitWireGuardStatus();
+}
+#endif
+
 bool WireGuardConnectionImpl::stopWireGuard()
 {
     if (isStarted_) {
@@ -146,6 +164,7 @@ void WireGuardConnection::startConnect(const QString &configPathOrUrl, const QSt
     qCDebug(LOG_CONNECTION) << "Connecting WireGuard:" << pimpl_->getAdapterName();
 
     do_stop_thread_ = true;
+    wakeUpThread();
     wait();
     do_stop_thread_ = false;
 
@@ -178,6 +197,7 @@ void WireGuardConnection::startDisconnect()
 
     adapterGatewayInfo_.clear();
     do_stop_thread_ = true;
+    wakeUpThread();
 }
 
 bool WireGuardConnection::isDisconnected() const
@@ -196,11 +216,26 @@ QString WireGuardConnection::getWireGuardAdapterName()
     return QString("utun420");
 }
 
+void WireGuardConnection::wakeUpThread()
+{
+#ifdef Q_OS_LINUX
+    // the thread may be blocked in the status wait
+    if (isRunning()) {
+        pimpl_->cancelWaitStatus();
+    }
+#endif
+}
+
 void WireGuardConnection::run()
 {
     types::WireGuardStatus status;
+    status.state = types::WireGuardState::NONE;
+    status.errorCode = 0;
+    status.bytesReceived = status.bytesTransmitted = 0;
+#ifndef Q_OS_LINUX
     quint64 bytesReceived = 0;
     quint64 bytesTransmitted = 0;
+#endif
     bool is_configured = false;
     bool is_connected = false;
     QElapsedTimer elapsedTimer;
@@ -215,12 +250,22 @@ void WireGuardConnection::run()
         }
         const auto current_state = getCurrentState();
         unsigned int next_status_check_ms = 100u;
+        bool isStatusWaited = false;
         if (current_state != ConnectionState::DISCONNECTED) {
 
             if (current_state == ConnectionState::CONNECTED)
                 elapsedTimer.invalidate();
 
-            if (!pimpl_->getStatus(&status)) {
+#ifdef Q_OS_LINUX
+            // the helper holds the answer until the status changes, so there is no need to sleep between the checks;
+            // the byte counters are read by TunnelStatsProvider from the helper's shared memory, they don't end the wait
+            const unsigned int timeoutMs = current_state == ConnectionState::CONNECTED ? kStatusWaitTimeoutMs : kConnectingStatusWaitTimeoutMs;
+            const bool isStatusReceived = pimpl_->waitStatus(&status, 0, timeoutMs);
+            isStatusWaited = true;
+#else
+            const bool isStatusReceived = pimpl_->getStatus(&status);
+#endif
+            if (!isStatusReceived) {
                 qCDebug(LOG_WIREGUARD) << "Failed to get WireGuard status";
                 pimpl_->disconnect();
                 break;
@@ -257,6 +302,7 @@ void WireGuardConnection::run()
                     is_connected = true;
                     setCurrentStateAndEmitSignal(WireGuardConnection::ConnectionState::CONNECTED);
                 }
+#ifndef Q_OS_LINUX
                 const auto newBytesReceived = status.bytesReceived - bytesReceived;
                 const auto newBytesTransmitted = status.bytesTransmitted - bytesTransmitted;
                 if (newBytesReceived || newBytesTransmitted) {
@@ -264,6 +310,7 @@ void WireGuardConnection::run()
                     bytesTransmitted = status.bytesTransmitted;
                     emit statisticsUpdated(newBytesReceived, newBytesTransmitted, false);
                 }
+#endif
                 next_status_check_ms = 500u;
                 break;
             }
@@ -274,7 +321,8 @@ void WireGuardConnection::run()
             setError(STATE_TIMEOUT_FOR_AUTOMATIC);
         }
 
-        QThread::msleep(next_status_check_ms);
+        if (!isStatusWaited)
+            QThread::msleep(next_status_check_ms);
     }
 }
 
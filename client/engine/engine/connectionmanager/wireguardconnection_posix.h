@@ -42,11 +42,15 @@ private:
     enum class ConnectionState { DISCONNECTED, CONNECTING, CONNECTED };
     static constexpr int PROCESS_KILL_TIMEOUT = 10000;
     static constexpr int kTimeoutForAutomatic = 20000;  // 20 secs timeout for the automatic connection mode
+    // Linux only, the status wait in the helper (see Helper_linux::waitWireGuardStatus)
+    static constexpr unsigned int kConnectingStatusWaitTimeoutMs = 1000;
+    static constexpr unsigned int kStatusWaitTimeoutMs = 10000;
 
     ConnectionState getCurrentState() const;
     void setCurrentState(ConnectionState state);
     void setCurrentStateAndEmitSignal(ConnectionState state);
     void setError(CONNECT_ERROR err);
+    void wakeUpThread();
     bool checkForKernelModule();
 
     IHelper *helper_;
@@ -21,7 +21,8 @@ EmergencyController::EmergencyController(QObject *parent, IHelper *helper) : QOb
     helper_(helper),
     state_(STATE_DISCONNECTED)
 {
-    connector_ = new OpenVPNConnection(this, helper_);
+    // the emergency connection does not report traffic, so its counters are never sampled
+    connector_ = new OpenVPNConnection(this, helper_, new TunnelStatsProvider(this));
     connect(connector_, &OpenVPNConnection::connected, this, &EmergencyController::onConnectionConnected, Qt::QueuedConnection);
     connect(connector_, &OpenVPNConnection::disconnected, this, &EmergencyController::onConnectionDisconnected, Qt::QueuedConnection);
     connect(connector_, &OpenVPNConnection::reconnecting, this, &EmergencyController::onConnectionReconnecting, Qt::QueuedConnection);
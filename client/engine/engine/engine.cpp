@@ -28,7 +28,6 @@
 #include "firewall/firewallexceptions.h"
 #include "getdeviceid.h"
 #include "openvpnversioncontroller.h"
-#include "apiresources/apiutils.h"
 
 #ifdef Q_OS_WIN
     #include <Objbase.h>
@@ -1125,7 +1124,7 @@ void Engine::continueWithPrivKeyPasswordImpl(const QString &password, bool bSave
 
 void Engine::gotoCustomOvpnConfigModeImpl()
 {
-    api_responses::ServerList serverLocations(WSNet::instance()->apiResourcersManager()->locations());
+    auto serverLocations = api_responses::ServerList::create(WSNet::instance()->apiResourcersManager()->locations());
     api_responses::StaticIps staticIps(WSNet::instance()->apiResourcersManager()->staticIps());
     updateServerLocations(serverLocations, staticIps);
     myIpManager_->getIP(1);
@@ -1740,7 +1739,9 @@ void Engine::detectAppropriatePacketSizeImpl()
         qCDebug(LOG_PACKET_SIZE) << "Detecting appropriate packet size";
         runningPacketDetection_ = true;
         emit packetSizeDetectionStateChanged(true, false);
-        packetSizeController_->detectAppropriatePacketSize(HardcodedSettings::instance().windscribeHost());
+        types::NetworkInterface networkInterface;
+        networkDetectionManager_->getCurrentNetworkInterface(networkInterface);
+        packetSizeController_->detectAppropriatePacketSize(HardcodedSettings::instance().windscribeHost(), networkInterface.networkOrSsid);
     }
     else
     {
@@ -2017,7 +2018,7 @@ void Engine::syncRobert()
 void Engine::onCustomConfigsChanged()
 {
     qCDebug(LOG_BASIC) << "Custom configs changed";
-    api_responses::ServerList serverLocations(WSNet::instance()->apiResourcersManager()->locations());
+    auto serverLocations = api_responses::ServerList::create(WSNet::instance()->apiResourcersManager()->locations());
     api_responses::StaticIps staticIps(WSNet::instance()->apiResourcersManager()->staticIps());
     updateServerLocations(serverLocations, staticIps);
 }
@@ -2313,14 +2314,14 @@ void Engine::onApiResourcesManagerLoginFailed(LoginResult loginResult, const QSt
 
 void Engine::onApiResourcesManagerLocationsUpdated()
 {
-    api_responses::ServerList serverLocations(WSNet::instance()->apiResourcersManager()->locations());
+    auto serverLocations = api_responses::ServerList::create(WSNet::instance()->apiResourcersManager()->locations());
     api_responses::StaticIps staticIps(WSNet::instance()->apiResourcersManager()->staticIps());
     updateServerLocations(serverLocations, staticIps);
 
     // Auto-enable anti-censorship for first-run users if the serverlist endpoint returned a country override.
     if (checkAutoEnableAntiCensorship_) {
         checkAutoEnableAntiCensorship_ = false;
-        if (!serverLocations.countryOverride().isEmpty() && !ExtraConfig::instance().haveServerListCountryOverride()) {
+        if (!serverLocations->countryOverride().isEmpty() && !ExtraConfig::instance().haveServerListCountryOverride()) {
             qCDebug(LOG_BASIC) << "Automatically enabled anti-censorship feature due to country override";
             emit autoEnableAntiCensorship();
         }
@@ -2338,14 +2339,12 @@ void Engine::onApiResourcesManagerServerCredentialsFetched()
     }
 }
 
-void Engine::updateServerLocations(const api_responses::ServerList &serverLocations, const api_responses::StaticIps &staticIps)
+void Engine::updateServerLocations(const std::shared_ptr<const api_responses::ServerList> &serverLocations, const api_responses::StaticIps &staticIps)
 {
     qCDebug(LOG_BASIC) << "Servers locations changed";
-    auto locations = serverLocations.locations();
-    ApiUtils::mergeWindflixLocations(locations);
-    locationsModel_->setApiLocations(locations, staticIps);
+    locationsModel_->setApiLocations(serverLocations, staticIps);
     locationsModel_->setCustomConfigLocations(customConfigs_->getConfigs());
-    checkForceDisconnectNode(serverLocations.forceDisconnectNodes());
+    checkForceDisconnectNode(serverLocations->forceDisconnectNodes());
 }
 
 void Engine::updateFirewallSettings()
@@ -2519,6 +2518,10 @@ void Engine::updateSessionStatus(const std::string &json)
 
 void Engine::saveWsnetSettings()
 {
+    // the authHash is one of the wsnet settings as well
+    if (!WSNet::instance()->isPersistentSettingsChanged())
+        return;
+
     QString wsnetSettings = QString::fromStdString(WSNet::instance()->currentPersistentSettings());
     QSettings settings;
     settings.setValue("wsnetSettings", wsnetSettings);
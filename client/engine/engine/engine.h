@@ -374,7 +374,7 @@ private:
 
     void doCheckUpdate();
     void loginImpl(bool isUseAuthHash, const QString &username, const QString &password, const QString &code2fa);
-    void updateServerLocations(const api_responses::ServerList &serverLocations, const api_responses::StaticIps &staticIps);
+    void updateServerLocations(const std::shared_ptr<const api_responses::ServerList> &serverLocations, const api_responses::StaticIps &staticIps);
     void updateFirewallSettings();
 
     void addCustomRemoteIpToFirewallIfNeed();
@@ -4,6 +4,7 @@
 #include <stdlib.h>
 
 #include "../../../../backend/posix_common/helper_commands_serialize.h"
+#include "types/wireguardtypes.h"
 #include "utils/log/categories.h"
 
 Helper_linux::Helper_linux(QObject *parent) : Helper_posix(parent)
@@ -45,31 +46,76 @@ std::optional<bool> Helper_linux::installUpdate(const QString &package) const
 
 bool Helper_linux::setDnsLeakProtectEnabled(bool bEnabled)
 {
-    QMutexLocker locker(&mutex_);
-
     CMD_ANSWER answer;
     CMD_SET_DNS_LEAK_PROTECT_ENABLED cmd;
     cmd.enabled = bEnabled;
 
-    std::stringstream stream;
-    boost::archive::text_oarchive oa(stream, boost::archive::no_header);
-    oa << cmd;
-
-    return runCommand(HELPER_CMD_SET_DNS_LEAK_PROTECT_ENABLED, stream.str(), answer);
+    return runCommand(HELPER_CMD_SET_DNS_LEAK_PROTECT_ENABLED, serializeCommand(cmd), answer);
 }
 
 bool Helper_linux::resetMacAddresses(const QString &ignoreNetwork)
 {
-    QMutexLocker locker(&mutex_);
-
     CMD_ANSWER answer;
     CMD_RESET_MAC_ADDRESSES cmd;
     cmd.ignoreNetwork = ignoreNetwork.toStdString();
 
-    std::stringstream stream;
-    boost::archive::text_oarchive oa(stream, boost::archive::no_header);
-    oa << cmd;
+    return runCommand(HELPER_CMD_RESET_MAC_ADDRESSES, serializeCommand(cmd), answer) && answer.executed;
+}
+
+
+bool Helper_linux::waitWireGuardStatus(types::WireGuardStatus *status, unsigned int statsIntervalMs, unsigned int timeoutMs)
+{
+    if (curState_ != STATE_CONNECTED) {
+        return false;
+    }
+
+    CMD_WAIT_WIREGUARD_STATUS cmd;
+    switch (status->state) {
+    case types::WireGuardState::FAILURE:
+        cmd.state = kWgStateError;
+        break;
+    case types::WireGuardState::STARTING:
+        cmd.state = kWgStateStarting;
+        break;
+    case types::WireGuardState::LISTENING:
+        cmd.state = kWgStateListening;
+        break;
+    case types::WireGuardState::CONNECTING:
+        cmd.state = kWgStateConnecting;
+        break;
+    case types::WireGuardState::ACTIVE:
+        cmd.state = kWgStateActive;
+        break;
+    case types::WireGuardState::NONE:
+    default:
+        cmd.state = kWgStateNone;
+        break;
+    }
+    cmd.bytesReceived = status->bytesReceived;
+    cmd.bytesTransmitted = status->bytesTransmitted;
+    cmd.statsIntervalMs = statsIntervalMs;
+    cmd.timeoutMs = timeoutMs;
+
+    CMD_ANSWER answer;
+    if (!runCommand(HELPER_CMD_WAIT_WIREGUARD_STATUS, serializeCommand(cmd), answer)) {
+        doDisconnectAndReconnect();
+        return false;
+    }
+    if (!answer.executed) {
+        return false;
+    }
 
-    return runCommand(HELPER_CMD_RESET_MAC_ADDRESSES, stream.str(), answer) && answer.executed;
+    status->errorCode = 0;
+    wireGuardStatusFromAnswer(answer, status);
+    return true;
 }
 
+bool Helper_linux::cancelWaitWireGuardStatus()
+{
+    if (curState_ != STATE_CONNECTED) {
+        return false;
+    }
+
+    CMD_ANSWER answer;
+    return runCommand(HELPER_CMD_CANCEL_WAIT_WIREGUARD_STATUS, std::string(), answer);
+}
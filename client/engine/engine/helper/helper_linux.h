@@ -18,4 +18,10 @@ public:
     std::optional<bool> installUpdate(const QString& package) const;
     bool setDnsLeakProtectEnabled(bool bEnabled);
     bool resetMacAddresses(const QString &ignoreNetwork = "");
+
+    // Blocks until the WireGuard status differs from *status (the state, or the byte counters after statsIntervalMs),
+    // or until timeoutMs, and updates *status. Returns false if the helper failed.
+    bool waitWireGuardStatus(types::WireGuardStatus *status, unsigned int statsIntervalMs, unsigned int timeoutMs);
+    // makes the current (or the next) waitWireGuardStatus() return immediately
+    bool cancelWaitWireGuardStatus();
 };
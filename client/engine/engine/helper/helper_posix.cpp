@@ -8,6 +8,7 @@
 #include <QCoreApplication>
 #include <QThread>
 #include <QDateTime>
+#include <array>
 #include "types/wireguardtypes.h"
 #include "../openvpnversioncontroller.h"
 #include "installhelper_mac.h"
@@ -30,7 +31,7 @@ using namespace boost::asio;
 Helper_posix *g_this_ = NULL;
 
 Helper_posix::Helper_posix(QObject *parent) : IHelper(parent), cmdId_(0), lastOpenVPNCmdId_(0)
-  , ep_(SOCK_PATH), bHelperConnectedEmitted_(false)
+  , ep_(SOCK_PATH), lastRequestId_(0), isReadingAnswers_(false), bHelperConnectedEmitted_(false)
   , curState_(STATE_INIT), bNeedFinish_(false), firstConnectToHelperErrorReported_(false)
 {
     WS_ASSERT(g_this_ == NULL);
@@ -57,8 +58,6 @@ void Helper_posix::setNeedFinish()
 
 void Helper_posix::getUnblockingCmdStatus(unsigned long cmdId, QString &outLog, bool &outFinished)
 {
-    QMutexLocker locker(&mutex_);
-
     outFinished = false;
     if (curState_ != STATE_CONNECTED)
     {
@@ -68,12 +67,8 @@ void Helper_posix::getUnblockingCmdStatus(unsigned long cmdId, QString &outLog,
     CMD_GET_CMD_STATUS cmd;
     cmd.cmdId = cmdId;
 
-    std::stringstream stream;
-    boost::archive::text_oarchive oa(stream, boost::archive::no_header);
-    oa << cmd;
-
     CMD_ANSWER answer;
-    if (!runCommand(HELPER_CMD_GET_CMD_STATUS, stream.str(), answer) || answer.executed == 0) {
+    if (!runCommand(HELPER_CMD_GET_CMD_STATUS, serializeCommand(cmd), answer) || answer.executed == 0) {
         doDisconnectAndReconnect();
         return;
     }
@@ -86,20 +81,14 @@ void Helper_posix::clearUnblockingCmd(unsigned long cmdId)
 {
     Q_UNUSED(cmdId);
 
-    QMutexLocker locker(&mutex_);
-
     if (curState_ != STATE_CONNECTED) {
         return;
     }
 
     CMD_CLEAR_CMDS cmd;
 
-    std::stringstream stream;
-    boost::archive::text_oarchive oa(stream, boost::archive::no_header);
-    oa << cmd;
-
     CMD_ANSWER answer;
-    if (!runCommand(HELPER_CMD_CLEAR_CMDS, stream.str(), answer)) {
+    if (!runCommand(HELPER_CMD_CLEAR_CMDS, serializeCommand(cmd), answer)) {
         doDisconnectAndReconnect();
     }
 }
@@ -114,8 +103,6 @@ bool Helper_posix::setSplitTunnelingSettings(bool isActive, bool isExclude,
                                            bool isAllowLanTraffic, const QStringList &files,
                                            const QStringList &ips, const QStringList &hosts)
 {
-    QMutexLocker locker(&mutex_);
-
     if (curState_ != STATE_CONNECTED) {
         return false;
     }
@@ -137,12 +124,8 @@ bool Helper_posix::setSplitTunnelingSettings(bool isActive, bool isExclude,
         cmdSplitTunnelingSettings.hosts.push_back(hosts[i].toStdString());
     }
 
-    std::stringstream stream;
-    boost::archive::text_oarchive oa(stream, boost::archive::no_header);
-    oa << cmdSplitTunnelingSettings;
-
     CMD_ANSWER answer;
-    if (!runCommand(HELPER_CMD_SPLIT_TUNNELING_SETTINGS, stream.str(), answer)) {
+    if (!runCommand(HELPER_CMD_SPLIT_TUNNELING_SETTINGS, serializeCommand(cmdSplitTunnelingSettings), answer)) {
         doDisconnectAndReconnect();
         return false;
     }
@@ -155,8 +138,6 @@ bool Helper_posix::sendConnectStatus(bool isConnected, bool isTerminateSocket, b
 {
     Q_UNUSED(isTerminateSocket);
     Q_UNUSED(isKeepLocalSocket);
-    QMutexLocker locker(&mutex_);
-
     if (curState_ != STATE_CONNECTED) {
         return false;
     }
@@ -198,12 +179,8 @@ bool Helper_posix::sendConnectStatus(bool isConnected, bool isTerminateSocket, b
         cmd.remoteIp = vpnAdapter.remoteIp().toStdString();
     }
 
-    std::stringstream stream;
-    boost::archive::text_oarchive oa(stream, boost::archive::no_header);
-    oa << cmd;
-
     CMD_ANSWER answer;
-    if (!runCommand(HELPER_CMD_SEND_CONNECT_STATUS, stream.str(), answer)) {
+    if (!runCommand(HELPER_CMD_SEND_CONNECT_STATUS, serializeCommand(cmd), answer)) {
         doDisconnectAndReconnect();
         return false;
     }
@@ -216,41 +193,27 @@ bool Helper_posix::sendConnectStatus(bool isConnected, bool isTerminateSocket, b
 
 bool Helper_posix::changeMtu(const QString &adapter, int mtu)
 {
-    QMutexLocker locker(&mutex_);
-
     CMD_ANSWER answer;
     CMD_CHANGE_MTU cmd;
     cmd.mtu = mtu;
     cmd.adapterName = adapter.toStdString();
 
-    std::stringstream stream;
-    boost::archive::text_oarchive oa(stream, boost::archive::no_header);
-    oa << cmd;
-
-    return runCommand(HELPER_CMD_CHANGE_MTU, stream.str(), answer);
+    return runCommand(HELPER_CMD_CHANGE_MTU, serializeCommand(cmd), answer);
 }
 
 bool Helper_posix::deleteRoute(const QString &range, int mask, const QString &gateway)
 {
-    QMutexLocker locker(&mutex_);
-
     CMD_ANSWER answer;
     CMD_DELETE_ROUTE cmd;
     cmd.range = range.toStdString();
     cmd.mask = mask;
     cmd.gateway = gateway.toStdString();
 
-    std::stringstream stream;
-    boost::archive::text_oarchive oa(stream, boost::archive::no_header);
-    oa << cmd;
-
-    return runCommand(HELPER_CMD_DELETE_ROUTE, stream.str(), answer);
+    return runCommand(HELPER_CMD_DELETE_ROUTE, serializeCommand(cmd), answer);
 }
 
 IHelper::ExecuteError Helper_posix::startWireGuard()
 {
-    QMutexLocker locker(&mutex_);
-
     if (curState_ != STATE_CONNECTED) {
         return IHelper::EXECUTE_ERROR;
     }
@@ -267,8 +230,6 @@ IHelper::ExecuteError Helper_posix::startWireGuard()
 bool Helper_posix::stopWireGuard()
 {
     if (curState_ == STATE_CONNECTED) {
-        QMutexLocker locker(&mutex_);
-
         CMD_ANSWER answer;
         if (!runCommand(HELPER_CMD_STOP_WIREGUARD, "", answer)) {
             doDisconnectAndReconnect();
@@ -283,8 +244,6 @@ bool Helper_posix::stopWireGuard()
 
 bool Helper_posix::configureWireGuard(const WireGuardConfig &config)
 {
-    QMutexLocker locker(&mutex_);
-
     if (curState_ != STATE_CONNECTED)
         return false;
 
@@ -315,12 +274,8 @@ bool Helper_posix::configureWireGuard(const WireGuardConfig &config)
     cmd.allowedIps = config.peerAllowedIps().toLatin1().data();
     cmd.listenPort = config.clientListenPort().toUInt();
 
-    std::stringstream stream;
-    boost::archive::text_oarchive oa(stream, boost::archive::no_header);
-    oa << cmd;
-
     CMD_ANSWER answer;
-    if (!runCommand(HELPER_CMD_CONFIGURE_WIREGUARD, stream.str(), answer) || answer.executed == 0) {
+    if (!runCommand(HELPER_CMD_CONFIGURE_WIREGUARD, serializeCommand(cmd), answer) || answer.executed == 0) {
         qCDebug(LOG_WIREGUARD) << "WireGuard configuration failed";
         doDisconnectAndReconnect();
         return false;
@@ -330,8 +285,6 @@ bool Helper_posix::configureWireGuard(const WireGuardConfig &config)
 
 bool Helper_posix::getWireGuardStatus(types::WireGuardStatus *status)
 {
-    QMutexLocker locker(&mutex_);
-
     if (status) {
         status->state = types::WireGuardState::NONE;
         status->errorCode = 0;
@@ -350,6 +303,12 @@ bool Helper_posix::getWireGuardStatus(types::WireGuardStatus *status)
         return false;
     }
 
+    wireGuardStatusFromAnswer(answer, status);
+    return true;
+}
+
+void Helper_posix::wireGuardStatusFromAnswer(const CMD_ANSWER &answer, types::WireGuardStatus *status)
+{
     switch (answer.cmdId) {
     default:
     case kWgStateNone:
@@ -374,13 +333,10 @@ bool Helper_posix::getWireGuardStatus(types::WireGuardStatus *status)
         status->bytesTransmitted = answer.customInfoValue[1];
         break;
     }
-    return true;
 }
 
 bool Helper_posix::startCtrld(const QString &upstream1, const QString &upstream2, const QStringList &domains, bool isCreateLog)
 {
-    QMutexLocker locker(&mutex_);
-
     if (curState_ != STATE_CONNECTED) {
         return false;
     }
@@ -396,12 +352,8 @@ bool Helper_posix::startCtrld(const QString &upstream1, const QString &upstream2
     cmd.domains = domainsList;
     cmd.isCreateLog = isCreateLog;
 
-    std::stringstream stream;
-    boost::archive::text_oarchive oa(stream, boost::archive::no_header);
-    oa << cmd;
-
     CMD_ANSWER answer;
-    if (!runCommand(HELPER_CMD_START_CTRLD, stream.str(), answer) || answer.executed == 0) {
+    if (!runCommand(HELPER_CMD_START_CTRLD, serializeCommand(cmd), answer) || answer.executed == 0) {
         qCDebug(LOG_BASIC) << "helper returned error starting ctrld";
         doDisconnectAndReconnect();
         return false;
@@ -419,8 +371,6 @@ IHelper::ExecuteError Helper_posix::executeOpenVPN(const QString &config, unsign
                                                    const QString &socksProxy, unsigned int socksPort, unsigned long &outCmdId, bool isCustomConfig)
 
 {
-    QMutexLocker locker(&mutex_);
-
     if (curState_ != STATE_CONNECTED) {
         return IHelper::EXECUTE_ERROR;
     }
@@ -449,12 +399,8 @@ IHelper::ExecuteError Helper_posix::executeOpenVPN(const QString &config, unsign
     }
 #endif
 
-    std::stringstream stream;
-    boost::archive::text_oarchive oa(stream, boost::archive::no_header);
-    oa << cmd;
-
     CMD_ANSWER answer;
-    if (!runCommand(HELPER_CMD_START_OPENVPN, stream.str(), answer) || answer.executed == 0) {
+    if (!runCommand(HELPER_CMD_START_OPENVPN, serializeCommand(cmd), answer) || answer.executed == 0) {
         doDisconnectAndReconnect();
         return IHelper::EXECUTE_ERROR;
     }
@@ -465,47 +411,29 @@ IHelper::ExecuteError Helper_posix::executeOpenVPN(const QString &config, unsign
 
 bool Helper_posix::executeTaskKill(CmdKillTarget target)
 {
-    QMutexLocker locker(&mutex_);
-
     CMD_TASK_KILL cmd;
     CMD_ANSWER answer;
     cmd.target = target;
 
-    std::stringstream stream;
-    boost::archive::text_oarchive oa(stream, boost::archive::no_header);
-    oa << cmd;
-
-    return runCommand(HELPER_CMD_TASK_KILL, stream.str(), answer);
+    return runCommand(HELPER_CMD_TASK_KILL, serializeCommand(cmd), answer);
 }
 
 bool Helper_posix::setDnsScriptEnabled(bool bEnabled)
 {
-    QMutexLocker locker(&mutex_);
-
     CMD_SET_DNS_SCRIPT_ENABLED cmd;
     CMD_ANSWER answer;
     cmd.enabled = bEnabled;
 
-    std::stringstream stream;
-    boost::archive::text_oarchive oa(stream, boost::archive::no_header);
-    oa << cmd;
-
-    return runCommand(HELPER_CMD_SET_DNS_SCRIPT_ENABLED, stream.str(), answer);
+    return runCommand(HELPER_CMD_SET_DNS_SCRIPT_ENABLED, serializeCommand(cmd), answer);
 }
 
 bool Helper_posix::checkFirewallState(const QString &tag)
 {
-    QMutexLocker locker(&mutex_);
-
     CMD_CHECK_FIREWALL_STATE cmd;
     CMD_ANSWER answer;
     cmd.tag = tag.toStdString();
 
-    std::stringstream stream;
-    boost::archive::text_oarchive oa(stream, boost::archive::no_header);
-    oa << cmd;
-
-    if (!runCommand(HELPER_CMD_CHECK_FIREWALL_STATE, stream.str(), answer)) {
+    if (!runCommand(HELPER_CMD_CHECK_FIREWALL_STATE, serializeCommand(cmd), answer)) {
         return false;
     }
     return answer.exitCode != 0;
@@ -513,23 +441,15 @@ bool Helper_posix::checkFirewallState(const QString &tag)
 
 bool Helper_posix::clearFirewallRules(bool isKeepPfEnabled)
 {
-    QMutexLocker locker(&mutex_);
-
     CMD_CLEAR_FIREWALL_RULES cmd;
     CMD_ANSWER answer;
     cmd.isKeepPfEnabled = isKeepPfEnabled;
 
-    std::stringstream stream;
-    boost::archive::text_oarchive oa(stream, boost::archive::no_header);
-    oa << cmd;
-
-    return runCommand(HELPER_CMD_CLEAR_FIREWALL_RULES, stream.str(), answer);
+    return runCommand(HELPER_CMD_CLEAR_FIREWALL_RULES, serializeCommand(cmd), answer);
 }
 
 bool Helper_posix::setFirewallRules(CmdIpVersion version, const QString &table, const QString &group, const QString &rules)
 {
-    QMutexLocker locker(&mutex_);
-
     CMD_SET_FIREWALL_RULES cmd;
     CMD_ANSWER answer;
     cmd.ipVersion = version;
@@ -537,28 +457,18 @@ bool Helper_posix::setFirewallRules(CmdIpVersion version, const QString &table,
     cmd.group = group.toStdString();
     cmd.rules = rules.toStdString();
 
-    std::stringstream stream;
-    boost::archive::text_oarchive oa(stream, boost::archive::no_header);
-    oa << cmd;
-
-    return runCommand(HELPER_CMD_SET_FIREWALL_RULES, stream.str(), answer);
+    return runCommand(HELPER_CMD_SET_FIREWALL_RULES, serializeCommand(cmd), answer);
 }
 
 bool Helper_posix::getFirewallRules(CmdIpVersion version, const QString &table, const QString &group, QString &rules)
 {
-    QMutexLocker locker(&mutex_);
-
     CMD_GET_FIREWALL_RULES cmd;
     CMD_ANSWER answer;
     cmd.ipVersion = version;
     cmd.table = table.toStdString();
     cmd.group = group.toStdString();
 
-    std::stringstream stream;
-    boost::archive::text_oarchive oa(stream, boost::archive::no_header);
-    oa << cmd;
-
-    if (!runCommand(HELPER_CMD_GET_FIREWALL_RULES, stream.str(), answer)) {
+    if (!runCommand(HELPER_CMD_GET_FIREWALL_RULES, serializeCommand(cmd), answer)) {
         return false;
     }
     rules = QString::fromStdString(answer.body);
@@ -567,8 +477,6 @@ bool Helper_posix::getFirewallRules(CmdIpVersion version, const QString &table,
 
 bool Helper_posix::setFirewallOnBoot(bool enabled, const QSet<QString> &ipTable, bool allowLanTraffic)
 {
-    QMutexLocker locker(&mutex_);
-
     CMD_SET_FIREWALL_ON_BOOT cmd;
     CMD_ANSWER answer;
     cmd.enabled = enabled;
@@ -582,17 +490,11 @@ bool Helper_posix::setFirewallOnBoot(bool enabled, const QSet<QString> &ipTable,
 
     cmd.ipTable = ipTableStr;
 
-    std::stringstream stream;
-    boost::archive::text_oarchive oa(stream, boost::archive::no_header);
-    oa << cmd;
-
-    return runCommand(HELPER_CMD_SET_FIREWALL_ON_BOOT, stream.str(), answer);
+    return runCommand(HELPER_CMD_SET_FIREWALL_ON_BOOT, serializeCommand(cmd), answer);
 }
 
 bool Helper_posix::setMacAddress(const QString &interface, const QString &macAddress, const QString &network, bool isWifi)
 {
-    QMutexLocker locker(&mutex_);
-
     CMD_SET_MAC_ADDRESS cmd;
     CMD_ANSWER answer;
     cmd.interface = interface.toStdString();
@@ -600,29 +502,19 @@ bool Helper_posix::setMacAddress(const QString &interface, const QString &macAdd
     cmd.network = network.toStdString();
     cmd.isWifi = isWifi;
 
-    std::stringstream stream;
-    boost::archive::text_oarchive oa(stream, boost::archive::no_header);
-    oa << cmd;
-
-    return runCommand(HELPER_CMD_SET_MAC_ADDRESS, stream.str(), answer) && answer.executed;
+    return runCommand(HELPER_CMD_SET_MAC_ADDRESS, serializeCommand(cmd), answer) && answer.executed;
 }
 
 bool Helper_posix::startStunnel(const QString &hostname, unsigned int port, unsigned int localPort, bool extraPadding)
 {
-    QMutexLocker locker(&mutex_);
-
     CMD_START_STUNNEL cmd;
     cmd.hostname = hostname.toStdString();
     cmd.port = port;
     cmd.localPort = localPort;
     cmd.extraPadding = extraPadding;
 
-    std::stringstream stream;
-    boost::archive::text_oarchive oa(stream, boost::archive::no_header);
-    oa << cmd;
-
     CMD_ANSWER answer;
-    if (!runCommand(HELPER_CMD_START_STUNNEL, stream.str(), answer) || answer.executed == 0) {
+    if (!runCommand(HELPER_CMD_START_STUNNEL, serializeCommand(cmd), answer) || answer.executed == 0) {
         doDisconnectAndReconnect();
         return IHelper::EXECUTE_ERROR;
     }
@@ -632,19 +524,13 @@ bool Helper_posix::startStunnel(const QString &hostname, unsigned int port, unsi
 
 bool Helper_posix::startWstunnel(const QString &hostname, unsigned int port, unsigned int localPort)
 {
-    QMutexLocker locker(&mutex_);
-
     CMD_START_WSTUNNEL cmd;
     cmd.hostname = hostname.toStdString();
     cmd.port = port;
     cmd.localPort = localPort;
 
-    std::stringstream stream;
-    boost::archive::text_oarchive oa(stream, boost::archive::no_header);
-    oa << cmd;
-
     CMD_ANSWER answer;
-    if (!runCommand(HELPER_CMD_START_WSTUNNEL, stream.str(), answer) || answer.executed == 0) {
+    if (!runCommand(HELPER_CMD_START_WSTUNNEL, serializeCommand(cmd), answer) || answer.executed == 0) {
         doDisconnectAndReconnect();
         return IHelper::EXECUTE_ERROR;
     }
@@ -658,8 +544,11 @@ void Helper_posix::run()
     firstConnectToHelperErrorReported_ = false;
     io_service_.reset();
     reconnectElapsedTimer_.start();
-    g_this_->socket_.reset(new boost::asio::local::stream_protocol::socket(io_service_));
-    socket_->async_connect(ep_, connectHandler);
+    {
+        QMutexLocker locker(&mutexSocket_);
+        g_this_->socket_.reset(new boost::asio::local::stream_protocol::socket(io_service_));
+        socket_->async_connect(ep_, connectHandler);
+    }
     io_service_.run();
 }
 
@@ -701,9 +590,33 @@ void Helper_posix::connectHandler(const boost::system::error_code &ec)
 
 void Helper_posix::doDisconnectAndReconnect()
 {
+    QMutexLocker locker(&mutex_);
     if (!isRunning())
     {
         qCDebug(LOG_BASIC) << "Disconnected from helper socket, try reconnect";
+
+        // wake up the thread reading the answers from the old socket and let it finish before the socket is replaced
+        {
+            QMutexLocker lockerSocket(&mutexSocket_);
+            if (socket_) {
+                boost::system::error_code ec;
+                socket_->shutdown(boost::asio::socket_base::shutdown_both, ec);
+            }
+        }
+        {
+            QMutexLocker lockerRequests(&mutexRequests_);
+            while (isReadingAnswers_) {
+                requestFinished_.wait(&mutexRequests_);
+            }
+        }
+        {
+            QMutexLocker lockerSocket(&mutexSocket_);
+            if (socket_) {
+                boost::system::error_code ec;
+                socket_->close(ec);
+            }
+        }
+
         g_this_->curState_ = STATE_INIT;
         start(QThread::LowPriority);
     }
@@ -711,62 +624,118 @@ void Helper_posix::doDisconnectAndReconnect()
 
 bool Helper_posix::runCommand(int cmdId, const std::string &data, CMD_ANSWER &answer)
 {
-    bool ret = sendCmdToHelper(cmdId, data);
-    if (!ret) {
-        return ret;
+    PENDING_REQUEST request(&answer);
+    uint32_t requestId;
+    {
+        QMutexLocker locker(&mutexRequests_);
+        requestId = ++lastRequestId_;
+        pendingRequests_[requestId] = &request;
+    }
+
+    if (!sendCmdToHelper(requestId, cmdId, data)) {
+        QMutexLocker locker(&mutexRequests_);
+        pendingRequests_.erase(requestId);
+        return false;
     }
 
-    return readAnswer(answer);
+    return waitForAnswer(request);
 }
 
-bool Helper_posix::readAnswer(CMD_ANSWER &outAnswer)
+bool Helper_posix::waitForAnswer(PENDING_REQUEST &request)
 {
-    boost::system::error_code ec;
-    int length;
-    boost::asio::read(*socket_, boost::asio::buffer(&length, sizeof(length)),
-                      boost::asio::transfer_exactly(sizeof(length)), ec);
-    if (ec) {
-        return false;
-    } else {
-        std::vector<char> buff(length);
-        boost::asio::read(*socket_, boost::asio::buffer(&buff[0], length),
-                          boost::asio::transfer_exactly(length), ec);
-        if (ec) {
-            return false;
+    QMutexLocker locker(&mutexRequests_);
+    while (!request.isFinished) {
+        if (isReadingAnswers_) {
+            requestFinished_.wait(&mutexRequests_);
+            continue;
         }
 
-        std::string str(buff.begin(), buff.end());
-        std::istringstream stream(str);
-        boost::archive::text_iarchive ia(stream, boost::archive::no_header);
-        ia >> outAnswer;
+        // nobody reads the socket at the moment, read the answers (possibly for other commands) until ours is received
+        isReadingAnswers_ = true;
+        locker.unlock();
+        uint32_t requestId = 0;
+        CMD_ANSWER answer;
+        bool isSuccess = readAnswer(requestId, answer);
+        locker.relock();
+        isReadingAnswers_ = false;
+
+        if (isSuccess) {
+            auto it = pendingRequests_.find(requestId);
+            if (it != pendingRequests_.end()) {
+                *it->second->answer = std::move(answer);
+                it->second->isSuccess = true;
+                it->second->isFinished = true;
+                pendingRequests_.erase(it);
+            } else {
+                qCDebug(LOG_BASIC) << "Received an answer from the helper for an unknown request:" << requestId;
+            }
+        } else {
+            // the connection is broken, none of the commands in flight will get an answer
+            for (auto &it : pendingRequests_) {
+                it.second->isFinished = true;
+            }
+            pendingRequests_.clear();
+        }
+        requestFinished_.wakeAll();
     }
-
-    return true;
+    return request.isSuccess;
 }
 
-bool Helper_posix::sendCmdToHelper(int cmdId, const std::string &data)
+bool Helper_posix::readAnswer(uint32_t &outRequestId, CMD_ANSWER &outAnswer)
 {
-    int length = data.size();
-    boost::system::error_code ec;
+    // the socket may be replaced by a reconnect while the answer is read
+    std::shared_ptr<boost::asio::local::stream_protocol::socket> socket;
+    {
+        QMutexLocker locker(&mutexSocket_);
+        socket = socket_;
+    }
+    if (!socket) {
+        return false;
+    }
 
-    // first 4 bytes - cmdId
-    boost::asio::write(*socket_, boost::asio::buffer(&cmdId, sizeof(cmdId)), boost::asio::transfer_exactly(sizeof(cmdId)), ec);
+    boost::system::error_code ec;
+    HELPER_FRAME_HEADER header;
+    boost::asio::read(*socket, boost::asio::buffer(&header, sizeof(header)), boost::asio::transfer_exactly(sizeof(header)), ec);
     if (ec) {
         return false;
     }
-    // second 4 bytes - pid
-    const auto pid = getpid();
-    boost::asio::write(*socket_, boost::asio::buffer(&pid, sizeof(pid)), boost::asio::transfer_exactly(sizeof(pid)), ec);
-    if (ec) {
+    if (helper_protocol::parseFrame((const char *)&header, sizeof(header), header) == helper_protocol::FrameStatus::kInvalid) {
+        qCDebug(LOG_BASIC) << "Incorrect answer from the helper";
         return false;
     }
-    // third 4 bytes - size of buffer
-    boost::asio::write(*socket_, boost::asio::buffer(&length, sizeof(length)), boost::asio::transfer_exactly(sizeof(length)), ec);
+
+    std::string body(header.length, '\0');
+    boost::asio::read(*socket, boost::asio::buffer(&body[0], body.size()), boost::asio::transfer_exactly(body.size()), ec);
     if (ec) {
         return false;
     }
-    // body of message
-    boost::asio::write(*socket_, boost::asio::buffer(data.data(), length), boost::asio::transfer_exactly(length), ec);
+
+    try {
+        helper_protocol::BinaryIArchive ia(body.data(), body.size());
+        ia >> outAnswer;
+    } catch (const std::exception &e) {
+        qCDebug(LOG_BASIC) << "Incorrect answer from the helper:" << e.what();
+        return false;
+    }
+    outRequestId = header.requestId;
+    return true;
+}
+
+bool Helper_posix::sendCmdToHelper(uint32_t requestId, int cmdId, const std::string &data)
+{
+    HELPER_FRAME_HEADER header = helper_protocol::makeHeader(requestId, cmdId, getpid(), data.size());
+    std::array<boost::asio::const_buffer, 2> buffers = { boost::asio::buffer(&header, sizeof(header)), boost::asio::buffer(data) };
+
+    // one gather write per command, the lock keeps the frames of the parallel commands from interleaving
+    boost::system::error_code ec;
+    {
+        QMutexLocker locker(&mutexSocket_);
+        if (socket_) {
+            boost::asio::write(*socket_, buffers, ec);
+        } else {
+            ec = boost::asio::error::not_connected;
+        }
+    }
     if (ec) {
         doDisconnectAndReconnect();
         return false;
@@ -2,11 +2,14 @@
 
 #include <QElapsedTimer>
 #include <QThread>
+#include <map>
+#include <memory>
 #include <QWaitCondition>
 #include <QMutex>
 #include "ihelper.h"
 #include "utils/boost_includes.h"
 #include "../../../../backend/posix_common/helper_commands.h"
+#include "../../../../backend/posix_common/helper_protocol.h"
 
 // common base helper for Linux/Mac
 class Helper_posix : public IHelper
@@ -88,6 +91,7 @@ protected:
     // for blocking execute
     WAITING_DATA waitingData_;
 
+    // serializes the reconnects, the commands themselves can run in parallel
     QMutex mutex_;
     unsigned long cmdId_;
 
@@ -95,9 +99,27 @@ protected:
 
     boost::asio::io_service io_service_;
     boost::asio::local::stream_protocol::endpoint ep_;
-    boost::scoped_ptr<boost::asio::local::stream_protocol::socket> socket_;
+    // replaced on reconnect, the reading thread keeps its own reference to the socket it reads
+    std::shared_ptr<boost::asio::local::stream_protocol::socket> socket_;
     QMutex mutexSocket_;
 
+    // a command waiting for its answer
+    struct PENDING_REQUEST
+    {
+        CMD_ANSWER *answer;
+        bool isFinished;
+        bool isSuccess;
+
+        explicit PENDING_REQUEST(CMD_ANSWER *a) : answer(a), isFinished(false), isSuccess(false) {}
+    };
+
+    // the commands in flight by request id, one of the waiting threads reads the answers for all of them
+    QMutex mutexRequests_;
+    QWaitCondition requestFinished_;
+    std::map<uint32_t, PENDING_REQUEST *> pendingRequests_;
+    uint32_t lastRequestId_;
+    bool isReadingAnswers_;
+
     QElapsedTimer reconnectElapsedTimer_;
     bool bHelperConnectedEmitted_;
 
@@ -114,10 +136,29 @@ protected:
     static void connectHandler(const boost::system::error_code &ec);
     virtual void doDisconnectAndReconnect();
 
-    bool readAnswer(CMD_ANSWER &outAnswer);
-    bool sendCmdToHelper(int cmdId, const std::string &data);
+    bool readAnswer(uint32_t &outRequestId, CMD_ANSWER &outAnswer);
+    bool sendCmdToHelper(uint32_t requestId, int cmdId, const std::string &data);
+    bool waitForAnswer(PENDING_REQUEST &request);
     virtual bool runCommand(int cmdId, const std::string &data, CMD_ANSWER &answer);
 
+    // fills the status from the answer to HELPER_CMD_GET_WIREGUARD_STATUS
+    static void wireGuardStatusFromAnswer(const CMD_ANSWER &answer, types::WireGuardStatus *status);
+
+    // the Linux helper takes the commands in the binary format of helper_protocol.h,
+    // the Mac helper is reached over XPC and still takes boost text archives
+    template<typename T>
+    static std::string serializeCommand(const T &cmd)
+    {
+#ifdef Q_OS_LINUX
+        return helper_protocol::serialize(cmd);
+#else
+        std::stringstream stream;
+        boost::archive::text_oarchive oa(stream, boost::archive::no_header);
+        oa << cmd;
+        return stream.str();
+#endif
+    }
+
 private:
     bool firstConnectToHelperErrorReported_;
 };
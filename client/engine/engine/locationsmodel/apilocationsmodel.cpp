@@ -9,6 +9,7 @@
 namespace locationsmodel {
 
 ApiLocationsModel::ApiLocationsModel(QObject *parent, IConnectStateController *stateController, INetworkDetectionManager *networkDetectionManager) : QObject(parent),
+    serverList_(std::make_shared<const api_responses::ServerList>(std::string())),
     pingManager_(this, stateController, networkDetectionManager, "pingStorage")
 {
     if (bestLocation_.isValid())
@@ -22,20 +23,20 @@ ApiLocationsModel::ApiLocationsModel(QObject *parent, IConnectStateController *s
     connect(&pingManager_, &PingManager::pingInfoChanged, this, &ApiLocationsModel::onPingInfoChanged);
 }
 
-void ApiLocationsModel::setLocations(const QVector<api_responses::Location> &locations, const api_responses::StaticIps &staticIps)
+void ApiLocationsModel::setLocations(const std::shared_ptr<const api_responses::ServerList> &serverList, const api_responses::StaticIps &staticIps)
 {
-    if (!isChanged(locations, staticIps)) {
+    if (!isChanged(serverList, staticIps)) {
         return;
     }
 
-    locations_ = locations;
+    serverList_ = serverList;
     staticIps_ = staticIps;
 
     whitelistIps();
 
     // ping stuff
     QVector<PingIpInfo> ips;
-    for (const api_responses::Location &l : locations) {
+    for (const api_responses::Location &l : serverList_->locations()) {
         for (int i = 0; i < l.groupsCount(); ++i) {
             api_responses::Group group = l.getGroup(i);
             // Ping with Curl by hostname was introduced later, so the ping hostname may be empty when updating the program from an older version.
@@ -59,7 +60,7 @@ void ApiLocationsModel::setLocations(const QVector<api_responses::Location> &loc
 
 void ApiLocationsModel::clear()
 {
-    locations_.clear();
+    serverList_ = std::make_shared<const api_responses::ServerList>(std::string());
     staticIps_ = api_responses::StaticIps();
     pingManager_.clearIps();
     QSharedPointer<QVector<types::Location> > empty(new QVector<types::Location>());
@@ -101,40 +102,39 @@ QSharedPointer<BaseLocationInfo> ApiLocationsModel::getMutableLocationInfoById(c
         modifiedLocationId = locationId.bestLocationToApiLocation();
     }
 
-    for (const api_responses::Location &l : locations_)
+    const api_responses::Location *location = serverList_->locationById(modifiedLocationId.id());
+    if (location && LocationID::createTopApiLocationId(location->getId()) == modifiedLocationId.toTopLevelLocation())
     {
-        if (LocationID::createTopApiLocationId(l.getId()) == modifiedLocationId.toTopLevelLocation())
+        const api_responses::Location &l = *location;
+        for (int i = 0; i < l.groupsCount(); ++i)
         {
-            for (int i = 0; i < l.groupsCount(); ++i)
+            const api_responses::Group group = l.getGroup(i);
+            if (LocationID::createApiLocationId(l.getId(), group.getCity(), group.getNick()) == modifiedLocationId)
             {
-                const api_responses::Group group = l.getGroup(i);
-                if (LocationID::createApiLocationId(l.getId(), group.getCity(), group.getNick()) == modifiedLocationId)
+                QVector< QSharedPointer<const BaseNode> > nodes;
+                for (int n = 0; n < group.getNodesCount(); ++n)
                 {
-                    QVector< QSharedPointer<const BaseNode> > nodes;
-                    for (int n = 0; n < group.getNodesCount(); ++n)
-                    {
-                        const api_responses::Node &apiInfoNode = group.getNode(n);
-                        QStringList ips;
-                        ips << apiInfoNode.getIp(0) << apiInfoNode.getIp(1) << apiInfoNode.getIp(2);
-                        nodes << QSharedPointer<const ApiLocationNode>(new ApiLocationNode(ips, apiInfoNode.getHostname(), apiInfoNode.getWeight(), group.getWgPubKey()));
-                    }
-
-                    // once API server list is updated so that the old WINDFLIX locations' dns_hostname matches that of the containing region this code can be removed
-                    QString dnsHostname;
-                    if (!group.getDnsHostName().isEmpty())
-                    {
-                        dnsHostname = group.getDnsHostName();
-                        qCDebug(LOG_BASIC) << "Overriding DNS hostname for old WINDFLIX location with: " << dnsHostname;
-                    }
-                    else
-                    {
-                        dnsHostname =  l.getDnsHostName();
-                    }
+                    const api_responses::Node &apiInfoNode = group.getNode(n);
+                    QStringList ips;
+                    ips << apiInfoNode.getIp(0) << apiInfoNode.getIp(1) << apiInfoNode.getIp(2);
+                    nodes << QSharedPointer<const ApiLocationNode>(new ApiLocationNode(ips, apiInfoNode.getHostname(), apiInfoNode.getWeight(), group.getWgPubKey()));
+                }
 
-                    int selectedNode = NodeSelectionAlgorithm::selectRandomNodeBasedOnWeight(nodes);
-                    QSharedPointer<BaseLocationInfo> bli(new MutableLocationInfo(modifiedLocationId, group.getCity() + " - " + group.getNick(), nodes, selectedNode,dnsHostname, group.getOvpnX509()));
-                    return bli;
+                // once API server list is updated so that the old WINDFLIX locations' dns_hostname matches that of the containing region this code can be removed
+                QString dnsHostname;
+                if (!group.getDnsHostName().isEmpty())
+                {
+                    dnsHostname = group.getDnsHostName();
+                    qCDebug(LOG_BASIC) << "Overriding DNS hostname for old WINDFLIX location with: " << dnsHostname;
+                }
+                else
+                {
+                    dnsHostname =  l.getDnsHostName();
                 }
+
+                int selectedNode = NodeSelectionAlgorithm::selectRandomNodeBasedOnWeight(nodes);
+                QSharedPointer<BaseLocationInfo> bli(new MutableLocationInfo(modifiedLocationId, group.getCity() + " - " + group.getNick(), nodes, selectedNode,dnsHostname, group.getOvpnX509()));
+                return bli;
             }
         }
     }
@@ -148,13 +148,11 @@ void ApiLocationsModel::onPingInfoChanged(const QString &ip, int timems)
         detectBestLocation(true);
     }
 
-    for (const api_responses::Location &l : locations_) {
-        for (int i = 0; i < l.groupsCount(); ++i) {
-            const api_responses::Group group = l.getGroup(i);
-            if (group.getPingIp() == ip) {
-                emit locationPingTimeChanged(LocationID::createApiLocationId(l.getId(), group.getCity(), group.getNick()), timems);
-            }
-        }
+    const QVector<api_responses::ServerList::GroupIndex> groups = serverList_->groupsByPingIp(ip);
+    for (const api_responses::ServerList::GroupIndex &index : groups) {
+        const api_responses::Location &l = serverList_->locations()[index.location];
+        const api_responses::Group group = l.getGroup(index.group);
+        emit locationPingTimeChanged(LocationID::createApiLocationId(l.getId(), group.getCity(), group.getNick()), timems);
     }
 
     if (staticIps_.getIpsCount() > 0) {
@@ -181,7 +179,7 @@ void ApiLocationsModel::detectBestLocation(bool isAllNodesInDisconnectedState)
     int prevBestLocationLatency = INT_MAX;
 
     // #1040 YOLO: try to find a best location that is 'priority' (10gbps, not disabled, and latency < 30ms) first
-    for (const api_responses::Location &l : locations_) {
+    for (const api_responses::Location &l : serverList_->locations()) {
         for (int i = 0; i < l.groupsCount(); ++i) {
             const api_responses::Group group = l.getGroup(i);
             int latency = pingManager_.getPing(group.getPingIp()).toInt();
@@ -200,7 +198,7 @@ void ApiLocationsModel::detectBestLocation(bool isAllNodesInDisconnectedState)
 
     // If we didn't find a priority best location, then use the old logic
     if (!locationIdWithMinLatency.isValid()) {
-        for (const api_responses::Location &l : locations_) {
+        for (const api_responses::Location &l : serverList_->locations()) {
             for (int i = 0; i < l.groupsCount(); ++i) {
                 const api_responses::Group group = l.getGroup(i);
 
@@ -286,7 +284,7 @@ BestAndAllLocations ApiLocationsModel::generateLocationsUpdated()
     BestAndAllLocations ball;
     bool isBestLocationValid = false;
 
-    for (const api_responses::Location &l : locations_)
+    for (const api_responses::Location &l : serverList_->locations())
     {
         types::Location item;
         item.id = LocationID::createTopApiLocationId(l.getId());
@@ -388,21 +386,15 @@ void ApiLocationsModel::sendLocationsUpdated()
 
 void ApiLocationsModel::whitelistIps()
 {
-    QStringList ips;
-    for (const api_responses::Location &l : locations_)
-    {
-        for (int i = 0; i < l.groupsCount(); ++i)
-        {
-            ips << l.getGroup(i).getPingIp();
-        }
-    }
+    QStringList ips = serverList_->pingIps();
     ips << staticIps_.getAllPingIps();
     emit whitelistIpsChanged(ips);
 }
 
-bool ApiLocationsModel::isChanged(const QVector<api_responses::Location> &locations, const api_responses::StaticIps &staticIps)
+bool ApiLocationsModel::isChanged(const std::shared_ptr<const api_responses::ServerList> &serverList, const api_responses::StaticIps &staticIps)
 {
-    return locations_ != locations || staticIps_ != staticIps;
+    // ServerList::create() returns the same model only for a byte-identical payload
+    return serverList_ != serverList || staticIps_ != staticIps;
 }
 
 
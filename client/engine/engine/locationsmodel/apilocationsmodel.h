@@ -5,7 +5,7 @@
 
 #include "baselocationinfo.h"
 #include "bestlocation.h"
-#include "api_responses/location.h"
+#include "api_responses/serverlist.h"
 #include "api_responses/staticips.h"
 #include "engine/networkdetectionmanager/inetworkdetectionmanager.h"
 #include "engine/ping/pingmanager.h"
@@ -28,7 +28,7 @@ class ApiLocationsModel : public QObject
 public:
     explicit ApiLocationsModel(QObject *parent, IConnectStateController *stateController, INetworkDetectionManager *networkDetectionManager);
 
-    void setLocations(const QVector<api_responses::Location> &locations, const api_responses::StaticIps &staticIps);
+    void setLocations(const std::shared_ptr<const api_responses::ServerList> &serverList, const api_responses::StaticIps &staticIps);
     void clear();
 
     QSharedPointer<BaseLocationInfo> getMutableLocationInfoById(const LocationID &locationId);
@@ -47,7 +47,7 @@ private slots:
     void onPingInfoChanged(const QString &ip, int timems);
 
 private:
-    QVector<api_responses::Location> locations_;
+    std::shared_ptr<const api_responses::ServerList> serverList_;
     api_responses::StaticIps staticIps_;
     BestLocation bestLocation_;
     PingManager pingManager_;
@@ -58,7 +58,7 @@ private:
     void sendLocationsUpdated();
     void whitelistIps();
 
-    bool isChanged(const QVector<api_responses::Location> &locations, const api_responses::StaticIps &staticIps);
+    bool isChanged(const std::shared_ptr<const api_responses::ServerList> &serverList, const api_responses::StaticIps &staticIps);
 };
 
 } //namespace locationsmodel
@@ -25,9 +25,9 @@ LocationsModel::~LocationsModel()
     delete apiLocationsModel_;
 }
 
-void LocationsModel::setApiLocations(const QVector<api_responses::Location> &locations, const api_responses::StaticIps &staticIps)
+void LocationsModel::setApiLocations(const std::shared_ptr<const api_responses::ServerList> &serverList, const api_responses::StaticIps &staticIps)
 {
-    apiLocationsModel_->setLocations(locations, staticIps);
+    apiLocationsModel_->setLocations(serverList, staticIps);
 }
 
 void LocationsModel::setCustomConfigLocations(const QVector<QSharedPointer<const customconfigs::ICustomConfig> > &customConfigs)
@@ -4,7 +4,7 @@
 
 #include "apilocationsmodel.h"
 #include "customconfiglocationsmodel.h"
-#include "api_responses/location.h"
+#include "api_responses/serverlist.h"
 #include "api_responses/staticips.h"
 
 namespace locationsmodel {
@@ -17,7 +17,7 @@ public:
     explicit LocationsModel(QObject *parent, IConnectStateController *stateController, INetworkDetectionManager *networkDetectionManager);
     ~LocationsModel() override;
 
-    void setApiLocations(const QVector<api_responses::Location> &locations, const api_responses::StaticIps &staticIps);
+    void setApiLocations(const std::shared_ptr<const api_responses::ServerList> &serverList, const api_responses::StaticIps &staticIps);
     void setCustomConfigLocations(const QVector<QSharedPointer<const customconfigs::ICustomConfig>> &customConfigs);
     void clear();
 
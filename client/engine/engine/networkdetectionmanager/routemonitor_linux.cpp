@@ -1,5 +1,6 @@
 #include "routemonitor_linux.h"
 
+#include <errno.h>
 #include <linux/netlink.h>
 #include <linux/rtnetlink.h>
 #include <stdio.h>
@@ -7,6 +8,7 @@
 #include <unistd.h>
 
 #include "utils/log/categories.h"
+#include "utils/network_utils/networkstate_linux.h"
 #include "utils/ws_assert.h"
 
 RouteMonitor_linux::RouteMonitor_linux(QObject *parent) : QObject(parent)
@@ -32,7 +34,7 @@ void RouteMonitor_linux::init()
     memset(&addr, 0, sizeof(addr));
     addr.nl_family = AF_NETLINK;
     addr.nl_pid    = getpid();
-    addr.nl_groups = RTMGRP_IPV4_ROUTE;
+    addr.nl_groups = NetworkState_linux::kMonitoredGroups;
 
     if (bind(fd_, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
         qCDebug(LOG_BASIC) << "RouteMonitor_linux could not bind address";
@@ -40,6 +42,18 @@ void RouteMonitor_linux::init()
         return;
     }
 
+    // route churn during the VPN setup comes in bursts
+    int rcvbuf = 1024 * 1024;
+    setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    // subscribed first, so the changes after the dump are not lost
+    NetworkState_linux::instance().startMonitoring();
+
+    debounceTimer_ = new QTimer(this);
+    debounceTimer_->setSingleShot(true);
+    debounceTimer_->setInterval(kDebounceMs);
+    connect(debounceTimer_, &QTimer::timeout, this, &RouteMonitor_linux::routesChanged);
+
     notifier_ = new QSocketNotifier(fd_, QSocketNotifier::Read, this);
     connect(notifier_, &QSocketNotifier::activated, this, &RouteMonitor_linux::netlinkSocketReady);
     notifier_->setEnabled(true);
@@ -49,6 +63,10 @@ void RouteMonitor_linux::finish()
 {
     if (notifier_) {
         notifier_->setEnabled(false);
+        NetworkState_linux::instance().stopMonitoring();
+    }
+    if (debounceTimer_) {
+        debounceTimer_->stop();
     }
 }
 
@@ -57,9 +75,26 @@ void RouteMonitor_linux::netlinkSocketReady(QSocketDescriptor socket, QSocketNot
     Q_UNUSED(socket)
     Q_UNUSED(activationEvent)
 
-    char buffer[4096];
-    ssize_t len = recv(fd_, buffer, sizeof(buffer), MSG_DONTWAIT);
-    if (len >= 0) {
-        emit routesChanged();
+    bool isChanged = false;
+    char buffer[32768];
+    while (true) {
+        ssize_t len = recv(fd_, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (len < 0) {
+            if (errno == ENOBUFS) {
+                // messages were lost, read the whole state again
+                qCDebug(LOG_BASIC) << "RouteMonitor_linux lost netlink messages, resyncing";
+                isChanged = NetworkState_linux::instance().resync() || isChanged;
+                continue;
+            }
+            break;
+        }
+        for (struct nlmsghdr *hdr = (struct nlmsghdr *)buffer; NLMSG_OK(hdr, len); hdr = NLMSG_NEXT(hdr, len)) {
+            isChanged = NetworkState_linux::instance().handleMessage(hdr) || isChanged;
+        }
+    }
+
+    // the churn which does not change the state we track is not reported
+    if (isChanged && !debounceTimer_->isActive()) {
+        debounceTimer_->start();
     }
 }
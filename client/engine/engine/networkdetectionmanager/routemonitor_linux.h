@@ -2,7 +2,10 @@
 
 #include <QObject>
 #include <QSocketNotifier>
+#include <QTimer>
 
+// Keeps NetworkState_linux up to date from the rtnetlink multicast messages,
+// routesChanged() is emitted once per burst of changes.
 class RouteMonitor_linux : public QObject
 {
     Q_OBJECT
@@ -23,4 +26,7 @@ private slots:
 private:
     int fd_ = -1;
     QSocketNotifier *notifier_ = nullptr;
+    QTimer *debounceTimer_ = nullptr;
+
+    static constexpr int kDebounceMs = 100;
 };
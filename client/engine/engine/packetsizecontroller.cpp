@@ -1,8 +1,8 @@
 #include "packetsizecontroller.h"
 
+#include "pmtuprober.h"
 #include "utils/ipvalidation.h"
 #include "utils/log/categories.h"
-#include "utils/network_utils/network_utils.h"
 
 PacketSizeController::PacketSizeController(QObject *parent)
     : QObject(parent),
@@ -30,10 +30,10 @@ void PacketSizeController::setPacketSize(const types::PacketSize &packetSize)
     setPacketSizeImpl(packetSize);
 }
 
-void PacketSizeController::detectAppropriatePacketSize(const QString &hostname)
+void PacketSizeController::detectAppropriatePacketSize(const QString &hostname, const QString &networkOrSsid)
 {
     QMutexLocker locker(&mutex_);
-    QMetaObject::invokeMethod(this, "detectAppropriatePacketSizeImpl", Q_ARG(QString, hostname));
+    QMetaObject::invokeMethod(this, "detectAppropriatePacketSizeImpl", Q_ARG(QString, hostname), Q_ARG(QString, networkOrSsid));
 }
 
 void PacketSizeController::earlyStop()
@@ -51,19 +51,44 @@ void PacketSizeController::setPacketSizeImpl(const types::PacketSize &packetSize
     }
 }
 
-void PacketSizeController::detectAppropriatePacketSizeImpl(const QString &hostname)
+void PacketSizeController::detectAppropriatePacketSizeImpl(const QString &hostname, const QString &networkOrSsid)
 {
+    int mtu = -1;
     {
         QMutexLocker locker(&mutex_);
         earlyStop_ = false;
+        // a known network, skip the detection; the path of the network may change, so the mtu is detected again
+        // after kNetworkMtuTtlMs
+        auto it = mtuByNetwork_.constFind(networkOrSsid);
+        if (!networkOrSsid.isEmpty() && it != mtuByNetwork_.constEnd())
+        {
+            if (it->detectTime.hasExpired(kNetworkMtuTtlMs))
+                mtuByNetwork_.remove(networkOrSsid);
+            else
+                mtu = it->mtu;
+        }
     }
 
-    const int mtu = getIdealPacketSize(hostname);
+    if (mtu > 0)
+    {
+        qCDebug(LOG_PACKET_SIZE) << "Using the mtu detected before on this network";
+    }
+    else
+    {
+        mtu = getIdealPacketSize(hostname);
+    }
     const bool is_error = mtu < 0;
 
     QMutexLocker locker(&mutex_);
     if (mtu > 0)
     {
+        if (!networkOrSsid.isEmpty() && !mtuByNetwork_.contains(networkOrSsid))
+        {
+            NetworkMtu &networkMtu = mtuByNetwork_[networkOrSsid];
+            networkMtu.mtu = mtu;
+            networkMtu.detectTime.start();
+        }
+
         qCDebug(LOG_PACKET_SIZE) << "Found mtu: " << mtu;
         types::PacketSize packetSize;
         packetSize.isAutomatic = packetSize_.isAutomatic;
@@ -76,7 +101,6 @@ void PacketSizeController::detectAppropriatePacketSizeImpl(const QString &hostna
 
 int PacketSizeController::getIdealPacketSize(const QString &hostname)
 {
-    int mtu = 1470;
     QString modifiedHostname = hostname;
 
     // if this is IP, use without change
@@ -93,26 +117,13 @@ int PacketSizeController::getIdealPacketSize(const QString &hostname)
 
     qCDebug(LOG_PACKET_SIZE) << "Detecting packet size via:" << modifiedHostname;
 
-    bool success = false;
-    while (mtu >= 1300)
-    {
+    PmtuProber prober(1300, 1470);
+    const int mtu = prober.probe(modifiedHostname, [this]() {
         QMutexLocker locker(&mutex_);
-        if (earlyStop_)
-        {
-            qCDebug(LOG_PACKET_SIZE) << "Exiting packet size detection loop early";
-            break;
-        }
-
-        bool pingSuccess = NetworkUtils::pingWithMtu(modifiedHostname, mtu);
-        if (pingSuccess)
-        {
-            success = true;
-            break;
-        }
-        mtu -= 10;
-    }
+        return earlyStop_;
+    });
 
-    if (!success)
+    if (mtu < 0)
     {
         qCDebug(LOG_PACKET_SIZE) << "Couldn't find appropriate MTU -- check internet connection";
         return -1;
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <QElapsedTimer>
+#include <QHash>
 #include <QObject>
 #include <QMutex>
 #include "types/packetsize.h"
@@ -15,7 +17,8 @@ public:
     explicit PacketSizeController(QObject *parent = nullptr);
 
     void setPacketSize(const types::PacketSize &packetSize);
-    void detectAppropriatePacketSize(const QString &hostname);
+    // networkOrSsid identifies the network, the result is cached for it
+    void detectAppropriatePacketSize(const QString &hostname, const QString &networkOrSsid);
     void earlyStop();
 
 signals:
@@ -27,12 +30,19 @@ public slots:
     void finish();
 
 private slots:
-    void detectAppropriatePacketSizeImpl(const QString &hostname);
+    void detectAppropriatePacketSizeImpl(const QString &hostname, const QString &networkOrSsid);
 
 private:
     QMutex mutex_;
     bool earlyStop_;
     types::PacketSize packetSize_;
+    static constexpr qint64 kNetworkMtuTtlMs = 60 * 60 * 1000;
+    struct NetworkMtu
+    {
+        int mtu;
+        QElapsedTimer detectTime;
+    };
+    QHash<QString, NetworkMtu> mtuByNetwork_;
 
 #ifdef Q_OS_WIN
     QScopedPointer<Debug::CrashHandlerForThread> crashHandler_;
@@ -1,5 +1,7 @@
 #include "pingmanager.h"
 
+#include <QMap>
+
 #include "../connectstatecontroller/iconnectstatecontroller.h"
 #include "types/pingtime.h"
 #include "utils/extraconfig.h"
@@ -14,6 +16,12 @@ PingManager::PingManager(QObject *parent, IConnectStateController *stateControll
     connect(&pingTimer_, &QTimer::timeout, this, &PingManager::onPingTimer);
 }
 
+PingManager::~PingManager()
+{
+    for (const auto &batch : qAsConst(pingBatches_))
+        batch->cancel();
+}
+
 void PingManager::updateIps(const QVector<PingIpInfo> &ips)
 {
     PingLog::addLog("PingIpsController::updateIps", "update ips:" + QString::number(ips.count()));
@@ -97,6 +105,8 @@ void PingManager::onPingTimer()
             PingLog::addLog("PingIpsController::onPingTimer", "Re-ping all nodes by network change");
     }
 
+    // collect the nodes to ping and send them as one batch per ping type, so wsnet can schedule the whole set at once
+    QMap<wsnet::PingType, QPair<std::vector<std::string>, std::vector<std::string>>> batches;
     for (auto it = ips_.begin(); it != ips_.end(); ++it) {
         PingIpState &pni = it.value();
 
@@ -111,25 +121,31 @@ void PingManager::onPingTimer()
 
         if (pni.iterationTime != pingStorage_.currentIterationTime()) {
             PingLog::addLog("PingNodesController::onPingTimer", QString::fromLatin1("ping new node: %1 (%2 - %3)").arg(pni.ipInfo.ip, pni.ipInfo.city, pni.ipInfo.nick));
-            pni.nowPinging = true;
-            WSNet::instance()->pingManager()->ping(pni.ipInfo.ip.toStdString(), pni.ipInfo.hostname.toStdString(), pingType,
-                        [this](const std::string &ip, bool isSuccess, std::int32_t timeMs, bool isFromDisconnectedVpnState) {
-                            QMetaObject::invokeMethod(this, [this, ip, isSuccess, timeMs, isFromDisconnectedVpnState] {
-                                onPingFinished(ip, isSuccess, timeMs, isFromDisconnectedVpnState);
-                        });
-            });
-        } else if (pni.latestPingFailed) {
-            if (pni.nextTimeForFailedPing == 0 || QDateTime::currentMSecsSinceEpoch() >= pni.nextTimeForFailedPing) {
-                pni.nowPinging = true;
-                PingLog::addLog("PingNodesController::onPingTimer", "start ping because latest ping failed: " + it.key());
-                WSNet::instance()->pingManager()->ping(pni.ipInfo.ip.toStdString(), pni.ipInfo.hostname.toStdString(), pingType,
-                   [this](const std::string &ip, bool isSuccess, std::int32_t timeMs, bool isFromDisconnectedVpnState) {
-                       QMetaObject::invokeMethod(this, [this, ip, isSuccess, timeMs, isFromDisconnectedVpnState] { // NOLINT: false positive for memory leak
-                           onPingFinished(ip, isSuccess, timeMs, isFromDisconnectedVpnState);
-                    });
-                });
-            }
+        } else if (pni.latestPingFailed && (pni.nextTimeForFailedPing == 0 || QDateTime::currentMSecsSinceEpoch() >= pni.nextTimeForFailedPing)) {
+            PingLog::addLog("PingNodesController::onPingTimer", "start ping because latest ping failed: " + it.key());
+        } else {
+            continue;
         }
+
+        pni.nowPinging = true;
+        auto &batch = batches[pingType];
+        batch.first.push_back(pni.ipInfo.ip.toStdString());
+        batch.second.push_back(pni.ipInfo.hostname.toStdString());
+    }
+
+    for (auto it = batches.begin(); it != batches.end(); ++it) {
+        quint64 batchId = curBatchId_++;
+        pingBatches_[batchId] = WSNet::instance()->pingManager()->pingBatch(it.value().first, it.value().second, it.key(),
+            [this](const std::string &ip, bool isSuccess, std::int32_t timeMs, bool isFromDisconnectedVpnState) {
+                QMetaObject::invokeMethod(this, [this, ip, isSuccess, timeMs, isFromDisconnectedVpnState] { // NOLINT: false positive for memory leak
+                    onPingFinished(ip, isSuccess, timeMs, isFromDisconnectedVpnState);
+                });
+            },
+            [this, batchId](std::uint32_t successCount, std::uint32_t failedCount) {
+                QMetaObject::invokeMethod(this, [this, batchId] {
+                    pingBatches_.remove(batchId);
+                });
+            });
     }
 }
 
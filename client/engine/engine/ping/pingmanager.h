@@ -30,6 +30,7 @@ class PingManager : public QObject
 public:
     explicit PingManager(QObject *parent, IConnectStateController *stateController, INetworkDetectionManager *networkDetectionManager,
                          const QString &storageSettingName);
+    ~PingManager();
 
     void updateIps(const QVector<PingIpInfo> &ips);
     void clearIps();
@@ -94,6 +95,10 @@ private:
     QHash<QString, PingIpState> ips_;
     QTimer pingTimer_;
 
+    // ping sweeps in progress, removed when finished
+    quint64 curBatchId_ = 0;
+    QHash<quint64, std::shared_ptr<wsnet::WSNetCancelableCallback>> pingBatches_;
+
     void onPingFinished(const std::string &ip, bool isSuccess, std::int32_t timeMs, bool isFromDisconnectedVpnState);
 
 
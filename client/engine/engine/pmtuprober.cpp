@@ -0,0 +1,362 @@
+#include "pmtuprober.h"
+
+#include <QElapsedTimer>
+#include <QHostInfo>
+#include <QRandomGenerator>
+#include <QScopeGuard>
+#include <algorithm>
+#include <vector>
+
+#ifdef Q_OS_WIN
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #include <iphlpapi.h>
+    #include <icmpapi.h>
+#else
+    #include <cerrno>
+    #include <cstring>
+    #include <netinet/in.h>
+    #include <poll.h>
+    #include <sys/socket.h>
+    #include <unistd.h>
+#endif
+
+#include "utils/log/categories.h"
+#include "utils/network_utils/network_utils.h"
+
+PmtuProber::PmtuProber(int minPayload, int maxPayload) : minPayload_(minPayload), maxPayload_(maxPayload)
+{
+}
+
+int PmtuProber::probe(const QString &hostname, std::function<bool()> isStopped)
+{
+    QHostAddress address(hostname);
+    if (address.isNull()) {
+        const QHostInfo info = QHostInfo::fromName(hostname);
+        for (const QHostAddress &it : info.addresses()) {
+            if (it.protocol() == QAbstractSocket::IPv4Protocol) {
+                address = it;
+                break;
+            }
+        }
+    }
+    if (address.isNull()) {
+        qCDebug(LOG_PACKET_SIZE) << "Couldn't resolve" << hostname;
+        return -1;
+    }
+
+    // The sizes up to good got a reply, the sizes from bad did not.
+    // The first round includes the kernel's path MTU, or else the largest size, which is the answer on most networks.
+    int good = minPayload_ - 1;
+    int bad = maxPayload_ + 1;
+    int hint = cachedPayload(address);
+    if (hint < 0) {
+        hint = maxPayload_;
+    }
+    bool isSocketAvailable = true;
+
+    while (bad - good > 1) {
+        if (isStopped()) {
+            qCDebug(LOG_PACKET_SIZE) << "Exiting packet size detection loop early";
+            return -1;
+        }
+
+        QVector<int> sizes = roundSizes(good, bad, isSocketAvailable ? kProbesPerRound : 1);
+        if (hint > good && hint < bad) {
+            sizes << hint;
+            if (hint + 1 < bad) {
+                sizes << hint + 1;
+            }
+        }
+        hint = -1;
+
+        QVector<bool> replied;
+        if (isSocketAvailable && !probeSizes(address, sizes, replied)) {
+            qCDebug(LOG_PACKET_SIZE) << "ICMP sockets are not available, using the ping utility";
+            isSocketAvailable = false;
+        }
+        if (!isSocketAvailable) {
+            probeSizesWithPing(address.toString(), sizes, replied);
+        }
+
+        // a reply proves the smaller sizes, a lost probe only counts above the largest reply
+        for (int i = 0; i < sizes.size(); ++i) {
+            if (replied[i]) {
+                good = std::max(good, sizes[i]);
+            }
+        }
+        for (int i = 0; i < sizes.size(); ++i) {
+            if (!replied[i] && sizes[i] > good) {
+                bad = std::min(bad, sizes[i]);
+            }
+        }
+        qCDebug(LOG_PACKET_SIZE) << "Probed" << sizes << "replied" << replied;
+    }
+
+    return good >= minPayload_ ? good : -1;
+}
+
+QVector<int> PmtuProber::roundSizes(int good, int bad, int count)
+{
+    // split the unknown sizes into count + 1 parts
+    QVector<int> sizes;
+    const int unknown = bad - good - 1;
+    if (unknown <= count) {
+        for (int size = good + 1; size < bad; ++size) {
+            sizes << size;
+        }
+    } else {
+        for (int i = 1; i <= count; ++i) {
+            sizes << good + (unknown + 1) * i / (count + 1);
+        }
+    }
+    return sizes;
+}
+
+void PmtuProber::probeSizesWithPing(const QString &host, const QVector<int> &sizes, QVector<bool> &outReplied)
+{
+    outReplied.fill(false, sizes.size());
+    for (int i = 0; i < sizes.size(); ++i) {
+        outReplied[i] = NetworkUtils::pingWithMtu(host, sizes[i]);
+    }
+}
+
+#ifdef Q_OS_WIN
+
+bool PmtuProber::probeSizes(const QHostAddress &address, const QVector<int> &sizes, QVector<bool> &outReplied)
+{
+    HANDLE icmpFile = IcmpCreateFile();
+    if (icmpFile == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    struct Probe
+    {
+        HANDLE event = NULL;
+        std::vector<unsigned char> request;
+        std::vector<unsigned char> reply;
+    };
+    std::vector<Probe> probes(sizes.size());
+    // closing the ICMP handle cancels the outstanding requests, so it must go before the buffers
+    auto exitGuard = qScopeGuard([&] {
+        IcmpCloseHandle(icmpFile);
+        for (auto &probe : probes) {
+            if (probe.event) {
+                CloseHandle(probe.event);
+            }
+        }
+    });
+
+    IP_OPTION_INFORMATION options;
+    memset(&options, 0, sizeof(options));
+    options.Ttl = 128;
+    options.Flags = IP_FLAG_DF;
+    const IPAddr dest = htonl(address.toIPv4Address());
+
+    std::vector<HANDLE> pendingEvents;
+    for (int i = 0; i < sizes.size(); ++i) {
+        Probe &probe = probes[i];
+        probe.event = CreateEvent(NULL, TRUE, FALSE, NULL);
+        probe.request.assign(sizes[i], (unsigned char)('a' + i));
+        probe.reply.resize(sizeof(ICMP_ECHO_REPLY) + sizes[i] + 8 + sizeof(IO_STATUS_BLOCK));
+        DWORD ret = IcmpSendEcho2(icmpFile, probe.event, NULL, NULL, dest, probe.request.data(), (WORD)probe.request.size(),
+                                  &options, probe.reply.data(), (DWORD)probe.reply.size(), kTimeoutMs);
+        if (ret == 0 && GetLastError() == ERROR_IO_PENDING) {
+            pendingEvents.push_back(probe.event);
+        }
+    }
+    if (!pendingEvents.empty()) {
+        WaitForMultipleObjects((DWORD)pendingEvents.size(), pendingEvents.data(), TRUE, kTimeoutMs + 100);
+    }
+
+    outReplied.fill(false, sizes.size());
+    for (int i = 0; i < sizes.size(); ++i) {
+        Probe &probe = probes[i];
+        if (IcmpParseReplies(probe.reply.data(), (DWORD)probe.reply.size()) > 0) {
+            outReplied[i] = ((PICMP_ECHO_REPLY)probe.reply.data())->Status == IP_SUCCESS;
+        }
+    }
+    return true;
+}
+
+int PmtuProber::cachedPayload(const QHostAddress &address)
+{
+    Q_UNUSED(address);
+    return -1;
+}
+
+#else
+
+namespace {
+
+quint16 icmpChecksum(const quint8 *data, size_t size)
+{
+    quint32 sum = 0;
+    for (size_t i = 0; i + 1 < size; i += 2) {
+        quint16 word;
+        memcpy(&word, data + i, sizeof(word));
+        sum += word;
+    }
+    if (size & 1) {
+        sum += data[size - 1];
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return (quint16)~sum;
+}
+
+sockaddr_in toSockaddr(const QHostAddress &address)
+{
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(address.toIPv4Address());
+    return addr;
+}
+
+} // namespace
+
+bool PmtuProber::probeSizes(const QHostAddress &address, const QVector<int> &sizes, QVector<bool> &outReplied)
+{
+    // a new socket per round, so late replies of the previous round are not received
+    int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_ICMP);
+    if (fd < 0) {
+        return false;
+    }
+    auto exitGuard = qScopeGuard([&] {
+        close(fd);
+    });
+
+#ifdef Q_OS_LINUX
+    // set DF and send the sizes above the cached path MTU too
+    int pmtuDiscover = IP_PMTUDISC_PROBE;
+    setsockopt(fd, IPPROTO_IP, IP_MTU_DISCOVER, &pmtuDiscover, sizeof(pmtuDiscover));
+#else
+    int on = 1;
+    setsockopt(fd, IPPROTO_IP, IP_DONTFRAG, &on, sizeof(on));
+#endif
+
+    // Linux replaces the identifier with the local port of the socket, macOS keeps it
+    const quint16 identifier = (quint16)QRandomGenerator::global()->bounded(1, 0xFFFF);
+    const sockaddr_in dest = toSockaddr(address);
+
+    outReplied.fill(false, sizes.size());
+    QVector<bool> pending(sizes.size(), false);
+    for (int i = 0; i < sizes.size(); ++i) {
+        std::vector<quint8> packet(8 + sizes[i], (quint8)('a' + i));
+        packet[0] = 8;  // echo request
+        packet[1] = 0;
+        packet[2] = packet[3] = 0;
+        packet[4] = identifier >> 8;
+        packet[5] = identifier & 0xFF;
+        packet[6] = 0;
+        packet[7] = (quint8)i;
+        const quint16 sum = icmpChecksum(packet.data(), packet.size());
+        memcpy(&packet[2], &sum, sizeof(sum));
+        // fails with EMSGSIZE if the size is above the MTU of the interface
+        if (sendto(fd, packet.data(), packet.size(), 0, (const sockaddr *)&dest, sizeof(dest)) == (ssize_t)packet.size()) {
+            pending[i] = true;
+        }
+    }
+
+    // done once no pending probe is larger than the largest reply
+    auto isRoundDone = [&] {
+        int largestReply = -1;
+        for (int i = 0; i < sizes.size(); ++i) {
+            if (outReplied[i]) {
+                largestReply = std::max(largestReply, sizes[i]);
+            }
+        }
+        for (int i = 0; i < sizes.size(); ++i) {
+            if (pending[i] && sizes[i] > largestReply) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    QElapsedTimer timer;
+    timer.start();
+    while (!isRoundDone()) {
+        const int remainingMs = kTimeoutMs - (int)timer.elapsed();
+        if (remainingMs <= 0) {
+            break;
+        }
+        pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        int ret = poll(&pfd, 1, remainingMs);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            break;
+        }
+
+        quint8 buf[4096];
+        ssize_t len = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (len <= 0) {
+            continue;
+        }
+        const quint8 *data = buf;
+        size_t size = len;
+#ifdef Q_OS_MACOS
+        // macOS datagram ICMP sockets deliver the packet with the IP header
+        if ((data[0] >> 4) == 4) {
+            size_t headerSize = (data[0] & 0x0F) * 4;
+            if (size < headerSize) {
+                continue;
+            }
+            data += headerSize;
+            size -= headerSize;
+        }
+        if (size >= 8 && ((data[4] << 8) | data[5]) != identifier) {
+            continue;
+        }
+#endif
+        if (size < 8 || data[0] != 0) {
+            continue;
+        }
+        const int index = data[7];
+        if (index < sizes.size() && pending[index] && size == (size_t)(8 + sizes[index])) {
+            pending[index] = false;
+            outReplied[index] = true;
+        }
+    }
+    return true;
+}
+
+int PmtuProber::cachedPayload(const QHostAddress &address)
+{
+#ifdef Q_OS_LINUX
+    // connecting a UDP socket sends nothing, but gives the path MTU of the route
+    int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (fd < 0) {
+        return -1;
+    }
+    auto exitGuard = qScopeGuard([&] {
+        close(fd);
+    });
+
+    sockaddr_in dest = toSockaddr(address);
+    dest.sin_port = htons(53);
+    int mtu = 0;
+    socklen_t len = sizeof(mtu);
+    if (::connect(fd, (const sockaddr *)&dest, sizeof(dest)) < 0 || getsockopt(fd, IPPROTO_IP, IP_MTU, &mtu, &len) < 0) {
+        return -1;
+    }
+    const int payload = mtu - kHeadersSize;
+    if (payload < minPayload_) {
+        return -1;
+    }
+    qCDebug(LOG_PACKET_SIZE) << "Path MTU cached by the kernel:" << mtu;
+    return std::min(payload, maxPayload_);
+#else
+    Q_UNUSED(address);
+    return -1;
+#endif
+}
+
+#endif
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <QHostAddress>
+#include <QString>
+#include <QVector>
+#include <functional>
+
+// Finds the largest ICMP echo payload which reaches a host without fragmentation.
+// The probes have the DF flag set and are sent from an in-process socket, several sizes at once per round,
+// and the range is narrowed down to 1 byte. On Linux the path MTU cached by the kernel is probed first.
+// If ICMP sockets are not available (net.ipv4.ping_group_range on Linux), the ping utility is used, one size per round.
+class PmtuProber
+{
+public:
+    PmtuProber(int minPayload, int maxPayload);
+
+    // Blocking. Returns the payload size, or -1 if no size got a reply or the probing was stopped.
+    // isStopped is checked before each round.
+    int probe(const QString &hostname, std::function<bool()> isStopped);
+
+private:
+    static constexpr int kProbesPerRound = 4;
+    static constexpr int kTimeoutMs = 1000;
+    // IPv4 + ICMP headers
+    static constexpr int kHeadersSize = 28;
+
+    int minPayload_;
+    int maxPayload_;
+
+    // Sends the probes in parallel, outReplied[i] is set if sizes[i] got a reply.
+    // Returns false if the probes could not be sent from an in-process socket.
+    bool probeSizes(const QHostAddress &address, const QVector<int> &sizes, QVector<bool> &outReplied);
+    void probeSizesWithPing(const QString &host, const QVector<int> &sizes, QVector<bool> &outReplied);
+    // the path MTU the kernel uses for the address, as a payload size, or -1
+    int cachedPayload(const QHostAddress &address);
+    static QVector<int> roundSizes(int good, int bad, int count);
+};
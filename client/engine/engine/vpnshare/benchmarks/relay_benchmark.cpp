@@ -0,0 +1,204 @@
+// Compares the relay of an established vpnshare proxy connection over loopback TCP:
+//   - qt: two QTcpSocket objects on a Qt event loop with SocketWriteAll flow control, as HttpProxyConnection and
+//     SocksProxyConnection relay when SocketRelay is not available;
+//   - splice: SocketRelay, splice() through a pipe on the epoll thread.
+// The source and the sink run in a child process, so the CPU time of the parent is the cost of the relay only.
+// The peak of the pending bytes is taken from the SocketBufferAccounting of the run, both paths report to it.
+//
+// Usage: relay_benchmark [megabytes]
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QTcpSocket>
+
+#include "../socketutils/socketrelay.h"
+#include "../socketutils/socketwriteall.h"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Result
+{
+    uint64_t bytes;
+    double seconds;
+};
+
+int listenOnLoopback(int &port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (fd < 0 || bind(fd, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 1) != 0 ||
+        getsockname(fd, (sockaddr *)&addr, &len) != 0) {
+        perror("listen");
+        exit(1);
+    }
+    port = ntohs(addr.sin_port);
+    return fd;
+}
+
+int connectToLoopback(int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (fd < 0 || connect(fd, (sockaddr *)&addr, sizeof(addr)) != 0) {
+        perror("connect");
+        exit(1);
+    }
+    return fd;
+}
+
+double cpuSeconds()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+// the child process: sends the data through the proxy to the sink and reports what the sink has received
+void runSourceAndSink(int proxyPort, int sinkListenFd, uint64_t totalBytes, int resultFd)
+{
+    uint64_t received = 0;
+    std::thread sink([&]() {
+        int fd = accept(sinkListenFd, nullptr, nullptr);
+        std::vector<char> buf(256 * 1024);
+        ssize_t len;
+        while ((len = read(fd, buf.data(), buf.size())) > 0) {
+            received += len;
+        }
+        close(fd);
+    });
+
+    int fd = connectToLoopback(proxyPort);
+    const auto start = Clock::now();
+    std::vector<char> buf(256 * 1024, 'x');
+    uint64_t sent = 0;
+    while (sent < totalBytes) {
+        ssize_t len = write(fd, buf.data(), std::min<uint64_t>(buf.size(), totalBytes - sent));
+        if (len <= 0) {
+            break;
+        }
+        sent += len;
+    }
+    shutdown(fd, SHUT_WR);
+    sink.join();
+
+    Result result = { received, std::chrono::duration<double>(Clock::now() - start).count() };
+    (void)write(resultFd, &result, sizeof(result));
+    close(fd);
+}
+
+void relayWithQt(int clientFd, int externalFd, std::shared_ptr<SocketBufferAccounting> accounting)
+{
+    QEventLoop loop;
+    QTcpSocket client, external;
+    client.setSocketDescriptor(clientFd);
+    external.setSocketDescriptor(externalFd);
+    client.setReadBufferSize(SocketWriteAll::kReadBufferSize);
+    external.setReadBufferSize(SocketWriteAll::kReadBufferSize);
+    SocketWriteAll toClient(nullptr, &client, accounting);
+    SocketWriteAll toExternal(nullptr, &external, accounting);
+
+    // the data is left in the source socket while the other side is full, as the proxy connections do
+    auto relay = [](QTcpSocket &from, SocketWriteAll &to) {
+        if (!to.isFull() && from.bytesAvailable() > 0) {
+            to.write(from.readAll());
+        }
+    };
+    QObject::connect(&client, &QTcpSocket::readyRead, [&]() { relay(client, toExternal); });
+    QObject::connect(&external, &QTcpSocket::readyRead, [&]() { relay(external, toClient); });
+    QObject::connect(&toExternal, &SocketWriteAll::drained, [&]() { relay(client, toExternal); });
+    QObject::connect(&toClient, &SocketWriteAll::drained, [&]() { relay(external, toClient); });
+    QObject::connect(&client, &QTcpSocket::disconnected, [&]() {
+        toExternal.write(client.readAll());
+        external.disconnectFromHost();
+    });
+    QObject::connect(&external, &QTcpSocket::disconnected, &loop, &QEventLoop::quit);
+    loop.exec();
+}
+
+void relayWithSocketRelay(int clientFd, int externalFd, std::shared_ptr<SocketBufferAccounting> accounting)
+{
+    std::promise<void> finished;
+    SocketRelay::instance().add(clientFd, externalFd, std::string(), std::string(), accounting,
+                                [&finished]() { finished.set_value(); });
+    finished.get_future().wait();
+}
+
+void runBenchmark(const char *name, void (*relay)(int, int, std::shared_ptr<SocketBufferAccounting>), uint64_t totalBytes)
+{
+    int proxyPort, sinkPort;
+    int proxyListenFd = listenOnLoopback(proxyPort);
+    int sinkListenFd = listenOnLoopback(sinkPort);
+    int resultPipe[2];
+    if (pipe(resultPipe) != 0) {
+        perror("pipe");
+        exit(1);
+    }
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        runSourceAndSink(proxyPort, sinkListenFd, totalBytes, resultPipe[1]);
+        _exit(0);
+    }
+
+    const double cpuStart = cpuSeconds();
+    int clientFd = accept(proxyListenFd, nullptr, nullptr);
+    int externalFd = connectToLoopback(sinkPort);
+    auto accounting = std::make_shared<SocketBufferAccounting>();
+    relay(clientFd, externalFd, accounting);
+    const double cpu = cpuSeconds() - cpuStart;
+
+    Result result = {};
+    if (read(resultPipe[0], &result, sizeof(result)) != sizeof(result)) {
+        fprintf(stderr, "%s: no result from the child process\n", name);
+    }
+    waitpid(pid, nullptr, 0);
+    close(resultPipe[0]);
+    close(resultPipe[1]);
+    close(proxyListenFd);
+    close(sinkListenFd);
+
+    if (result.bytes != totalBytes) {
+        fprintf(stderr, "%s: the sink has received %llu bytes of %llu\n", name, (unsigned long long)result.bytes,
+                (unsigned long long)totalBytes);
+    }
+    if (accounting->bytes != 0 || (uint64_t)accounting->writtenBytes != result.bytes) {
+        fprintf(stderr, "%s: %lld bytes relayed, %lld left pending\n", name, (long long)accounting->writtenBytes.load(),
+                (long long)accounting->bytes.load());
+    }
+    printf("%-6s: %8.1f MB/s, %6.3f CPU s per GB, %6lld KB peak pending\n", name, result.bytes / 1e6 / result.seconds,
+           cpu / (result.bytes / 1e9), (long long)accounting->peakBytes.load() / 1024);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const uint64_t megabytes = argc > 1 ? strtoull(argv[1], nullptr, 10) : 2048;
+    QCoreApplication app(argc, argv);
+
+    printf("relaying %llu MB over loopback TCP\n", (unsigned long long)megabytes);
+    runBenchmark("qt", relayWithQt, megabytes * 1024 * 1024);
+    runBenchmark("splice", relayWithSocketRelay, megabytes * 1024 * 1024);
+    return 0;
+}
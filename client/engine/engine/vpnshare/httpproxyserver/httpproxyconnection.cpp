@@ -4,17 +4,28 @@
 #include "utils/ws_assert.h"
 #include "utils/log/categories.h"
 
+#ifdef Q_OS_LINUX
+    #include "../socketutils/relayhandover.h"
+    #include "../socketutils/socketrelay.h"
+#endif
+
 namespace HttpProxyServer {
 
 
 HttpProxyConnection::HttpProxyConnection(qintptr socketDescriptor, const QString &hostname, QObject *parent) : QObject(parent),
     socket_(nullptr), socketExternal_(nullptr), socketDescriptor_(socketDescriptor),
     hostname_(hostname), state_(READ_CLIENT_REQUEST), writeAllSocket_(nullptr),
-    writeAllSocketExternal_(nullptr), httpError_(), bAlreadyClosedAndEmitFinished_(false)
+    writeAllSocketExternal_(nullptr), bufferAccounting_(std::make_shared<SocketBufferAccounting>()), httpError_(),
+    bAlreadyClosedAndEmitFinished_(false), relayId_(0)
 {
     httpError_.status = HttpProxyReply::ok;
 }
 
+std::shared_ptr<SocketBufferAccounting> HttpProxyConnection::bufferAccounting() const
+{
+    return bufferAccounting_;
+}
+
 void HttpProxyConnection::forceClose()
 {
     closeSocketsAndEmitFinished();
@@ -29,9 +40,12 @@ void HttpProxyConnection::start()
     }
 
     state_ = READ_CLIENT_REQUEST;
+    socket_->setReadBufferSize(SocketWriteAll::kReadBufferSize);
     connect(socket_, &QTcpSocket::disconnected, this, &HttpProxyConnection::onSocketDisconnected);
     connect(socket_, &QTcpSocket::readyRead, this, &HttpProxyConnection::onSocketReadyRead);
-    writeAllSocket_ = new SocketWriteAll(this, socket_);
+    writeAllSocket_ = new SocketWriteAll(this, socket_, bufferAccounting_);
+    // the reading from the web server is resumed when the client takes the pending data
+    connect(writeAllSocket_, &SocketWriteAll::drained, this, &HttpProxyConnection::onExternalSocketReadyRead);
 }
 
 void HttpProxyConnection::onSocketDisconnected()
@@ -41,6 +55,11 @@ void HttpProxyConnection::onSocketDisconnected()
 
 void HttpProxyConnection::onSocketReadyRead()
 {
+    if (writeAllSocketExternal_ && writeAllSocketExternal_->isFull())
+    {
+        // the data is left in the socket until the web server takes the pending data
+        return;
+    }
     QByteArray arr = socket_->readAll();
 
     if (state_ == READ_CLIENT_REQUEST)
@@ -59,13 +78,15 @@ void HttpProxyConnection::onSocketReadyRead()
             if (requestParser_.getRequest().extractHostAndPort())
             {
                 socketExternal_ = new QTcpSocket(this);
+                socketExternal_->setReadBufferSize(SocketWriteAll::kReadBufferSize);
 
                 connect(socketExternal_, &QTcpSocket::connected, this, &HttpProxyConnection::onExternalSocketConnected);
                 connect(socketExternal_, &QTcpSocket::disconnected, this, &HttpProxyConnection::onExternalSocketDisconnected);
                 connect(socketExternal_, &QTcpSocket::readyRead, this, &HttpProxyConnection::onExternalSocketReadyRead);
                 connect(socketExternal_, &QTcpSocket::errorOccurred, this, &HttpProxyConnection::onExternalSocketError);
 
-                writeAllSocketExternal_ = new SocketWriteAll(this, socketExternal_);
+                writeAllSocketExternal_ = new SocketWriteAll(this, socketExternal_, bufferAccounting_);
+                connect(writeAllSocketExternal_, &SocketWriteAll::drained, this, &HttpProxyConnection::onSocketReadyRead);
 
                 state_ = CONNECTING_TO_EXTERNAL_SERVER;
                 socketExternal_->connectToHost(QString::fromStdString(requestParser_.getRequest().host), requestParser_.getRequest().port);
@@ -121,7 +142,7 @@ void HttpProxyConnection::onExternalSocketConnected()
                 writeAllSocketExternal_->write(extraContent_);
                 extraContent_.clear();
             }
-            state_ = RELAY_BETWEEN_CLIENT_SERVER;
+            startRelay();
         }
         else
         {
@@ -162,6 +183,11 @@ void HttpProxyConnection::onExternalSocketDisconnected()
         // wait while all data will be write to client socket
         if (writeAllSocket_)
         {
+            // the data held back by the flow control
+            if (state_ == RELAY_BETWEEN_CLIENT_SERVER && socketExternal_->bytesAvailable() > 0)
+            {
+                writeAllSocket_->write(socketExternal_->readAll());
+            }
             connect(writeAllSocket_, &SocketWriteAll::allDataWriteFinished, this, &HttpProxyConnection::onSocketAllDataWritten);
             writeAllSocket_->setEmitAllDataWritten();
         }
@@ -174,6 +200,10 @@ void HttpProxyConnection::onExternalSocketDisconnected()
 
 void HttpProxyConnection::onExternalSocketReadyRead()
 {
+    if (writeAllSocket_->isFull())
+    {
+        return;
+    }
     QByteArray arr = socketExternal_->readAll();
     if (state_ == RELAY_BETWEEN_CLIENT_SERVER)
     {
@@ -196,7 +226,7 @@ void HttpProxyConnection::onExternalSocketReadyRead()
             {
                 writeAllSocket_->write(QByteArray(arr.data() + parsed, remainingData));
             }
-            state_ = RELAY_BETWEEN_CLIENT_SERVER;
+            startRelay();
         }
         else if (ret == TRI_FALSE)
         {
@@ -224,11 +254,50 @@ void HttpProxyConnection::onExternalSocketError(QAbstractSocket::SocketError soc
     }
 }
 
+#ifdef Q_OS_LINUX
+void HttpProxyConnection::tryHandOverToRelay()
+{
+    if (state_ != RELAY_BETWEEN_CLIENT_SERVER || relayId_ != 0 || bAlreadyClosedAndEmitFinished_)
+    {
+        return;
+    }
+    // the data already queued in Qt must be sent first to keep the order
+    if (!writeAllSocket_->isEmpty() || !writeAllSocketExternal_->isEmpty() ||
+        socket_->bytesToWrite() > 0 || socketExternal_->bytesToWrite() > 0 ||
+        socket_->state() != QAbstractSocket::ConnectedState || socketExternal_->state() != QAbstractSocket::ConnectedState)
+    {
+        return;
+    }
+
+    relayId_ = handOverToSocketRelay(socket_, socketExternal_, bufferAccounting_, [this]() {
+        QMetaObject::invokeMethod(this, [this] { closeSocketsAndEmitFinished(); }, Qt::QueuedConnection);
+    });
+    bufferAccounting_->isRelayed = relayId_ != 0;
+}
+#endif
+
+void HttpProxyConnection::startRelay()
+{
+    state_ = RELAY_BETWEEN_CLIENT_SERVER;
+#ifdef Q_OS_LINUX
+    // the handshake data is written by Qt, then the sockets are moved to the splice() relay
+    connect(socket_, &QTcpSocket::bytesWritten, this, &HttpProxyConnection::tryHandOverToRelay);
+    connect(socketExternal_, &QTcpSocket::bytesWritten, this, &HttpProxyConnection::tryHandOverToRelay);
+    tryHandOverToRelay();
+#endif
+}
+
 void HttpProxyConnection::closeSocketsAndEmitFinished()
 {
     if (!bAlreadyClosedAndEmitFinished_)
     {
         bAlreadyClosedAndEmitFinished_ = true;
+#ifdef Q_OS_LINUX
+        if (relayId_ != 0)
+        {
+            SocketRelay::instance().remove(relayId_);
+        }
+#endif
         if (socket_)
         {
             socket_->close();
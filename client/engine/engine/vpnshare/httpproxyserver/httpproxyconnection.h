@@ -17,6 +17,9 @@ public:
 
     bool start(qintptr socketDescriptor);
 
+    // the data waiting to be written to both sockets and the written bytes, can be read from any thread
+    std::shared_ptr<SocketBufferAccounting> bufferAccounting() const;
+
 public slots:
     void start();
     void forceClose();
@@ -50,12 +53,18 @@ private:
 
     SocketWriteAll *writeAllSocket_;
     SocketWriteAll *writeAllSocketExternal_;
+    std::shared_ptr<SocketBufferAccounting> bufferAccounting_;
 
     QByteArray extraContent_;
     HttpProxyReply httpError_;
 
     bool bAlreadyClosedAndEmitFinished_;
+    quint64 relayId_;
     void closeSocketsAndEmitFinished();
+    void startRelay();
+#ifdef Q_OS_LINUX
+    void tryHandOverToRelay();
+#endif
 };
 
 } // namespace HttpProxyServer
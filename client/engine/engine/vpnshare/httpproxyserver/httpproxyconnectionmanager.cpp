@@ -1,24 +1,39 @@
 #include "httpproxyconnectionmanager.h"
 
-#include <QThread>
-#include <QTimer>
 #include "utils/ws_assert.h"
+#include "utils/log/categories.h"
 
 namespace HttpProxyServer {
 
 HttpProxyConnectionManager::HttpProxyConnectionManager(QObject *parent, int threadsCount, ConnectedUsersCounter *usersCounter) : QObject(parent),
     usersCounter_(usersCounter)
 {
-    WS_ASSERT(threadsCount > 0);
-    for (int i = 0; i < threadsCount; i++)
-    {
-        QThread *thread = new QThread(this);
-        threads_[thread] = 0;
-        thread->start(QThread::LowPriority);
-    }
+    workerPool_ = new ProxyWorkerPool(this, threadsCount, [this](qintptr socketDescriptor) {
+        return createConnection(socketDescriptor);
+    });
 }
 
-void HttpProxyConnectionManager::newConnection(qintptr socketDescriptor)
+bool HttpProxyConnectionManager::listen(quint16 port)
+{
+    return workerPool_->listen(port);
+}
+
+void HttpProxyConnectionManager::close()
+{
+    workerPool_->close();
+}
+
+bool HttpProxyConnectionManager::isListening() const
+{
+    return workerPool_->isListening();
+}
+
+quint16 HttpProxyConnectionManager::serverPort() const
+{
+    return workerPool_->port();
+}
+
+ProxyWorkerPool::Connection HttpProxyConnectionManager::createConnection(qintptr socketDescriptor)
 {
 #ifdef Q_OS_WIN
     SOCKADDR_IN  addr = {0};
@@ -28,88 +43,43 @@ void HttpProxyConnectionManager::newConnection(qintptr socketDescriptor)
     socklen_t addr_len = sizeof(addr);
 #endif
     getpeername(socketDescriptor, (sockaddr*)&addr, &addr_len);
-    char *ip = inet_ntoa(addr.sin_addr);
-    usersCounter_->newUserConnected(ip);
-    QThread *thread = getLessBusyThread();
+    const QString ip = inet_ntoa(addr.sin_addr);
+    // the counter lives on the thread of the manager
+    QMetaObject::invokeMethod(this, [this, ip]() { usersCounter_->newUserConnected(ip); }, Qt::QueuedConnection);
+
     HttpProxyConnection *connection = new HttpProxyConnection(socketDescriptor, ip);
     connect(connection, &HttpProxyConnection::finished, this, &HttpProxyConnectionManager::onConnectionFinished);
-    addConnectionToThread(thread, connection);
-
-    //qDebug() << "Count of connections:" << connections_.count();
+    return { connection, connection->bufferAccounting() };
 }
 
 void HttpProxyConnectionManager::closeAllConnections()
 {
-    for(auto c : connections_.keys())
-    {
-        QMetaObject::invokeMethod(c, "forceClose", Qt::QueuedConnection);
-    }
+    workerPool_->closeAllConnections();
 }
 
 void HttpProxyConnectionManager::stop()
 {
-    for(auto thread : threads_.keys())
-    {
-        thread->exit();
-    }
-    for(auto thread : threads_.keys())
-    {
-        thread->wait();
-    }
+    workerPool_->stop();
 }
 
 void HttpProxyConnectionManager::onConnectionFinished(const QString &hostname)
 {
     HttpProxyConnection *connection = static_cast<HttpProxyConnection *>(sender());
     usersCounter_->userDiconnected(hostname);
-    //qDebug() << "Connection finished:" << connection;
-    QMap<HttpProxyConnection *, QThread *>::iterator it = connections_.find(connection);
-    WS_ASSERT(it != connections_.end());
-
-    QMap<QThread *, quint32>::iterator itThread = threads_.find(it.value());
-    WS_ASSERT(itThread != threads_.end());
-    itThread.value()--;
-
-    it.key()->deleteLater();
-    connections_.erase(it);
-
-    //qDebug() << "Count of connections:" << connections_.count();
-
-}
-
-QThread *HttpProxyConnectionManager::getLessBusyThread()
-{
-    WS_ASSERT(threads_.count() > 0);
-    quint32 min = threads_.begin().value();
-    QThread *thread = threads_.begin().key();
-
-    for (QMap<QThread *, quint32>::const_iterator it = threads_.cbegin(); it != threads_.cend(); ++it)
-    {
-        if (it.value() < min)
-        {
-            min = it.value();
-            thread = it.key();
-        }
-    }
-    return thread;
+    workerPool_->removeConnection(connection);
+    connection->deleteLater();
 }
 
-void HttpProxyConnectionManager::addConnectionToThread(QThread *thread, HttpProxyConnection *connection)
+qint64 HttpProxyConnectionManager::bufferedBytes() const
 {
-    //qDebug() << "Connection started:" << connection;
-    connection->moveToThread(thread);
-    QTimer::singleShot(0, connection, SLOT(start()));
-    WS_ASSERT(!connections_.contains(connection));
-    connections_[connection] = thread;
-    threads_[thread]++;
+    return workerPool_->bufferedBytes();
 }
 
-void HttpProxyConnectionManager::dumpThreads()
+void HttpProxyConnectionManager::logMemoryUsage() const
 {
-    for (QMap<QThread *, quint32>::iterator it = threads_.begin(); it != threads_.end(); ++it)
-    {
-        qDebug() << "Thread:" << it.key() << "Value:" << it.value();
-    }
+    qCDebug(LOG_HTTP_SERVER) << "Buffered bytes:" << bufferedBytes() << "in" << workerPool_->connectionsCount() << "connections, peak per connection:"
+                             << workerPool_->peakConnectionBufferedBytes()
+                             << "all proxies:" << SocketWriteAll::total().bytes.load() << "peak:" << SocketWriteAll::total().peakBytes.load();
 }
 
 } // namespace HttpProxyServer
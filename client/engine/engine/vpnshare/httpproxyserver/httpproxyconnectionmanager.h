@@ -1,9 +1,9 @@
 #pragma once
 
 #include <QObject>
-#include <QMap>
 #include "httpproxyconnection.h"
 #include "../connecteduserscounter.h"
+#include "../proxyworkerpool.h"
 
 namespace HttpProxyServer {
 
@@ -14,21 +14,27 @@ public:
     explicit HttpProxyConnectionManager(QObject *parent, int threadsCount, ConnectedUsersCounter *usersCounter);
 
 public:
-    void newConnection(qintptr socketDescriptor);
+    bool listen(quint16 port);
+    void close();
+    bool isListening() const;
+    quint16 serverPort() const;
+
     void closeAllConnections();
     void stop();
 
+    // the data waiting to be written by the active connections
+    qint64 bufferedBytes() const;
+    void logMemoryUsage() const;
+
 private slots:
     void onConnectionFinished(const QString &hostname);
 
 private:
-    QMap<QThread *, quint32> threads_;
-    QMap<HttpProxyConnection *, QThread *> connections_;
+    ProxyWorkerPool *workerPool_;
     ConnectedUsersCounter *usersCounter_;
 
-    QThread *getLessBusyThread();
-    void addConnectionToThread(QThread *thread, HttpProxyConnection *connection);
-    void dumpThreads();
+    // called on the thread of a worker
+    ProxyWorkerPool::Connection createConnection(qintptr socketDescriptor);
 };
 
 } // namespace HttpProxyServer
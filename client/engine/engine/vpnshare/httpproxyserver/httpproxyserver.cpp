@@ -4,11 +4,11 @@
 
 namespace HttpProxyServer {
 
-HttpProxyServer::HttpProxyServer(QObject *parent) : QTcpServer(parent)
+HttpProxyServer::HttpProxyServer(QObject *parent) : QObject(parent)
 {
     usersCounter_ = new ConnectedUsersCounter(this);
     connect(usersCounter_, &ConnectedUsersCounter::usersCountChanged, this, &HttpProxyServer::usersCountChanged);
-    connectionManager_ = new HttpProxyConnectionManager(this, 4, usersCounter_);
+    connectionManager_ = new HttpProxyConnectionManager(this, ProxyWorkerPool::defaultWorkersCount(), usersCounter_);
 }
 
 HttpProxyServer::~HttpProxyServer()
@@ -20,7 +20,7 @@ bool HttpProxyServer::startServer(quint16 port)
 {
     WS_ASSERT(!isListening());
 
-    if (listen(QHostAddress::AnyIPv4, port))
+    if (connectionManager_->listen(port))
     {
         qCDebug(LOG_HTTP_SERVER) << "Http proxy server started on port" << serverPort();
         return true;
@@ -37,8 +37,9 @@ void HttpProxyServer::stopServer()
     if (isListening())
     {
         qCDebug(LOG_HTTP_SERVER) << "Http proxy server stopped on port" << serverPort();
-        close();
+        connectionManager_->close();
     }
+    connectionManager_->logMemoryUsage();
     connectionManager_->stop();
     usersCounter_->reset();
 }
@@ -53,9 +54,14 @@ void HttpProxyServer::closeActiveConnections()
     connectionManager_->closeAllConnections();
 }
 
-void HttpProxyServer::incomingConnection(qintptr socketDescriptor)
+bool HttpProxyServer::isListening() const
 {
-    connectionManager_->newConnection(socketDescriptor);
+    return connectionManager_->isListening();
+}
+
+quint16 HttpProxyServer::serverPort() const
+{
+    return connectionManager_->serverPort();
 }
 
 
@@ -0,0 +1,513 @@
+#include "proxyworkerpool.h"
+
+#include <QSocketNotifier>
+#include <cmath>
+#include <cstring>
+#include "utils/ws_assert.h"
+
+#ifdef Q_OS_WIN
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #include <windows.h>
+#else
+    #include <arpa/inet.h>
+    #include <cerrno>
+    #include <ctime>
+    #include <fcntl.h>
+    #include <netinet/in.h>
+    #include <sys/socket.h>
+    #include <unistd.h>
+#endif
+
+namespace {
+const qintptr kInvalidSocket = -1;
+// the connections accepted per notification, so a burst does not hold the thread
+const int kMaxAcceptsPerNotification = 64;
+const int kListenBacklog = 128;
+}
+
+ProxyWorkerPool::ProxyWorkerPool(QObject *parent, int workersCount, ConnectionFactory factory) : QObject(parent),
+    factory_(factory), listenSocket_(kInvalidSocket), notifier_(nullptr), port_(0), isListening_(false), isStopped_(false),
+    lastRebalanceUs_(0), peakConnectionBufferedBytes_(0)
+{
+    WS_ASSERT(workersCount > 0);
+    clock_.start();
+
+    for (int i = 0; i < workersCount; i++)
+    {
+        Worker *worker = new Worker();
+        worker->thread = new QThread(this);
+        worker->context = new QObject();
+        worker->listenSocket = kInvalidSocket;
+        worker->notifier = nullptr;
+        worker->connectionsCount = 0;
+        worker->cpuTimeUs = worker->sampleTimeUs = worker->lastCpuTimeUs = worker->lastSampleTimeUs = 0;
+        worker->cpuUsage = worker->bytesPerSec = 0;
+        worker->context->moveToThread(worker->thread);
+        connect(worker->thread, &QThread::finished, worker->context, &QObject::deleteLater);
+        workers_ << worker;
+        worker->thread->start(QThread::LowPriority);
+
+        // the CPU time of a thread can only be read on the thread itself on all the platforms
+        QMetaObject::invokeMethod(worker->context, [this, worker]() {
+            QTimer *timer = new QTimer(worker->context);
+            connect(timer, &QTimer::timeout, worker->context, [this, worker]() {
+                const qint64 cpuTime = currentThreadCpuTimeUs();
+                QMutexLocker locker(&mutex_);
+                worker->cpuTimeUs = cpuTime;
+                worker->sampleTimeUs = clock_.nsecsElapsed() / 1000;
+            });
+            timer->start(kCpuSampleIntervalMs);
+        }, Qt::QueuedConnection);
+    }
+
+    connect(&rebalanceTimer_, &QTimer::timeout, this, &ProxyWorkerPool::onRebalanceTimer);
+    rebalanceTimer_.start(kRebalanceIntervalMs);
+}
+
+ProxyWorkerPool::~ProxyWorkerPool()
+{
+    close();
+    stop();
+    qDeleteAll(workers_);
+}
+
+bool ProxyWorkerPool::listen(quint16 port)
+{
+    WS_ASSERT(!isListening_);
+    WS_ASSERT(!isStopped_);
+
+#ifdef Q_OS_LINUX
+    for (Worker *worker : std::as_const(workers_))
+    {
+        quint16 boundPort;
+        worker->listenSocket = openListenSocket(port, true, boundPort);
+        if (worker->listenSocket == kInvalidSocket)
+        {
+            for (Worker *w : std::as_const(workers_))
+            {
+                closeSocket(w->listenSocket);
+                w->listenSocket = kInvalidSocket;
+            }
+            return false;
+        }
+        // for the port 0 the other listeners take the port of the first one
+        port = boundPort;
+    }
+
+    for (Worker *worker : std::as_const(workers_))
+    {
+        QMetaObject::invokeMethod(worker->context, [this, worker]() {
+            worker->notifier = new QSocketNotifier(worker->listenSocket, QSocketNotifier::Read, worker->context);
+            connect(worker->notifier, &QSocketNotifier::activated, worker->context, [this, worker]() {
+                acceptConnections(worker, worker->listenSocket);
+            });
+        }, Qt::QueuedConnection);
+    }
+#else
+    listenSocket_ = openListenSocket(port, false, port);
+    if (listenSocket_ == kInvalidSocket)
+    {
+        return false;
+    }
+    notifier_ = new QSocketNotifier(listenSocket_, QSocketNotifier::Read, this);
+    connect(notifier_, &QSocketNotifier::activated, this, [this]() {
+        acceptConnections(nullptr, listenSocket_);
+    });
+#endif
+
+    port_ = port;
+    isListening_ = true;
+    return true;
+}
+
+void ProxyWorkerPool::close()
+{
+    if (!isListening_)
+    {
+        return;
+    }
+    isListening_ = false;
+
+#ifdef Q_OS_LINUX
+    for (Worker *worker : std::as_const(workers_))
+    {
+        // the notifier is deleted on its thread before the socket is closed
+        if (worker->thread->isRunning())
+        {
+            QMetaObject::invokeMethod(worker->context, [worker]() {
+                delete worker->notifier;
+                worker->notifier = nullptr;
+            }, Qt::BlockingQueuedConnection);
+        }
+        closeSocket(worker->listenSocket);
+        worker->listenSocket = kInvalidSocket;
+    }
+#else
+    delete notifier_;
+    notifier_ = nullptr;
+    closeSocket(listenSocket_);
+    listenSocket_ = kInvalidSocket;
+#endif
+}
+
+bool ProxyWorkerPool::isListening() const
+{
+    return isListening_;
+}
+
+quint16 ProxyWorkerPool::port() const
+{
+    return port_;
+}
+
+void ProxyWorkerPool::removeConnection(QObject *connection)
+{
+    QMutexLocker locker(&mutex_);
+    auto it = connections_.find(connection);
+    WS_ASSERT(it != connections_.end());
+    if (it == connections_.end())
+    {
+        return;
+    }
+    it->worker->connectionsCount--;
+    peakConnectionBufferedBytes_ = qMax(peakConnectionBufferedBytes_, it->accounting->peakBytes.load());
+    connections_.erase(it);
+}
+
+void ProxyWorkerPool::closeAllConnections()
+{
+    QMutexLocker locker(&mutex_);
+    for (auto it = connections_.cbegin(); it != connections_.cend(); ++it)
+    {
+        QMetaObject::invokeMethod(it.key(), "forceClose", Qt::QueuedConnection);
+    }
+}
+
+void ProxyWorkerPool::stop()
+{
+    if (isStopped_)
+    {
+        return;
+    }
+    isStopped_ = true;
+    rebalanceTimer_.stop();
+
+    for (Worker *worker : std::as_const(workers_))
+    {
+        worker->thread->exit();
+    }
+    for (Worker *worker : std::as_const(workers_))
+    {
+        worker->thread->wait();
+    }
+}
+
+int ProxyWorkerPool::connectionsCount() const
+{
+    QMutexLocker locker(&mutex_);
+    return connections_.count();
+}
+
+qint64 ProxyWorkerPool::bufferedBytes() const
+{
+    QMutexLocker locker(&mutex_);
+    qint64 bytes = 0;
+    for (const ConnectionInfo &info : connections_)
+    {
+        bytes += info.accounting->bytes;
+    }
+    return bytes;
+}
+
+qint64 ProxyWorkerPool::peakConnectionBufferedBytes() const
+{
+    QMutexLocker locker(&mutex_);
+    qint64 peak = peakConnectionBufferedBytes_;
+    for (const ConnectionInfo &info : connections_)
+    {
+        peak = qMax(peak, info.accounting->peakBytes.load());
+    }
+    return peak;
+}
+
+int ProxyWorkerPool::defaultWorkersCount()
+{
+    return qBound(2, QThread::idealThreadCount(), 8);
+}
+
+void ProxyWorkerPool::onRebalanceTimer()
+{
+    const qint64 nowUs = clock_.nsecsElapsed() / 1000;
+    const double elapsedSec = (nowUs - lastRebalanceUs_) / 1e6;
+    lastRebalanceUs_ = nowUs;
+    if (elapsedSec <= 0)
+    {
+        return;
+    }
+
+    QMutexLocker locker(&mutex_);
+    for (Worker *worker : std::as_const(workers_))
+    {
+        const qint64 sampleUs = worker->sampleTimeUs - worker->lastSampleTimeUs;
+        worker->cpuUsage = sampleUs > 0 && worker->lastSampleTimeUs > 0 ? double(worker->cpuTimeUs - worker->lastCpuTimeUs) / sampleUs : 0;
+        worker->lastCpuTimeUs = worker->cpuTimeUs;
+        worker->lastSampleTimeUs = worker->sampleTimeUs;
+        worker->bytesPerSec = 0;
+    }
+    for (ConnectionInfo &info : connections_)
+    {
+        const qint64 written = info.accounting->writtenBytes;
+        // moving a relayed connection would not change the CPU usage of the workers
+        info.bytesPerSec = info.accounting->isRelayed ? 0 : (written - info.lastWrittenBytes) / elapsedSec;
+        info.lastWrittenBytes = written;
+        info.worker->bytesPerSec += info.bytesPerSec;
+    }
+
+    Worker *busiest = workers_.first();
+    Worker *idlest = workers_.first();
+    for (Worker *worker : std::as_const(workers_))
+    {
+        if (worker->cpuUsage > busiest->cpuUsage)
+        {
+            busiest = worker;
+        }
+        if (worker->cpuUsage < idlest->cpuUsage)
+        {
+            idlest = worker;
+        }
+    }
+    const double gap = busiest->cpuUsage - idlest->cpuUsage;
+    if (gap < kImbalanceThreshold || busiest->bytesPerSec <= 0)
+    {
+        return;
+    }
+
+    // the CPU time of the worker is shared by its connections in proportion to their bytes; the best connection to move
+    // halves the gap, and one that costs more than the gap would only swap the workers
+    QObject *best = nullptr;
+    double bestDistance = 0;
+    for (auto it = connections_.begin(); it != connections_.end(); ++it)
+    {
+        if (it->worker != busiest || it->bytesPerSec <= 0)
+        {
+            continue;
+        }
+        const double cost = busiest->cpuUsage * it->bytesPerSec / busiest->bytesPerSec;
+        const double distance = std::abs(cost - gap / 2);
+        if (cost < gap && (!best || distance < bestDistance))
+        {
+            best = it.key();
+            bestDistance = distance;
+        }
+    }
+    if (best)
+    {
+        moveConnection(best, connections_[best], idlest);
+    }
+}
+
+void ProxyWorkerPool::acceptConnections(Worker *worker, qintptr listenSocket)
+{
+    for (int i = 0; i < kMaxAcceptsPerNotification; i++)
+    {
+        const qintptr socketDescriptor = acceptSocket(listenSocket);
+        if (socketDescriptor == kInvalidSocket)
+        {
+            break;
+        }
+
+        if (worker)
+        {
+            // on the thread of the worker that has accepted it
+            {
+                QMutexLocker locker(&mutex_);
+                worker->connectionsCount++;
+            }
+            startConnection(worker, socketDescriptor);
+        }
+        else
+        {
+            Worker *target;
+            {
+                QMutexLocker locker(&mutex_);
+                target = leastLoadedWorker();
+                target->connectionsCount++;
+            }
+            QMetaObject::invokeMethod(target->context, [this, target, socketDescriptor]() {
+                startConnection(target, socketDescriptor);
+            }, Qt::QueuedConnection);
+        }
+    }
+}
+
+void ProxyWorkerPool::startConnection(Worker *worker, qintptr socketDescriptor)
+{
+    Connection connection = factory_(socketDescriptor);
+    WS_ASSERT(connection.object->thread() == worker->thread);
+    {
+        QMutexLocker locker(&mutex_);
+        ConnectionInfo info;
+        info.worker = worker;
+        info.accounting = connection.accounting;
+        info.lastWrittenBytes = connection.accounting->writtenBytes;
+        info.bytesPerSec = 0;
+        connections_.insert(connection.object, info);
+    }
+    QMetaObject::invokeMethod(connection.object, "start");
+}
+
+ProxyWorkerPool::Worker *ProxyWorkerPool::leastLoadedWorker() const
+{
+    // by CPU usage, the bytes per second and the number of connections, so the new connections are spread while idle
+    Worker *least = workers_.first();
+    for (Worker *worker : std::as_const(workers_))
+    {
+        if (worker->cpuUsage + kImbalanceThreshold / 2 < least->cpuUsage)
+        {
+            least = worker;
+        }
+        else if (std::abs(worker->cpuUsage - least->cpuUsage) <= kImbalanceThreshold / 2 &&
+                 (worker->bytesPerSec < least->bytesPerSec ||
+                  (worker->bytesPerSec == least->bytesPerSec && worker->connectionsCount < least->connectionsCount)))
+        {
+            least = worker;
+        }
+    }
+    return least;
+}
+
+void ProxyWorkerPool::moveConnection(QObject *connection, ConnectionInfo &info, Worker *to)
+{
+    info.worker->connectionsCount--;
+    info.worker->bytesPerSec -= info.bytesPerSec;
+    to->connectionsCount++;
+    to->bytesPerSec += info.bytesPerSec;
+    info.worker = to;
+
+    // an object can only be moved from its own thread; the pending events of the connection go with it, and the call
+    // is dropped if the connection is deleted before
+    QThread *thread = to->thread;
+    QMetaObject::invokeMethod(connection, [connection, thread]() {
+        connection->moveToThread(thread);
+    }, Qt::QueuedConnection);
+}
+
+qintptr ProxyWorkerPool::openListenSocket(quint16 port, bool isReusePort, quint16 &boundPort)
+{
+#ifdef Q_OS_WIN
+    SOCKET s = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == INVALID_SOCKET)
+    {
+        return kInvalidSocket;
+    }
+    // as QTcpServer does on Windows, another process can't bind the port
+    BOOL on = TRUE;
+    setsockopt(s, SOL_SOCKET, SO_EXCLUSIVEADDRUSE, (const char *)&on, sizeof(on));
+    u_long nonBlocking = 1;
+    ioctlsocket(s, FIONBIO, &nonBlocking);
+    Q_UNUSED(isReusePort);
+#else
+    int s = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (s < 0)
+    {
+        return kInvalidSocket;
+    }
+    fcntl(s, F_SETFD, FD_CLOEXEC);
+    fcntl(s, F_SETFL, fcntl(s, F_GETFL) | O_NONBLOCK);
+    int on = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    #ifdef Q_OS_LINUX
+    if (isReusePort && setsockopt(s, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) != 0)
+    {
+        ::close(s);
+        return kInvalidSocket;
+    }
+    #else
+    Q_UNUSED(isReusePort);
+    #endif
+#endif
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+#ifdef Q_OS_WIN
+    int addrLen = sizeof(addr);
+#else
+    socklen_t addrLen = sizeof(addr);
+#endif
+    if (::bind(s, (sockaddr *)&addr, sizeof(addr)) != 0 || ::listen(s, kListenBacklog) != 0 ||
+        getsockname(s, (sockaddr *)&addr, &addrLen) != 0)
+    {
+        closeSocket((qintptr)s);
+        return kInvalidSocket;
+    }
+    boundPort = ntohs(addr.sin_port);
+    return (qintptr)s;
+}
+
+qintptr ProxyWorkerPool::acceptSocket(qintptr listenSocket)
+{
+    while (true)
+    {
+#ifdef Q_OS_WIN
+        SOCKET s = ::accept((SOCKET)listenSocket, nullptr, nullptr);
+        return s == INVALID_SOCKET ? kInvalidSocket : (qintptr)s;
+#elif defined(Q_OS_LINUX)
+        int s = accept4((int)listenSocket, nullptr, nullptr, SOCK_CLOEXEC);
+#else
+        int s = ::accept((int)listenSocket, nullptr, nullptr);
+        if (s >= 0)
+        {
+            fcntl(s, F_SETFD, FD_CLOEXEC);
+        }
+#endif
+#ifndef Q_OS_WIN
+        if (s < 0 && (errno == EINTR || errno == ECONNABORTED))
+        {
+            continue;
+        }
+        return s < 0 ? kInvalidSocket : s;
+#endif
+    }
+}
+
+void ProxyWorkerPool::closeSocket(qintptr socket)
+{
+    if (socket == kInvalidSocket)
+    {
+        return;
+    }
+#ifdef Q_OS_WIN
+    closesocket((SOCKET)socket);
+#else
+    ::close((int)socket);
+#endif
+}
+
+qint64 ProxyWorkerPool::currentThreadCpuTimeUs()
+{
+#ifdef Q_OS_WIN
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (!GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime))
+    {
+        return 0;
+    }
+    ULARGE_INTEGER kernel, user;
+    kernel.LowPart = kernelTime.dwLowDateTime;
+    kernel.HighPart = kernelTime.dwHighDateTime;
+    user.LowPart = userTime.dwLowDateTime;
+    user.HighPart = userTime.dwHighDateTime;
+    // in 100 ns units
+    return (kernel.QuadPart + user.QuadPart) / 10;
+#else
+    timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+    {
+        return 0;
+    }
+    return qint64(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+#include <functional>
+#include <memory>
+#include "socketutils/socketwriteall.h"
+
+class QSocketNotifier;
+
+// The event loop threads of the connections of a proxy server.
+// The connections are accepted on the workers: on Linux every worker has its own SO_REUSEPORT listener and the kernel
+// spreads the connections between them; elsewhere one listener on the thread of the pool passes them to the least loaded
+// worker. The load of a worker is the CPU time of its thread, the load of a connection the bytes per second it writes;
+// every kRebalanceIntervalMs a connection of the busiest worker is moved to the idlest one if the CPU usage differs by
+// more than kImbalanceThreshold. The connections relayed by SocketRelay are not moved and do not count in the load
+// of their worker, their data is moved on the relay thread.
+class ProxyWorkerPool : public QObject
+{
+    Q_OBJECT
+public:
+    struct Connection
+    {
+        QObject *object;    // has the start() and forceClose() slots
+        std::shared_ptr<SocketBufferAccounting> accounting;
+    };
+    // creates the connection of an accepted socket, called on the thread of the worker
+    typedef std::function<Connection(qintptr socketDescriptor)> ConnectionFactory;
+
+    static constexpr int kRebalanceIntervalMs = 1000;
+    static constexpr int kCpuSampleIntervalMs = 250;
+    // the difference of the CPU usage of two workers, in cores
+    static constexpr double kImbalanceThreshold = 0.2;
+
+    explicit ProxyWorkerPool(QObject *parent, int workersCount, ConnectionFactory factory);
+    ~ProxyWorkerPool();
+
+    // listens on all the IPv4 addresses
+    bool listen(quint16 port);
+    void close();
+    bool isListening() const;
+    quint16 port() const;
+
+    // must be called when the connection has finished, before it is deleted
+    void removeConnection(QObject *connection);
+    void closeAllConnections();
+    void stop();
+
+    int connectionsCount() const;
+    qint64 bufferedBytes() const;
+    // including the finished connections
+    qint64 peakConnectionBufferedBytes() const;
+
+    static int defaultWorkersCount();
+
+private slots:
+    void onRebalanceTimer();
+
+private:
+    struct Worker
+    {
+        QThread *thread;
+        QObject *context;               // lives in the thread
+        qintptr listenSocket;
+        QSocketNotifier *notifier;      // accessed on the thread only
+        int connectionsCount;
+        qint64 cpuTimeUs;
+        qint64 sampleTimeUs;
+        qint64 lastCpuTimeUs;
+        qint64 lastSampleTimeUs;
+        double cpuUsage;
+        double bytesPerSec;
+    };
+
+    struct ConnectionInfo
+    {
+        Worker *worker;
+        std::shared_ptr<SocketBufferAccounting> accounting;
+        qint64 lastWrittenBytes;
+        double bytesPerSec;
+    };
+
+    ConnectionFactory factory_;
+    QVector<Worker *> workers_;
+    QHash<QObject *, ConnectionInfo> connections_;
+    // guards the workers and the connections, they are updated from the threads of the workers
+    mutable QMutex mutex_;
+
+    qintptr listenSocket_;
+    QSocketNotifier *notifier_;
+    quint16 port_;
+    bool isListening_;
+    bool isStopped_;
+
+    QTimer rebalanceTimer_;
+    QElapsedTimer clock_;
+    qint64 lastRebalanceUs_;
+    qint64 peakConnectionBufferedBytes_;
+
+    void acceptConnections(Worker *worker, qintptr listenSocket);
+    void startConnection(Worker *worker, qintptr socketDescriptor);
+    Worker *leastLoadedWorker() const;
+    void moveConnection(QObject *connection, ConnectionInfo &info, Worker *to);
+
+    static qintptr openListenSocket(quint16 port, bool isReusePort, quint16 &boundPort);
+    static qintptr acceptSocket(qintptr listenSocket);
+    static void closeSocket(qintptr socket);
+    static qint64 currentThreadCpuTimeUs();
+};
@@ -0,0 +1,35 @@
+#include "relayhandover.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include "socketrelay.h"
+
+quint64 handOverToSocketRelay(QTcpSocket *socket1, QTcpSocket *socket2, std::shared_ptr<SocketBufferAccounting> accounting,
+                              std::function<void()> onFinished)
+{
+    if (!SocketRelay::instance().isAvailable()) {
+        return 0;
+    }
+
+    int fd1 = fcntl(socket1->socketDescriptor(), F_DUPFD_CLOEXEC, 0);
+    if (fd1 < 0) {
+        return 0;
+    }
+    int fd2 = fcntl(socket2->socketDescriptor(), F_DUPFD_CLOEXEC, 0);
+    if (fd2 < 0) {
+        close(fd1);
+        return 0;
+    }
+
+    // abort() below must not be seen as a disconnect by the owner
+    socket1->disconnect();
+    socket2->disconnect();
+
+    const QByteArray pendingTo2 = socket1->readAll();
+    const QByteArray pendingTo1 = socket2->readAll();
+    // only the descriptors owned by Qt are closed, the connections stay open on the duplicates
+    socket1->abort();
+    socket2->abort();
+
+    return SocketRelay::instance().add(fd1, fd2, pendingTo1.toStdString(), pendingTo2.toStdString(), accounting, onFinished);
+}
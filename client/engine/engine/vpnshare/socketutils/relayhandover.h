@@ -0,0 +1,13 @@
+#pragma once
+
+#include <QTcpSocket>
+#include <functional>
+#include <memory>
+#include "socketwriteall.h"
+
+// Moves a connected pair of sockets to SocketRelay once the proxy handshake is done; the QTcpSocket objects are
+// left unconnected and the data they have already read is relayed first.
+// The caller must make sure that nothing is left to write on both sockets. Returns the relay session id, or 0 if
+// the relay is not available and the sockets are untouched. The relayed data is reported to accounting. Linux only.
+quint64 handOverToSocketRelay(QTcpSocket *socket1, QTcpSocket *socket2, std::shared_ptr<SocketBufferAccounting> accounting,
+                              std::function<void()> onFinished);
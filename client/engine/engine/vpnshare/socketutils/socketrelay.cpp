@@ -0,0 +1,386 @@
+#include "socketrelay.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "socketwriteall.h"
+
+SocketRelay::SocketRelay() : isStopping_(false), lastId_(0)
+{
+    epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (epollFd_ < 0 || wakeFd_ < 0) {
+        return;
+    }
+    epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = nullptr;
+    epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeFd_, &ev);
+
+    thread_ = std::thread(&SocketRelay::run, this);
+}
+
+SocketRelay::~SocketRelay()
+{
+    if (thread_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            isStopping_ = true;
+        }
+        uint64_t value = 1;
+        (void)write(wakeFd_, &value, sizeof(value));
+        thread_.join();
+    }
+
+    while (!sessions_.empty()) {
+        finish(sessions_.begin()->second.get(), false);
+    }
+    finished_.clear();
+    for (const auto &pipe : freePipes_) {
+        close(pipe.first);
+        close(pipe.second);
+    }
+    if (wakeFd_ >= 0) {
+        close(wakeFd_);
+    }
+    if (epollFd_ >= 0) {
+        close(epollFd_);
+    }
+}
+
+uint64_t SocketRelay::add(int fd1, int fd2, const std::string &initialTo1, const std::string &initialTo2,
+                          std::shared_ptr<SocketBufferAccounting> accounting, std::function<void()> onFinished)
+{
+    if (!thread_.joinable()) {
+        return 0;
+    }
+
+    std::unique_ptr<Session> session(new Session);
+    session->fds[0] = fd1;
+    session->fds[1] = fd2;
+    for (int i = 0; i < 2; ++i) {
+        fcntl(session->fds[i], F_SETFL, fcntl(session->fds[i], F_GETFL) | O_NONBLOCK);
+        Direction &dir = session->dirs[i];
+        dir.from = session->fds[i];
+        dir.to = session->fds[1 - i];
+        const std::string &initial = i == 0 ? initialTo2 : initialTo1;
+        dir.buffer.assign(initial.begin(), initial.end());
+        dir.bufferEnd = dir.buffer.size();
+        dir.accounting = accounting;
+        account(dir, dir.bufferEnd, dir.bufferEnd);
+        session->refs[i] = { session.get(), i };
+    }
+    session->onFinished = onFinished;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    session->id = ++lastId_;
+    const uint64_t id = session->id;
+    activeIds_.insert(id);
+    added_.push_back(std::move(session));
+    uint64_t value = 1;
+    (void)write(wakeFd_, &value, sizeof(value));
+    return id;
+}
+
+void SocketRelay::remove(uint64_t id)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (activeIds_.erase(id)) {
+        removed_.push_back(id);
+        uint64_t value = 1;
+        (void)write(wakeFd_, &value, sizeof(value));
+    }
+}
+
+void SocketRelay::run()
+{
+    // a splice() to a socket closed by the peer may raise SIGPIPE, it's handled as an error instead
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &set, nullptr);
+
+    epoll_event events[64];
+    while (true) {
+        int count = epoll_wait(epollFd_, events, 64, -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            if (events[i].data.ptr == nullptr) {
+                uint64_t value;
+                while (read(wakeFd_, &value, sizeof(value)) > 0) {
+                }
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (isStopping_) {
+                        return;
+                    }
+                }
+                handleCommands();
+                continue;
+            }
+
+            FdRef *ref = static_cast<FdRef *>(events[i].data.ptr);
+            Session *session = ref->session;
+            if (session->isFinished) {
+                continue;
+            }
+            if ((events[i].events & EPOLLERR) || !transfer(session->dirs[0]) || !transfer(session->dirs[1]) ||
+                (session->dirs[0].isDone && session->dirs[1].isDone)) {
+                finish(session, true);
+            } else {
+                updateEvents(session);
+            }
+        }
+        finished_.clear();
+    }
+}
+
+void SocketRelay::handleCommands()
+{
+    std::vector<std::unique_ptr<Session>> added;
+    std::vector<uint64_t> removed;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        added.swap(added_);
+        removed.swap(removed_);
+    }
+
+    for (auto &session : added) {
+        start(std::move(session));
+    }
+    for (uint64_t id : removed) {
+        auto it = sessions_.find(id);
+        if (it != sessions_.end()) {
+            finish(it->second.get(), false);
+        }
+    }
+}
+
+void SocketRelay::start(std::unique_ptr<Session> session)
+{
+    Session *s = session.get();
+    sessions_[s->id] = std::move(session);
+
+    for (int i = 0; i < 2; ++i) {
+        Direction &dir = s->dirs[i];
+        if (!takePipe(dir.pipe)) {
+            dir.buffer.resize(std::max(dir.buffer.size(), kBufferSize));
+        }
+    }
+
+    if (!transfer(s->dirs[0]) || !transfer(s->dirs[1]) || (s->dirs[0].isDone && s->dirs[1].isDone)) {
+        finish(s, true);
+    } else {
+        updateEvents(s);
+    }
+}
+
+bool SocketRelay::transfer(Direction &dir)
+{
+    dir.isWaitingRead = false;
+    dir.isWaitingWrite = false;
+
+    for (int i = 0; i < kMaxTransfersPerWakeup && !dir.isDone; ++i) {
+        if (dir.bufferStart < dir.bufferEnd) {
+            ssize_t written = send(dir.to, dir.buffer.data() + dir.bufferStart, dir.bufferEnd - dir.bufferStart, MSG_NOSIGNAL);
+            if (written < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    dir.isWaitingWrite = true;
+                    return true;
+                }
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            dir.bufferStart += written;
+            account(dir, -written, 0);
+            if (dir.bufferStart == dir.bufferEnd) {
+                dir.bufferStart = dir.bufferEnd = 0;
+                // the initial data is not kept if the direction has a pipe
+                if (dir.pipe[0] >= 0) {
+                    std::vector<char>().swap(dir.buffer);
+                }
+            }
+            continue;
+        }
+
+        if (dir.inPipe > 0) {
+            ssize_t moved = splice(dir.pipe[0], nullptr, dir.to, nullptr, dir.inPipe, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (moved < 0) {
+                if (errno == EAGAIN) {
+                    dir.isWaitingWrite = true;
+                    return true;
+                }
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            dir.inPipe -= moved;
+            account(dir, -moved, 0);
+            continue;
+        }
+
+        if (dir.isEof) {
+            shutdown(dir.to, SHUT_WR);
+            dir.isDone = true;
+            return true;
+        }
+
+        ssize_t received;
+        if (dir.pipe[0] >= 0) {
+            received = splice(dir.from, nullptr, dir.pipe[1], nullptr, kBufferSize, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (received < 0 && errno == EINVAL) {
+                // splice() is not supported for this socket
+                releasePipe(dir);
+                dir.buffer.resize(kBufferSize);
+                continue;
+            }
+            if (received > 0) {
+                dir.inPipe = received;
+                account(dir, received, received);
+            }
+        } else {
+            received = recv(dir.from, dir.buffer.data(), dir.buffer.size(), 0);
+            if (received > 0) {
+                dir.bufferEnd = received;
+                account(dir, received, received);
+            }
+        }
+        if (received < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                dir.isWaitingRead = true;
+                return true;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if (received == 0) {
+            dir.isEof = true;
+        }
+    }
+
+    // the limit is reached, continue on the next wakeup
+    if (!dir.isDone && !dir.isWaitingRead && !dir.isWaitingWrite) {
+        if (dir.inPipe > 0 || dir.bufferStart < dir.bufferEnd) {
+            dir.isWaitingWrite = true;
+        } else {
+            dir.isWaitingRead = true;
+        }
+    }
+    return true;
+}
+
+void SocketRelay::updateEvents(Session *session)
+{
+    for (int i = 0; i < 2; ++i) {
+        // fds[i] is read by dirs[i] and written by the other direction
+        const bool isNeeded = !session->dirs[i].isEof || !session->dirs[1 - i].isDone;
+        if (!isNeeded) {
+            if (session->isRegistered[i]) {
+                epoll_ctl(epollFd_, EPOLL_CTL_DEL, session->fds[i], nullptr);
+                session->isRegistered[i] = false;
+            }
+            continue;
+        }
+
+        const uint32_t events = (session->dirs[i].isWaitingRead ? EPOLLIN : 0) | (session->dirs[1 - i].isWaitingWrite ? EPOLLOUT : 0);
+        if (session->isRegistered[i] && events == session->events[i]) {
+            continue;
+        }
+        epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = events;
+        ev.data.ptr = &session->refs[i];
+        epoll_ctl(epollFd_, session->isRegistered[i] ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, session->fds[i], &ev);
+        session->isRegistered[i] = true;
+        session->events[i] = events;
+    }
+}
+
+void SocketRelay::finish(Session *session, bool isCallback)
+{
+    if (session->isFinished) {
+        return;
+    }
+    session->isFinished = true;
+
+    for (int i = 0; i < 2; ++i) {
+        if (session->isRegistered[i]) {
+            epoll_ctl(epollFd_, EPOLL_CTL_DEL, session->fds[i], nullptr);
+        }
+        close(session->fds[i]);
+        releasePipe(session->dirs[i]);
+        // the data left is dropped with the sockets
+        account(session->dirs[i], -session->dirs[i].pendingBytes, 0);
+    }
+
+    if (isCallback) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (activeIds_.erase(session->id) && session->onFinished) {
+            session->onFinished();
+        }
+    }
+
+    auto it = sessions_.find(session->id);
+    if (it != sessions_.end()) {
+        finished_.push_back(std::move(it->second));
+        sessions_.erase(it);
+    }
+}
+
+bool SocketRelay::takePipe(int pipe[2])
+{
+    if (!freePipes_.empty()) {
+        pipe[0] = freePipes_.back().first;
+        pipe[1] = freePipes_.back().second;
+        freePipes_.pop_back();
+        return true;
+    }
+    return pipe2(pipe, O_CLOEXEC | O_NONBLOCK) == 0;
+}
+
+void SocketRelay::account(Direction &dir, int64_t pendingDelta, int64_t relayedBytes)
+{
+    if (pendingDelta == 0 && relayedBytes == 0) {
+        return;
+    }
+    dir.pendingBytes += pendingDelta;
+    SocketWriteAll::total().add(pendingDelta);
+    if (dir.accounting) {
+        dir.accounting->add(pendingDelta);
+        dir.accounting->writtenBytes += relayedBytes;
+    }
+}
+
+void SocketRelay::releasePipe(Direction &dir)
+{
+    if (dir.pipe[0] < 0) {
+        return;
+    }
+    // a pipe with data left can't be reused
+    if (dir.inPipe == 0 && freePipes_.size() < kMaxFreePipes) {
+        freePipes_.emplace_back(dir.pipe[0], dir.pipe[1]);
+    } else {
+        close(dir.pipe[0]);
+        close(dir.pipe[1]);
+    }
+    dir.pipe[0] = dir.pipe[1] = -1;
+    dir.inPipe = 0;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct SocketBufferAccounting;
+
+// Relays the data between pairs of connected TCP sockets on its own epoll thread, once the proxy handshake is done.
+// The data is moved with splice() through a pipe per direction, so it is not copied to user space;
+// if a pipe can't be created, the direction uses a fixed buffer. Linux only.
+// The data read and not yet written is accounted as the pending bytes of SocketWriteAll are.
+class SocketRelay
+{
+public:
+    static SocketRelay &instance()
+    {
+        static SocketRelay i;
+        return i;
+    }
+
+    bool isAvailable() const { return thread_.joinable(); }
+
+    // Takes the ownership of the descriptors, the initial data is sent before the relayed data.
+    // The relayed and pending bytes are reported to the accounting of the connection (may be null) and to SocketWriteAll::total().
+    // onFinished is called on the relay thread once both directions are closed, or on an error.
+    // Returns the session id, or 0 if the relay thread is not running.
+    uint64_t add(int fd1, int fd2, const std::string &initialTo1, const std::string &initialTo2,
+                 std::shared_ptr<SocketBufferAccounting> accounting, std::function<void()> onFinished);
+    // Closes the session. onFinished is not called after remove() returns.
+    void remove(uint64_t id);
+
+private:
+    static constexpr size_t kBufferSize = 64 * 1024;
+    static constexpr size_t kMaxFreePipes = 64;
+    // the transfers per direction and wakeup, so a fast session does not delay the others
+    static constexpr int kMaxTransfersPerWakeup = 16;
+
+    struct Direction
+    {
+        int from = -1;
+        int to = -1;
+        int pipe[2] = { -1, -1 };
+        size_t inPipe = 0;
+        // the initial data, and the relayed data if there is no pipe
+        std::vector<char> buffer;
+        size_t bufferStart = 0;
+        size_t bufferEnd = 0;
+        bool isWaitingRead = false;
+        bool isWaitingWrite = false;
+        bool isEof = false;
+        bool isDone = false;
+        // read and not yet written, in the pipe or the buffer
+        int64_t pendingBytes = 0;
+        std::shared_ptr<SocketBufferAccounting> accounting;
+    };
+
+    struct Session;
+    struct FdRef
+    {
+        Session *session;
+        int index;
+    };
+
+    struct Session
+    {
+        uint64_t id;
+        int fds[2];
+        Direction dirs[2];      // dirs[i] reads from fds[i]
+        FdRef refs[2];
+        uint32_t events[2] = { 0, 0 };
+        bool isRegistered[2] = { false, false };
+        bool isFinished = false;
+        std::function<void()> onFinished;
+    };
+
+    int epollFd_;
+    int wakeFd_;
+    std::thread thread_;
+
+    std::mutex mutex_;
+    bool isStopping_;
+    uint64_t lastId_;
+    std::vector<std::unique_ptr<Session>> added_;
+    std::vector<uint64_t> removed_;
+    std::set<uint64_t> activeIds_;
+
+    // owned by the relay thread
+    std::map<uint64_t, std::unique_ptr<Session>> sessions_;
+    // deleted after the events which may refer to them are handled
+    std::vector<std::unique_ptr<Session>> finished_;
+    std::vector<std::pair<int, int>> freePipes_;
+
+    SocketRelay();
+    ~SocketRelay();
+
+    void run();
+    void handleCommands();
+    void start(std::unique_ptr<Session> session);
+    // returns false on an error
+    bool transfer(Direction &dir);
+    void updateEvents(Session *session);
+    void finish(Session *session, bool isCallback);
+    bool takePipe(int pipe[2]);
+    void releasePipe(Direction &dir);
+    static void account(Direction &dir, int64_t pendingDelta, int64_t relayedBytes);
+};
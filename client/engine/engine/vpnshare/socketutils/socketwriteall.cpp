@@ -1,45 +1,100 @@
 #include "socketwriteall.h"
 
-SocketWriteAll::SocketWriteAll(QObject *parent, QTcpSocket *socket) : QObject(parent),
-    socket_(socket), bEmitAllDataWritten_(false)
+void SocketBufferAccounting::add(qint64 delta)
+{
+    qint64 current = bytes.fetch_add(delta) + delta;
+    qint64 peak = peakBytes.load();
+    while (current > peak && !peakBytes.compare_exchange_weak(peak, current))
+    {
+    }
+}
+
+SocketWriteAll::SocketWriteAll(QObject *parent, QTcpSocket *socket, std::shared_ptr<SocketBufferAccounting> accounting) : QObject(parent),
+    socket_(socket), accounting_(accounting), pendingBytes_(0), bFull_(false), bEmitAllDataWritten_(false)
 {
     connect(socket_, &QTcpSocket::bytesWritten, this, &SocketWriteAll::onBytesWritten);
 }
 
-void SocketWriteAll::write(const QByteArray &arr)
+SocketWriteAll::~SocketWriteAll()
 {
-    if (arr_.isEmpty())
+    // the socket may be already deleted, the data is gone with it
+    total().add(-pendingBytes_);
+    if (accounting_)
     {
-        arr_ = arr;
-        socket_->write(arr_);
+        accounting_->add(-pendingBytes_);
     }
-    else
+}
+
+void SocketWriteAll::write(const QByteArray &arr)
+{
+    // the data is kept in the write buffer of the socket until it is sent
+    socket_->write(arr);
+    if (accounting_)
     {
-        arr_.append(arr);
+        accounting_->writtenBytes += arr.size();
     }
+    updatePendingBytes();
 }
 
 void SocketWriteAll::setEmitAllDataWritten()
 {
-    if (arr_.isEmpty())
+    if (isEmpty())
     {
         emit allDataWriteFinished();
     }
     bEmitAllDataWritten_ = true;
 }
 
-void SocketWriteAll::onBytesWritten(qint64 bytes)
+bool SocketWriteAll::isEmpty() const
+{
+    return socket_->bytesToWrite() == 0;
+}
+
+bool SocketWriteAll::isFull() const
+{
+    return bFull_;
+}
+
+qint64 SocketWriteAll::pendingBytes() const
+{
+    return pendingBytes_;
+}
+
+SocketBufferAccounting &SocketWriteAll::total()
 {
-    arr_.remove(0, bytes);
-    if (!arr_.isEmpty())
+    static SocketBufferAccounting accounting;
+    return accounting;
+}
+
+void SocketWriteAll::onBytesWritten(qint64 /*bytes*/)
+{
+    updatePendingBytes();
+    if (bFull_ && pendingBytes_ < kLowWatermark)
     {
-        socket_->write(arr_);
+        bFull_ = false;
+        emit drained();
     }
-    else
+    if (isEmpty() && bEmitAllDataWritten_)
     {
-        if (bEmitAllDataWritten_)
+        emit allDataWriteFinished();
+    }
+}
+
+void SocketWriteAll::updatePendingBytes()
+{
+    const qint64 pending = socket_->bytesToWrite();
+    const qint64 delta = pending - pendingBytes_;
+    pendingBytes_ = pending;
+    if (delta != 0)
+    {
+        total().add(delta);
+        if (accounting_)
         {
-            emit allDataWriteFinished();
+            accounting_->add(delta);
         }
     }
+    if (pendingBytes_ > kHighWatermark)
+    {
+        bFull_ = true;
+    }
 }
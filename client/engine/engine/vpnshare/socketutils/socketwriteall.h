@@ -2,24 +2,59 @@
 
 #include <QObject>
 #include <QTcpSocket>
+#include <atomic>
+#include <memory>
 
+// The pending bytes of a group of writers (a connection, or all of them), can be read from any thread.
+struct SocketBufferAccounting
+{
+    std::atomic<qint64> bytes{0};
+    std::atomic<qint64> peakBytes{0};
+    // all the bytes given to the writers, the load of the connection for ProxyWorkerPool
+    std::atomic<qint64> writtenBytes{0};
+    // the data goes through SocketRelay, so it does not load the thread of the connection
+    std::atomic<bool> isRelayed{false};
+
+    void add(qint64 delta);
+};
+
+// Writes to the socket with flow control: the owner stops reading the source socket while isFull() and resumes on drained().
 class SocketWriteAll : public QObject
 {
     Q_OBJECT
 public:
-    explicit SocketWriteAll(QObject *parent, QTcpSocket *socket);
+    // isFull() is set above the high watermark and cleared below the low one
+    static constexpr qint64 kHighWatermark = 256 * 1024;
+    static constexpr qint64 kLowWatermark = 64 * 1024;
+    // for QTcpSocket::setReadBufferSize() of the source sockets, so the paused data stays in the kernel
+    static constexpr qint64 kReadBufferSize = 64 * 1024;
+
+    explicit SocketWriteAll(QObject *parent, QTcpSocket *socket, std::shared_ptr<SocketBufferAccounting> accounting = nullptr);
+    ~SocketWriteAll();
+
     void write(const QByteArray &arr);
 
     void setEmitAllDataWritten();
+    bool isEmpty() const;
+    bool isFull() const;
+    qint64 pendingBytes() const;
+
+    // all the writers
+    static SocketBufferAccounting &total();
 
 signals:
     void allDataWriteFinished();
+    void drained();
 
 private slots:
     void onBytesWritten(qint64 bytes);
 
 private:
     QTcpSocket *socket_;
-    QByteArray arr_;
+    std::shared_ptr<SocketBufferAccounting> accounting_;
+    qint64 pendingBytes_;
+    bool bFull_;
     bool bEmitAllDataWritten_;
+
+    void updatePendingBytes();
 };
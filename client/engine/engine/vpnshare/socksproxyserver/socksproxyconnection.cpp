@@ -1,18 +1,58 @@
 #include "socksproxyconnection.h"
 #include <QHostAddress>
+#include <QHostInfo>
+#include <QSocketNotifier>
 #include <QThread>
+#include <QTimer>
 #include "utils/ws_assert.h"
 #include "utils/log/categories.h"
 
+#ifdef Q_OS_LINUX
+    #include "../socketutils/relayhandover.h"
+    #include "../socketutils/socketrelay.h"
+#endif
+
 namespace SocksProxyServer {
 
+namespace {
+
+bool toSockaddr(const QHostAddress &address, sockaddr_storage &addr)
+{
+    memset(&addr, 0, sizeof(addr));
+    if (address.protocol() == QAbstractSocket::IPv4Protocol)
+    {
+        sockaddr_in *addr4 = (sockaddr_in *)&addr;
+        addr4->sin_family = AF_INET;
+        addr4->sin_addr.s_addr = htonl(address.toIPv4Address());
+        return true;
+    }
+    else if (address.protocol() == QAbstractSocket::IPv6Protocol)
+    {
+        sockaddr_in6 *addr6 = (sockaddr_in6 *)&addr;
+        addr6->sin6_family = AF_INET6;
+        Q_IPV6ADDR ip6 = address.toIPv6Address();
+        memcpy(&addr6->sin6_addr, &ip6, sizeof(addr6->sin6_addr));
+        return true;
+    }
+    return false;
+}
+
+const int kUdpIdleCheckIntervalMs = 5000;
+
+} // namespace
 
 SocksProxyConnection::SocksProxyConnection(qintptr socketDescriptor, const QString &hostname,
                                            QObject *parent)
     : QObject(parent), socket_(nullptr), socketExternal_(nullptr),
     socketDescriptor_(socketDescriptor), hostname_(hostname), state_(READ_IDENT_REQ),
-    writeAllSocket_(0), writeAllSocketExternal_(0), bAlreadyClosedAndEmitFinished_(false)
+    writeAllSocket_(0), writeAllSocketExternal_(0), bufferAccounting_(std::make_shared<SocketBufferAccounting>()),
+    udpIdleTimer_(nullptr), bAlreadyClosedAndEmitFinished_(false), relayId_(0)
+{
+}
+
+std::shared_ptr<SocketBufferAccounting> SocksProxyConnection::bufferAccounting() const
 {
+    return bufferAccounting_;
 }
 
 void SocksProxyConnection::start()
@@ -25,9 +65,12 @@ void SocksProxyConnection::start()
     }
     state_ = READ_IDENT_REQ;
     readExactly_.reset(new SocksProxyReadExactly(sizeof(socks5_ident_req)));
+    socket_->setReadBufferSize(SocketWriteAll::kReadBufferSize);
     connect(socket_, &QTcpSocket::disconnected, this, &SocksProxyConnection::onSocketDisconnected);
     connect(socket_, &QTcpSocket::readyRead, this, &SocksProxyConnection::onSocketReadyRead);
-    writeAllSocket_ = new SocketWriteAll(this, socket_);
+    writeAllSocket_ = new SocketWriteAll(this, socket_, bufferAccounting_);
+    // the reading from the external host is resumed when the client takes the pending data
+    connect(writeAllSocket_, &SocketWriteAll::drained, this, &SocksProxyConnection::onExternalSocketReadyRead);
 }
 
 void SocksProxyConnection::forceClose()
@@ -43,6 +86,11 @@ void SocksProxyConnection::onSocketDisconnected()
 
 void SocksProxyConnection::onSocketReadyRead()
 {
+    if (state_ == RELAY_BETWEEN_CLIENT_SERVER && writeAllSocketExternal_->isFull())
+    {
+        // the data is left in the socket until the external host takes the pending data
+        return;
+    }
     socketReadArr_.append(socket_->readAll());
 
     if (state_ == READ_IDENT_REQ)
@@ -104,13 +152,15 @@ void SocksProxyConnection::onSocketReadyRead()
             {
                 WS_ASSERT(socketExternal_ == NULL);
                 socketExternal_ = new QTcpSocket(this);
+                socketExternal_->setReadBufferSize(SocketWriteAll::kReadBufferSize);
 
                 connect(socketExternal_, &QTcpSocket::connected, this, &SocksProxyConnection::onExternalSocketConnected);
                 connect(socketExternal_, &QTcpSocket::disconnected, this, &SocksProxyConnection::onExternalSocketDisconnected);
                 connect(socketExternal_, &QTcpSocket::readyRead, this, &SocksProxyConnection::onExternalSocketReadyRead);
                 connect(socketExternal_, &QTcpSocket::errorOccurred, this, &SocksProxyConnection::onExternalSocketError);
 
-                writeAllSocketExternal_ = new SocketWriteAll(this, socketExternal_);
+                writeAllSocketExternal_ = new SocketWriteAll(this, socketExternal_, bufferAccounting_);
+                connect(writeAllSocketExternal_, &SocketWriteAll::drained, this, &SocksProxyConnection::onSocketReadyRead);
                 state_ = CONNECT_TO_HOST;
 
                 if (commandParser_.cmd().AddrType == 0x01)  // ip4
@@ -131,19 +181,15 @@ void SocksProxyConnection::onSocketReadyRead()
                     socketExternal_->connectToHost(QString::fromStdString(hostname), commandParser_.cmd().DestPort);
                 }
             }
-            else if (commandParser_.cmd().Cmd == 0x02)  // bind
-            {
-                WS_ASSERT(false);
-            }
             else if (commandParser_.cmd().Cmd == 0x03)  // udp associate
             {
-                WS_ASSERT(false);
+                startUdpAssociate();
             }
             else
             {
-                qCDebug(LOG_SOCKS_SERVER) << "SocksProxyConnection::onSocketReadyRead() unknown command:" << commandParser_.cmd().Cmd;
-                closeSocketsAndEmitFinished();
-                WS_ASSERT(false);
+                // bind is not supported
+                qCDebug(LOG_SOCKS_SERVER) << "SocksProxyConnection::onSocketReadyRead() unsupported command:" << commandParser_.cmd().Cmd;
+                writeReplyAndClose(0x07);
             }
         }
         else if (res == TRI_INDETERMINATE)
@@ -162,6 +208,11 @@ void SocksProxyConnection::onSocketReadyRead()
         writeAllSocketExternal_->write(socketReadArr_);
         socketReadArr_.clear();
     }
+    else if (state_ == UDP_ASSOCIATE)
+    {
+        // the control connection only keeps the association alive
+        socketReadArr_.clear();
+    }
     else
     {
         qCDebug(LOG_SOCKS_SERVER) << "SocksProxyConnection::onSocketReadyRead() unknown state:" << state_;
@@ -186,7 +237,7 @@ void SocksProxyConnection::onExternalSocketConnected()
         //resp.BindPort = 0x00;
         //memset(&resp.BindAddr.IPv4, 0, sizeof(resp.BindAddr.IPv4));
         writeAllSocket_->write(getByteArrayFromSocks5Resp(resp));
-        state_ = RELAY_BETWEEN_CLIENT_SERVER;
+        startRelay();
     }
     else
     {
@@ -210,6 +261,10 @@ void SocksProxyConnection::onExternalSocketDisconnected()
 
 void SocksProxyConnection::onExternalSocketReadyRead()
 {
+    if (writeAllSocket_->isFull())
+    {
+        return;
+    }
     QByteArray arr = socketExternal_->readAll();
     if (state_ == RELAY_BETWEEN_CLIENT_SERVER)
     {
@@ -263,11 +318,170 @@ void SocksProxyConnection::onExternalSocketError(QAbstractSocket::SocketError so
     }*/
 }
 
+void SocksProxyConnection::startRelay()
+{
+    state_ = RELAY_BETWEEN_CLIENT_SERVER;
+    // the data sent by the client right after the command
+    if (!socketReadArr_.isEmpty())
+    {
+        writeAllSocketExternal_->write(socketReadArr_);
+        socketReadArr_.clear();
+    }
+#ifdef Q_OS_LINUX
+    // the handshake data is written by Qt, then the sockets are moved to the splice() relay
+    connect(socket_, &QTcpSocket::bytesWritten, this, &SocksProxyConnection::tryHandOverToRelay);
+    connect(socketExternal_, &QTcpSocket::bytesWritten, this, &SocksProxyConnection::tryHandOverToRelay);
+    tryHandOverToRelay();
+#endif
+}
+
+#ifdef Q_OS_LINUX
+void SocksProxyConnection::tryHandOverToRelay()
+{
+    if (state_ != RELAY_BETWEEN_CLIENT_SERVER || relayId_ != 0 || bAlreadyClosedAndEmitFinished_)
+    {
+        return;
+    }
+    // the data already queued in Qt must be sent first to keep the order
+    if (!writeAllSocket_->isEmpty() || !writeAllSocketExternal_->isEmpty() ||
+        socket_->bytesToWrite() > 0 || socketExternal_->bytesToWrite() > 0 ||
+        socket_->state() != QAbstractSocket::ConnectedState || socketExternal_->state() != QAbstractSocket::ConnectedState)
+    {
+        return;
+    }
+
+    relayId_ = handOverToSocketRelay(socket_, socketExternal_, bufferAccounting_, [this]() {
+        QMetaObject::invokeMethod(this, [this] { closeSocketsAndEmitFinished(); }, Qt::QueuedConnection);
+    });
+    bufferAccounting_->isRelayed = relayId_ != 0;
+}
+#endif
+
+void SocksProxyConnection::writeReplyAndClose(unsigned char reply)
+{
+    socks5_resp resp;
+    memcpy(&resp, &commandParser_.cmd(), sizeof(resp));
+    resp.Reply = reply;
+    writeAllSocket_->write(getByteArrayFromSocks5Resp(resp));
+    connect(writeAllSocket_, &SocketWriteAll::allDataWriteFinished, this, &SocksProxyConnection::closeSocketsAndEmitFinished);
+    writeAllSocket_->setEmitAllDataWritten();
+}
+
+void SocksProxyConnection::startUdpAssociate()
+{
+    // the relay is bound to the address the client has connected to, so it is reachable from the client
+    sockaddr_storage bindAddr;
+    sockaddr_storage clientHost;
+    if (!toSockaddr(socket_->localAddress(), bindAddr) || !toSockaddr(socket_->peerAddress(), clientHost))
+    {
+        writeReplyAndClose(0x01);
+        return;
+    }
+
+    // DST.ADDR is ignored, only the client host may use the association; DST.PORT is its source port if not 0
+    udpRelay_.reset(new SocksUdpRelay([this](const std::string &domain) { resolveUdpDomain(domain); }));
+    if (!udpRelay_->start((const sockaddr *)&bindAddr, (const sockaddr *)&clientHost, commandParser_.cmd().DestPort))
+    {
+        qCDebug(LOG_SOCKS_SERVER) << "SocksProxyConnection::startUdpAssociate() can't create the UDP relay";
+        udpRelay_.reset();
+        writeReplyAndClose(0x01);
+        return;
+    }
+
+    for (udp_socket_t s : udpRelay_->sockets())
+    {
+        QSocketNotifier *notifier = new QSocketNotifier(s, QSocketNotifier::Read, this);
+        connect(notifier, &QSocketNotifier::activated, this, [this, s]() { udpRelay_->onReadable(s); });
+        udpNotifiers_ << notifier;
+    }
+
+    udpIdleTimer_ = new QTimer(this);
+    connect(udpIdleTimer_, &QTimer::timeout, this, [this]() {
+        if (udpRelay_->idleMs() > SocksUdpRelay::kIdleTimeoutMs)
+        {
+            qCDebug(LOG_SOCKS_SERVER) << "UDP association idle, closed";
+            closeSocketsAndEmitFinished();
+        }
+    });
+    udpIdleTimer_->start(kUdpIdleCheckIntervalMs);
+
+    sockaddr_storage bound;
+    udpRelay_->getBoundAddress(bound);
+    socks5_resp resp;
+    memset(&resp, 0, sizeof(resp));
+    resp.Version = 0x05;
+    resp.Reply = 0x00;
+    // getByteArrayFromSocks5Resp() copies the fields as they are, so they are in network order here
+    if (bound.ss_family == AF_INET)
+    {
+        resp.AddrType = 0x01;
+        memcpy(&resp.BindAddr.IPv4, &((sockaddr_in *)&bound)->sin_addr, sizeof(resp.BindAddr.IPv4));
+        resp.BindPort = ((sockaddr_in *)&bound)->sin_port;
+    }
+    else
+    {
+        resp.AddrType = 0x04;
+        memcpy(&resp.BindAddr.IPv6, &((sockaddr_in6 *)&bound)->sin6_addr, sizeof(resp.BindAddr.IPv6));
+        resp.BindPort = ((sockaddr_in6 *)&bound)->sin6_port;
+    }
+    writeAllSocket_->write(getByteArrayFromSocks5Resp(resp));
+    state_ = UDP_ASSOCIATE;
+}
+
+void SocksProxyConnection::stopUdpAssociate()
+{
+    // the notifiers go before their sockets
+    qDeleteAll(udpNotifiers_);
+    udpNotifiers_.clear();
+    if (udpIdleTimer_)
+    {
+        udpIdleTimer_->stop();
+    }
+    if (udpRelay_)
+    {
+        const SocksUdpRelay::Stats &stats = udpRelay_->stats();
+        qCDebug(LOG_SOCKS_SERVER) << "UDP association closed, datagrams to external:" << stats.toExternal
+                                  << "to client:" << stats.toClient << "dropped:" << stats.dropped;
+        udpRelay_.reset();
+    }
+}
+
+void SocksProxyConnection::resolveUdpDomain(const std::string &domain)
+{
+    QHostInfo::lookupHost(QString::fromStdString(domain), this, [this, domain](const QHostInfo &info) {
+        if (!udpRelay_)
+        {
+            return;
+        }
+        // IPv4 first, IPv6 may be not routed through the tunnel
+        for (auto protocol : { QAbstractSocket::IPv4Protocol, QAbstractSocket::IPv6Protocol })
+        {
+            for (const QHostAddress &address : info.addresses())
+            {
+                sockaddr_storage addr;
+                if (address.protocol() == protocol && toSockaddr(address, addr))
+                {
+                    udpRelay_->setResolved(domain, (const sockaddr *)&addr);
+                    return;
+                }
+            }
+        }
+        udpRelay_->setResolved(domain, nullptr);
+    });
+}
+
 void SocksProxyConnection::closeSocketsAndEmitFinished()
 {
     if (!bAlreadyClosedAndEmitFinished_)
     {
         bAlreadyClosedAndEmitFinished_ = true;
+        stopUdpAssociate();
+#ifdef Q_OS_LINUX
+        if (relayId_ != 0)
+        {
+            SocketRelay::instance().remove(relayId_);
+        }
+#endif
         if (socket_)
         {
             socket_->close();
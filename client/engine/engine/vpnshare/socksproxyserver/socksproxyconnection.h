@@ -8,6 +8,10 @@
 #include "socksproxyidentreqparser.h"
 #include "../socketutils/socketwriteall.h"
 #include "socksproxycommandparser.h"
+#include "socksudprelay.h"
+
+class QSocketNotifier;
+class QTimer;
 
 namespace SocksProxyServer {
 
@@ -19,6 +23,9 @@ public:
 
     bool start(qintptr socketDescriptor);
 
+    // the data waiting to be written to both sockets and the written bytes, can be read from any thread
+    std::shared_ptr<SocketBufferAccounting> bufferAccounting() const;
+
 public slots:
     void start();
     void forceClose();
@@ -44,19 +51,33 @@ private:
     qintptr socketDescriptor_;
     QString hostname_;
 
-    enum { READ_IDENT_REQ, READ_COMMANDS, CONNECT_TO_HOST, RELAY_BETWEEN_CLIENT_SERVER } state_;
+    enum { READ_IDENT_REQ, READ_COMMANDS, CONNECT_TO_HOST, RELAY_BETWEEN_CLIENT_SERVER, UDP_ASSOCIATE } state_;
 
     QByteArray socketReadArr_;
     SocketWriteAll *writeAllSocket_;
     SocketWriteAll *writeAllSocketExternal_;
+    std::shared_ptr<SocketBufferAccounting> bufferAccounting_;
 
     SocksProxyIdentReqParser identReqParser_;
     SocksProxyCommandParser commandParser_;
     QScopedPointer<SocksProxyReadExactly> readExactly_;
 
+    QScopedPointer<SocksUdpRelay> udpRelay_;
+    QList<QSocketNotifier *> udpNotifiers_;
+    QTimer *udpIdleTimer_;
+
     bool bAlreadyClosedAndEmitFinished_;
+    quint64 relayId_;
 
     QByteArray getByteArrayFromSocks5Resp(const socks5_resp &resp);
+    void writeReplyAndClose(unsigned char reply);
+    void startUdpAssociate();
+    void stopUdpAssociate();
+    void resolveUdpDomain(const std::string &domain);
+    void startRelay();
+#ifdef Q_OS_LINUX
+    void tryHandOverToRelay();
+#endif
 
 };
 
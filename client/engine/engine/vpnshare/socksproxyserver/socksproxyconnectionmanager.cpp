@@ -1,24 +1,39 @@
 #include "socksproxyconnectionmanager.h"
 
-#include <QThread>
-#include <QTimer>
 #include "utils/ws_assert.h"
+#include "utils/log/categories.h"
 
 namespace SocksProxyServer {
 
 SocksProxyConnectionManager::SocksProxyConnectionManager(QObject *parent, int threadsCount, ConnectedUsersCounter *usersCounter) : QObject(parent),
     usersCounter_(usersCounter)
 {
-    WS_ASSERT(threadsCount > 0);
-    for (int i = 0; i < threadsCount; i++)
-    {
-        QThread *thread = new QThread(this);
-        threads_[thread] = 0;
-        thread->start(QThread::LowPriority);
-    }
+    workerPool_ = new ProxyWorkerPool(this, threadsCount, [this](qintptr socketDescriptor) {
+        return createConnection(socketDescriptor);
+    });
 }
 
-void SocksProxyConnectionManager::newConnection(qintptr socketDescriptor)
+bool SocksProxyConnectionManager::listen(quint16 port)
+{
+    return workerPool_->listen(port);
+}
+
+void SocksProxyConnectionManager::close()
+{
+    workerPool_->close();
+}
+
+bool SocksProxyConnectionManager::isListening() const
+{
+    return workerPool_->isListening();
+}
+
+quint16 SocksProxyConnectionManager::serverPort() const
+{
+    return workerPool_->port();
+}
+
+ProxyWorkerPool::Connection SocksProxyConnectionManager::createConnection(qintptr socketDescriptor)
 {
 #ifdef Q_OS_WIN
     SOCKADDR_IN  addr = {0};
@@ -28,79 +43,43 @@ void SocksProxyConnectionManager::newConnection(qintptr socketDescriptor)
     socklen_t addr_len = sizeof(addr);
 #endif
     getpeername(socketDescriptor, (sockaddr*)&addr, &addr_len);
-    char *ip = inet_ntoa(addr.sin_addr);
-    usersCounter_->newUserConnected(ip);
+    const QString ip = inet_ntoa(addr.sin_addr);
+    // the counter lives on the thread of the manager
+    QMetaObject::invokeMethod(this, [this, ip]() { usersCounter_->newUserConnected(ip); }, Qt::QueuedConnection);
 
-    QThread *thread = getLessBusyThread();
     SocksProxyConnection *connection = new SocksProxyConnection(socketDescriptor, ip);
     connect(connection, &SocksProxyConnection::finished, this, &SocksProxyConnectionManager::onConnectionFinished);
-    addConnectionToThread(thread, connection);
-    //qCDebug(LOG_SOCKS_SERVER) << "Count of connections:" << connections_.count();
+    return { connection, connection->bufferAccounting() };
 }
 
 void SocksProxyConnectionManager::closeAllConnections()
 {
-    for(auto c : connections_.keys())
-    {
-        QMetaObject::invokeMethod(c, "forceClose", Qt::QueuedConnection);
-    }
+    workerPool_->closeAllConnections();
 }
 
 void SocksProxyConnectionManager::stop()
 {
-    for(auto thread : threads_.keys())
-    {
-        thread->exit();
-    }
-    for(auto thread : threads_.keys())
-    {
-        thread->wait();
-    }
+    workerPool_->stop();
 }
 
 void SocksProxyConnectionManager::onConnectionFinished(const QString &hostname)
 {
-    usersCounter_->userDiconnected(hostname);
-
     SocksProxyConnection *connection = static_cast<SocksProxyConnection *>(sender());
-    //qCDebug(LOG_SOCKS_SERVER) << "Connection finished:" << connection;
-    QMap<SocksProxyConnection *, QThread *>::iterator it = connections_.find(connection);
-    WS_ASSERT(it != connections_.end());
-
-    QMap<QThread *, quint32>::iterator itThread = threads_.find(it.value());
-    WS_ASSERT(itThread != threads_.end());
-    itThread.value()--;
-
-    it.key()->deleteLater();
-    connections_.erase(it);
-
-    //qCDebug(LOG_SOCKS_SERVER) << "Count of connections:" << connections_.count();
+    usersCounter_->userDiconnected(hostname);
+    workerPool_->removeConnection(connection);
+    connection->deleteLater();
 }
 
-QThread *SocksProxyConnectionManager::getLessBusyThread()
+qint64 SocksProxyConnectionManager::bufferedBytes() const
 {
-    WS_ASSERT(threads_.count() > 0);
-    quint32 min = threads_.begin().value();
-    QThread *thread = threads_.begin().key();
-    for (QMap<QThread *, quint32>::iterator it = threads_.begin(); it != threads_.end(); ++it)
-    {
-        if (it.value() < min)
-        {
-            min = it.value();
-            thread = it.key();
-        }
-    }
-    return thread;
+    return workerPool_->bufferedBytes();
 }
 
-void SocksProxyConnectionManager::addConnectionToThread(QThread *thread, SocksProxyConnection *connection)
+void SocksProxyConnectionManager::logMemoryUsage() const
 {
-    //qCDebug(LOG_SOCKS_SERVER) << "Connection started:" << connection;
-    connection->moveToThread(thread);
-    QTimer::singleShot(0, connection, SLOT(start()));
-    WS_ASSERT(!connections_.contains(connection));
-    connections_[connection] = thread;
-    threads_[thread]++;
+    qCDebug(LOG_SOCKS_SERVER) << "Buffered bytes:" << bufferedBytes() << "in" << workerPool_->connectionsCount() << "connections, peak per connection:"
+                              << workerPool_->peakConnectionBufferedBytes()
+                              << "all proxies:" << SocketWriteAll::total().bytes.load() << "peak:" << SocketWriteAll::total().peakBytes.load();
 }
 
 } // namespace SocksProxyServer
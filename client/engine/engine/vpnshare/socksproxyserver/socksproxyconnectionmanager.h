@@ -1,9 +1,9 @@
 #pragma once
 
 #include <QObject>
-#include <QMap>
 #include "socksproxyconnection.h"
 #include "../connecteduserscounter.h"
+#include "../proxyworkerpool.h"
 
 namespace SocksProxyServer {
 
@@ -14,20 +14,27 @@ public:
     explicit SocksProxyConnectionManager(QObject *parent, int threadsCount, ConnectedUsersCounter *usersCounter);
 
 public:
-    void newConnection(qintptr socketDescriptor);
+    bool listen(quint16 port);
+    void close();
+    bool isListening() const;
+    quint16 serverPort() const;
+
     void closeAllConnections();
     void stop();
 
+    // the data waiting to be written by the active connections
+    qint64 bufferedBytes() const;
+    void logMemoryUsage() const;
+
 private slots:
     void onConnectionFinished(const QString &hostname);
 
 private:
-    QMap<QThread *, quint32> threads_;
-    QMap<SocksProxyConnection *, QThread *> connections_;
+    ProxyWorkerPool *workerPool_;
     ConnectedUsersCounter *usersCounter_;
 
-    QThread *getLessBusyThread();
-    void addConnectionToThread(QThread *thread, SocksProxyConnection *connection);
+    // called on the thread of a worker
+    ProxyWorkerPool::Connection createConnection(qintptr socketDescriptor);
 };
 
 } // namespace SocksProxyServer
@@ -4,11 +4,11 @@
 
 namespace SocksProxyServer {
 
-SocksProxyServer::SocksProxyServer(QObject *parent) : QTcpServer(parent)
+SocksProxyServer::SocksProxyServer(QObject *parent) : QObject(parent)
 {
     usersCounter_ = new ConnectedUsersCounter(this);
     connect(usersCounter_, &ConnectedUsersCounter::usersCountChanged, this, &SocksProxyServer::usersCountChanged);
-    connectionManager_ = new SocksProxyConnectionManager(this, 4, usersCounter_);
+    connectionManager_ = new SocksProxyConnectionManager(this, ProxyWorkerPool::defaultWorkersCount(), usersCounter_);
 }
 
 SocksProxyServer::~SocksProxyServer()
@@ -20,7 +20,7 @@ bool SocksProxyServer::startServer(quint16 port)
 {
     WS_ASSERT(!isListening());
 
-    if (listen(QHostAddress::AnyIPv4, port))
+    if (connectionManager_->listen(port))
     {
         qCDebug(LOG_SOCKS_SERVER) << "Socks proxy server started on port" << serverPort();
         return true;
@@ -37,8 +37,9 @@ void SocksProxyServer::stopServer()
     if (isListening())
     {
         qCDebug(LOG_SOCKS_SERVER) << "Socks proxy server stopped on port" << serverPort();
-        close();
+        connectionManager_->close();
     }
+    connectionManager_->logMemoryUsage();
     connectionManager_->stop();
 }
 
@@ -52,9 +53,14 @@ void SocksProxyServer::closeActiveConnections()
     connectionManager_->closeAllConnections();
 }
 
-void SocksProxyServer::incomingConnection(qintptr socketDescriptor)
+bool SocksProxyServer::isListening() const
 {
-    connectionManager_->newConnection(socketDescriptor);
+    return connectionManager_->isListening();
+}
+
+quint16 SocksProxyServer::serverPort() const
+{
+    return connectionManager_->serverPort();
 }
 
 
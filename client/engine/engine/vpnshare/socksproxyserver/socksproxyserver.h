@@ -3,11 +3,11 @@
 #include "socksproxyconnectionmanager.h"
 #include "../connecteduserscounter.h"
 
-#include <QTcpServer>
+#include <QObject>
 
 namespace SocksProxyServer {
 
-class SocksProxyServer : public QTcpServer
+class SocksProxyServer : public QObject
 {
     Q_OBJECT
 public:
@@ -16,6 +16,8 @@ public:
 
     bool startServer(quint16 port);
     void stopServer();
+    bool isListening() const;
+    quint16 serverPort() const;
 
     int getConnectedUsersCount();
 
@@ -24,9 +26,6 @@ public:
 signals:
     void usersCountChanged();
 
-protected:
-    virtual void incomingConnection(qintptr socketDescriptor);
-
 
 private:
     SocksProxyConnectionManager *connectionManager_;
@@ -0,0 +1,626 @@
+#include "socksudprelay.h"
+
+#include <cerrno>
+#include <cstring>
+#include <memory>
+
+#if defined (Q_OS_MACOS) || defined (Q_OS_LINUX)
+    #include <fcntl.h>
+    #include <sys/uio.h>
+    #include <unistd.h>
+#endif
+
+namespace SocksProxyServer {
+
+namespace {
+
+const size_t kMaxDatagramSize = 65535;
+const size_t kSlotSize = kMaxSocksUdpHeaderSize + kMaxDatagramSize;
+
+bool isWouldBlock()
+{
+#ifdef Q_OS_WIN
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+#ifndef Q_OS_LINUX
+bool isInterrupted()
+{
+#ifdef Q_OS_WIN
+    // an ICMP port unreachable for an earlier datagram, not an error of the socket
+    return WSAGetLastError() == WSAECONNRESET;
+#else
+    return errno == EINTR;
+#endif
+}
+#endif
+
+} // namespace
+
+bool parseSocksUdpHeader(const char *data, size_t size, SocksUdpHeader &header)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    if (size < 4 || p[0] != 0 || p[1] != 0)
+    {
+        return false;
+    }
+    header.frag = p[2];
+    header.addrType = p[3];
+    header.domain.clear();
+    memset(&header.addr, 0, sizeof(header.addr));
+
+    size_t pos = 4;
+    if (header.addrType == 0x01)  // ip4
+    {
+        if (size < pos + 4 + 2)
+        {
+            return false;
+        }
+        sockaddr_in *addr = (sockaddr_in *)&header.addr;
+        addr->sin_family = AF_INET;
+        memcpy(&addr->sin_addr, p + pos, 4);
+        pos += 4;
+    }
+    else if (header.addrType == 0x04)  // ip6
+    {
+        if (size < pos + 16 + 2)
+        {
+            return false;
+        }
+        sockaddr_in6 *addr = (sockaddr_in6 *)&header.addr;
+        addr->sin6_family = AF_INET6;
+        memcpy(&addr->sin6_addr, p + pos, 16);
+        pos += 16;
+    }
+    else if (header.addrType == 0x03)  // domain name
+    {
+        if (size < pos + 1 || p[pos] == 0 || size < pos + 1 + p[pos] + 2)
+        {
+            return false;
+        }
+        header.domain.assign(data + pos + 1, p[pos]);
+        pos += 1 + p[pos];
+    }
+    else
+    {
+        return false;
+    }
+
+    header.port = (p[pos] << 8) | p[pos + 1];
+    if (header.addrType == 0x01)
+    {
+        ((sockaddr_in *)&header.addr)->sin_port = htons(header.port);
+    }
+    else if (header.addrType == 0x04)
+    {
+        ((sockaddr_in6 *)&header.addr)->sin6_port = htons(header.port);
+    }
+    header.size = pos + 2;
+    return true;
+}
+
+size_t writeSocksUdpHeaderBefore(const sockaddr *from, char *out)
+{
+    unsigned char header[4 + 16 + 2] = { 0, 0, 0 };
+    size_t size;
+    if (from->sa_family == AF_INET)
+    {
+        const sockaddr_in *addr = (const sockaddr_in *)from;
+        header[3] = 0x01;
+        memcpy(header + 4, &addr->sin_addr, 4);
+        memcpy(header + 8, &addr->sin_port, 2);
+        size = 4 + 4 + 2;
+    }
+    else
+    {
+        const sockaddr_in6 *addr = (const sockaddr_in6 *)from;
+        header[3] = 0x04;
+        memcpy(header + 4, &addr->sin6_addr, 16);
+        memcpy(header + 20, &addr->sin6_port, 2);
+        size = 4 + 16 + 2;
+    }
+    memcpy(out - size, header, size);
+    return size;
+}
+
+SocksUdpRelay::SocksUdpRelay(ResolveCallback onResolveNeeded) : onResolveNeeded_(onResolveNeeded),
+    clientSocket_(kInvalidUdpSocket), externalSocket4_(kInvalidUdpSocket), externalSocket6_(kInvalidUdpSocket),
+    isClientPortKnown_(false), lastActivity_(std::chrono::steady_clock::now())
+{
+    memset(&client_, 0, sizeof(client_));
+}
+
+SocksUdpRelay::~SocksUdpRelay()
+{
+    closeSocket(clientSocket_);
+    closeSocket(externalSocket4_);
+    closeSocket(externalSocket6_);
+}
+
+bool SocksUdpRelay::start(const sockaddr *bindAddr, const sockaddr *clientHost, unsigned short clientPort)
+{
+    sockaddr_storage addr;
+    memset(&addr, 0, sizeof(addr));
+    memcpy(&addr, bindAddr, addrLength(bindAddr));
+    if (addr.ss_family == AF_INET)
+    {
+        ((sockaddr_in *)&addr)->sin_port = 0;
+    }
+    else
+    {
+        ((sockaddr_in6 *)&addr)->sin6_port = 0;
+    }
+
+    clientSocket_ = openSocket(addr.ss_family);
+    if (clientSocket_ == kInvalidUdpSocket || bind(clientSocket_, (const sockaddr *)&addr, addrLength((const sockaddr *)&addr)) != 0)
+    {
+        return false;
+    }
+    // an address family may be not available
+    externalSocket4_ = openSocket(AF_INET);
+    externalSocket6_ = openSocket(AF_INET6);
+    if (externalSocket4_ == kInvalidUdpSocket && externalSocket6_ == kInvalidUdpSocket)
+    {
+        return false;
+    }
+
+    memcpy(&client_, clientHost, addrLength(clientHost));
+    if (client_.ss_family == AF_INET)
+    {
+        ((sockaddr_in *)&client_)->sin_port = htons(clientPort);
+    }
+    else
+    {
+        ((sockaddr_in6 *)&client_)->sin6_port = htons(clientPort);
+    }
+    isClientPortKnown_ = clientPort != 0;
+    lastActivity_ = std::chrono::steady_clock::now();
+    return true;
+}
+
+bool SocksUdpRelay::getBoundAddress(sockaddr_storage &addr) const
+{
+    socklen_t len = sizeof(addr);
+    return clientSocket_ != kInvalidUdpSocket && getsockname(clientSocket_, (sockaddr *)&addr, &len) == 0;
+}
+
+std::vector<udp_socket_t> SocksUdpRelay::sockets() const
+{
+    std::vector<udp_socket_t> sockets;
+    for (udp_socket_t socket : { clientSocket_, externalSocket4_, externalSocket6_ })
+    {
+        if (socket != kInvalidUdpSocket)
+        {
+            sockets.push_back(socket);
+        }
+    }
+    return sockets;
+}
+
+void SocksUdpRelay::onReadable(udp_socket_t socket)
+{
+    if (socket == clientSocket_)
+    {
+        readFromClient();
+    }
+    else if (socket != kInvalidUdpSocket && (socket == externalSocket4_ || socket == externalSocket6_))
+    {
+        readFromExternal(socket);
+    }
+}
+
+void SocksUdpRelay::setResolved(const std::string &domain, const sockaddr *addr)
+{
+    std::vector<PendingDatagram> datagrams;
+    auto it = pending_.find(domain);
+    if (it != pending_.end())
+    {
+        datagrams.swap(it->second);
+        pending_.erase(it);
+    }
+    if (!addr)
+    {
+        stats_.dropped += datagrams.size();
+        return;
+    }
+
+    if (resolved_.size() >= kMaxDestinations)
+    {
+        resolved_.clear();
+    }
+    sockaddr_storage &to = resolved_[domain];
+    memset(&to, 0, sizeof(to));
+    memcpy(&to, addr, addrLength(addr));
+    for (const auto &datagram : datagrams)
+    {
+        if (to.ss_family == AF_INET)
+        {
+            ((sockaddr_in *)&to)->sin_port = htons(datagram.port);
+        }
+        else
+        {
+            ((sockaddr_in6 *)&to)->sin6_port = htons(datagram.port);
+        }
+        sendToExternal((const sockaddr *)&to, datagram.payload.data(), datagram.payload.size());
+    }
+}
+
+qint64 SocksUdpRelay::idleMs() const
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - lastActivity_).count();
+}
+
+void SocksUdpRelay::readFromClient()
+{
+    char *buffer = threadBuffer().data();
+    Datagram datagrams[kBatchSize];
+    Datagram out4[kBatchSize];
+    Datagram out6[kBatchSize];
+    for (int i = 0; i < kBatchSize; ++i)
+    {
+        datagrams[i].data = buffer + i * kSlotSize + kMaxSocksUdpHeaderSize;
+    }
+
+    for (int batch = 0; batch < kMaxBatchesPerRead; ++batch)
+    {
+        const int count = receiveBatch(clientSocket_, datagrams, kBatchSize);
+        int count4 = 0;
+        int count6 = 0;
+        SocksUdpHeader header;
+        for (int i = 0; i < count; ++i)
+        {
+            const Datagram &datagram = datagrams[i];
+            // fragmentation is optional (RFC 1928), the fragments are dropped
+            if (!isFromClient(datagram.addr) || !parseSocksUdpHeader(datagram.data, datagram.size, header) || header.frag != 0)
+            {
+                stats_.dropped++;
+                continue;
+            }
+
+            const char *payload = datagram.data + header.size;
+            const size_t payloadSize = datagram.size - header.size;
+            if (header.addrType == 0x03)
+            {
+                auto it = resolved_.find(header.domain);
+                if (it == resolved_.end())
+                {
+                    std::vector<PendingDatagram> &pending = pending_[header.domain];
+                    const bool isNew = pending.empty();
+                    if (pending.size() < kMaxPendingPerDomain)
+                    {
+                        pending.push_back({ header.port, std::string(payload, payloadSize) });
+                    }
+                    else
+                    {
+                        stats_.dropped++;
+                    }
+                    if (isNew)
+                    {
+                        onResolveNeeded_(header.domain);
+                    }
+                    continue;
+                }
+                memcpy(&header.addr, &it->second, sizeof(header.addr));
+                if (header.addr.ss_family == AF_INET)
+                {
+                    ((sockaddr_in *)&header.addr)->sin_port = htons(header.port);
+                }
+                else
+                {
+                    ((sockaddr_in6 *)&header.addr)->sin6_port = htons(header.port);
+                }
+            }
+
+            Datagram &out = header.addr.ss_family == AF_INET ? out4[count4++] : out6[count6++];
+            memcpy(&out.addr, &header.addr, sizeof(out.addr));
+            out.addrLen = addrLength((const sockaddr *)&header.addr);
+            out.data = (char *)payload;
+            out.size = payloadSize;
+            if (destinations_.size() >= kMaxDestinations)
+            {
+                destinations_.clear();
+            }
+            destinations_.insert(endpointKey((const sockaddr *)&out.addr));
+        }
+
+        const int sent = sendBatch(externalSocket4_, out4, count4) + sendBatch(externalSocket6_, out6, count6);
+        stats_.toExternal += sent;
+        stats_.dropped += count4 + count6 - sent;
+        if (sent > 0)
+        {
+            lastActivity_ = std::chrono::steady_clock::now();
+        }
+        if (count < kBatchSize)
+        {
+            break;
+        }
+    }
+}
+
+void SocksUdpRelay::readFromExternal(udp_socket_t socket)
+{
+    char *buffer = threadBuffer().data();
+    Datagram datagrams[kBatchSize];
+    for (int i = 0; i < kBatchSize; ++i)
+    {
+        datagrams[i].data = buffer + i * kSlotSize + kMaxSocksUdpHeaderSize;
+    }
+
+    for (int batch = 0; batch < kMaxBatchesPerRead; ++batch)
+    {
+        const int count = receiveBatch(socket, datagrams, kBatchSize);
+        int countOut = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            if (destinations_.find(endpointKey((const sockaddr *)&datagrams[i].addr)) == destinations_.end())
+            {
+                stats_.dropped++;
+                continue;
+            }
+            // the header is written in place before the payload
+            const size_t headerSize = writeSocksUdpHeaderBefore((const sockaddr *)&datagrams[i].addr, datagrams[i].data);
+            Datagram &out = datagrams[countOut++];
+            out.data = datagrams[i].data - headerSize;
+            out.size = datagrams[i].size + headerSize;
+            memcpy(&out.addr, &client_, sizeof(out.addr));
+            out.addrLen = addrLength((const sockaddr *)&client_);
+        }
+
+        const int sent = sendBatch(clientSocket_, datagrams, countOut);
+        stats_.toClient += sent;
+        stats_.dropped += countOut - sent;
+        if (sent > 0)
+        {
+            lastActivity_ = std::chrono::steady_clock::now();
+        }
+
+        // the slots were reordered, restore them for the next batch
+        for (int i = 0; i < kBatchSize; ++i)
+        {
+            datagrams[i].data = buffer + i * kSlotSize + kMaxSocksUdpHeaderSize;
+        }
+        if (count < kBatchSize)
+        {
+            break;
+        }
+    }
+}
+
+void SocksUdpRelay::sendToExternal(const sockaddr *to, const char *data, size_t size)
+{
+    Datagram datagram;
+    memcpy(&datagram.addr, to, addrLength(to));
+    datagram.addrLen = addrLength(to);
+    datagram.data = (char *)data;
+    datagram.size = size;
+    if (destinations_.size() >= kMaxDestinations)
+    {
+        destinations_.clear();
+    }
+    destinations_.insert(endpointKey(to));
+
+    if (sendBatch(to->sa_family == AF_INET ? externalSocket4_ : externalSocket6_, &datagram, 1) == 1)
+    {
+        stats_.toExternal++;
+        lastActivity_ = std::chrono::steady_clock::now();
+    }
+    else
+    {
+        stats_.dropped++;
+    }
+}
+
+bool SocksUdpRelay::isFromClient(const sockaddr_storage &from)
+{
+    if (from.ss_family != client_.ss_family)
+    {
+        return false;
+    }
+    if (from.ss_family == AF_INET)
+    {
+        const sockaddr_in *addr = (const sockaddr_in *)&from;
+        sockaddr_in *client = (sockaddr_in *)&client_;
+        if (memcmp(&addr->sin_addr, &client->sin_addr, sizeof(addr->sin_addr)) != 0)
+        {
+            return false;
+        }
+        if (!isClientPortKnown_)
+        {
+            client->sin_port = addr->sin_port;
+            isClientPortKnown_ = true;
+        }
+        return addr->sin_port == client->sin_port;
+    }
+    else
+    {
+        const sockaddr_in6 *addr = (const sockaddr_in6 *)&from;
+        sockaddr_in6 *client = (sockaddr_in6 *)&client_;
+        if (memcmp(&addr->sin6_addr, &client->sin6_addr, sizeof(addr->sin6_addr)) != 0)
+        {
+            return false;
+        }
+        if (!isClientPortKnown_)
+        {
+            client->sin6_port = addr->sin6_port;
+            isClientPortKnown_ = true;
+        }
+        return addr->sin6_port == client->sin6_port;
+    }
+}
+
+std::vector<char> &SocksUdpRelay::threadBuffer()
+{
+    thread_local std::vector<char> buffer(kBatchSize * kSlotSize);
+    return buffer;
+}
+
+int SocksUdpRelay::receiveBatch(udp_socket_t socket, Datagram *datagrams, int count)
+{
+#ifdef Q_OS_LINUX
+    mmsghdr msgs[kBatchSize];
+    iovec iovs[kBatchSize];
+    memset(msgs, 0, sizeof(mmsghdr) * count);
+    for (int i = 0; i < count; ++i)
+    {
+        iovs[i].iov_base = datagrams[i].data;
+        iovs[i].iov_len = kMaxDatagramSize;
+        msgs[i].msg_hdr.msg_name = &datagrams[i].addr;
+        msgs[i].msg_hdr.msg_namelen = sizeof(datagrams[i].addr);
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    int received;
+    do
+    {
+        received = recvmmsg(socket, msgs, count, MSG_DONTWAIT, nullptr);
+    } while (received < 0 && errno == EINTR);
+    if (received < 0)
+    {
+        return 0;
+    }
+    for (int i = 0; i < received; ++i)
+    {
+        datagrams[i].addrLen = msgs[i].msg_hdr.msg_namelen;
+        datagrams[i].size = msgs[i].msg_len;
+    }
+    return received;
+#else
+    int received = 0;
+    while (received < count)
+    {
+        Datagram &datagram = datagrams[received];
+        socklen_t len = sizeof(datagram.addr);
+        const auto size = recvfrom(socket, datagram.data, (int)kMaxDatagramSize, 0, (sockaddr *)&datagram.addr, &len);
+        if (size < 0)
+        {
+            if (isInterrupted())
+            {
+                continue;
+            }
+            break;
+        }
+        datagram.addrLen = len;
+        datagram.size = size;
+        received++;
+    }
+    return received;
+#endif
+}
+
+int SocksUdpRelay::sendBatch(udp_socket_t socket, const Datagram *datagrams, int count)
+{
+    if (socket == kInvalidUdpSocket || count == 0)
+    {
+        return 0;
+    }
+
+#ifdef Q_OS_LINUX
+    mmsghdr msgs[kBatchSize];
+    iovec iovs[kBatchSize];
+    memset(msgs, 0, sizeof(mmsghdr) * count);
+    for (int i = 0; i < count; ++i)
+    {
+        iovs[i].iov_base = datagrams[i].data;
+        iovs[i].iov_len = datagrams[i].size;
+        msgs[i].msg_hdr.msg_name = (void *)&datagrams[i].addr;
+        msgs[i].msg_hdr.msg_namelen = datagrams[i].addrLen;
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    int sent = 0;
+    int next = 0;
+    while (next < count)
+    {
+        const int ret = sendmmsg(socket, msgs + next, count - next, MSG_DONTWAIT);
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (isWouldBlock())
+            {
+                break;
+            }
+            // this datagram can't be sent (e.g. no route), the next ones may be
+            next++;
+            continue;
+        }
+        sent += ret;
+        next += ret;
+    }
+    return sent;
+#else
+    int sent = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        const auto ret = sendto(socket, datagrams[i].data, (int)datagrams[i].size, 0, (const sockaddr *)&datagrams[i].addr, datagrams[i].addrLen);
+        if (ret < 0)
+        {
+            if (isWouldBlock())
+            {
+                break;
+            }
+            continue;
+        }
+        sent++;
+    }
+    return sent;
+#endif
+}
+
+std::string SocksUdpRelay::endpointKey(const sockaddr *addr)
+{
+    if (addr->sa_family == AF_INET)
+    {
+        const sockaddr_in *addr4 = (const sockaddr_in *)addr;
+        return std::string((const char *)&addr4->sin_addr, sizeof(addr4->sin_addr)) + std::string((const char *)&addr4->sin_port, 2);
+    }
+    const sockaddr_in6 *addr6 = (const sockaddr_in6 *)addr;
+    return std::string((const char *)&addr6->sin6_addr, sizeof(addr6->sin6_addr)) + std::string((const char *)&addr6->sin6_port, 2);
+}
+
+socklen_t SocksUdpRelay::addrLength(const sockaddr *addr)
+{
+    return addr->sa_family == AF_INET ? sizeof(sockaddr_in) : sizeof(sockaddr_in6);
+}
+
+void SocksUdpRelay::closeSocket(udp_socket_t socket)
+{
+    if (socket == kInvalidUdpSocket)
+    {
+        return;
+    }
+#ifdef Q_OS_WIN
+    closesocket(socket);
+#else
+    close(socket);
+#endif
+}
+
+udp_socket_t SocksUdpRelay::openSocket(int family)
+{
+    udp_socket_t s = socket(family, SOCK_DGRAM, IPPROTO_UDP);
+    if (s == kInvalidUdpSocket)
+    {
+        return s;
+    }
+#ifdef Q_OS_WIN
+    u_long nonBlocking = 1;
+    ioctlsocket(s, FIONBIO, &nonBlocking);
+#else
+    fcntl(s, F_SETFD, FD_CLOEXEC);
+    fcntl(s, F_SETFL, fcntl(s, F_GETFL) | O_NONBLOCK);
+#endif
+    if (family == AF_INET6)
+    {
+        int on = 1;
+        setsockopt(s, IPPROTO_IPV6, IPV6_V6ONLY, (const char *)&on, sizeof(on));
+    }
+    return s;
+}
+
+} // namespace SocksProxyServer
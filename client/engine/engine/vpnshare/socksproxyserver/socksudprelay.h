@@ -0,0 +1,137 @@
+#pragma once
+
+#include <QtGlobal>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#ifdef Q_OS_WIN
+    #include <Winsock2.h>
+    #include <Ws2tcpip.h>
+#elif defined (Q_OS_MACOS) || defined (Q_OS_LINUX)
+    #include <netinet/in.h>
+    #include <sys/socket.h>
+#endif
+
+namespace SocksProxyServer {
+
+#ifdef Q_OS_WIN
+typedef SOCKET udp_socket_t;
+const udp_socket_t kInvalidUdpSocket = INVALID_SOCKET;
+#else
+typedef int udp_socket_t;
+const udp_socket_t kInvalidUdpSocket = -1;
+#endif
+
+// The header of the datagrams between the client and the relay (RFC 1928, section 7).
+struct SocksUdpHeader
+{
+    unsigned char frag;
+    unsigned char addrType;     // 0x01 ip4, 0x03 domain name, 0x04 ip6
+    sockaddr_storage addr;      // ip4 and ip6, with the port
+    std::string domain;
+    unsigned short port;        // host order
+    size_t size;                // the payload follows the header
+};
+
+// the longest header, with a 255 bytes domain name
+const size_t kMaxSocksUdpHeaderSize = 4 + 1 + 255 + 2;
+
+bool parseSocksUdpHeader(const char *data, size_t size, SocksUdpHeader &header);
+// writes the header of a datagram received from the address right before out, returns its size
+size_t writeSocksUdpHeaderBefore(const sockaddr *from, char *out);
+
+// The UDP relay of a SOCKS5 UDP ASSOCIATE request. The client sends the datagrams with the SOCKS header to the
+// client socket, they are sent to the destinations from the external sockets (one per address family); the answers
+// are sent back to the client with the header. Only the datagrams of the client host are relayed, and only the
+// answers from the destinations the client has sent to. Fragments are dropped.
+// The owner watches the sockets and calls onReadable(); the datagrams are read and sent in batches
+// (recvmmsg/sendmmsg on Linux). Not thread-safe, all the calls are made on the thread of the owner.
+class SocksUdpRelay
+{
+public:
+    // asks the owner to resolve the domain name and call setResolved()
+    typedef std::function<void(const std::string &domain)> ResolveCallback;
+
+    static constexpr int kBatchSize = 32;
+    // the batches read per notification, so a busy association does not hold the thread
+    static constexpr int kMaxBatchesPerRead = 4;
+    static constexpr int kIdleTimeoutMs = 120 * 1000;
+    // the datagrams waiting for a domain name to be resolved
+    static constexpr size_t kMaxPendingPerDomain = 16;
+    static constexpr size_t kMaxDestinations = 4096;
+
+    struct Stats
+    {
+        quint64 toExternal = 0;
+        quint64 toClient = 0;
+        quint64 dropped = 0;
+    };
+
+    explicit SocksUdpRelay(ResolveCallback onResolveNeeded);
+    ~SocksUdpRelay();
+
+    // bindAddr is the local address of the control connection, clientHost its peer;
+    // clientPort is the source port given in the request, or 0 to take it from the first datagram
+    bool start(const sockaddr *bindAddr, const sockaddr *clientHost, unsigned short clientPort);
+    bool getBoundAddress(sockaddr_storage &addr) const;
+    std::vector<udp_socket_t> sockets() const;
+
+    void onReadable(udp_socket_t socket);
+    // addr is nullptr if the name could not be resolved
+    void setResolved(const std::string &domain, const sockaddr *addr);
+
+    qint64 idleMs() const;
+    const Stats &stats() const { return stats_; }
+
+private:
+    struct Datagram
+    {
+        sockaddr_storage addr;
+        socklen_t addrLen;
+        char *data;
+        size_t size;
+    };
+
+    struct PendingDatagram
+    {
+        unsigned short port;
+        std::string payload;
+    };
+
+    ResolveCallback onResolveNeeded_;
+    udp_socket_t clientSocket_;
+    udp_socket_t externalSocket4_;
+    udp_socket_t externalSocket6_;
+
+    sockaddr_storage client_;
+    bool isClientPortKnown_;
+
+    std::set<std::string> destinations_;
+    std::map<std::string, sockaddr_storage> resolved_;
+    std::map<std::string, std::vector<PendingDatagram>> pending_;
+
+    std::chrono::steady_clock::time_point lastActivity_;
+    Stats stats_;
+
+    void readFromClient();
+    void readFromExternal(udp_socket_t socket);
+    void sendToExternal(const sockaddr *to, const char *data, size_t size);
+    bool isFromClient(const sockaddr_storage &from);
+
+    // the reusable buffers of the thread, the datagrams are received after kMaxSocksUdpHeaderSize bytes,
+    // so the header for the client is written in place
+    static std::vector<char> &threadBuffer();
+    static int receiveBatch(udp_socket_t socket, Datagram *datagrams, int count);
+    // the datagrams that can't be sent are dropped, returns the number sent
+    static int sendBatch(udp_socket_t socket, const Datagram *datagrams, int count);
+    static std::string endpointKey(const sockaddr *addr);
+    static socklen_t addrLength(const sockaddr *addr);
+    static void closeSocket(udp_socket_t socket);
+    static udp_socket_t openSocket(int family);
+};
+
+} // namespace SocksProxyServer
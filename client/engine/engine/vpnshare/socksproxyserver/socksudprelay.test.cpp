@@ -0,0 +1,404 @@
+#include <QtTest>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#ifdef Q_OS_WIN
+    #include <Winsock2.h>
+    #include <Ws2tcpip.h>
+#else
+    #include <arpa/inet.h>
+    #include <poll.h>
+    #include <unistd.h>
+#endif
+
+#include "socksudprelay.h"
+
+using namespace SocksProxyServer;
+
+// The relay between a client socket and a local UDP echo server, the sockets are polled by the test.
+class TestSocksUdpRelay : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void testParseHeader();
+    void testParseInvalidHeader();
+    void testWriteHeader();
+    void testEcho();
+    void testBatch();
+    void testDomainName();
+    void testFragmentDropped();
+    void testOtherClientDropped();
+    void testUnknownSourceDropped();
+
+private:
+    udp_socket_t echoSocket_;
+    sockaddr_in echoAddr_;
+    std::thread echoThread_;
+    std::atomic<bool> isStopping_;
+
+    static sockaddr_in loopback(unsigned short port);
+    static udp_socket_t openClient();
+    static void closeSocket(udp_socket_t s);
+    static QByteArray header(const sockaddr_in &to);
+    // polls the relay sockets until the client has a datagram or the timeout
+    static bool pump(SocksUdpRelay &relay, udp_socket_t client, int timeoutMs);
+    static QByteArray receive(udp_socket_t s, sockaddr_in *from = nullptr);
+    static void sendTo(udp_socket_t s, const QByteArray &data, const sockaddr_storage &to);
+    void startRelay(SocksUdpRelay &relay, sockaddr_storage &relayAddr, unsigned short clientPort = 0);
+};
+
+sockaddr_in TestSocksUdpRelay::loopback(unsigned short port)
+{
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    return addr;
+}
+
+udp_socket_t TestSocksUdpRelay::openClient()
+{
+    udp_socket_t s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    sockaddr_in addr = loopback(0);
+    bind(s, (const sockaddr *)&addr, sizeof(addr));
+    return s;
+}
+
+void TestSocksUdpRelay::closeSocket(udp_socket_t s)
+{
+#ifdef Q_OS_WIN
+    closesocket(s);
+#else
+    close(s);
+#endif
+}
+
+QByteArray TestSocksUdpRelay::header(const sockaddr_in &to)
+{
+    QByteArray arr(4, 0);
+    arr[3] = 0x01;
+    arr.append((const char *)&to.sin_addr, 4);
+    arr.append((const char *)&to.sin_port, 2);
+    return arr;
+}
+
+bool TestSocksUdpRelay::pump(SocksUdpRelay &relay, udp_socket_t client, int timeoutMs)
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+        std::vector<udp_socket_t> sockets = relay.sockets();
+        std::vector<pollfd> pfds;
+        for (udp_socket_t s : sockets)
+        {
+            pfds.push_back({ s, POLLIN, 0 });
+        }
+        pfds.push_back({ client, POLLIN, 0 });
+#ifdef Q_OS_WIN
+        WSAPoll(pfds.data(), (ULONG)pfds.size(), 10);
+#else
+        poll(pfds.data(), pfds.size(), 10);
+#endif
+        for (size_t i = 0; i < sockets.size(); ++i)
+        {
+            if (pfds[i].revents & POLLIN)
+            {
+                relay.onReadable(sockets[i]);
+            }
+        }
+        if (pfds.back().revents & POLLIN)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+QByteArray TestSocksUdpRelay::receive(udp_socket_t s, sockaddr_in *from)
+{
+    char buf[65536];
+    sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    const auto size = recvfrom(s, buf, sizeof(buf), 0, (sockaddr *)&addr, &len);
+    if (from)
+    {
+        *from = addr;
+    }
+    return size > 0 ? QByteArray(buf, size) : QByteArray();
+}
+
+void TestSocksUdpRelay::sendTo(udp_socket_t s, const QByteArray &data, const sockaddr_storage &to)
+{
+    sendto(s, data.constData(), data.size(), 0, (const sockaddr *)&to, sizeof(sockaddr_in));
+}
+
+void TestSocksUdpRelay::startRelay(SocksUdpRelay &relay, sockaddr_storage &relayAddr, unsigned short clientPort)
+{
+    const sockaddr_in addr = loopback(0);
+    QVERIFY(relay.start((const sockaddr *)&addr, (const sockaddr *)&addr, clientPort));
+    QVERIFY(relay.getBoundAddress(relayAddr));
+    QCOMPARE(relayAddr.ss_family, (decltype(relayAddr.ss_family))AF_INET);
+}
+
+void TestSocksUdpRelay::initTestCase()
+{
+#ifdef Q_OS_WIN
+    WSADATA wsaData;
+    WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
+    echoSocket_ = openClient();
+    socklen_t len = sizeof(echoAddr_);
+    QVERIFY(getsockname(echoSocket_, (sockaddr *)&echoAddr_, &len) == 0);
+
+    isStopping_ = false;
+    echoThread_ = std::thread([this]() {
+        char buf[65536];
+        while (!isStopping_)
+        {
+            sockaddr_storage from;
+            socklen_t fromLen = sizeof(from);
+            const auto size = recvfrom(echoSocket_, buf, sizeof(buf), 0, (sockaddr *)&from, &fromLen);
+            if (size > 0)
+            {
+                sendto(echoSocket_, buf, size, 0, (const sockaddr *)&from, fromLen);
+            }
+        }
+    });
+}
+
+void TestSocksUdpRelay::cleanupTestCase()
+{
+    isStopping_ = true;
+    // wakes the echo thread up
+    udp_socket_t s = openClient();
+    sendto(s, "x", 1, 0, (const sockaddr *)&echoAddr_, sizeof(echoAddr_));
+    echoThread_.join();
+    closeSocket(s);
+    closeSocket(echoSocket_);
+}
+
+void TestSocksUdpRelay::testParseHeader()
+{
+    SocksUdpHeader h;
+    const QByteArray ip4 = QByteArray::fromHex("000000017f00000101bb") + "payload";
+    QVERIFY(parseSocksUdpHeader(ip4.constData(), ip4.size(), h));
+    QCOMPARE(h.frag, (unsigned char)0);
+    QCOMPARE(h.addrType, (unsigned char)0x01);
+    QCOMPARE(h.port, (unsigned short)443);
+    QCOMPARE(h.size, (size_t)10);
+    QCOMPARE(ntohl(((sockaddr_in *)&h.addr)->sin_addr.s_addr), (quint32)INADDR_LOOPBACK);
+    QCOMPARE(ntohs(((sockaddr_in *)&h.addr)->sin_port), (unsigned short)443);
+
+    const QByteArray ip6 = QByteArray::fromHex("0000020400000000000000000000000000000001") + QByteArray::fromHex("0035");
+    QVERIFY(parseSocksUdpHeader(ip6.constData(), ip6.size(), h));
+    QCOMPARE(h.frag, (unsigned char)2);
+    QCOMPARE(h.addrType, (unsigned char)0x04);
+    QCOMPARE(h.port, (unsigned short)53);
+    QCOMPARE(h.size, (size_t)22);
+    QCOMPARE(((sockaddr_in6 *)&h.addr)->sin6_family, (decltype(((sockaddr_in6 *)&h.addr)->sin6_family))AF_INET6);
+
+    const QByteArray domain = QByteArray::fromHex("000000030b") + "example.com" + QByteArray::fromHex("0050") + "x";
+    QVERIFY(parseSocksUdpHeader(domain.constData(), domain.size(), h));
+    QCOMPARE(h.addrType, (unsigned char)0x03);
+    QCOMPARE(h.domain, std::string("example.com"));
+    QCOMPARE(h.port, (unsigned short)80);
+    QCOMPARE(h.size, (size_t)18);
+}
+
+void TestSocksUdpRelay::testParseInvalidHeader()
+{
+    SocksUdpHeader h;
+    const QByteArray cases[] = {
+        QByteArray::fromHex("0000"),                        // too short
+        QByteArray::fromHex("000100017f00000101bb"),        // reserved bytes are not 0
+        QByteArray::fromHex("000000057f00000101bb"),        // unknown address type
+        QByteArray::fromHex("000000017f00000101"),          // truncated port
+        QByteArray::fromHex("0000000400000000"),            // truncated ip6
+        QByteArray::fromHex("00000003056578616d"),          // truncated domain name
+        QByteArray::fromHex("00000003000050"),              // empty domain name
+    };
+    for (const QByteArray &arr : cases)
+    {
+        QVERIFY2(!parseSocksUdpHeader(arr.constData(), arr.size(), h), arr.toHex().constData());
+    }
+}
+
+void TestSocksUdpRelay::testWriteHeader()
+{
+    const sockaddr_in addr = loopback(5353);
+    char buf[kMaxSocksUdpHeaderSize + 4];
+    memcpy(buf + kMaxSocksUdpHeaderSize, "data", 4);
+    const size_t size = writeSocksUdpHeaderBefore((const sockaddr *)&addr, buf + kMaxSocksUdpHeaderSize);
+    QCOMPARE(size, (size_t)10);
+
+    SocksUdpHeader h;
+    QVERIFY(parseSocksUdpHeader(buf + kMaxSocksUdpHeaderSize - size, size + 4, h));
+    QCOMPARE(h.port, (unsigned short)5353);
+    QCOMPARE(h.size, size);
+    QCOMPARE(memcmp(&((sockaddr_in *)&h.addr)->sin_addr, &addr.sin_addr, 4), 0);
+}
+
+void TestSocksUdpRelay::testEcho()
+{
+    SocksUdpRelay relay([](const std::string &) {});
+    sockaddr_storage relayAddr;
+    startRelay(relay, relayAddr);
+
+    udp_socket_t client = openClient();
+    sendTo(client, header(echoAddr_) + "hello", relayAddr);
+    QVERIFY(pump(relay, client, 2000));
+
+    sockaddr_in from;
+    const QByteArray answer = receive(client, &from);
+    QCOMPARE(from.sin_port, ((sockaddr_in *)&relayAddr)->sin_port);
+    QCOMPARE(answer, header(echoAddr_) + "hello");
+    QCOMPARE(relay.stats().toExternal, (quint64)1);
+    QCOMPARE(relay.stats().toClient, (quint64)1);
+    QCOMPARE(relay.stats().dropped, (quint64)0);
+    closeSocket(client);
+}
+
+void TestSocksUdpRelay::testBatch()
+{
+    SocksUdpRelay relay([](const std::string &) {});
+    sockaddr_storage relayAddr;
+    startRelay(relay, relayAddr);
+
+    udp_socket_t client = openClient();
+    const int count = SocksUdpRelay::kBatchSize * 3 + 5;
+    for (int i = 0; i < count; ++i)
+    {
+        sendTo(client, header(echoAddr_) + QByteArray::number(i), relayAddr);
+    }
+
+    QSet<QByteArray> answers;
+    while (answers.size() < count && pump(relay, client, 2000))
+    {
+        answers.insert(receive(client).mid(10));
+    }
+    QCOMPARE(answers.size(), count);
+    QVERIFY(answers.contains(QByteArray::number(count - 1)));
+    QCOMPARE(relay.stats().toExternal, (quint64)count);
+    closeSocket(client);
+}
+
+void TestSocksUdpRelay::testDomainName()
+{
+    std::vector<std::string> requested;
+    SocksUdpRelay relay([&requested](const std::string &domain) { requested.push_back(domain); });
+    sockaddr_storage relayAddr;
+    startRelay(relay, relayAddr);
+
+    udp_socket_t client = openClient();
+    QByteArray domainHeader = QByteArray::fromHex("0000000309") + "localhost";
+    domainHeader.append((const char *)&echoAddr_.sin_port, 2);
+    sendTo(client, domainHeader + "first", relayAddr);
+    sendTo(client, domainHeader + "second", relayAddr);
+    QVERIFY(!pump(relay, client, 200));
+    QCOMPARE(requested.size(), (size_t)1);
+    QCOMPARE(requested[0], std::string("localhost"));
+
+    // the waiting datagrams are sent once resolved, the next ones use the result
+    const sockaddr_in resolved = loopback(0);
+    relay.setResolved("localhost", (const sockaddr *)&resolved);
+    sendTo(client, domainHeader + "third", relayAddr);
+
+    QStringList answers;
+    while (answers.size() < 3 && pump(relay, client, 2000))
+    {
+        QByteArray answer = receive(client);
+        QCOMPARE(answer.left(10), header(echoAddr_));
+        answers << QString::fromLatin1(answer.mid(10));
+    }
+    answers.sort();
+    QCOMPARE(answers, QStringList({ "first", "second", "third" }));
+    QCOMPARE(requested.size(), (size_t)1);
+    closeSocket(client);
+}
+
+void TestSocksUdpRelay::testFragmentDropped()
+{
+    SocksUdpRelay relay([](const std::string &) {});
+    sockaddr_storage relayAddr;
+    startRelay(relay, relayAddr);
+
+    udp_socket_t client = openClient();
+    QByteArray fragment = header(echoAddr_) + "fragment";
+    fragment[2] = 0x01;
+    sendTo(client, fragment, relayAddr);
+    QVERIFY(!pump(relay, client, 300));
+    QCOMPARE(relay.stats().dropped, (quint64)1);
+    QCOMPARE(relay.stats().toExternal, (quint64)0);
+    closeSocket(client);
+}
+
+void TestSocksUdpRelay::testOtherClientDropped()
+{
+    udp_socket_t client = openClient();
+    sockaddr_in clientAddr;
+    socklen_t len = sizeof(clientAddr);
+    getsockname(client, (sockaddr *)&clientAddr, &len);
+
+    // the source port was given in the request, another port of the host is not the client
+    SocksUdpRelay relay([](const std::string &) {});
+    sockaddr_storage relayAddr;
+    startRelay(relay, relayAddr, ntohs(clientAddr.sin_port));
+
+    udp_socket_t other = openClient();
+    sendTo(other, header(echoAddr_) + "other", relayAddr);
+    QVERIFY(!pump(relay, other, 300));
+    QCOMPARE(relay.stats().dropped, (quint64)1);
+
+    sendTo(client, header(echoAddr_) + "client", relayAddr);
+    QVERIFY(pump(relay, client, 2000));
+    QCOMPARE(receive(client).mid(10), QByteArray("client"));
+    closeSocket(other);
+    closeSocket(client);
+}
+
+void TestSocksUdpRelay::testUnknownSourceDropped()
+{
+    SocksUdpRelay relay([](const std::string &) {});
+    sockaddr_storage relayAddr;
+    startRelay(relay, relayAddr);
+
+    udp_socket_t client = openClient();
+    sendTo(client, header(echoAddr_) + "hello", relayAddr);
+    QVERIFY(pump(relay, client, 2000));
+    receive(client);
+
+    // a host the client has not sent to can't reach it through the external socket
+    sockaddr_storage externalAddr;
+    socklen_t len = sizeof(externalAddr);
+    udp_socket_t externalSocket = kInvalidUdpSocket;
+    for (udp_socket_t s : relay.sockets())
+    {
+        len = sizeof(externalAddr);
+        if (getsockname(s, (sockaddr *)&externalAddr, &len) == 0 && externalAddr.ss_family == AF_INET &&
+            ((sockaddr_in *)&externalAddr)->sin_port != ((sockaddr_in *)&relayAddr)->sin_port)
+        {
+            externalSocket = s;
+            break;
+        }
+    }
+    QVERIFY(externalSocket != kInvalidUdpSocket);
+    ((sockaddr_in *)&externalAddr)->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    udp_socket_t stranger = openClient();
+    sendTo(stranger, "unsolicited", externalAddr);
+    QVERIFY(!pump(relay, client, 300));
+    QCOMPARE(relay.stats().dropped, (quint64)1);
+    QCOMPARE(relay.stats().toClient, (quint64)1);
+    closeSocket(stranger);
+    closeSocket(client);
+}
+
+QTEST_GUILESS_MAIN(TestSocksUdpRelay)
+#include "socksudprelay.test.moc"
@@ -0,0 +1,364 @@
+// Compares the completion latency of concurrent HTTPS requests for two curl multi loop implementations:
+//   - asio: the current CurlNetworkManager driven by the wsnet executor (CURLMOPT_SOCKETFUNCTION/CURLMOPT_TIMERFUNCTION);
+//   - legacy: a reproduction of the previous implementation, a dedicated thread with a condition variable,
+//     a mutex around the request bookkeeping and curl_multi_poll with the 1 second timeout.
+// The requests go to a loopback HTTPS server with a self-signed certificate generated at startup.
+//
+// Usage: curlloop_benchmark [requests_count]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <future>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include <curl/curl.h>
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+#include <spdlog/spdlog.h>
+#ifndef _WIN32
+    #include <sys/resource.h>
+#endif
+
+#include "httpnetworkmanager/curlnetworkmanager.h"
+#include "httpnetworkmanager/httprequest.h"
+
+using namespace wsnet;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+const std::uint32_t kTimeoutMs = 30000;
+const std::size_t kServerThreads = 2;
+
+// Minimal HTTPS server answering "ok" to any request and closing the connection
+class LoopbackHttpsServer
+{
+public:
+    LoopbackHttpsServer() : sslContext_(boost::asio::ssl::context::tls_server), acceptor_(io_context_)
+    {
+        generateCertificate();
+        boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::make_address("127.0.0.1"), 0);
+        acceptor_.open(endpoint.protocol());
+        acceptor_.set_option(boost::asio::socket_base::reuse_address(true));
+        acceptor_.bind(endpoint);
+        acceptor_.listen(boost::asio::socket_base::max_listen_connections);
+        accept();
+        for (std::size_t i = 0; i < kServerThreads; ++i)
+            threads_.emplace_back([this] { io_context_.run(); });
+    }
+
+    ~LoopbackHttpsServer()
+    {
+        io_context_.stop();
+        for (auto &thread : threads_)
+            thread.join();
+    }
+
+    std::uint16_t port() const { return acceptor_.local_endpoint().port(); }
+
+private:
+    typedef boost::asio::ssl::stream<boost::asio::ip::tcp::socket> SslStream;
+
+    boost::asio::io_context io_context_;
+    boost::asio::ssl::context sslContext_;
+    boost::asio::ip::tcp::acceptor acceptor_;
+    std::vector<std::thread> threads_;
+
+    void generateCertificate()
+    {
+        EVP_PKEY *key = EVP_EC_gen("P-256");
+        X509 *cert = X509_new();
+        ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+        X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+        X509_gmtime_adj(X509_getm_notAfter(cert), 24 * 3600);
+        X509_set_pubkey(cert, key);
+        X509_NAME *name = X509_get_subject_name(cert);
+        X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char *)"localhost", -1, -1, 0);
+        X509_set_issuer_name(cert, name);
+        X509_sign(cert, key, EVP_sha256());
+
+        SSL_CTX_use_certificate(sslContext_.native_handle(), cert);
+        SSL_CTX_use_PrivateKey(sslContext_.native_handle(), key);
+        X509_free(cert);
+        EVP_PKEY_free(key);
+    }
+
+    void accept()
+    {
+        acceptor_.async_accept([this](const boost::system::error_code &ec, boost::asio::ip::tcp::socket socket) {
+            if (ec)
+                return;
+            auto stream = std::make_shared<SslStream>(std::move(socket), sslContext_);
+            stream->async_handshake(boost::asio::ssl::stream_base::server, [this, stream](const boost::system::error_code &ec) {
+                if (!ec)
+                    readRequest(stream);
+            });
+            accept();
+        });
+    }
+
+    void readRequest(const std::shared_ptr<SslStream> &stream)
+    {
+        auto buf = std::make_shared<std::string>();
+        boost::asio::async_read_until(*stream, boost::asio::dynamic_buffer(*buf), "\r\n\r\n",
+                                      [stream, buf](const boost::system::error_code &ec, std::size_t) {
+            if (ec)
+                return;
+            static const std::string response = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\nConnection: close\r\n\r\nok";
+            boost::asio::async_write(*stream, boost::asio::buffer(response), [stream](const boost::system::error_code &, std::size_t) {
+                stream->async_shutdown([stream](const boost::system::error_code &) {});
+            });
+        });
+    }
+};
+
+// Reproduction of the previous CurlNetworkManager loop with the same per-request options
+class LegacyCurlLoop
+{
+public:
+    explicit LegacyCurlLoop(std::function<void(std::uint64_t id, bool isSuccess)> finishedCallback) :
+        finishedCallback_(finishedCallback), multiHandle_(curl_multi_init())
+    {
+        thread_ = std::thread(std::bind(&LegacyCurlLoop::run, this));
+    }
+
+    ~LegacyCurlLoop()
+    {
+        finish_ = true;
+        condition_.notify_all();
+        curl_multi_wakeup(multiHandle_);
+        thread_.join();
+        for (auto &it : activeRequests_) {
+            if (it.second.isAddedToMultiHandle)
+                curl_multi_remove_handle(multiHandle_, it.second.curlEasyHandle);
+            curl_easy_cleanup(it.second.curlEasyHandle);
+            curl_slist_free_all(it.second.hosts);
+        }
+        curl_multi_cleanup(multiHandle_);
+    }
+
+    void executeRequest(std::uint64_t id, const std::string &url, const std::string &resolve)
+    {
+        RequestInfo ri;
+        ri.curlEasyHandle = curl_easy_init();
+        ri.hosts = curl_slist_append(NULL, resolve.c_str());
+        curl_easy_setopt(ri.curlEasyHandle, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(ri.curlEasyHandle, CURLOPT_WRITEFUNCTION, writeDataCallback);
+        curl_easy_setopt(ri.curlEasyHandle, CURLOPT_ACCEPT_ENCODING, "");
+        curl_easy_setopt(ri.curlEasyHandle, CURLOPT_FRESH_CONNECT, 1L);
+        curl_easy_setopt(ri.curlEasyHandle, CURLOPT_FORBID_REUSE, 1L);
+        curl_easy_setopt(ri.curlEasyHandle, CURLOPT_CONNECTTIMEOUT_MS, kTimeoutMs);
+        curl_easy_setopt(ri.curlEasyHandle, CURLOPT_RESOLVE, ri.hosts);
+        curl_easy_setopt(ri.curlEasyHandle, CURLOPT_SSL_VERIFYPEER, 0L);
+        curl_easy_setopt(ri.curlEasyHandle, CURLOPT_SSL_VERIFYHOST, 0L);
+        curl_easy_setopt(ri.curlEasyHandle, CURLOPT_PRIVATE, new std::uint64_t(id));
+
+        std::lock_guard locker(mutex_);
+        activeRequests_[id] = ri;
+        condition_.notify_all();
+        curl_multi_wakeup(multiHandle_);
+    }
+
+private:
+    struct RequestInfo {
+        CURL *curlEasyHandle = nullptr;
+        struct curl_slist *hosts = nullptr;
+        bool isAddedToMultiHandle = false;
+    };
+
+    std::function<void(std::uint64_t id, bool isSuccess)> finishedCallback_;
+    CURLM *multiHandle_;
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::atomic_bool finish_ = false;
+    std::map<std::uint64_t, RequestInfo> activeRequests_;
+
+    static size_t writeDataCallback(void *, size_t size, size_t count, void *) { return size * count; }
+
+    void run()
+    {
+        while (!finish_) {
+            {
+                std::unique_lock<std::mutex> locker(mutex_);
+                while (activeRequests_.empty() && !finish_)
+                    condition_.wait(locker);
+            }
+            if (finish_)
+                break;
+
+            {
+                std::lock_guard locker(mutex_);
+                for (auto &it : activeRequests_) {
+                    if (!it.second.isAddedToMultiHandle) {
+                        curl_multi_add_handle(multiHandle_, it.second.curlEasyHandle);
+                        it.second.isAddedToMultiHandle = true;
+                    }
+                }
+            }
+
+            int stillRunning;
+            curl_multi_perform(multiHandle_, &stillRunning);
+            struct CURLMsg *curlMsg = nullptr;
+            do {
+                int msgq = 0;
+                curlMsg = curl_multi_info_read(multiHandle_, &msgq);
+                if (curlMsg && (curlMsg->msg == CURLMSG_DONE)) {
+                    CURL *curlEasyHandle = curlMsg->easy_handle;
+                    CURLcode result = curlMsg->data.result;
+                    std::uint64_t *pointerId;
+                    curl_easy_getinfo(curlEasyHandle, CURLINFO_PRIVATE, &pointerId);
+                    curl_multi_remove_handle(multiHandle_, curlEasyHandle);
+
+                    std::uint64_t id = *pointerId;
+                    {
+                        std::lock_guard locker(mutex_);
+                        auto it = activeRequests_.find(id);
+                        curl_easy_cleanup(it->second.curlEasyHandle);
+                        curl_slist_free_all(it->second.hosts);
+                        activeRequests_.erase(it);
+                    }
+                    delete pointerId;
+                    finishedCallback_(id, result == CURLE_OK);
+                }
+            } while (curlMsg);
+
+            curl_multi_poll(multiHandle_, NULL, 0, 1000, NULL);
+        }
+    }
+};
+
+struct Results
+{
+    std::vector<double> latenciesMs;
+    std::size_t failedCount = 0;
+    double totalMs = 0;
+};
+
+void printResults(const char *name, Results &results)
+{
+    std::sort(results.latenciesMs.begin(), results.latenciesMs.end());
+    auto percentile = [&results](double p) {
+        if (results.latenciesMs.empty())
+            return 0.0;
+        std::size_t ind = std::min(results.latenciesMs.size() - 1, (std::size_t)(p * results.latenciesMs.size()));
+        return results.latenciesMs[ind];
+    };
+    printf("%-8s ok: %zu, failed: %zu, p50: %.1f ms, p99: %.1f ms, total: %.1f ms\n", name, results.latenciesMs.size(),
+           results.failedCount, percentile(0.5), percentile(0.99), results.totalMs);
+}
+
+Results runAsioLoop(std::uint16_t port, std::size_t count)
+{
+    Results results;
+    ExecutorPool pool(1);
+    ComponentExecutor executor = pool.makeExecutor("CurlNetworkManager");
+    std::promise<void> finished;
+    std::vector<Clock::time_point> startTimes(count);
+    std::size_t finishedCount = 0;
+    Clock::time_point start;
+
+    auto onFinished = [&](std::uint64_t id, bool isSuccess, const std::string &) {
+        if (isSuccess)
+            results.latenciesMs.push_back(std::chrono::duration<double, std::milli>(Clock::now() - startTimes[id]).count());
+        else
+            results.failedCount++;
+        if (++finishedCount == count) {
+            results.totalMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            finished.set_value();
+        }
+    };
+
+    CurlNetworkManager curlNetworkManager(executor, onFinished, [](std::uint64_t, std::uint64_t, std::uint64_t) {},
+                                          [](std::uint64_t, const std::string &) {});
+    if (!curlNetworkManager.init())
+        return results;
+
+    std::string url = "https://localhost:" + std::to_string(port) + "/";
+    boost::asio::post(executor, [&] {
+        start = Clock::now();
+        for (std::size_t i = 0; i < count; ++i) {
+            auto request = std::make_shared<HttpRequest>(url, kTimeoutMs, HttpMethod::kGet, true);
+            startTimes[i] = Clock::now();
+            curlNetworkManager.executeRequest(i, request, { "127.0.0.1" }, kTimeoutMs);
+        }
+    });
+    finished.get_future().wait();
+    pool.stop();
+    return results;
+}
+
+Results runLegacyLoop(std::uint16_t port, std::size_t count)
+{
+    Results results;
+    std::vector<Clock::time_point> startTimes(count);
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::size_t finishedCount = 0;
+
+    {
+        LegacyCurlLoop loop([&](std::uint64_t id, bool isSuccess) {
+            std::lock_guard locker(mutex);
+            if (isSuccess)
+                results.latenciesMs.push_back(std::chrono::duration<double, std::milli>(Clock::now() - startTimes[id]).count());
+            else
+                results.failedCount++;
+            if (++finishedCount == count)
+                condition.notify_all();
+        });
+
+        std::string url = "https://localhost:" + std::to_string(port) + "/";
+        std::string resolve = "localhost:" + std::to_string(port) + ":127.0.0.1";
+        auto start = Clock::now();
+        for (std::size_t i = 0; i < count; ++i) {
+            {
+                std::lock_guard locker(mutex);
+                startTimes[i] = Clock::now();
+            }
+            loop.executeRequest(i, url, resolve);
+        }
+
+        std::unique_lock<std::mutex> locker(mutex);
+        condition.wait(locker, [&] { return finishedCount == count; });
+        results.totalMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+    return results;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    std::size_t count = argc > 1 ? std::stoul(argv[1]) : 1000;
+    spdlog::set_level(spdlog::level::warn);
+
+#ifndef _WIN32
+    // both ends of every connection live in this process
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+#endif
+
+    LoopbackHttpsServer server;
+    printf("%zu concurrent requests to https://localhost:%u\n", count, server.port());
+
+    // CurlNetworkManager does the global curl initialization, so it runs first
+    Results asioResults = runAsioLoop(server.port(), count);
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    Results legacyResults = runLegacyLoop(server.port(), count);
+    curl_global_cleanup();
+
+    printResults("asio", asioResults);
+    printResults("legacy", legacyResults);
+    return 0;
+}
@@ -0,0 +1,144 @@
+// Compares the PersistentSettings formats on a realistic set of values (a large server list, openvpn config, etc.):
+//   - legacy: one JSON document with the values as escaped strings, fully parsed at startup and fully serialized on save
+//     (a reproduction of the previous implementation);
+//   - records: the current PersistentSettings, one raw record per key, indexed on the first access and updated in place.
+// Measures the startup (load and get the auth hash, then the server list) and the save after a small change.
+//
+// Usage: persistentsettings_benchmark [iterations]
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <rapidjson/document.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+#include <spdlog/spdlog.h>
+
+#include "utils/persistentsettings.h"
+
+using namespace wsnet;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+const char *kLegacyKeys[] = { "flvId", "authHash", "sessionStatus", "locations", "serverCredentialsOvpn", "serverCredentialsIkev2",
+                              "serverConfigs", "portMap", "staticIps", "notifications" };
+const std::size_t kKeysCount = sizeof(kLegacyKeys) / sizeof(kLegacyKeys[0]);
+typedef std::array<std::string, kKeysCount> Values;
+
+std::string makeJsonArray(const std::string &item, std::size_t targetSize)
+{
+    std::string result = "{\"data\":[";
+    for (int i = 0; result.size() < targetSize; ++i)
+        result += (i ? "," : "") + item;
+    return result + "]}";
+}
+
+Values makeValues()
+{
+    Values values;
+    values[0] = "300fa426-4640-4a3f-b95c-1f0277462358";
+    values[1] = std::string(180, 'a');
+    values[2] = makeJsonArray("{\"status\":1,\"is_premium\":1,\"traffic_used\":123456,\"user_id\":\"abcdef\"}", 1024);
+    values[3] = makeJsonArray("{\"id\":12,\"name\":\"Canada East\",\"country_code\":\"CA\",\"groups\":[{\"id\":1,\"city\":\"Montreal\","
+                              "\"nick\":\"Bagel Poutine\",\"pro\":0,\"hosts\":[{\"hostname\":\"ca-001.windscribe.com\",\"ip\":\"1.2.3.4\"}]}]}", 600 * 1024);
+    values[4] = makeJsonArray("{\"username\":\"user\",\"password\":\"password\"}", 256);
+    values[5] = values[4];
+    values[6] = std::string("client\ndev tun\nproto udp\n<ca>\n") + std::string(40 * 1024, 'c') + "\n</ca>\n";
+    values[7] = makeJsonArray("{\"heading\":\"UDP\",\"use\":\"udp\",\"ports\":[\"443\",\"80\",\"53\"]}", 8 * 1024);
+    values[8] = makeJsonArray("{\"name\":\"Toronto\",\"ip\":\"1.2.3.4\",\"static_ip\":\"5.6.7.8\"}", 4 * 1024);
+    values[9] = makeJsonArray("{\"id\":1,\"title\":\"News\",\"message\":\"<p>Some \\\"quoted\\\" html</p>\"}", 24 * 1024);
+    return values;
+}
+
+std::string legacySerialize(const Values &values)
+{
+    using namespace rapidjson;
+    Document doc;
+    doc.SetObject();
+    doc.AddMember("version", 1, doc.GetAllocator());
+    for (std::size_t i = 0; i < kKeysCount; ++i)
+        doc.AddMember(StringRef(kLegacyKeys[i]), StringRef(values[i].c_str()), doc.GetAllocator());
+    StringBuffer sb;
+    Writer<StringBuffer> writer(sb);
+    doc.Accept(writer);
+    return sb.GetString();
+}
+
+Values legacyLoad(const std::string &settings)
+{
+    using namespace rapidjson;
+    Values values;
+    Document doc;
+    doc.Parse(settings.c_str());
+    auto jsonObject = doc.GetObj();
+    for (std::size_t i = 0; i < kKeysCount; ++i)
+        values[i] = jsonObject[kLegacyKeys[i]].GetString();
+    return values;
+}
+
+template<typename F>
+double medianMs(int iterations, F f)
+{
+    std::vector<double> times;
+    for (int i = 0; i < iterations; ++i) {
+        auto start = Clock::now();
+        f(i);
+        times.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    int iterations = argc > 1 ? std::stoi(argv[1]) : 50;
+    spdlog::set_level(spdlog::level::warn);
+
+    Values values = makeValues();
+    std::string legacySettings = legacySerialize(values);
+
+    // the legacy JSON is converted to the records format by the constructor
+    PersistentSettings converted(legacySettings);
+    std::string recordsSettings = converted.getAsString();
+    printf("size: legacy %zu bytes, records %zu bytes\n", legacySettings.size(), recordsSettings.size());
+
+    std::size_t checksum = 0;
+    double legacyAuthHash = medianMs(iterations, [&](int) {
+        Values loaded = legacyLoad(legacySettings);
+        checksum += loaded[1].size();
+    });
+    double recordsAuthHash = medianMs(iterations, [&](int) {
+        PersistentSettings settings(recordsSettings);
+        checksum += settings.authHash().size();
+    });
+    double legacyLocations = medianMs(iterations, [&](int) {
+        Values loaded = legacyLoad(legacySettings);
+        checksum += loaded[1].size() + loaded[3].size();
+    });
+    double recordsLocations = medianMs(iterations, [&](int) {
+        PersistentSettings settings(recordsSettings);
+        checksum += settings.authHash().size() + settings.locations().size();
+    });
+
+    double legacySave = medianMs(iterations, [&](int i) {
+        values[0] = std::to_string(i);
+        checksum += legacySerialize(values).size();
+    });
+    PersistentSettings settings(recordsSettings);
+    double recordsSave = medianMs(iterations, [&](int i) {
+        settings.setFailovedId(std::to_string(i));
+        checksum += settings.getAsString().size();
+    });
+
+    printf("%-40s legacy %8.3f ms, records %8.3f ms\n", "startup, authHash():", legacyAuthHash, recordsAuthHash);
+    printf("%-40s legacy %8.3f ms, records %8.3f ms\n", "startup, authHash() and locations():", legacyLocations, recordsLocations);
+    printf("%-40s legacy %8.3f ms, records %8.3f ms\n", "save after setFailovedId():", legacySave, recordsSave);
+    printf("(checksum %zu)\n", checksum);
+    return 0;
+}
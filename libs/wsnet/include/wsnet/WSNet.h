@@ -24,6 +24,10 @@ public:
     // set debugLog to true for more verbose log output
     static void setLogger(WSNetLoggerFunction loggerFunction, bool debugLog);
 
+    // the number of threads executing the library tasks, must be called before initialize()
+    // 0 (by default) means the number of CPU cores, but not less than 2 and not more than 4
+    static void setThreadsCount(std::uint32_t threadsCount);
+
     // basePlatform value can be "windows", "mac", "linux", "android", "ios"
     // platformName and appVersion values are added to each request.
     // difference between basePlatform and platformName is that platformName is more specific (for example windows_arm64/windows).
@@ -41,6 +45,12 @@ public:
     virtual void setIsConnectedToVpnState(bool isConnected) = 0;
 
     virtual std::string currentPersistentSettings() = 0;
+    // true if the persistent settings have changed since the last currentPersistentSettings() call (or initialize()),
+    // the caller can skip saving them otherwise
+    virtual bool isPersistentSettingsChanged() = 0;
+
+    // per-component counters of the library executor (queue depth, handler wait and run times) in JSON format
+    virtual std::string executorStats() = 0;
 
     virtual std::shared_ptr<WSNetDnsResolver> dnsResolver() = 0;
     virtual std::shared_ptr<WSNetHttpNetworkManager> httpNetworkManager() = 0;
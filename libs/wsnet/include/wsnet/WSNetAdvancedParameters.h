@@ -23,6 +23,11 @@ public:
 
     virtual void setLogApiResponce(bool isEnabled) = 0;
     virtual bool isLogApiResponce() const = 0;
+
+    // race the failovers ("happy eyeballs"): start the next failover after a short delay without waiting
+    // for the previous one to time out, the first successful one is used
+    virtual void setFailoverRacing(bool isEnabled) = 0;
+    virtual bool isFailoverRacing() const = 0;
 };
 
 } // namespace wsnet
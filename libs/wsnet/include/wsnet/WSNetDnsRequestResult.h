@@ -16,6 +16,8 @@ public:
     virtual std::uint32_t elapsedMs() = 0;
     virtual bool isError() = 0;
     virtual std::string errorString() = 0;
+    // in seconds, the minimum TTL of the answers, for an error the time it can be cached
+    virtual std::uint32_t ttl() = 0;
 };
 
 } // namespace wsnet
@@ -75,6 +75,12 @@ public:
     // this callback function must return control after the firewall is configured
     // you can pass null to disable the callback function
     virtual std::shared_ptr<WSNetCancelableCallback> setWhitelistSocketsCallback(WSNetHttpNetworkManagerWhitelistSocketsCallback whitelistSocketsCallback) = 0;
+
+    // false by default
+    // if enabled, connections and TLS sessions are reused between requests and HTTP/2 is negotiated so that concurrent requests
+    // to the same host are multiplexed over one connection. Pooled connections are dropped when the connectivity/VPN state
+    // or the whitelist callbacks change.
+    virtual void setConnectionPoolEnabled(bool isEnabled) = 0;
 };
 
 } // namespace wsnet
@@ -13,6 +13,7 @@ namespace wsnet {
 enum class PingType { kHttp = 0, kIcmp };
 
 typedef std::function<void(const std::string &ip, bool isSuccess, std::int32_t timeMs, bool isFromDisconnectedVpnState)> WSNetPingCallback;
+typedef std::function<void(std::uint32_t successCount, std::uint32_t failedCount)> WSNetPingBatchFinishedCallback;
 
 // Useful for testing and debugging purposes
 class WSNetPingManager : public scapix_object<WSNetPingManager>
@@ -25,6 +26,15 @@ public:
     // pingType: 0 - HTTP, 1 - ICMP
     virtual std::shared_ptr<WSNetCancelableCallback> ping(const std::string &ip, const std::string &hostname,
                                                           PingType pingType, WSNetPingCallback callback) = 0;
+
+    // Pings a set of targets as one job, the number of pings in flight is adjusted automatically based on observed loss and RTT.
+    // ips - required
+    // hostnames - optional for http ping, either empty or of the same size as ips
+    // callback is called as soon as each ping completes, finishedCallback is called once after the last one.
+    // Canceling the returned object cancels the whole batch, pending targets are not pinged.
+    virtual std::shared_ptr<WSNetCancelableCallback> pingBatch(const std::vector<std::string> &ips, const std::vector<std::string> &hostnames,
+                                                               PingType pingType, WSNetPingCallback callback,
+                                                               WSNetPingBatchFinishedCallback finishedCallback) = 0;
 };
 
 } // namespace wsnet
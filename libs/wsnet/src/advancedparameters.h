@@ -54,12 +54,24 @@ public:
         return isLogApiResponce_;
     }
 
+    void setFailoverRacing(bool isEnabled) override
+    {
+        std::lock_guard locker(mutex_);
+        isFailoverRacing_ = isEnabled;
+    }
+    bool isFailoverRacing() const override
+    {
+        std::lock_guard locker(mutex_);
+        return isFailoverRacing_;
+    }
+
 private:
     mutable std::mutex mutex_;
     bool isAPIExtraTLSPadding_ = false;
     bool isIgnoreCountryOverride_ = false;
     std::string countryOverrideValue_;
     bool isLogApiResponce_ = false;
+    bool isFailoverRacing_ = false;
 };
 
 } // namespace wsnet
@@ -8,10 +8,10 @@ namespace wsnet {
 
 using namespace std::chrono;
 
-ApiResourcesManager::ApiResourcesManager(boost::asio::io_context &io_context, WSNetServerAPI *serverAPI, PersistentSettings &persistentSettings, ConnectState &connectState) :
-    io_context_(io_context),
-    loginTimer_(io_context, boost::asio::chrono::seconds(1)),
-    fetchTimer_(io_context, boost::asio::chrono::seconds(1)),
+ApiResourcesManager::ApiResourcesManager(const ComponentExecutor &executor, WSNetServerAPI *serverAPI, PersistentSettings &persistentSettings, ConnectState &connectState) :
+    executor_(executor),
+    loginTimer_(executor, boost::asio::chrono::seconds(1)),
+    fetchTimer_(executor, boost::asio::chrono::seconds(1)),
     serverAPI_(serverAPI),
     persistentSettings_(persistentSettings),
     connectState_(connectState)
@@ -78,7 +78,7 @@ bool ApiResourcesManager::loginWithAuthHash()
             startLoginTime_ = std::chrono::steady_clock::now();
         } else {
             if (utils::since(*startLoginTime_).count() > kWaitTimeForNoNetwork) {
-                boost::asio::post(io_context_, [this] {
+                boost::asio::post(executor_, [this] {
                     std::lock_guard locker(mutex_);
                     callback_->call(ApiResourcesManagerNotification::kLoginFailed, LoginResult::kNoConnectivity, std::string());
                 });
@@ -113,7 +113,7 @@ void ApiResourcesManager::login(const std::string &username, const std::string &
             startLoginTime_ = std::chrono::steady_clock::now();
         } else {
             if (utils::since(*startLoginTime_).count() > kWaitTimeForNoNetwork) {
-                boost::asio::post(io_context_, [this] {
+                boost::asio::post(executor_, [this] {
                     std::lock_guard locker(mutex_);
                     callback_->call(ApiResourcesManagerNotification::kLoginFailed, LoginResult::kNoConnectivity, std::string());
                 });
@@ -573,7 +573,7 @@ void ApiResourcesManager::onInitialSessionAnswer(ServerApiRetCode serverApiRetCo
     requestsInProgress_.erase(RequestType::kSessionStatus);
     if (serverApiRetCode == ServerApiRetCode::kNetworkError) {
         // repeat the request
-        boost::asio::post(io_context_, [this] {
+        boost::asio::post(executor_, [this] {
             loginWithAuthHash();
         });
     } else {
@@ -587,7 +587,7 @@ void ApiResourcesManager::onLoginAnswer(ServerApiRetCode serverApiRetCode, const
     requestsInProgress_.erase(RequestType::kSessionStatus);
     if (serverApiRetCode == ServerApiRetCode::kNetworkError) {
         // repeat the request
-        boost::asio::post(io_context_, [this, username, password, code2fa] {
+        boost::asio::post(executor_, [this, username, password, code2fa] {
             login(username, password, code2fa);
         });
     } else {
@@ -2,6 +2,7 @@
 
 #include "WSNetApiResourcesManager.h"
 #include <boost/asio.hpp>
+#include "utils/executorpool.h"
 #include <optional>
 #include "WSNetServerAPI.h"
 #include "connectstate.h"
@@ -16,7 +17,7 @@ enum class RequestType { kSessionStatus, kLocations, kServerCredentialsOpenVPN,
 class ApiResourcesManager : public WSNetApiResourcesManager
 {
 public:
-    explicit ApiResourcesManager(boost::asio::io_context &io_context, WSNetServerAPI *serverAPI, PersistentSettings &persistentSettings, ConnectState &connectState);
+    explicit ApiResourcesManager(const ComponentExecutor &executor, WSNetServerAPI *serverAPI, PersistentSettings &persistentSettings, ConnectState &connectState);
     virtual ~ApiResourcesManager();
 
     std::shared_ptr<WSNetCancelableCallback> setCallback(WSNetApiResourcesManagerCallback callback) override;
@@ -62,7 +63,7 @@ private:
     mutable std::mutex mutex_;
     std::shared_ptr<CancelableCallback<WSNetApiResourcesManagerCallback>> callback_ = nullptr;
 
-    boost::asio::io_context &io_context_;
+    ComponentExecutor executor_;
     boost::asio::steady_timer loginTimer_;
     boost::asio::steady_timer fetchTimer_;
     WSNetServerAPI *serverAPI_;
@@ -1,6 +1,7 @@
 #define CARES_NO_DEPRECATED     // Someday remove this and replace the functions with the new c-ares interface
 #include <ares.h>
 #include "dnsresolver_cares.h"
+#include <algorithm>
 #include <assert.h>
 #include <spdlog/spdlog.h>
 #include "utils/utils.h"
@@ -224,6 +225,7 @@ void DnsResolver_cares::caresCallback(void *arg, int status, int timeouts, struc
 
     std::shared_ptr<DnsRequestResult> result = std::make_shared<DnsRequestResult>();
     if (status == ARES_SUCCESS) {
+        bool isTtlSet = false;
         for (struct ares_addrinfo_node *node = results->nodes; node != NULL; node = node->ai_next) {
             char addr_buf[46] = "??";
             if (node->ai_family == AF_INET) {
@@ -234,11 +236,18 @@ void DnsResolver_cares::caresCallback(void *arg, int status, int timeouts, struc
                 continue;
             }
             result->ips_.push_back(addr_buf);
+            std::uint32_t ttl = (std::uint32_t)std::max(node->ai_ttl, 0);
+            result->ttl_ = isTtlSet ? std::min(result->ttl_, ttl) : ttl;
+            isTtlSet = true;
         }
         result->isError_ = false;
     } else {
         result->errorString_ = ares_strerror(status);
         result->isError_ = true;
+        if (status == ARES_ENOTFOUND || status == ARES_ENODATA)
+            result->ttl_ = kNotFoundTtl;
+        else if (status != ARES_ECANCELLED)    // canceled due to the DNS servers change, nothing to cache
+            result->ttl_ = kFailureTtl;
     }
 
     result->elapsedMs_ = (unsigned int)utils::since(pars->qi.startTime).count();
@@ -37,6 +37,9 @@ private:
 
     static constexpr int kTimeoutMs = 2000;  // default value in c-ares, let's leave it as it is
     static constexpr int kTries = 2; // the number of tries the resolver will try contacting each name server before giving up.
+    // c-ares does not provide the SOA minimum for the failed queries, so use fixed TTLs for them
+    static constexpr std::uint32_t kNotFoundTtl = 30;   // NXDOMAIN or no records of the requested family
+    static constexpr std::uint32_t kFailureTtl = 5;     // timeouts, refused queries and other failures
 
     struct QueueItem
     {
@@ -60,11 +63,13 @@ private:
         std::uint32_t elapsedMs() override { return elapsedMs_; }
         bool isError() override { return isError_; }
         std::string errorString() override { return errorString_; }
+        std::uint32_t ttl() override { return ttl_; }
 
         std::vector<std::string> ips_;
         unsigned int elapsedMs_;
         bool isError_;
         std::string errorString_;
+        std::uint32_t ttl_ = 0;
     };
     AresLibraryInit aresLibraryInit_;
     std::thread thread_;
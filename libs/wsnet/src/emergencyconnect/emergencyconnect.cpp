@@ -13,8 +13,8 @@ CMRC_DECLARE(wsnet);
 
 namespace wsnet {
 
-EmergencyConnect::EmergencyConnect(boost::asio::io_context &io_context, IFailoverContainer *failoverContainer, WSNetDnsResolver *dnsResolver) :
-    io_context_(io_context),
+EmergencyConnect::EmergencyConnect(const ComponentExecutor &executor, IFailoverContainer *failoverContainer, WSNetDnsResolver *dnsResolver) :
+    executor_(executor),
     failoverContainer_(failoverContainer),
     dnsResolver_(dnsResolver)
 {
@@ -56,7 +56,7 @@ std::shared_ptr<WSNetCancelableCallback> EmergencyConnect::getIpEndpoints(WSNetE
 {
 #ifndef FAILOVER_CONTAINER_PUBLIC
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetEmergencyConnectCallback>>(callback);
-    boost::asio::post(io_context_, [this, cancelableCallback] {
+    boost::asio::post(executor_, [this, cancelableCallback] {
         auto failover = failoverContainer_->failoverById(FAILOVER_OLD_RANDOM_DOMAIN_GENERATION);
         assert(failover);
         std::vector<FailoverData> data;
@@ -81,7 +81,7 @@ void EmergencyConnect::onDnsResolved(std::uint64_t requestId, const std::string
 {
 #ifndef FAILOVER_CONTAINER_PUBLIC
 
-    boost::asio::post(io_context_, [this, requestId, hostname, result] {
+    boost::asio::post(executor_, [this, requestId, hostname, result] {
         auto it = dnsRequests_.find(requestId);
         if (it == dnsRequests_.end())
             return;
@@ -2,6 +2,7 @@
 
 #include <map>
 #include <boost/asio.hpp>
+#include "utils/executorpool.h"
 #include "WSNetEmergencyConnect.h"
 #include "WSNetDnsResolver.h"
 #include "failover/ifailovercontainer.h"
@@ -12,7 +13,7 @@ namespace wsnet {
 class EmergencyConnect : public WSNetEmergencyConnect
 {
 public:
-    explicit EmergencyConnect(boost::asio::io_context &io_context, IFailoverContainer *failoverContainer, WSNetDnsResolver *dnsResolver);
+    explicit EmergencyConnect(const ComponentExecutor &executor, IFailoverContainer *failoverContainer, WSNetDnsResolver *dnsResolver);
     virtual ~EmergencyConnect();
 
     std::string ovpnConfig() const override;
@@ -22,7 +23,7 @@ public:
     std::shared_ptr<WSNetCancelableCallback> getIpEndpoints(WSNetEmergencyConnectCallback callback) override;
 
 private:
-    boost::asio::io_context &io_context_;
+    ComponentExecutor executor_;
     IFailoverContainer *failoverContainer_;
     WSNetDnsResolver *dnsResolver_;
 
@@ -20,6 +20,8 @@ public:
     // if data is empty then it is implied that failed
     virtual bool getData(bool bIgnoreSslErrors, std::vector<FailoverData> &data, FailoverCallback callback) = 0;
     virtual std::string name() const = 0;
+    // the data which is known without network requests (e.g. hardcoded domains), used to warm up the DNS cache
+    virtual std::vector<FailoverData> staticData() const { return std::vector<FailoverData>(); }
     std::string uniqueId() const { return uniqueId_; }
 
 protected:
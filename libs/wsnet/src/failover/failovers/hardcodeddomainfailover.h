@@ -18,6 +18,11 @@ public:
         return true;
     }
 
+    std::vector<FailoverData> staticData() const override
+    {
+        return std::vector<FailoverData> { FailoverData(domain_) };
+    }
+
     std::string name() const override
     {
         // the domain name has been reduced to 3 characters for log security
@@ -0,0 +1,45 @@
+#include "curlconnectionpool.h"
+#include <cassert>
+#include <spdlog/spdlog.h>
+
+namespace wsnet {
+
+CurlConnectionPool::CurlConnectionPool()
+{
+    share_ = curl_share_init();
+    if (!share_) {
+        spdlog::error("curl_share_init failed");
+        return;
+    }
+
+    bool isOk = curl_share_setopt(share_, CURLSHOPT_LOCKFUNC, lockCallback) == CURLSHE_OK &&
+                curl_share_setopt(share_, CURLSHOPT_UNLOCKFUNC, unlockCallback) == CURLSHE_OK &&
+                curl_share_setopt(share_, CURLSHOPT_USERDATA, this) == CURLSHE_OK &&
+                curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT) == CURLSHE_OK &&
+                curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION) == CURLSHE_OK;
+    if (!isOk) {
+        spdlog::error("Failed to setup the curl share handle");
+        curl_share_cleanup(share_);
+        share_ = nullptr;
+    }
+}
+
+CurlConnectionPool::~CurlConnectionPool()
+{
+    if (share_) {
+        [[maybe_unused]] CURLSHcode res = curl_share_cleanup(share_);
+        assert(res == CURLSHE_OK);
+    }
+}
+
+void CurlConnectionPool::lockCallback(CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr)
+{
+    static_cast<CurlConnectionPool *>(userptr)->locks_[data].lock();
+}
+
+void CurlConnectionPool::unlockCallback(CURL *handle, curl_lock_data data, void *userptr)
+{
+    static_cast<CurlConnectionPool *>(userptr)->locks_[data].unlock();
+}
+
+} // namespace wsnet
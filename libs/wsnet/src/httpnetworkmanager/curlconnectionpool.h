@@ -0,0 +1,28 @@
+#pragma once
+
+#include <curl/curl.h>
+#include <mutex>
+
+namespace wsnet {
+
+// Connection cache and TLS session cache shared between curl easy handles (CURLSH share handle).
+// The pooled connections are closed when the object is destroyed,
+// so the owner keeps it in a shared_ptr and each request holds a reference while it is using the pool.
+class CurlConnectionPool
+{
+public:
+    CurlConnectionPool();
+    ~CurlConnectionPool();
+
+    bool isValid() const { return share_ != nullptr; }
+    CURLSH *handle() const { return share_; }
+
+private:
+    CURLSH *share_ = nullptr;
+    std::mutex locks_[CURL_LOCK_DATA_LAST];
+
+    static void lockCallback(CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr);
+    static void unlockCallback(CURL *handle, curl_lock_data data, void *userptr);
+};
+
+} // namespace wsnet
@@ -14,17 +14,31 @@
 #endif
 namespace wsnet {
 
-CurlNetworkManager::CurlNetworkManager(CurlFinishedCallback finishedCallback, CurlProgressCallback progressCallback, CurlReadyDataCallback readyDataCallback) :
+CurlNetworkManager::CurlNetworkManager(const ComponentExecutor &executor, CurlFinishedCallback finishedCallback,
+                                       CurlProgressCallback progressCallback, CurlReadyDataCallback readyDataCallback) :
+    executor_(executor),
     finishedCallback_(finishedCallback), progressCallback_(progressCallback), readyDataCallback_(readyDataCallback),
-    finish_(false), multiHandle_(nullptr)
+    multiHandle_(nullptr),
+    timer_(executor)
 {
 }
 
 CurlNetworkManager::~CurlNetworkManager()
 {
-    finish_ = true;
-    condition_.notify_all();
-    thread_.join();
+    timer_.cancel();
+    for (auto it = activeRequests_.begin(); it != activeRequests_.end(); ++it) {
+        curl_multi_remove_handle(multiHandle_, it->second->curlEasyHandle);
+        delete it->second;
+    }
+    activeRequests_.clear();
+
+    // close the pooled connections before the curl global cleanup
+    connectionPool_.reset();
+
+    // curl closes the remaining sockets through curlCloseSocketCallback, so the sockets_ map is still needed here
+    if (multiHandle_)
+        curl_multi_cleanup(multiHandle_);
+    sockets_.clear();
 
     if (isCurlGlobalInitialized_)
         curl_global_cleanup();
@@ -47,7 +61,16 @@ bool CurlNetworkManager::init()
         isCurlGlobalInitialized_ = true;
 
         multiHandle_ = curl_multi_init();
-        thread_ = std::thread(std::bind(&CurlNetworkManager::run, this));
+        if (!multiHandle_) {
+            spdlog::critical("curl_multi_init failed");
+            return false;
+        }
+        curl_multi_setopt(multiHandle_, CURLMOPT_SOCKETFUNCTION, curlMultiSocketCallback);
+        curl_multi_setopt(multiHandle_, CURLMOPT_SOCKETDATA, this);
+        curl_multi_setopt(multiHandle_, CURLMOPT_TIMERFUNCTION, curlMultiTimerCallback);
+        curl_multi_setopt(multiHandle_, CURLMOPT_TIMERDATA, this);
+        // allow HTTP/2 multiplexing for the connection pool mode
+        curl_multi_setopt(multiHandle_, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
     }
     return true;
 }
@@ -71,12 +94,12 @@ void CurlNetworkManager::executeRequest(std::uint64_t requestId, const std::shar
     }
 
     if (requestInfo->curlEasyHandle)  {
-        std::lock_guard locker(mutex_);
         if (setupOptions(requestInfo, request, ips, timeoutMs)) {
             activeRequests_[requestId] = requestInfo;
-            condition_.notify_all();
-            curl_multi_wakeup(multiHandle_);
-            return;
+            // curl reacts with the timer callback, the transfer is started from there
+            if (curl_multi_add_handle(multiHandle_, requestInfo->curlEasyHandle) == CURLM_OK)
+                return;
+            activeRequests_.erase(requestId);
         }
     }
     // if we here then something failed
@@ -86,15 +109,13 @@ void CurlNetworkManager::executeRequest(std::uint64_t requestId, const std::shar
 
 void CurlNetworkManager::cancelRequest(std::uint64_t requestId)
 {
-    std::lock_guard locker(mutex_);
     auto it = activeRequests_.find(requestId);
     if (it != activeRequests_.end())
-        it->second->isNeedRemoveFromMultiHandle = true;
+        removeRequest(it);
 }
 
 void CurlNetworkManager::setProxySettings(const std::string &address, const std::string &username, const std::string &password)
 {
-    std::lock_guard locker(mutex_);
     proxySettings_.address = address;
     proxySettings_.username = username;
     proxySettings_.password = password;
@@ -102,112 +123,205 @@ void CurlNetworkManager::setProxySettings(const std::string &address, const std:
 
 void CurlNetworkManager::setWhitelistSocketsCallback(std::shared_ptr<CancelableCallback<WSNetHttpNetworkManagerWhitelistSocketsCallback> > callback)
 {
-    std::lock_guard locker(mutexForWhiteListSockets_);
     whitelistSocketsCallback_ = callback;
 }
 
-void CurlNetworkManager::run()
+void CurlNetworkManager::setConnectionPoolEnabled(bool isEnabled)
 {
-    while (!finish_) {
+    if (isConnectionPoolEnabled_ == isEnabled)
+        return;
+
+    isConnectionPoolEnabled_ = isEnabled;
+    spdlog::info("Curl connection pool mode: {}", isEnabled);
+    // requests in progress keep the old pool until they finish
+    connectionPool_.reset();
+    if (isEnabled) {
+        connectionPool_ = std::make_shared<CurlConnectionPool>();
+        if (!connectionPool_->isValid())
+            connectionPool_.reset();
+    }
+}
 
-        {
-            std::unique_lock<std::mutex> locker(mutex_);
-            while (activeRequests_.empty() && !finish_)
-                condition_.wait(locker);
-        }
+void CurlNetworkManager::resetConnectionPool()
+{
+    if (!connectionPool_)
+        return;
 
-        if (finish_)
-            break;
+    // requests in progress keep the old pool until they finish, new requests start from scratch
+    connectionPool_ = std::make_shared<CurlConnectionPool>();
+    if (!connectionPool_->isValid())
+        connectionPool_.reset();
+}
 
-        {
-            std::lock_guard locker(mutex_);
-            // add curl handles for requests which have not been added
-            for (auto it = activeRequests_.begin(); it != activeRequests_.end(); ++it) {
-                if (!it->second->isAddedToMultiHandle) {
-                    curl_multi_add_handle(multiHandle_, it->second->curlEasyHandle);
-                    it->second->isAddedToMultiHandle = true;
-                }
-            }
+void CurlNetworkManager::stop()
+{
+    while (!activeRequests_.empty())
+        removeRequest(activeRequests_.begin());
+    timer_.cancel();
+    // the idle pooled connections are still watched, curl closes their sockets in the destructor
+    for (auto &it : sockets_) {
+        it.second->what = CURL_POLL_NONE;
+        boost::system::error_code ec;
+        it.second->socket.cancel(ec);
+    }
+}
 
-            // check for need to be deleted requests (for cases when the function abort() was called)
-            for (auto it = activeRequests_.begin(); it != activeRequests_.end(); /*++it*/) {  // should not increment it in the for loop
-                if (it->second->isNeedRemoveFromMultiHandle) {
-                    RequestInfo *ri = it->second;
-                    if (it->second->isAddedToMultiHandle)
-                        curl_multi_remove_handle(multiHandle_, ri->curlEasyHandle);
-                    it = activeRequests_.erase(it);
-                    delete ri;
-                } else {
-                    ++it;
-                }
-            }
-        }
+void CurlNetworkManager::waitForSocket(const std::shared_ptr<SocketInfo> &socketInfo, curl_socket_t s)
+{
+    using namespace std::placeholders;
+    std::weak_ptr<SocketInfo> weakSocketInfo = socketInfo;
+    if ((socketInfo->what & CURL_POLL_IN) && !socketInfo->isReadPending) {
+        socketInfo->isReadPending = true;
+        socketInfo->socket.async_wait(boost::asio::socket_base::wait_read,
+                                      std::bind(&CurlNetworkManager::onSocketReady, this, weakSocketInfo, s, CURL_CSELECT_IN, _1));
+    }
+    if ((socketInfo->what & CURL_POLL_OUT) && !socketInfo->isWritePending) {
+        socketInfo->isWritePending = true;
+        socketInfo->socket.async_wait(boost::asio::socket_base::wait_write,
+                                      std::bind(&CurlNetworkManager::onSocketReady, this, weakSocketInfo, s, CURL_CSELECT_OUT, _1));
+    }
+}
 
-        int still_running;
-        curl_multi_perform(multiHandle_, &still_running);
-        // check finished requests
-        struct CURLMsg *curlMsg = nullptr;
-        do {
-            int msgq = 0;
-            curlMsg = curl_multi_info_read(multiHandle_, &msgq);
-            if (curlMsg && (curlMsg->msg == CURLMSG_DONE)) {
-                CURL *curlEasyHandle = curlMsg->easy_handle;
-                std::uint64_t *pointerId;
-                curl_easy_getinfo(curlEasyHandle, CURLINFO_PRIVATE, &pointerId);
-                assert(pointerId != nullptr);
-
-                curl_off_t totalTime;
-                curl_easy_getinfo(curlEasyHandle, CURLINFO_TOTAL_TIME_T, &totalTime);
-
-                curl_multi_remove_handle(multiHandle_, curlEasyHandle);
-
-                CURLcode result = curlMsg->data.result;
-
-                std::uint64_t id;
-                //remove request from activeRequests
-                {
-                    std::lock_guard locker(mutex_);
-                    id = *pointerId;
-                    auto it = activeRequests_.find(id);
-                    assert(it != activeRequests_.end());
-                    assert(it->second->curlEasyHandle == curlEasyHandle);
-
-                    if (result != CURLE_OK) {
-                        spdlog::debug("Curl request error: {}", curl_easy_strerror(result));
-
-                        // Log all curl output for a failed request
-                        if (it->second->isDebugLogCurlError) {
-                            for (const auto &log: it->second->debugLogs) {
-                                spdlog::info("{}", log);
-                            }
-                        }
-                    } else {
-                        // Log curl output for a successful request, only strings containing "Trying" and "Connected" substrings to reduce log bloat
-                        if (it->second->isDebugLogCurlError) {
-                            for (const auto &log: it->second->debugLogs) {
-                                if (log.find("Trying") != std::string::npos || log.find("Connected") != std::string::npos) {
-                                    spdlog::info("{}", log);
-                                }
-                            }
+void CurlNetworkManager::onSocketReady(const std::weak_ptr<SocketInfo> &weakSocketInfo, curl_socket_t s, int action, const boost::system::error_code &ec)
+{
+    // the socket was closed by curl in the meantime
+    auto socketInfo = weakSocketInfo.lock();
+    if (!socketInfo)
+        return;
+
+    if (action == CURL_CSELECT_IN)
+        socketInfo->isReadPending = false;
+    else
+        socketInfo->isWritePending = false;
+
+    if (ec == boost::asio::error::operation_aborted)
+        return;
+    // curl is no longer interested in this event
+    if (!(socketInfo->what & (action == CURL_CSELECT_IN ? CURL_POLL_IN : CURL_POLL_OUT)))
+        return;
+
+    int stillRunning;
+    curl_multi_socket_action(multiHandle_, s, ec ? CURL_CSELECT_ERR : action, &stillRunning);
+    checkFinishedRequests();
+
+    // re-arm the wait if the socket was not closed by curl in the meantime (the descriptor may have been reused already)
+    auto it = sockets_.find(s);
+    if (it != sockets_.end() && it->second == socketInfo)
+        waitForSocket(socketInfo, s);
+}
+
+void CurlNetworkManager::onTimer(const boost::system::error_code &ec)
+{
+    if (ec == boost::asio::error::operation_aborted)
+        return;
+
+    int stillRunning;
+    curl_multi_socket_action(multiHandle_, CURL_SOCKET_TIMEOUT, 0, &stillRunning);
+    checkFinishedRequests();
+}
+
+void CurlNetworkManager::checkFinishedRequests()
+{
+    struct CURLMsg *curlMsg = nullptr;
+    do {
+        int msgq = 0;
+        curlMsg = curl_multi_info_read(multiHandle_, &msgq);
+        if (curlMsg && (curlMsg->msg == CURLMSG_DONE)) {
+            CURL *curlEasyHandle = curlMsg->easy_handle;
+            std::uint64_t *pointerId;
+            curl_easy_getinfo(curlEasyHandle, CURLINFO_PRIVATE, &pointerId);
+            assert(pointerId != nullptr);
+
+            CURLcode result = curlMsg->data.result;
+            std::uint64_t id = *pointerId;
+            auto it = activeRequests_.find(id);
+            assert(it != activeRequests_.end());
+            assert(it->second->curlEasyHandle == curlEasyHandle);
+
+            if (result != CURLE_OK) {
+                spdlog::debug("Curl request error: {}", curl_easy_strerror(result));
+
+                // Log all curl output for a failed request
+                if (it->second->isDebugLogCurlError) {
+                    for (const auto &log: it->second->debugLogs) {
+                        spdlog::info("{}", log);
+                    }
+                }
+            } else {
+                // Log curl output for a successful request, only strings containing "Trying" and "Connected" substrings to reduce log bloat
+                if (it->second->isDebugLogCurlError) {
+                    for (const auto &log: it->second->debugLogs) {
+                        if (log.find("Trying") != std::string::npos || log.find("Connected") != std::string::npos) {
+                            spdlog::info("{}", log);
                         }
                     }
-
-                    delete it->second;
-                    activeRequests_.erase(id);
                 }
-                finishedCallback_(id, result == CURLE_OK, curl_easy_strerror(result));
             }
-        } while(curlMsg);
 
+            // curlMsg points to data of the easy handle, so it must not be used after the removal
+            removeRequest(it);
+            finishedCallback_(id, result == CURLE_OK, curl_easy_strerror(result));
+        }
+    } while(curlMsg);
+}
+
+void CurlNetworkManager::removeRequest(std::map<std::uint64_t, RequestInfo *>::iterator it)
+{
+    RequestInfo *ri = it->second;
+    curl_multi_remove_handle(multiHandle_, ri->curlEasyHandle);
+    activeRequests_.erase(it);
+    delete ri;
+}
 
-        // wait for activity or timeout
-        int numfds;
-        curl_multi_poll(multiHandle_, NULL, 0, 1000, &numfds);
+int CurlNetworkManager::curlMultiSocketCallback(CURL *easy, curl_socket_t s, int what, void *userp, void *socketp)
+{
+    CurlNetworkManager *this_ = static_cast<CurlNetworkManager *>(userp);
+    auto it = this_->sockets_.find(s);
+    if (it == this_->sockets_.end()) {
+        // should not happen, all the sockets are opened through curlOpenSocketCallback
+        if (what != CURL_POLL_REMOVE)
+            spdlog::error("CurlNetworkManager: unknown curl socket {}", (std::int64_t)s);
+        return 0;
     }
 
-    for (auto it = activeRequests_.begin(); it != activeRequests_.end(); ++it)
-        delete it->second;
-    activeRequests_.clear();
+    // on CURL_POLL_REMOVE just stop watching the socket, curl closes it later through curlCloseSocketCallback
+    it->second->what = (what == CURL_POLL_REMOVE) ? CURL_POLL_NONE : what;
+    this_->waitForSocket(it->second, s);
+    return 0;
+}
+
+int CurlNetworkManager::curlMultiTimerCallback(CURLM *multi, long timeoutMs, void *userp)
+{
+    CurlNetworkManager *this_ = static_cast<CurlNetworkManager *>(userp);
+    // curl_multi_socket_action must not be called from inside the callback, so even a zero timeout goes through the timer
+    if (timeoutMs < 0) {
+        this_->timer_.cancel();
+    } else {
+        this_->timer_.expires_after(std::chrono::milliseconds(timeoutMs));
+        this_->timer_.async_wait(std::bind(&CurlNetworkManager::onTimer, this_, std::placeholders::_1));
+    }
+    return 0;
+}
+
+curl_socket_t CurlNetworkManager::curlOpenSocketCallback(void *clientp, curlsocktype purpose, struct curl_sockaddr *address)
+{
+    CurlNetworkManager *this_ = static_cast<CurlNetworkManager *>(clientp);
+    if (purpose != CURLSOCKTYPE_IPCXN || address->socktype != SOCK_STREAM || (address->family != AF_INET && address->family != AF_INET6)) {
+        spdlog::error("CurlNetworkManager: unsupported socket type requested by curl");
+        return CURL_SOCKET_BAD;
+    }
+
+    auto socketInfo = std::make_shared<SocketInfo>(this_->executor_);
+    boost::system::error_code ec;
+    socketInfo->socket.open(address->family == AF_INET ? boost::asio::ip::tcp::v4() : boost::asio::ip::tcp::v6(), ec);
+    if (ec) {
+        spdlog::error("CurlNetworkManager: cannot open a socket: {}", ec.message());
+        return CURL_SOCKET_BAD;
+    }
+
+    curl_socket_t s = socketInfo->socket.native_handle();
+    this_->sockets_[s] = socketInfo;
+    return s;
 }
 
 CURLcode CurlNetworkManager::sslctx_function(CURL *curl, void *sslctx, void *parm)
@@ -241,7 +355,6 @@ int CurlNetworkManager::curlSocketCallback(void *clientp, curl_socket_t curlfd,
 {
     CurlNetworkManager *this_ = (CurlNetworkManager *)clientp;
 
-    std::lock_guard locker(this_->mutexForWhiteListSockets_);
     // whitelist the new socket descriptor
     if (this_->whitelistSockets_.find(curlfd) == this_->whitelistSockets_.end()) {
         this_->whitelistSockets_.insert(curlfd);
@@ -255,12 +368,19 @@ int CurlNetworkManager::curlSocketCallback(void *clientp, curl_socket_t curlfd,
 int CurlNetworkManager::curlCloseSocketCallback(void *clientp, curl_socket_t curlfd)
 {
     CurlNetworkManager *this_ = (CurlNetworkManager *)clientp;
+    auto it = this_->sockets_.find(curlfd);
+    if (it != this_->sockets_.end()) {
+        // closing through asio aborts the pending waits, their handlers see the expired SocketInfo
+        boost::system::error_code ec;
+        it->second->socket.close(ec);
+        this_->sockets_.erase(it);
+    } else {
 #ifdef _WIN32
-    closesocket(curlfd);
+        closesocket(curlfd);
 #else
-    close(curlfd);
+        close(curlfd);
 #endif
-    std::lock_guard locker(this_->mutexForWhiteListSockets_);
+    }
     // whitelist the deleted socket descriptor
     if (this_->whitelistSockets_.find(curlfd) != this_->whitelistSockets_.end()) {
         this_->whitelistSockets_.erase(curlfd);
@@ -300,6 +420,8 @@ bool CurlNetworkManager::setupOptions(RequestInfo *requestInfo, const std::share
     if (curl_easy_setopt(requestInfo->curlEasyHandle, CURLOPT_ACCEPT_ENCODING, "") != CURLE_OK) return false;
     if (curl_easy_setopt(requestInfo->curlEasyHandle, CURLOPT_URL, request->url().c_str()) != CURLE_OK) return false;
 
+    if (curl_easy_setopt(requestInfo->curlEasyHandle, CURLOPT_OPENSOCKETFUNCTION, curlOpenSocketCallback) != CURLE_OK) return false;
+    if (curl_easy_setopt(requestInfo->curlEasyHandle, CURLOPT_OPENSOCKETDATA, this) != CURLE_OK) return false;
     if (curl_easy_setopt(requestInfo->curlEasyHandle, CURLOPT_SOCKOPTFUNCTION, curlSocketCallback) != CURLE_OK) return false;
     if (curl_easy_setopt(requestInfo->curlEasyHandle, CURLOPT_SOCKOPTDATA, this) != CURLE_OK) return false;
     if (curl_easy_setopt(requestInfo->curlEasyHandle, CURLOPT_CLOSESOCKETFUNCTION, curlCloseSocketCallback) != CURLE_OK) return false;
@@ -307,9 +429,7 @@ bool CurlNetworkManager::setupOptions(RequestInfo *requestInfo, const std::share
 
     spdlog::debug("New curl request : {}", request->url().c_str());
 
-    if (curl_easy_setopt(requestInfo->curlEasyHandle, CURLOPT_FRESH_CONNECT, 1L) != CURLE_OK) return false;
-    // make connection get closed at once after use
-    if (curl_easy_setopt(requestInfo->curlEasyHandle, CURLOPT_FORBID_REUSE, 1L) != CURLE_OK) return false;
+    if (!setupConnectionReuse(requestInfo, request)) return false;
 
     // timeout for the connect phase, this timeout only limits the connection phase, it has no impact once libcurl has connected
     // I noticed that this time curl distributes equally between all IP addresses of the domain,
@@ -377,6 +497,24 @@ bool CurlNetworkManager::setupOptions(RequestInfo *requestInfo, const std::share
     return true;
 }
 
+bool CurlNetworkManager::setupConnectionReuse(RequestInfo *requestInfo, const std::shared_ptr<WSNetHttpRequest> &request)
+{
+    // ECH requests are used to bypass censorship, never mix them with the regular connections
+    if (connectionPool_ && request->echConfig().empty()) {
+        requestInfo->connectionPool = connectionPool_;
+        if (curl_easy_setopt(requestInfo->curlEasyHandle, CURLOPT_SHARE, connectionPool_->handle()) != CURLE_OK) return false;
+        if (curl_easy_setopt(requestInfo->curlEasyHandle, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS) != CURLE_OK) return false;
+        // wait for a connection that can be multiplexed instead of opening a new one
+        if (curl_easy_setopt(requestInfo->curlEasyHandle, CURLOPT_PIPEWAIT, 1L) != CURLE_OK) return false;
+        return true;
+    }
+
+    if (curl_easy_setopt(requestInfo->curlEasyHandle, CURLOPT_FRESH_CONNECT, 1L) != CURLE_OK) return false;
+    // make connection get closed at once after use
+    if (curl_easy_setopt(requestInfo->curlEasyHandle, CURLOPT_FORBID_REUSE, 1L) != CURLE_OK) return false;
+    return true;
+}
+
 bool CurlNetworkManager::setupResolveHosts(RequestInfo *requestInfo, const std::shared_ptr<WSNetHttpRequest> &request, const std::vector<std::string> &ips)
 {
     if (!ips.empty()) {
@@ -384,6 +522,18 @@ bool CurlNetworkManager::setupResolveHosts(RequestInfo *requestInfo, const std::
         if (port == 0) //  use 443 by default
             port = 443;
 
+        // curl matches pooled connections by the hostname only, so a request to a specific IP (e.g. an HTTP ping of a node)
+        // could be served over a connection to another IP of the same hostname.
+        // CONNECT_TO makes the IP part of the connection identity.
+        if (requestInfo->connectionPool && !request->overrideIp().empty()) {
+            std::string host = request->sniDomain().empty() ? request->hostname() : request->sniDomain();
+            std::string strConnectTo = host + ":" + std::to_string(port) + ":" + request->overrideIp() + ":" + std::to_string(port);
+            struct curl_slist *connectTo = curl_slist_append(NULL, strConnectTo.c_str());
+            if (connectTo == NULL) return false;
+            requestInfo->curlLists.push_back(connectTo);
+            if (curl_easy_setopt(requestInfo->curlEasyHandle, CURLOPT_CONNECT_TO, connectTo) != CURLE_OK) return false;
+        }
+
         std::string strResolve = request->hostname() + ":" + std::to_string(port) + ":" + utils::join(ips, ",");
         struct curl_slist *hosts = curl_slist_append(NULL, strResolve.c_str());
         if (hosts == NULL) return false;
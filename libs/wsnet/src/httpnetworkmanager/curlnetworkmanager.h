@@ -1,14 +1,13 @@
 #pragma once
 
 #include <curl/curl.h>
-#include <thread>
-#include <mutex>
-#include <atomic>
 #include <map>
-#include <condition_variable>
+#include <boost/asio.hpp>
+#include "utils/executorpool.h"
 #include "WSNetHttpRequest.h"
 #include "WSNetHttpNetworkManager.h"
 #include "certmanager.h"
+#include "curlconnectionpool.h"
 #include "utils/cancelablecallback.h"
 
 namespace wsnet {
@@ -18,10 +17,14 @@ typedef std::function<void(std::uint64_t requestId, std::uint64_t bytesReceived,
 typedef std::function<void(std::uint64_t requestId, const std::string &data)> CurlReadyDataCallback;
 
 // Implementing queries with curl library.
+// The curl multi handle is driven by the executor: socket readiness and timeouts are reported by curl through
+// CURLMOPT_SOCKETFUNCTION/CURLMOPT_TIMERFUNCTION and handled with asio async waits.
+// Not thread safe, all functions must be called on the executor. Callbacks are called on the executor as well.
 class CurlNetworkManager
 {
 public:
-    explicit CurlNetworkManager(CurlFinishedCallback finishedCallback, CurlProgressCallback progressCallback, CurlReadyDataCallback readyDataCallback);
+    explicit CurlNetworkManager(const ComponentExecutor &executor, CurlFinishedCallback finishedCallback,
+                                CurlProgressCallback progressCallback, CurlReadyDataCallback readyDataCallback);
     virtual ~CurlNetworkManager();
 
     bool init();
@@ -34,10 +37,18 @@ public:
 
     void setWhitelistSocketsCallback(std::shared_ptr<CancelableCallback<WSNetHttpNetworkManagerWhitelistSocketsCallback> > callback);
 
-private:
-    void run();
+    // In the connection pool mode the connections and TLS sessions are reused between requests and HTTP/2 is negotiated,
+    // so that concurrent requests to the same host are multiplexed over one connection.
+    // Otherwise each request uses a fresh connection which is closed right after use.
+    void setConnectionPoolEnabled(bool isEnabled);
+    // Closes all the pooled connections, subsequent requests establish new ones
+    void resetConnectionPool();
+    // Drops the requests in progress without calling their callbacks and cancels the waits for the sockets and the timer,
+    // so the executor can run out of work on shutdown
+    void stop();
 
 private:
+    ComponentExecutor executor_;
     bool isCurlGlobalInitialized_ = false;
     CurlFinishedCallback finishedCallback_;
     CurlProgressCallback progressCallback_;
@@ -45,11 +56,6 @@ private:
 
     CertManager certManager_;
 
-    std::mutex mutex_;
-    std::condition_variable condition_;
-    std::thread thread_;
-    std::atomic<bool> finish_;
-
     struct ProxySettings {
         std::string address;
         std::string username;
@@ -62,14 +68,14 @@ private:
         CurlNetworkManager *curlNetworkManager;
         CURL *curlEasyHandle = nullptr;
         std::vector<struct curl_slist *> curlLists;
-        bool isAddedToMultiHandle = false;
-        bool isNeedRemoveFromMultiHandle = false;
         bool isDebugLogCurlError = false;
         std::string domain;
         std::string domainMd5;
         std::vector<std::string> ips;
         std::vector<std::string> ipsMd5;
         std::vector<std::string> debugLogs;
+        // keeps the pool alive while the easy handle is attached to it
+        std::shared_ptr<CurlConnectionPool> connectionPool;
 
         // free all curl handles and data
         ~RequestInfo() {
@@ -88,13 +94,35 @@ private:
     CURLM *multiHandle_;
     std::map<std::uint64_t, RequestInfo *> activeRequests_;
 
-    std::mutex mutexForWhiteListSockets_; // this socket protects whitelistSocketsCallback_ variable
+    // curl sockets are created through asio (CURLOPT_OPENSOCKETFUNCTION) so that we can wait for their readiness
+    struct SocketInfo {
+        explicit SocketInfo(const ComponentExecutor &executor) : socket(executor) {}
+        boost::asio::ip::tcp::socket socket;
+        int what = CURL_POLL_NONE;   // the events curl is currently interested in
+        bool isReadPending = false;
+        bool isWritePending = false;
+    };
+    std::map<curl_socket_t, std::shared_ptr<SocketInfo> > sockets_;
+    boost::asio::steady_timer timer_;
+
+    bool isConnectionPoolEnabled_ = false;
+    std::shared_ptr<CurlConnectionPool> connectionPool_;
+
     std::shared_ptr<CancelableCallback<WSNetHttpNetworkManagerWhitelistSocketsCallback> > whitelistSocketsCallback_;
     std::set<int> whitelistSockets_;
 
+    void waitForSocket(const std::shared_ptr<SocketInfo> &socketInfo, curl_socket_t s);
+    void onSocketReady(const std::weak_ptr<SocketInfo> &socketInfo, curl_socket_t s, int action, const boost::system::error_code &ec);
+    void onTimer(const boost::system::error_code &ec);
+    void checkFinishedRequests();
+    void removeRequest(std::map<std::uint64_t, RequestInfo *>::iterator it);
+
     static CURLcode sslctx_function(CURL *curl, void *sslctx, void *parm);
     static size_t writeDataCallback(void *ptr, size_t size, size_t count, void *ri);
     static int progressCallback(void *ri,   curl_off_t dltotal,   curl_off_t dlnow,   curl_off_t ultotal,   curl_off_t ulnow);
+    static int curlMultiSocketCallback(CURL *easy, curl_socket_t s, int what, void *userp, void *socketp);
+    static int curlMultiTimerCallback(CURLM *multi, long timeoutMs, void *userp);
+    static curl_socket_t curlOpenSocketCallback(void *clientp, curlsocktype purpose, struct curl_sockaddr *address);
     static int curlSocketCallback(void *clientp, curl_socket_t curlfd, curlsocktype purpose);
     static int curlCloseSocketCallback(void *clientp, curl_socket_t curlfd);
     static int curlTrace(CURL *handle, curl_infotype type, char *data, size_t size, void *clientp);
@@ -103,6 +131,7 @@ private:
     bool setupResolveHosts(RequestInfo *requestInfo, const std::shared_ptr<WSNetHttpRequest> &request, const std::vector<std::string> &ips);
     bool setupSslVerification(RequestInfo *requestInfo, const std::shared_ptr<WSNetHttpRequest> &request);
     bool setupProxy(RequestInfo *requestInfo);
+    bool setupConnectionReuse(RequestInfo *requestInfo, const std::shared_ptr<WSNetHttpRequest> &request);
 };
 
 } // namespace wsnet
@@ -1,4 +1,5 @@
 #include "dnscache.h"
+#include <algorithm>
 #include <assert.h>
 #include <spdlog/spdlog.h>
 #include "settings.h"
@@ -6,32 +7,46 @@
 
 namespace wsnet {
 
-DnsCache::DnsCache(WSNetDnsResolver *dnsResolver, DnsCacheCallback callback) :
-    dnsResolver_(dnsResolver), callback_(callback)
+DnsCache::DnsCache(WSNetDnsResolver *dnsResolver, DnsCacheCallback callback, Clock clock) :
+    dnsResolver_(dnsResolver), callback_(callback), clock_(clock ? clock : &std::chrono::steady_clock::now)
 {
 }
 
 DnsCache::~DnsCache()
 {
     std::lock_guard locker(mutex_);
-    for (auto &it : activeRequests_) {
-        it.second->cancel();
+    for (auto &it : inFlight_) {
+        it.second.request->cancel();
+    }
+    for (auto &it : obsoleteLookups_) {
+        it.second.request->cancel();
     }
 }
 
 DnsCacheResult DnsCache::resolve(std::uint64_t id, const std::string &hostname, bool bypassCache)
 {
     std::lock_guard locker(mutex_);
-    assert(activeRequests_.find(id) == activeRequests_.end());
 
     if (!bypassCache) {
         auto it = cache_.find(hostname);
         if (it != cache_.end()) {
-            return DnsCacheResult { id, true, it->second, true, 0 };
+            auto now = clock_();
+            if (now < it->second.expireTime) {
+                lru_.splice(lru_.begin(), lru_, it->second.lruIt);
+                if (isNeedPrefetch(it->second, now) && inFlight_.find(hostname) == inFlight_.end())
+                    startLookup(hostname, std::nullopt);
+                return DnsCacheResult { id, it->second.isSuccess, it->second.ips, true, 0 };
+            }
+            removeFromCache(it);
         }
     }
-    auto asyncRequest = dnsResolver_->lookup(hostname, id, std::bind(&DnsCache::onDnsResolved, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
-    activeRequests_[id] = asyncRequest;
+
+    // join the lookup of the same hostname if it's already in progress
+    auto itInFlight = inFlight_.find(hostname);
+    if (itInFlight != inFlight_.end())
+        itInFlight->second.waiters.push_back(id);
+    else
+        startLookup(hostname, id);
     return DnsCacheResult { id, false, std::vector<std::string>(), false };
 }
 
@@ -39,38 +54,118 @@ void DnsCache::clear()
 {
     std::lock_guard locker(mutex_);
     cache_.clear();
+    lru_.clear();
+    // the lookups in progress may have been started with the previous network settings,
+    // so the next resolve() or prefetch() of these hostnames starts a new lookup
+    for (auto &it : inFlight_)
+        obsoleteLookups_[it.second.lookupId] = std::move(it.second);
+    inFlight_.clear();
     spdlog::info("Clear DNS cache");
 }
 
-void DnsCache::onDnsResolved(std::uint64_t id, const std::string &hostname, std::shared_ptr<WSNetDnsRequestResult> result)
+void DnsCache::prefetch(const std::vector<std::string> &hostnames)
 {
     std::lock_guard locker(mutex_);
-    auto it = activeRequests_.find(id);
-    assert(it != activeRequests_.end());
-
-    // log no more than once per 1 second
-    bool isNeedLog = true;
-    if (tunnelTestLastLogTime_.has_value()) {
-        auto timeSinceLastLog = utils::since(tunnelTestLastLogTime_.value()).count();
-        isNeedLog = timeSinceLastLog >= 1000;
+    auto now = clock_();
+    for (const auto &hostname : hostnames) {
+        auto it = cache_.find(hostname);
+        if (it != cache_.end() && now < it->second.expireTime && !isNeedPrefetch(it->second, now))
+            continue;
+        if (inFlight_.find(hostname) != inFlight_.end())
+            continue;
+        startLookup(hostname, std::nullopt);
     }
-    // useful log for tunnel test
-    if (isNeedLog && hostname.find(Settings::instance().serverTunnelTestSubdomain()) != std::string::npos) {
-        spdlog::info("DNS resolution for tunnel test, result: {}, timems: {}", result->errorString(), result->elapsedMs());
-        tunnelTestLastLogTime_ = std::chrono::steady_clock::now();
+}
+
+void DnsCache::startLookup(const std::string &hostname, std::optional<std::uint64_t> waiterId)
+{
+    InFlightLookup lookup;
+    lookup.lookupId = curLookupId_++;
+    if (waiterId.has_value())
+        lookup.waiters.push_back(waiterId.value());
+    lookup.request = dnsResolver_->lookup(hostname, lookup.lookupId, std::bind(&DnsCache::onDnsResolved, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+    inFlight_[hostname] = lookup;
+}
+
+void DnsCache::putToCache(const std::string &hostname, bool isSuccess, const std::vector<std::string> &ips, std::int64_t ttlMs)
+{
+    auto it = cache_.find(hostname);
+    if (it != cache_.end())
+        removeFromCache(it);
+    if (ttlMs <= 0)
+        return;
+
+    if (cache_.size() >= kMaxEntries) {
+        assert(!lru_.empty());
+        removeFromCache(cache_.find(lru_.back()));
     }
 
-    if (!result->isError()) {
-        cache_[hostname] = result->ips();
-        callback_(DnsCacheResult { id, true, result->ips(), false,  result->elapsedMs()} );
+    auto now = clock_();
+    lru_.push_front(hostname);
+    cache_[hostname] = CacheEntry { isSuccess, ips, now, now + std::chrono::milliseconds(ttlMs), lru_.begin() };
+}
+
+void DnsCache::removeFromCache(std::unordered_map<std::string, CacheEntry>::iterator it)
+{
+    assert(it != cache_.end());
+    lru_.erase(it->second.lruIt);
+    cache_.erase(it);
+}
+
+bool DnsCache::isNeedPrefetch(const CacheEntry &entry, TimePoint now) const
+{
+    // there is no point to refresh the negative entries in the background
+    if (!entry.isSuccess)
+        return false;
+    return (entry.expireTime - now) < (entry.expireTime - entry.createdTime) * kPrefetchTtlRatio;
+}
+
+void DnsCache::onDnsResolved(std::uint64_t lookupId, const std::string &hostname, std::shared_ptr<WSNetDnsRequestResult> result)
+{
+    std::vector<std::uint64_t> waiters;
+    {
+        std::lock_guard locker(mutex_);
+        // log no more than once per 1 second
+        bool isNeedLog = true;
+        if (tunnelTestLastLogTime_.has_value()) {
+            auto timeSinceLastLog = utils::since(tunnelTestLastLogTime_.value()).count();
+            isNeedLog = timeSinceLastLog >= 1000;
+        }
+        // useful log for tunnel test
+        if (isNeedLog && hostname.find(Settings::instance().serverTunnelTestSubdomain()) != std::string::npos) {
+            spdlog::info("DNS resolution for tunnel test, result: {}, timems: {}", result->errorString(), result->elapsedMs());
+            tunnelTestLastLogTime_ = std::chrono::steady_clock::now();
+        }
 
-    } else {
-        cache_.erase(hostname);
-        callback_(DnsCacheResult { id, false, std::vector<std::string>(), false, result->elapsedMs() } );
+        auto itObsolete = obsoleteLookups_.find(lookupId);
+        if (itObsolete != obsoleteLookups_.end()) {
+            waiters = std::move(itObsolete->second.waiters);
+            obsoleteLookups_.erase(itObsolete);
+        } else {
+            auto it = inFlight_.find(hostname);
+            if (it == inFlight_.end() || it->second.lookupId != lookupId) {
+                assert(false);
+                return;
+            }
+            std::int64_t ttlMs = (std::int64_t)result->ttl() * 1000;
+            if (!result->isError()) {
+                putToCache(hostname, true, result->ips(), std::clamp(ttlMs, kMinTtlMs, kMaxTtlMs));
+            } else if (it->second.waiters.empty()) {
+                // a failed prefetch leaves the current entry until it expires
+            } else {
+                putToCache(hostname, false, std::vector<std::string>(), std::min(ttlMs, kMaxNegativeTtlMs));
+            }
+            waiters = std::move(it->second.waiters);
+            inFlight_.erase(it);
+        }
     }
 
-    activeRequests_.erase(it);
+    for (auto id : waiters) {
+        if (!result->isError())
+            callback_(DnsCacheResult { id, true, result->ips(), false, result->elapsedMs() });
+        else
+            callback_(DnsCacheResult { id, false, std::vector<std::string>(), false, result->elapsedMs() });
+    }
 }
 
 } // namespace wsnet
-
@@ -1,8 +1,10 @@
 #pragma once
 #include <string>
+#include <list>
 #include <map>
 #include <mutex>
 #include <optional>
+#include <unordered_map>
 #include "WSNetDnsResolver.h"
 
 namespace wsnet {
@@ -18,26 +20,75 @@ struct DnsCacheResult
 
 typedef std::function<void(const DnsCacheResult &result)> DnsCacheCallback;
 
-// TODO: add TTL support, remove from cache + whitelist ips handler
+// DNS cache on top of the WSNetDnsResolver
+//   - entries live for the TTL of the DNS answer (clamped to [kMinTtlMs, kMaxTtlMs]);
+//   - failed lookups (NXDOMAIN, timeouts) are cached as well for the TTL chosen by the resolver (not longer than kMaxNegativeTtlMs);
+//   - the number of entries is limited to kMaxEntries, the least recently used entries are evicted;
+//   - a hit to an entry which is about to expire starts a background lookup, so hot entries are refreshed before they expire;
+//   - concurrent lookups of the same hostname are coalesced into one resolver request;
+//   - known hostnames (e.g. the failover domains) can be resolved in advance with prefetch().
+// Thread safe
+// TODO: remove from cache + whitelist ips handler
 class DnsCache final
 {
 public:
-    explicit DnsCache(WSNetDnsResolver *dnsResolver, DnsCacheCallback callback);
+    typedef std::function<std::chrono::steady_clock::time_point()> Clock;
+
+    // the clock is std::chrono::steady_clock::now() if not set, the tests set their own
+    explicit DnsCache(WSNetDnsResolver *dnsResolver, DnsCacheCallback callback, Clock clock = nullptr);
     ~DnsCache();
 
     DnsCacheResult resolve(std::uint64_t id, const std::string &hostname, bool bypassCache = false);
     void clear();
+    // starts background lookups of the hostnames which are neither cached nor being resolved
+    void prefetch(const std::vector<std::string> &hostnames);
 
 private:
+    static constexpr std::size_t kMaxEntries = 256;
+    static constexpr std::int64_t kMinTtlMs = 5000;
+    static constexpr std::int64_t kMaxTtlMs = 3600 * 1000;
+    static constexpr std::int64_t kMaxNegativeTtlMs = 60 * 1000;
+    // the entry is prefetched if it is hit during the last part of its lifetime
+    static constexpr double kPrefetchTtlRatio = 0.1;
+
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    struct CacheEntry
+    {
+        bool isSuccess;
+        std::vector<std::string> ips;
+        TimePoint createdTime;
+        TimePoint expireTime;
+        std::list<std::string>::iterator lruIt;
+    };
+
+    struct InFlightLookup
+    {
+        std::uint64_t lookupId;
+        std::shared_ptr<WSNetCancelableCallback> request;
+        // ids of resolve() calls waiting for the result, empty for a prefetch
+        std::vector<std::uint64_t> waiters;
+    };
+
     WSNetDnsResolver *dnsResolver_;
     DnsCacheCallback callback_;
+    Clock clock_;
     std::mutex mutex_;
-    std::map<std::string, std::vector<std::string> > cache_;
-    std::map<std::uint64_t, std::shared_ptr<WSNetCancelableCallback> > activeRequests_;
+    std::unordered_map<std::string, CacheEntry> cache_;
+    // most recently used hostnames at the front
+    std::list<std::string> lru_;
+    std::map<std::string, InFlightLookup> inFlight_;
+    // the lookups started before the cache was cleared, by lookup id; their waiters get the result but it's not stored
+    std::map<std::uint64_t, InFlightLookup> obsoleteLookups_;
+    std::uint64_t curLookupId_ = 0;
 
     std::optional<std::chrono::time_point<std::chrono::steady_clock> > tunnelTestLastLogTime_;
 
-    void onDnsResolved(std::uint64_t id, const std::string &hostname, std::shared_ptr<WSNetDnsRequestResult> result);
+    void startLookup(const std::string &hostname, std::optional<std::uint64_t> waiterId);
+    void putToCache(const std::string &hostname, bool isSuccess, const std::vector<std::string> &ips, std::int64_t ttlMs);
+    void removeFromCache(std::unordered_map<std::string, CacheEntry>::iterator it);
+    bool isNeedPrefetch(const CacheEntry &entry, TimePoint now) const;
+    void onDnsResolved(std::uint64_t lookupId, const std::string &hostname, std::shared_ptr<WSNetDnsRequestResult> result);
 };
 
 } // namespace wsnet
@@ -0,0 +1,287 @@
+// Checks the coalescing of the DnsCache lookups, that clear() detaches the lookups in progress
+// (the requests made after clear() start a new lookup and only its result is cached), the lifetime of the entries,
+// the LRU eviction and the refresh of the hot entries.
+// The resolver is a fake which completes the lookups when the test says so, the clock is moved by the test.
+
+#include <gtest/gtest.h>
+#include <map>
+#include <vector>
+
+#include "dnscache.h"
+
+using namespace wsnet;
+
+namespace {
+
+class FakeCancelableCallback : public WSNetCancelableCallback
+{
+public:
+    void cancel() override { isCanceled = true; }
+    bool isCanceled = false;
+};
+
+class FakeDnsRequestResult : public WSNetDnsRequestResult
+{
+public:
+    FakeDnsRequestResult(const std::vector<std::string> &ips, std::uint32_t ttl) : ips_(ips), ttl_(ttl) {}
+
+    std::vector<std::string> ips() override { return ips_; }
+    std::uint32_t elapsedMs() override { return 1; }
+    bool isError() override { return ips_.empty(); }
+    std::string errorString() override { return ips_.empty() ? "error" : "ok"; }
+    std::uint32_t ttl() override { return ttl_; }
+
+private:
+    std::vector<std::string> ips_;
+    std::uint32_t ttl_;
+};
+
+class FakeDnsResolver : public WSNetDnsResolver
+{
+public:
+    struct Lookup
+    {
+        std::string hostname;
+        WSNetDnsResolverCallback callback;
+    };
+
+    void setDnsServers(const std::vector<std::string> &) override {}
+    void setAddressFamily(int) override {}
+
+    std::shared_ptr<WSNetCancelableCallback> lookup(const std::string &hostname, std::uint64_t requestId, WSNetDnsResolverCallback callback) override
+    {
+        lookups[requestId] = Lookup { hostname, callback };
+        return std::make_shared<FakeCancelableCallback>();
+    }
+
+    std::shared_ptr<WSNetDnsRequestResult> lookupBlocked(const std::string &) override { return nullptr; }
+
+    void finish(std::uint64_t requestId, const std::vector<std::string> &ips, std::uint32_t ttl = 60)
+    {
+        auto lookup = lookups.at(requestId);
+        lookups.erase(requestId);
+        lookup.callback(requestId, lookup.hostname, std::make_shared<FakeDnsRequestResult>(ips, ttl));
+    }
+
+    // the lookup started last
+    void finishLast(const std::vector<std::string> &ips, std::uint32_t ttl = 60)
+    {
+        finish(lookups.rbegin()->first, ips, ttl);
+    }
+
+    std::map<std::uint64_t, Lookup> lookups;
+};
+
+class DnsCacheTest : public ::testing::Test
+{
+protected:
+    DnsCacheTest() : cache_(&resolver_, [this](const DnsCacheResult &result) { results_[result.id] = result; }, [this]() { return now_; }) {}
+
+    void advance(std::chrono::milliseconds ms) { now_ += ms; }
+
+    std::chrono::steady_clock::time_point now_;
+    FakeDnsResolver resolver_;
+    std::map<std::uint64_t, DnsCacheResult> results_;
+    DnsCache cache_;
+};
+
+} // namespace
+
+TEST_F(DnsCacheTest, CoalescesLookupsOfSameHostname)
+{
+    EXPECT_FALSE(cache_.resolve(1, "example.com").bFromCache);
+    EXPECT_FALSE(cache_.resolve(2, "example.com").bFromCache);
+    ASSERT_EQ(resolver_.lookups.size(), 1u);
+
+    resolver_.finish(resolver_.lookups.begin()->first, { "1.1.1.1" });
+    ASSERT_EQ(results_.size(), 2u);
+    EXPECT_TRUE(results_[1].bSuccess);
+    EXPECT_TRUE(results_[2].bSuccess);
+
+    auto cached = cache_.resolve(3, "example.com");
+    EXPECT_TRUE(cached.bFromCache);
+    EXPECT_EQ(cached.ips, std::vector<std::string>({ "1.1.1.1" }));
+}
+
+TEST_F(DnsCacheTest, ClearWhileLookupInFlightStartsNewLookup)
+{
+    cache_.resolve(1, "example.com");
+    ASSERT_EQ(resolver_.lookups.size(), 1u);
+    const std::uint64_t obsoleteLookupId = resolver_.lookups.begin()->first;
+
+    cache_.clear();
+
+    // does not join the lookup started before clear()
+    EXPECT_FALSE(cache_.resolve(2, "example.com").bFromCache);
+    ASSERT_EQ(resolver_.lookups.size(), 2u);
+    const std::uint64_t lookupId = resolver_.lookups.rbegin()->first;
+    EXPECT_NE(lookupId, obsoleteLookupId);
+
+    // the prefetch does not start a third one, the new lookup is in progress
+    cache_.prefetch({ "example.com" });
+    EXPECT_EQ(resolver_.lookups.size(), 2u);
+
+    // the obsolete result goes to its waiter only and is not cached
+    resolver_.finish(obsoleteLookupId, { "1.1.1.1" });
+    ASSERT_EQ(results_.size(), 1u);
+    EXPECT_EQ(results_[1].ips, std::vector<std::string>({ "1.1.1.1" }));
+
+    resolver_.finish(lookupId, { "2.2.2.2" });
+    ASSERT_EQ(results_.size(), 2u);
+    EXPECT_EQ(results_[2].ips, std::vector<std::string>({ "2.2.2.2" }));
+
+    auto cached = cache_.resolve(3, "example.com");
+    EXPECT_TRUE(cached.bFromCache);
+    EXPECT_EQ(cached.ips, std::vector<std::string>({ "2.2.2.2" }));
+}
+
+TEST_F(DnsCacheTest, ClearWhilePrefetchInFlightAllowsNewPrefetch)
+{
+    cache_.prefetch({ "example.com" });
+    ASSERT_EQ(resolver_.lookups.size(), 1u);
+    const std::uint64_t obsoleteLookupId = resolver_.lookups.begin()->first;
+
+    cache_.clear();
+    cache_.prefetch({ "example.com" });
+    ASSERT_EQ(resolver_.lookups.size(), 2u);
+
+    resolver_.finish(obsoleteLookupId, { "1.1.1.1" });
+    EXPECT_TRUE(results_.empty());
+    EXPECT_FALSE(cache_.resolve(1, "example.com").bFromCache);
+}
+
+TEST_F(DnsCacheTest, EntryExpiresAfterTtl)
+{
+    cache_.resolve(1, "example.com");
+    resolver_.finishLast({ "1.1.1.1" }, 60);
+
+    advance(std::chrono::seconds(30));
+    EXPECT_TRUE(cache_.resolve(2, "example.com").bFromCache);
+    EXPECT_TRUE(resolver_.lookups.empty());
+
+    advance(std::chrono::seconds(30));
+    EXPECT_FALSE(cache_.resolve(3, "example.com").bFromCache);
+    EXPECT_EQ(resolver_.lookups.size(), 1u);
+}
+
+TEST_F(DnsCacheTest, TtlIsClamped)
+{
+    struct TestCase
+    {
+        std::uint32_t ttlSec;
+        std::chrono::milliseconds lifetime;
+    };
+    const std::vector<TestCase> testCases = {
+        { 0, std::chrono::seconds(5) },
+        { 2, std::chrono::seconds(5) },
+        { 7200, std::chrono::hours(1) },
+    };
+
+    std::uint64_t id = 0;
+    for (const auto &testCase : testCases) {
+        SCOPED_TRACE(testCase.ttlSec);
+        cache_.clear();
+        cache_.resolve(id++, "example.com");
+        resolver_.finishLast({ "1.1.1.1" }, testCase.ttlSec);
+
+        advance(testCase.lifetime - std::chrono::milliseconds(1));
+        EXPECT_TRUE(cache_.resolve(id++, "example.com").bFromCache);
+
+        // joins the refresh started by the previous hit
+        advance(std::chrono::milliseconds(1));
+        EXPECT_FALSE(cache_.resolve(id++, "example.com").bFromCache);
+        resolver_.lookups.clear();
+    }
+}
+
+TEST_F(DnsCacheTest, FailureIsCachedForNegativeTtl)
+{
+    struct TestCase
+    {
+        std::uint32_t ttlSec;
+        std::chrono::milliseconds lifetime;
+    };
+    // not longer than 1 minute, the failure is not clamped to the minimal TTL of the answers
+    const std::vector<TestCase> testCases = {
+        { 10, std::chrono::seconds(10) },
+        { 300, std::chrono::minutes(1) },
+    };
+
+    std::uint64_t id = 0;
+    for (const auto &testCase : testCases) {
+        SCOPED_TRACE(testCase.ttlSec);
+        cache_.clear();
+        cache_.resolve(id++, "example.com");
+        resolver_.finishLast({}, testCase.ttlSec);
+
+        advance(testCase.lifetime - std::chrono::milliseconds(1));
+        auto cached = cache_.resolve(id++, "example.com");
+        EXPECT_TRUE(cached.bFromCache);
+        EXPECT_FALSE(cached.bSuccess);
+        // the failures are not refreshed in the background
+        EXPECT_TRUE(resolver_.lookups.empty());
+
+        advance(std::chrono::milliseconds(1));
+        EXPECT_FALSE(cache_.resolve(id++, "example.com").bFromCache);
+        resolver_.lookups.clear();
+    }
+}
+
+TEST_F(DnsCacheTest, FailureWithZeroTtlIsNotCached)
+{
+    cache_.resolve(1, "example.com");
+    resolver_.finishLast({}, 0);
+    EXPECT_FALSE(results_[1].bSuccess);
+    EXPECT_FALSE(cache_.resolve(2, "example.com").bFromCache);
+}
+
+TEST_F(DnsCacheTest, LeastRecentlyUsedEntryIsEvicted)
+{
+    // DnsCache::kMaxEntries
+    const std::size_t kMaxEntries = 256;
+    std::uint64_t id = 0;
+    for (std::size_t i = 0; i < kMaxEntries; ++i) {
+        cache_.resolve(id++, "host" + std::to_string(i));
+        resolver_.finishLast({ "1.1.1.1" });
+    }
+    // host1 is the least recently used now
+    EXPECT_TRUE(cache_.resolve(id++, "host0").bFromCache);
+
+    cache_.resolve(id++, "new");
+    resolver_.finishLast({ "1.1.1.1" });
+
+    EXPECT_TRUE(cache_.resolve(id++, "new").bFromCache);
+    EXPECT_TRUE(cache_.resolve(id++, "host0").bFromCache);
+    EXPECT_TRUE(cache_.resolve(id++, "host2").bFromCache);
+    EXPECT_FALSE(cache_.resolve(id++, "host1").bFromCache);
+}
+
+TEST_F(DnsCacheTest, HotEntryIsRefreshedBeforeExpiry)
+{
+    cache_.resolve(1, "example.com");
+    resolver_.finishLast({ "1.1.1.1" }, 100);
+
+    // the refresh starts during the last 10% of the lifetime only
+    advance(std::chrono::seconds(89));
+    EXPECT_TRUE(cache_.resolve(2, "example.com").bFromCache);
+    EXPECT_TRUE(resolver_.lookups.empty());
+
+    advance(std::chrono::seconds(2));
+    auto cached = cache_.resolve(3, "example.com");
+    EXPECT_TRUE(cached.bFromCache);
+    EXPECT_EQ(cached.ips, std::vector<std::string>({ "1.1.1.1" }));
+    ASSERT_EQ(resolver_.lookups.size(), 1u);
+
+    // no second refresh while the first one is in progress
+    EXPECT_TRUE(cache_.resolve(4, "example.com").bFromCache);
+    EXPECT_EQ(resolver_.lookups.size(), 1u);
+
+    // the refresh answers nobody, it replaces the entry
+    resolver_.finishLast({ "2.2.2.2" }, 100);
+    EXPECT_EQ(results_.size(), 1u);
+
+    advance(std::chrono::seconds(50));
+    cached = cache_.resolve(5, "example.com");
+    EXPECT_TRUE(cached.bFromCache);
+    EXPECT_EQ(cached.ips, std::vector<std::string>({ "2.2.2.2" }));
+}
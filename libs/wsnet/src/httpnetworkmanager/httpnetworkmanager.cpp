@@ -4,8 +4,8 @@
 
 namespace wsnet {
 
-HttpNetworkManager::HttpNetworkManager(boost::asio::io_context &io_context, WSNetDnsResolver *dnsResolver) :
-    io_context_(io_context), impl_(io_context, dnsResolver)
+HttpNetworkManager::HttpNetworkManager(const ComponentExecutor &executor, WSNetDnsResolver *dnsResolver) :
+    executor_(executor), impl_(executor, dnsResolver)
 {
 }
 
@@ -38,15 +38,20 @@ std::shared_ptr<WSNetCancelableCallback> HttpNetworkManager::executeRequestEx(co
                                                  WSNetHttpNetworkManagerProgressCallback progressCallback, WSNetHttpNetworkManagerReadyDataCallback readyReadCallback)
 {
     auto cc = std::make_shared<HttpNetworkManagerCallbacks>(finishedCallback, progressCallback, readyReadCallback);
-    boost::asio::post(io_context_, [this, request, id, cc] {
-        impl_.executeRequest(request, id, cc);
+    // if called from a handler of another wsnet component, the callbacks will be called on the executor of that component
+    std::optional<ComponentExecutor> callbackExecutor;
+    auto caller = ComponentExecutor::current();
+    if (caller && *caller != executor_)
+        callbackExecutor = *caller;
+    boost::asio::post(executor_, [this, request, id, cc, callbackExecutor] {
+        impl_.executeRequest(request, id, cc, callbackExecutor);
     });
     return cc;
 }
 
 void HttpNetworkManager::setProxySettings(const std::string &address, const std::string &username, const std::string &password)
 {
-    boost::asio::post(io_context_, [this, address, username, password] {
+    boost::asio::post(executor_, [this, address, username, password] {
         impl_.setProxySettings(address, username, password);
     });
 }
@@ -55,12 +60,12 @@ std::shared_ptr<WSNetCancelableCallback> HttpNetworkManager::setWhitelistIpsCall
 {
     if (whitelistIpsCallback) {
         auto cancelableCallback = std::make_shared<CancelableCallback<WSNetHttpNetworkManagerWhitelistIpsCallback>>(whitelistIpsCallback);
-        boost::asio::post(io_context_, [this, cancelableCallback] {
+        boost::asio::post(executor_, [this, cancelableCallback] {
             impl_.setWhitelistIpsCallback(cancelableCallback);
         });
         return cancelableCallback;
     } else {
-        boost::asio::post(io_context_, [this] {
+        boost::asio::post(executor_, [this] {
             impl_.setWhitelistIpsCallback(nullptr);
         });
         return nullptr;
@@ -71,24 +76,52 @@ std::shared_ptr<WSNetCancelableCallback> HttpNetworkManager::setWhitelistSockets
 {
     if (whitelistSocketsCallback) {
         auto cancelableCallback = std::make_shared<CancelableCallback<WSNetHttpNetworkManagerWhitelistSocketsCallback>>(whitelistSocketsCallback);
-        boost::asio::post(io_context_, [this, cancelableCallback] {
+        boost::asio::post(executor_, [this, cancelableCallback] {
             impl_.setWhitelistSocketsCallback(cancelableCallback);
         });
         return cancelableCallback;
     } else {
-        boost::asio::post(io_context_, [this] {
+        boost::asio::post(executor_, [this] {
             impl_.setWhitelistSocketsCallback(nullptr);
         });
         return nullptr;
     }
 }
 
+void HttpNetworkManager::setConnectionPoolEnabled(bool isEnabled)
+{
+    boost::asio::post(executor_, [this, isEnabled] {
+        impl_.setConnectionPoolEnabled(isEnabled);
+    });
+}
+
 void HttpNetworkManager::clearDnsCache()
 {
-    boost::asio::post(io_context_, [this] {
+    boost::asio::post(executor_, [this] {
         impl_.clearDnsCache();
     });
 }
 
+void HttpNetworkManager::prefetchDns(const std::vector<std::string> &hostnames)
+{
+    boost::asio::post(executor_, [this, hostnames] {
+        impl_.prefetchDns(hostnames);
+    });
+}
+
+void HttpNetworkManager::resetConnectionPool()
+{
+    boost::asio::post(executor_, [this] {
+        impl_.resetConnectionPool();
+    });
+}
+
+void HttpNetworkManager::stop()
+{
+    boost::asio::post(executor_, [this] {
+        impl_.stop();
+    });
+}
+
 } // namespace wsnet
 
@@ -6,11 +6,11 @@
 
 namespace wsnet {
 
-// Essentially redirects all calls to the HttpNetworkManager_impl for execution on the library thread (task queue)
+// Essentially redirects all calls to the HttpNetworkManager_impl for execution on the executor of the component (task queue)
 class HttpNetworkManager : public WSNetHttpNetworkManager
 {
 public:
-    HttpNetworkManager(boost::asio::io_context &io_context, WSNetDnsResolver *dnsResolver);
+    HttpNetworkManager(const ComponentExecutor &executor, WSNetDnsResolver *dnsResolver);
 
     bool init();
 
@@ -38,10 +38,17 @@ public:
     std::shared_ptr<WSNetCancelableCallback> setWhitelistIpsCallback(WSNetHttpNetworkManagerWhitelistIpsCallback whitelistIpsCallback) override;
     std::shared_ptr<WSNetCancelableCallback> setWhitelistSocketsCallback(WSNetHttpNetworkManagerWhitelistSocketsCallback whitelistSocketsCallback) override;
 
+    void setConnectionPoolEnabled(bool isEnabled) override;
+
     void clearDnsCache();
+    // resolves the hostnames concurrently in the background and puts the results to the DNS cache
+    void prefetchDns(const std::vector<std::string> &hostnames);
+    void resetConnectionPool();
+    // cancels the requests in progress on shutdown, see CurlNetworkManager::stop()
+    void stop();
 
 private:
-    boost::asio::io_context &io_context_;
+    ComponentExecutor executor_;
     HttpNetworkManager_impl impl_;
 };
 
@@ -4,10 +4,11 @@
 
 namespace wsnet {
 
-HttpNetworkManager_impl::HttpNetworkManager_impl(boost::asio::io_context &io_context, WSNetDnsResolver *dnsResolver) :
-    io_context_(io_context),
+HttpNetworkManager_impl::HttpNetworkManager_impl(const ComponentExecutor &executor, WSNetDnsResolver *dnsResolver) :
+    executor_(executor),
     dnsCache_(dnsResolver, std::bind(&HttpNetworkManager_impl::onDnsResolvedCallback, this, std::placeholders::_1)),
-    curlNetworkManager_(std::bind(&HttpNetworkManager_impl::onCurlFinishedCallback, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3),
+    curlNetworkManager_(executor,
+                        std::bind(&HttpNetworkManager_impl::onCurlFinishedCallback, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3),
                         std::bind(&HttpNetworkManager_impl::onCurlProgressCallback, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3),
                         std::bind(&HttpNetworkManager_impl::onCurlReadyDataCallback, this, std::placeholders::_1, std::placeholders::_2))
 {
@@ -22,12 +23,13 @@ bool HttpNetworkManager_impl::init()
     return curlNetworkManager_.init();
 }
 
-void HttpNetworkManager_impl::executeRequest(const std::shared_ptr<WSNetHttpRequest> &request, std::uint64_t id, std::shared_ptr<HttpNetworkManagerCallbacks> callbacks)
+void HttpNetworkManager_impl::executeRequest(const std::shared_ptr<WSNetHttpRequest> &request, std::uint64_t id, std::shared_ptr<HttpNetworkManagerCallbacks> callbacks,
+                                             const std::optional<ComponentExecutor> &callbackExecutor)
 {
     if (callbacks->isCanceled())
         return;
 
-    requestsMap_[curRequestId_] = RequestData { request, id, callbacks, std::chrono::steady_clock::now() };
+    requestsMap_[curRequestId_] = RequestData { request, id, callbacks, std::chrono::steady_clock::now(), {}, {}, callbackExecutor };
 
     // skip DNS-resolution if the overrideIp is settled
     if (!request->overrideIp().empty()) {
@@ -59,11 +61,15 @@ void HttpNetworkManager_impl::setWhitelistIpsCallback(std::shared_ptr<Cancelable
 {
     whitelistIpsCallback_ = callback;
     isWhitelistCallbackChanged_ = true;
+    // pooled connections may go to IPs which are not in the firewall exceptions of the new callback owner
+    curlNetworkManager_.resetConnectionPool();
 }
 
 void HttpNetworkManager_impl::setWhitelistSocketsCallback(std::shared_ptr<CancelableCallback<WSNetHttpNetworkManagerWhitelistSocketsCallback> > callback)
 {
     curlNetworkManager_.setWhitelistSocketsCallback(callback);
+    // pooled sockets were whitelisted through the previous callback
+    curlNetworkManager_.resetConnectionPool();
 }
 
 void HttpNetworkManager_impl::clearDnsCache()
@@ -71,9 +77,29 @@ void HttpNetworkManager_impl::clearDnsCache()
     dnsCache_.clear();
 }
 
+void HttpNetworkManager_impl::prefetchDns(const std::vector<std::string> &hostnames)
+{
+    dnsCache_.prefetch(hostnames);
+}
+
+void HttpNetworkManager_impl::setConnectionPoolEnabled(bool isEnabled)
+{
+    curlNetworkManager_.setConnectionPoolEnabled(isEnabled);
+}
+
+void HttpNetworkManager_impl::resetConnectionPool()
+{
+    curlNetworkManager_.resetConnectionPool();
+}
+
+void HttpNetworkManager_impl::stop()
+{
+    curlNetworkManager_.stop();
+}
+
 void HttpNetworkManager_impl::onDnsResolvedCallback(const DnsCacheResult &result)
 {
-    boost::asio::post(io_context_, [this, result] {
+    boost::asio::post(executor_, [this, result] {
         onDnsResolvedImpl(result);
     });
 }
@@ -89,13 +115,13 @@ void HttpNetworkManager_impl::onDnsResolvedImpl(const DnsCacheResult &result)
     }
 
     if (!result.bSuccess) {
-        request->second.callbacks->callFinished(request->second.userDataId, (std::uint32_t)utils::since(request->second.startTime).count(), NetworkError::kDnsResolveError, std::string(), std::string());
+        callFinished(request->second, NetworkError::kDnsResolveError, std::string(), std::string());
         requestsMap_.erase(request);
         return;
     }
 
     if (request->second.request->timeoutMs() <= result.elapsedMs) {
-        request->second.callbacks->callFinished(request->second.userDataId, (std::uint32_t)utils::since(request->second.startTime).count(), NetworkError::kTimeoutExceed, std::string(), std::string());
+        callFinished(request->second, NetworkError::kTimeoutExceed, std::string(), std::string());
         requestsMap_.erase(request);
         return;
     }
@@ -110,21 +136,21 @@ void HttpNetworkManager_impl::onDnsResolvedImpl(const DnsCacheResult &result)
 
 void HttpNetworkManager_impl::onCurlFinishedCallback(std::uint64_t requestId, bool bSuccess, const std::string &curlError)
 {
-    boost::asio::post(io_context_, [this, requestId, bSuccess, curlError] {
+    boost::asio::post(executor_, [this, requestId, bSuccess, curlError] {
         onCurlFinishedCallbackImpl(requestId, bSuccess, curlError);
     });
 }
 
 void HttpNetworkManager_impl::onCurlProgressCallback(std::uint64_t requestId, std::uint64_t bytesReceived, std::uint64_t bytesTotal)
 {
-    boost::asio::post(io_context_, [this, requestId, bytesReceived, bytesTotal] {
+    boost::asio::post(executor_, [this, requestId, bytesReceived, bytesTotal] {
         onCurlProgressCallbackImpl(requestId, bytesReceived, bytesTotal);
     });
 }
 
 void HttpNetworkManager_impl::onCurlReadyDataCallback(std::uint64_t requestId, const std::string &data)
 {
-    boost::asio::post(io_context_, [this, requestId, data] {
+    boost::asio::post(executor_, [this, requestId, data] {
         onCurlReadyDataCallbackImpl(requestId, data);
     });
 }
@@ -135,7 +161,7 @@ void HttpNetworkManager_impl::onCurlFinishedCallbackImpl(std::uint64_t requestId
     if (request != requestsMap_.end()) {
         NetworkError networkError = (bSuccess ? NetworkError::kSuccess : NetworkError::kCurlError);
         RequestData &rd = request->second;
-        rd.callbacks->callFinished(rd.userDataId, utils::since(rd.startTime).count(), networkError, curlError, rd.data);
+        callFinished(rd, networkError, curlError, rd.data);
         if (rd.request->isRemoveFromWhitelistIpsAfterFinish())
             removeWhitelistIps(rd.ips);
         requestsMap_.erase(requestId);
@@ -150,7 +176,7 @@ void HttpNetworkManager_impl::onCurlProgressCallbackImpl(std::uint64_t requestId
         if (rd.callbacks->isCanceled()) {
             cancelAndRemoveRequest(request);
         } else {
-            rd.callbacks->callProgress(rd.userDataId, bytesReceived, bytesTotal);
+            callProgress(rd, bytesReceived, bytesTotal);
         }
     }
 }
@@ -165,7 +191,7 @@ void HttpNetworkManager_impl::onCurlReadyDataCallbackImpl(std::uint64_t requestI
         } else {
             if (!rd.callbacks->isDataReadyNull()) {
                 // call callback
-                rd.callbacks->callDataReady(rd.userDataId, data);
+                callDataReady(rd, data);
             } else {
                 // append data to internal data buffer
                 request->second.data.reserve( request->second.data.size() + data.size() );
@@ -175,6 +201,47 @@ void HttpNetworkManager_impl::onCurlReadyDataCallbackImpl(std::uint64_t requestI
     }
 }
 
+void HttpNetworkManager_impl::callFinished(const RequestData &rd, NetworkError networkError, const std::string &curlError, const std::string &data)
+{
+    auto callbacks = rd.callbacks;
+    auto userDataId = rd.userDataId;
+    auto elapsedMs = (std::uint32_t)utils::since(rd.startTime).count();
+    if (rd.callbackExecutor) {
+        // the callback checks for cancellation on the caller executor, so a request canceled by the caller is never reported
+        boost::asio::post(*rd.callbackExecutor, [callbacks, userDataId, elapsedMs, networkError, curlError, data] {
+            callbacks->callFinished(userDataId, elapsedMs, networkError, curlError, data);
+        });
+    } else {
+        callbacks->callFinished(userDataId, elapsedMs, networkError, curlError, data);
+    }
+}
+
+void HttpNetworkManager_impl::callProgress(const RequestData &rd, std::uint64_t bytesReceived, std::uint64_t bytesTotal)
+{
+    auto callbacks = rd.callbacks;
+    auto userDataId = rd.userDataId;
+    if (rd.callbackExecutor) {
+        boost::asio::post(*rd.callbackExecutor, [callbacks, userDataId, bytesReceived, bytesTotal] {
+            callbacks->callProgress(userDataId, bytesReceived, bytesTotal);
+        });
+    } else {
+        callbacks->callProgress(userDataId, bytesReceived, bytesTotal);
+    }
+}
+
+void HttpNetworkManager_impl::callDataReady(const RequestData &rd, const std::string &data)
+{
+    auto callbacks = rd.callbacks;
+    auto userDataId = rd.userDataId;
+    if (rd.callbackExecutor) {
+        boost::asio::post(*rd.callbackExecutor, [callbacks, userDataId, data] {
+            callbacks->callDataReady(userDataId, data);
+        });
+    } else {
+        callbacks->callDataReady(userDataId, data);
+    }
+}
+
 void HttpNetworkManager_impl::whitelistIps(const std::vector<std::string> &ips)
 {
     bool bChanged = isWhitelistCallbackChanged_;
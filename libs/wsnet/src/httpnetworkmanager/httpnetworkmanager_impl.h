@@ -2,7 +2,9 @@
 
 #include "WSNetHttpNetworkManager.h"
 #include <mutex>
+#include <optional>
 #include <boost/asio.hpp>
+#include "utils/executorpool.h"
 #include "WSNetDnsResolver.h"
 #include "curlnetworkmanager.h"
 #include "dnscache.h"
@@ -15,13 +17,14 @@ using HttpNetworkManagerCallbacks = CancelableCallback3<WSNetHttpNetworkManagerF
 class HttpNetworkManager_impl
 {
 public:
-    HttpNetworkManager_impl(boost::asio::io_context &io_context, WSNetDnsResolver *dnsResolver);
+    HttpNetworkManager_impl(const ComponentExecutor &executor, WSNetDnsResolver *dnsResolver);
     virtual ~HttpNetworkManager_impl();
 
     bool init();
 
+    // callbackExecutor is the executor to call the callbacks on, if not set they are called on the own executor
     void executeRequest(const std::shared_ptr<WSNetHttpRequest> &request, std::uint64_t id,
-                        std::shared_ptr<HttpNetworkManagerCallbacks> callbacks);
+                        std::shared_ptr<HttpNetworkManagerCallbacks> callbacks, const std::optional<ComponentExecutor> &callbackExecutor);
 
     void setProxySettings(const std::string &address,
                           const std::string &username, const std::string &password);
@@ -30,9 +33,14 @@ public:
     void setWhitelistSocketsCallback(std::shared_ptr<CancelableCallback<WSNetHttpNetworkManagerWhitelistSocketsCallback> > callback);
 
     void clearDnsCache();
+    void prefetchDns(const std::vector<std::string> &hostnames);
+
+    void setConnectionPoolEnabled(bool isEnabled);
+    void resetConnectionPool();
+    void stop();
 
 private:
-    boost::asio::io_context &io_context_;
+    ComponentExecutor executor_;
     DnsCache dnsCache_;
     CurlNetworkManager curlNetworkManager_;
     std::shared_ptr<CancelableCallback<WSNetHttpNetworkManagerWhitelistIpsCallback> > whitelistIpsCallback_;
@@ -47,6 +55,7 @@ private:
         std::chrono::steady_clock::time_point startTime;
         std::vector<std::string> ips;
         std::string data;
+        std::optional<ComponentExecutor> callbackExecutor;
     };
 
     std::map<std::uint64_t, RequestData> requestsMap_;
@@ -65,6 +74,10 @@ private:
     void onCurlProgressCallbackImpl(std::uint64_t requestId, std::uint64_t bytesReceived, std::uint64_t bytesTotal);
     void onCurlReadyDataCallbackImpl(std::uint64_t requestId, const std::string &data);
 
+    void callFinished(const RequestData &rd, NetworkError networkError, const std::string &curlError, const std::string &data);
+    void callProgress(const RequestData &rd, std::uint64_t bytesReceived, std::uint64_t bytesTotal);
+    void callDataReady(const RequestData &rd, const std::string &data);
+
     void whitelistIps(const std::vector<std::string> &ips);
     void removeWhitelistIps(const std::vector<std::string> &ips);
 
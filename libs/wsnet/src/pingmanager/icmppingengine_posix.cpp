@@ -0,0 +1,336 @@
+#include "icmppingengine_posix.h"
+
+#include <cmath>
+#include <cstring>
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <vector>
+#include <spdlog/spdlog.h>
+#include "utils/utils.h"
+
+namespace wsnet {
+
+namespace {
+constexpr std::uint8_t kIcmpEchoReply = 0;
+constexpr std::uint8_t kIcmpEchoRequest = 8;
+constexpr std::size_t kIcmpHeaderSize = 8;
+}
+
+IcmpPingEngine_posix::IcmpPingEngine_posix(const ComponentExecutor &executor) :
+    executor_(executor),
+    socket_(executor)
+{
+}
+
+IcmpPingEngine_posix::~IcmpPingEngine_posix()
+{
+    stop();
+}
+
+void IcmpPingEngine_posix::stop()
+{
+    std::lock_guard locker(mutex_);
+    isStopped_ = true;
+    boost::system::error_code ec;
+    socket_.close(ec);
+    for (auto &it : requests_)
+        it.second.timer->cancel();
+    requests_.clear();
+}
+
+bool IcmpPingEngine_posix::init()
+{
+    std::lock_guard locker(mutex_);
+    boost::system::error_code ec;
+    socket_.open(boost::asio::generic::datagram_protocol(AF_INET, IPPROTO_ICMP), ec);
+    if (ec) {
+        // Typically EACCES if the group of the process is not within net.ipv4.ping_group_range
+        spdlog::info("Datagram ICMP sockets are not available ({}), ICMP pings will use the ping utility", ec.message());
+        return false;
+    }
+
+    socket_.non_blocking(true, ec);
+    int on = 1;
+#ifdef __APPLE__
+    // macOS keeps the identifier as is, so choose a random one to tell our replies from other processes
+    identifier_ = (std::uint16_t)utils::random(1, 0xFFFF);
+    setsockopt(socket_.native_handle(), SOL_SOCKET, SO_TIMESTAMP, &on, sizeof(on));
+#else
+    // Linux replaces the identifier with the local "port" of the socket, binding to the port 0 allocates it now
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    socket_.bind(boost::asio::generic::datagram_protocol::endpoint(&addr, sizeof(addr), IPPROTO_ICMP), ec);
+    if (ec) {
+        spdlog::error("IcmpPingEngine_posix cannot bind the socket: {}", ec.message());
+        socket_.close(ec);
+        return false;
+    }
+    auto localEndpoint = socket_.local_endpoint(ec);
+    if (!ec && localEndpoint.size() >= sizeof(sockaddr_in))
+        identifier_ = ntohs(reinterpret_cast<const sockaddr_in *>(localEndpoint.data())->sin_port);
+    setsockopt(socket_.native_handle(), SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+#endif
+
+    startReceive();
+    return true;
+}
+
+bool IcmpPingEngine_posix::ping(const std::string &ip, std::uint32_t timeoutMs, IcmpPingEngineCallback callback, std::uint64_t &requestId)
+{
+    boost::system::error_code ec;
+    auto address = boost::asio::ip::make_address_v4(ip, ec);
+    if (ec) {
+        spdlog::error("IcmpPingEngine_posix::ping incorrect IP-address: {}", ip);
+        return false;
+    }
+
+    std::lock_guard locker(mutex_);
+    if (isStopped_ || !socket_.is_open() || requests_.size() >= 0xFFFF)
+        return false;
+
+    // find a sequence number which is not used by any outstanding request
+    std::uint16_t sequence = curSequence_++;
+    while (requests_.find(sequence) != requests_.end())
+        sequence = curSequence_++;
+    const std::uint64_t id = (++curGeneration_ << 16) | sequence;
+
+    Request request;
+    request.id = id;
+    request.ip = ip;
+    request.sendTimeUs = realtimeNowUs();
+    request.callback = callback;
+
+    // the payload contains the send time and the request id, the latter allows to filter out late replies to a reused sequence number
+    std::uint8_t packet[kIcmpHeaderSize + kPayloadSize];
+    memset(packet, 0, sizeof(packet));
+    packet[0] = kIcmpEchoRequest;
+    packet[4] = identifier_ >> 8;
+    packet[5] = identifier_ & 0xFF;
+    packet[6] = sequence >> 8;
+    packet[7] = sequence & 0xFF;
+    memcpy(packet + kIcmpHeaderSize, &request.sendTimeUs, sizeof(request.sendTimeUs));
+    memcpy(packet + kIcmpHeaderSize + sizeof(request.sendTimeUs), &id, sizeof(id));
+    std::uint16_t sum = checksum(packet, sizeof(packet));
+    memcpy(packet + 2, &sum, sizeof(sum));
+
+    sockaddr_in dest;
+    memset(&dest, 0, sizeof(dest));
+    dest.sin_family = AF_INET;
+    auto bytes = address.to_bytes();
+    memcpy(&dest.sin_addr, bytes.data(), bytes.size());
+
+    socket_.send_to(boost::asio::buffer(packet, sizeof(packet)),
+                    boost::asio::generic::datagram_protocol::endpoint(&dest, sizeof(dest), IPPROTO_ICMP), 0, ec);
+    if (ec) {
+        spdlog::error("IcmpPingEngine_posix::ping cannot send an echo request to {}: {}", ip, ec.message());
+        return false;
+    }
+
+    request.timer = std::make_unique<boost::asio::steady_timer>(executor_, std::chrono::milliseconds(timeoutMs));
+    request.timer->async_wait(std::bind(&IcmpPingEngine_posix::onTimeout, this, sequence, id, std::placeholders::_1));
+    requests_[sequence] = std::move(request);
+    // the reply is handled under the mutex, so the caller gets the id before its callback
+    requestId = id;
+    return true;
+}
+
+void IcmpPingEngine_posix::cancel(std::uint64_t requestId)
+{
+    std::lock_guard locker(mutex_);
+    auto it = requests_.find(requestId & 0xFFFF);
+    if (it != requests_.end() && it->second.id == requestId) {
+        it->second.timer->cancel();
+        requests_.erase(it);
+    }
+}
+
+bool IcmpPingEngine_posix::isOpen()
+{
+    std::lock_guard locker(mutex_);
+    return !isStopped_ && socket_.is_open();
+}
+
+void IcmpPingEngine_posix::startReceive()
+{
+    socket_.async_wait(boost::asio::socket_base::wait_read, std::bind(&IcmpPingEngine_posix::onReadable, this, std::placeholders::_1));
+}
+
+void IcmpPingEngine_posix::onReadable(const boost::system::error_code &ec)
+{
+    if (ec == boost::asio::error::operation_aborted)
+        return;
+
+    int fd;
+    {
+        std::lock_guard locker(mutex_);
+        if (isStopped_)
+            return;
+        fd = socket_.native_handle();
+    }
+
+    if (ec) {
+        // the socket won't become readable again, re-arming the wait would spin
+        stopOnError(ec);
+        return;
+    }
+
+    // drain all the datagrams that are already queued
+    while (true) {
+        std::uint8_t buf[kMaxPacketSize];
+        alignas(cmsghdr) std::uint8_t control[256];
+        iovec iov;
+        iov.iov_base = buf;
+        iov.iov_len = sizeof(buf);
+        sockaddr_in from;
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_name = &from;
+        msg.msg_namelen = sizeof(from);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        ssize_t len = recvmsg(fd, &msg, MSG_DONTWAIT);
+        if (len < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        std::int64_t recvTimeUs = -1;
+        for (cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level != SOL_SOCKET)
+                continue;
+#ifdef SCM_TIMESTAMPNS
+            if (cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+                timespec ts;
+                memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+                recvTimeUs = (std::int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+            }
+#endif
+            if (cmsg->cmsg_type == SCM_TIMESTAMP) {
+                timeval tv;
+                memcpy(&tv, CMSG_DATA(cmsg), sizeof(tv));
+                recvTimeUs = (std::int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+            }
+        }
+        // no kernel timestamp, fall back to the user space time
+        if (recvTimeUs < 0)
+            recvTimeUs = realtimeNowUs();
+
+        handlePacket(buf, len, recvTimeUs);
+    }
+
+    std::lock_guard locker(mutex_);
+    if (!isStopped_)
+        startReceive();
+}
+
+void IcmpPingEngine_posix::stopOnError(const boost::system::error_code &ec)
+{
+    spdlog::error("IcmpPingEngine_posix socket error, ICMP pings will use the ping utility: {}", ec.message());
+
+    std::vector<IcmpPingEngineCallback> callbacks;
+    {
+        std::lock_guard locker(mutex_);
+        if (isStopped_)
+            return;
+        isStopped_ = true;
+        boost::system::error_code closeEc;
+        socket_.close(closeEc);
+        for (auto &it : requests_) {
+            it.second.timer->cancel();
+            callbacks.push_back(std::move(it.second.callback));
+        }
+        requests_.clear();
+    }
+    // the outstanding pings are redone with the ping utility by their callers
+    for (const auto &callback : callbacks)
+        callback(false, -1, true);
+}
+
+void IcmpPingEngine_posix::handlePacket(const std::uint8_t *data, std::size_t size, std::int64_t recvTimeUs)
+{
+#ifdef __APPLE__
+    // macOS datagram ICMP sockets deliver the packet with the IP header
+    if (size > 0 && (data[0] >> 4) == 4) {
+        std::size_t headerSize = (data[0] & 0x0F) * 4;
+        if (size < headerSize)
+            return;
+        data += headerSize;
+        size -= headerSize;
+    }
+#endif
+    if (size < kIcmpHeaderSize + kPayloadSize || data[0] != kIcmpEchoReply)
+        return;
+
+    std::uint16_t identifier = (data[4] << 8) | data[5];
+    std::uint16_t sequence = (data[6] << 8) | data[7];
+    std::int64_t sendTimeUs;
+    std::uint64_t requestId;
+    memcpy(&sendTimeUs, data + kIcmpHeaderSize, sizeof(sendTimeUs));
+    memcpy(&requestId, data + kIcmpHeaderSize + sizeof(sendTimeUs), sizeof(requestId));
+
+    IcmpPingEngineCallback callback;
+    std::int64_t rttUs;
+    {
+        std::lock_guard locker(mutex_);
+        if (identifier != identifier_)
+            return;
+        auto it = requests_.find(sequence);
+        if (it == requests_.end() || it->second.id != requestId)
+            return;
+
+        rttUs = std::max<std::int64_t>(0, recvTimeUs - it->second.sendTimeUs);
+        callback = std::move(it->second.callback);
+        it->second.timer->cancel();
+        requests_.erase(it);
+    }
+    callback(true, (std::int32_t)std::round(rttUs / 1000.0), false);
+}
+
+void IcmpPingEngine_posix::onTimeout(std::uint16_t sequence, std::uint64_t requestId, const boost::system::error_code &ec)
+{
+    if (ec == boost::asio::error::operation_aborted)
+        return;
+
+    IcmpPingEngineCallback callback;
+    {
+        std::lock_guard locker(mutex_);
+        auto it = requests_.find(sequence);
+        if (it == requests_.end() || it->second.id != requestId)
+            return;
+        callback = std::move(it->second.callback);
+        requests_.erase(it);
+    }
+    callback(false, -1, false);
+}
+
+std::uint16_t IcmpPingEngine_posix::checksum(const std::uint8_t *data, std::size_t size)
+{
+    std::uint32_t sum = 0;
+    for (std::size_t i = 0; i + 1 < size; i += 2) {
+        std::uint16_t word;
+        memcpy(&word, data + i, sizeof(word));
+        sum += word;
+    }
+    if (size & 1)
+        sum += data[size - 1];
+    while (sum >> 16)
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    return (std::uint16_t)~sum;
+}
+
+std::int64_t IcmpPingEngine_posix::realtimeNowUs()
+{
+    // kernel timestamps are in CLOCK_REALTIME
+    timeval tv;
+    gettimeofday(&tv, nullptr);
+    return (std::int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+} // namespace wsnet
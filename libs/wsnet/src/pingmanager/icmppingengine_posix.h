@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <boost/asio.hpp>
+#include "utils/executorpool.h"
+
+namespace wsnet {
+
+// isSocketError is set if the request was dropped on a socket error of the engine, the ping was not done then
+typedef std::function<void(bool isSuccess, std::int32_t timeMs, bool isSocketError)> IcmpPingEngineCallback;
+
+// Native ICMP echo engine based on unprivileged datagram ICMP sockets (SOCK_DGRAM/IPPROTO_ICMP), works on the executor of the PingManager.
+// All outstanding echo requests are multiplexed over a single socket, replies are matched by identifier and sequence number.
+// RTT is calculated from the kernel receive timestamp (SO_TIMESTAMPNS/SO_TIMESTAMP).
+// On Linux such sockets are only allowed if the process group is within net.ipv4.ping_group_range,
+// so the caller must check the result of init() and use another ping method if it fails.
+// Thread safe
+class IcmpPingEngine_posix
+{
+public:
+    explicit IcmpPingEngine_posix(const ComponentExecutor &executor);
+    virtual ~IcmpPingEngine_posix();
+
+    bool init();
+
+    // Sets a non-zero request id before the callback can be called, the callback is called once (on the executor) unless cancel() was called.
+    // Returns false if the echo request could not be sent, in this case the callback is never called.
+    bool ping(const std::string &ip, std::uint32_t timeoutMs, IcmpPingEngineCallback callback, std::uint64_t &requestId);
+    void cancel(std::uint64_t requestId);
+    // false after a socket error, the pings must use another method then
+    bool isOpen();
+    // Closes the socket and drops the outstanding requests without calling their callbacks
+    void stop();
+
+private:
+    static constexpr std::size_t kPayloadSize = 16;
+    static constexpr std::size_t kMaxPacketSize = 1500;
+
+    struct Request
+    {
+        std::uint64_t id;
+        std::string ip;
+        std::int64_t sendTimeUs;
+        std::unique_ptr<boost::asio::steady_timer> timer;
+        IcmpPingEngineCallback callback;
+    };
+
+    ComponentExecutor executor_;
+    boost::asio::generic::datagram_protocol::socket socket_;
+    std::mutex mutex_;
+    std::uint16_t identifier_ = 0;
+    std::uint16_t curSequence_ = 0;
+    std::uint64_t curGeneration_ = 0;
+    // the key is the sequence number of the echo request
+    std::unordered_map<std::uint16_t, Request> requests_;
+    bool isStopped_ = false;
+
+    void startReceive();
+    void onReadable(const boost::system::error_code &ec);
+    // closes the socket and calls the callbacks of the outstanding requests with isSocketError
+    void stopOnError(const boost::system::error_code &ec);
+    void handlePacket(const std::uint8_t *data, std::size_t size, std::int64_t recvTimeUs);
+    void onTimeout(std::uint16_t sequence, std::uint64_t requestId, const boost::system::error_code &ec);
+
+    static std::uint16_t checksum(const std::uint8_t *data, std::size_t size);
+    static std::int64_t realtimeNowUs();
+};
+
+} // namespace wsnet
@@ -43,6 +43,12 @@ public:
     }
 
     bool isParallelPing() const { return isParallelPing_; }
+    bool isSuccess() const { return isSuccess_; }
+    std::int32_t timeMs() const { return timeMs_; }
+
+    // non-zero if the ping belongs to a batch
+    void setBatchId(std::uint64_t batchId) { batchId_ = batchId; }
+    std::uint64_t batchId() const { return batchId_; }
 
 protected:
     std::uint64_t id_;
@@ -54,6 +60,7 @@ protected:
     bool isSuccess_ = false;
     std::int32_t timeMs_ = -1;
     bool isParallelPing_;
+    std::uint64_t batchId_ = 0;
 };
 
 } // namespace wsnet
@@ -0,0 +1,90 @@
+#include "pingbatch.h"
+#include <algorithm>
+#include <cassert>
+
+namespace wsnet {
+
+PingBatch::PingBatch(const std::vector<std::string> &ips, const std::vector<std::string> &hostnames, PingType pingType, int maxConcurrency,
+                     WSNetPingCallback callback, WSNetPingBatchFinishedCallback finishedCallback) :
+    pingType_(pingType),
+    callback_(std::make_shared<CancelableCallback<WSNetPingCallback>>(callback)),
+    finishedCallback_(std::make_shared<CancelableCallback<WSNetPingBatchFinishedCallback>>(finishedCallback)),
+    maxConcurrency_(std::max(maxConcurrency, kMinConcurrency)),
+    window_(std::min(kInitialConcurrency, maxConcurrency_))
+{
+    targets_.reserve(ips.size());
+    for (std::size_t i = 0; i < ips.size(); ++i)
+        targets_.push_back(Target{ ips[i], i < hostnames.size() ? hostnames[i] : std::string() });
+}
+
+void PingBatch::cancel()
+{
+    isCanceled_ = true;
+    callback_->cancel();
+    finishedCallback_->cancel();
+}
+
+bool PingBatch::nextTarget(Target &target)
+{
+    if (isCanceled_ || nextInd_ >= targets_.size() || inFlight_ >= (int)window_)
+        return false;
+
+    target = targets_[nextInd_++];
+    inFlight_++;
+    return true;
+}
+
+void PingBatch::onPingFinished(bool isSuccess, std::int32_t timeMs)
+{
+    assert(inFlight_ > 0);
+    inFlight_--;
+    isSuccess ? successCount_++ : failedCount_++;
+
+    recentResults_.push_back(isSuccess);
+    if (!isSuccess)
+        recentLosses_++;
+    if (recentResults_.size() > kLossWindowSize) {
+        if (!recentResults_.front())
+            recentLosses_--;
+        recentResults_.pop_front();
+    }
+
+    if (isSuccess && timeMs >= 0) {
+        srtt_ = srtt_ < 0 ? timeMs : 0.875 * srtt_ + 0.125 * timeMs;
+        minSrtt_ = minSrtt_ < 0 ? srtt_ : std::min(minSrtt_, srtt_);
+    }
+
+    // wait for enough results before judging the loss ratio
+    if (recentResults_.size() >= kLossWindowSize / 2 && (double)recentLosses_ / recentResults_.size() > kMaxLossRatio) {
+        decreaseWindow();
+    } else if (isSuccess) {
+        if (isSlowStart_)
+            window_ += 1.0;
+        else if (srtt_ <= minSrtt_ * kRttInflationFactor)
+            window_ += 1.0 / window_;
+        window_ = std::min(window_, (double)maxConcurrency_);
+    }
+}
+
+bool PingBatch::isFinished() const
+{
+    return inFlight_ == 0 && (isCanceled_ || nextInd_ >= targets_.size());
+}
+
+void PingBatch::callFinished()
+{
+    finishedCallback_->call(successCount_, failedCount_);
+}
+
+void PingBatch::decreaseWindow()
+{
+    isSlowStart_ = false;
+    std::uint32_t completed = successCount_ + failedCount_;
+    // results of the pings that were sent before the previous decrease should not decrease the window again
+    if (completed - lastDecreaseAt_ < (std::uint32_t)window_)
+        return;
+    window_ = std::max(window_ / 2, (double)kMinConcurrency);
+    lastDecreaseAt_ = completed;
+}
+
+} // namespace wsnet
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <string>
+#include <vector>
+#include "ipingmethod.h"
+
+namespace wsnet {
+
+// A set of ping targets scheduled as one job by the PingManager.
+// The number of pings in flight (window) is controlled by an AIMD algorithm:
+//   - slow start: the window grows by one for each successful ping until the first decrease;
+//   - congestion avoidance: the window grows by one per window of successful pings while the smoothed RTT is not inflated;
+//   - if the loss ratio among the recent results exceeds kMaxLossRatio, the window is halved (at most once per window of results).
+// Not thread safe except cancel(), the PingManager calls other methods under its own mutex.
+class PingBatch : public WSNetCancelableCallback
+{
+public:
+    struct Target
+    {
+        std::string ip;
+        std::string hostname;
+    };
+
+    PingBatch(const std::vector<std::string> &ips, const std::vector<std::string> &hostnames, PingType pingType, int maxConcurrency,
+              WSNetPingCallback callback, WSNetPingBatchFinishedCallback finishedCallback);
+
+    void cancel() override;
+    bool isCanceled() const { return isCanceled_; }
+
+    PingType pingType() const { return pingType_; }
+    // one callback object shared by all ping methods of the batch
+    PingFinishedCallback callback() const { return callback_; }
+
+    // returns false if the window is full or there are no more pending targets
+    bool nextTarget(Target &target);
+    void onPingFinished(bool isSuccess, std::int32_t timeMs);
+
+    // true if no pings are in flight and nothing else will be started
+    bool isFinished() const;
+    void callFinished();
+
+    int window() const { return (int)window_; }
+
+private:
+    static constexpr int kInitialConcurrency = 8;
+    static constexpr int kMinConcurrency = 2;
+    static constexpr std::size_t kLossWindowSize = 20;
+    static constexpr double kMaxLossRatio = 0.2;
+    static constexpr double kRttInflationFactor = 2.0;
+
+    std::vector<Target> targets_;
+    PingType pingType_;
+    PingFinishedCallback callback_;
+    std::shared_ptr<CancelableCallback<WSNetPingBatchFinishedCallback>> finishedCallback_;
+    std::atomic_bool isCanceled_ = false;
+
+    std::size_t nextInd_ = 0;
+    int inFlight_ = 0;
+    std::uint32_t successCount_ = 0;
+    std::uint32_t failedCount_ = 0;
+
+    const int maxConcurrency_;
+    double window_;
+    bool isSlowStart_ = true;
+    std::uint32_t lastDecreaseAt_ = 0;
+    std::deque<bool> recentResults_;
+    std::size_t recentLosses_ = 0;
+    double srtt_ = -1;
+    double minSrtt_ = -1;
+
+    void decreaseWindow();
+};
+
+} // namespace wsnet
@@ -10,14 +10,18 @@
 
 namespace wsnet {
 
-PingManager::PingManager(boost::asio::io_context &io_context, WSNetHttpNetworkManager *httpNetworkManager, WSNetAdvancedParameters *advancedParameters) :
-    io_context_(io_context),
+PingManager::PingManager(const ComponentExecutor &executor, WSNetHttpNetworkManager *httpNetworkManager, WSNetAdvancedParameters *advancedParameters) :
+    executor_(executor),
     httpNetworkManager_(httpNetworkManager),
     advancedParameters_(advancedParameters)
 {
 
 #if !defined _WIN32 && !defined IS_TVOS
-    processManager_ = std::make_unique<ProcessManager>(io_context);
+    icmpPingEngine_ = std::make_unique<IcmpPingEngine_posix>(executor);
+    if (!icmpPingEngine_->init())
+        icmpPingEngine_.reset();
+    // also used if the engine stops on a socket error
+    processManager_ = std::make_unique<ProcessManager>(executor);
 #endif
 }
 
@@ -30,6 +34,22 @@ PingManager::~PingManager()
     processManager_.reset();
 #endif
     map_.clear();
+    batches_.clear();
+#if !defined _WIN32 && !defined IS_TVOS
+    // ping methods cancel their requests in the engine on destruction, so the engine must outlive them
+    icmpPingEngine_.reset();
+#endif
+}
+
+void PingManager::stop()
+{
+#if !defined _WIN32 && !defined IS_TVOS
+    boost::asio::post(executor_, [this] {
+        std::lock_guard locker(mutex_);
+        if (icmpPingEngine_)
+            icmpPingEngine_->stop();
+    });
+#endif
 }
 
 std::shared_ptr<WSNetCancelableCallback> PingManager::ping(const std::string &ip, const std::string &hostname, PingType pingType, WSNetPingCallback callback)
@@ -55,6 +75,25 @@ std::shared_ptr<WSNetCancelableCallback> PingManager::ping(const std::string &ip
     return callbackFunc;
 }
 
+std::shared_ptr<WSNetCancelableCallback> PingManager::pingBatch(const std::vector<std::string> &ips, const std::vector<std::string> &hostnames,
+                                                                PingType pingType, WSNetPingCallback callback,
+                                                                WSNetPingBatchFinishedCallback finishedCallback)
+{
+    assert(hostnames.empty() || hostnames.size() == ips.size());
+    std::lock_guard locker(mutex_);
+
+    int maxConcurrency = (pingType == PingType::kHttp) ? MAX_PARALLEL_HTTP_BATCH_PINGS : maxParallelPings();
+    auto batch = std::make_shared<PingBatch>(ips, hostnames, pingType, maxConcurrency, callback, finishedCallback);
+    auto batchId = curBatchId_++;
+    batches_[batchId] = batch;
+    // Executing in thread pool, so the finished callback is never called from inside this function (even for an empty batch)
+    boost::asio::post(executor_, [this, batchId] {
+        std::lock_guard locker(mutex_);
+        processBatch(batchId);
+    });
+    return batch;
+}
+
 void PingManager::setIsConnectedToVpnState(bool isConnected)
 {
     std::lock_guard locker(mutex_);
@@ -64,19 +103,33 @@ void PingManager::setIsConnectedToVpnState(bool isConnected)
 void PingManager::onPingMethodFinished(std::uint64_t id)
 {
     // Executing in thread pool to eliminate deadlocks
-    boost::asio::post(io_context_, [this, id] {
+    boost::asio::post(executor_, [this, id] {
         std::lock_guard locker(mutex_);
         auto it = map_.find(id);
         assert(it != map_.end());
 
-        if (it->second->isParallelPing()) {
+        bool isParallelPing = it->second->isParallelPing();
+        if (isParallelPing) {
             curParallelPings_--;
             assert(curParallelPings_ >= 0);
         }
 
+        auto batchId = it->second->batchId();
+        if (batchId != 0) {
+            it->second->callCallback();
+            auto itBatch = batches_.find(batchId);
+            assert(itBatch != batches_.end());
+            itBatch->second->onPingFinished(it->second->isSuccess(), it->second->timeMs());
+            map_.erase(it);
+            processBatch(batchId);
+            if (isParallelPing)
+                processParallelPings();
+            return;
+        }
+
         it->second->callCallback();
         map_.erase(it);
-        processNextPingsInQueue();
+        processParallelPings();
     });
 }
 
@@ -92,7 +145,8 @@ IPingMethod *PingManager::createPingMethod(std::uint64_t id, const std::string &
     spdlog::error("ICMP pings are not supported on Apple tvOS");
     assert(false);
 #else
-        return new PingMethodIcmp_posix(id, ip, hostname, true, callback, std::bind(&PingManager::onPingMethodFinished, this, std::placeholders::_1), processManager_.get());
+        return new PingMethodIcmp_posix(id, ip, hostname, true, callback, std::bind(&PingManager::onPingMethodFinished, this, std::placeholders::_1),
+                                        icmpPingEngine_.get(), processManager_.get());
 #endif
     } else {
         assert(false);
@@ -100,9 +154,18 @@ IPingMethod *PingManager::createPingMethod(std::uint64_t id, const std::string &
     return 0;
 }
 
+int PingManager::maxParallelPings()
+{
+#if !defined _WIN32 && !defined IS_TVOS
+    if (icmpPingEngine_ && icmpPingEngine_->isOpen())
+        return MAX_PARALLEL_NATIVE_PINGS;
+#endif
+    return MAX_PARALLEL_PINGS;
+}
+
 void PingManager::processNextPingsInQueue()
 {
-    while (curParallelPings_ < MAX_PARALLEL_PINGS && !queue_.empty()) {
+    while (curParallelPings_ < maxParallelPings() && !queue_.empty()) {
         auto id = queue_.front();
         curParallelPings_++;
         auto &ping = map_[id];
@@ -111,4 +174,48 @@ void PingManager::processNextPingsInQueue()
     }
 }
 
+void PingManager::processBatch(std::uint64_t batchId)
+{
+    auto it = batches_.find(batchId);
+    if (it == batches_.end())
+        return;
+
+    auto &batch = it->second;
+    // ICMP pings of a batch count towards the same limit as the queued ones, HTTP batches are limited by their window only
+    bool isParallelPing = batch->pingType() != PingType::kHttp;
+    PingBatch::Target target;
+    while ((!isParallelPing || curParallelPings_ < maxParallelPings()) && batch->nextTarget(target)) {
+        auto ping = createPingMethod(curPingId_, target.ip, target.hostname, batch->pingType(), batch->callback());
+        if (!ping) {
+            batch->onPingFinished(false, -1);
+            continue;
+        }
+        ping->setBatchId(batchId);
+        map_[curPingId_] = std::unique_ptr<IPingMethod>(ping);
+        curPingId_++;
+        if (ping->isParallelPing())
+            curParallelPings_++;
+        ping->ping(!isConnectedToVpn_);
+    }
+
+    if (batch->isFinished()) {
+        batch->callFinished();
+        batches_.erase(it);
+    }
+}
+
+void PingManager::processParallelPings()
+{
+    processNextPingsInQueue();
+
+    // processBatch() may erase the batch
+    std::vector<std::uint64_t> batchIds;
+    for (const auto &it : batches_) {
+        if (it.second->pingType() != PingType::kHttp)
+            batchIds.push_back(it.first);
+    }
+    for (auto batchId : batchIds)
+        processBatch(batchId);
+}
+
 } // namespace wsnet
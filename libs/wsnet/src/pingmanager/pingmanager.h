@@ -3,15 +3,18 @@
 #include <queue>
 #include <map>
 #include <boost/asio.hpp>
+#include "utils/executorpool.h"
 #include "WSNetPingManager.h"
 #include "WSNetHttpNetworkManager.h"
 #include "WSNetAdvancedParameters.h"
 #include "ipingmethod.h"
+#include "pingbatch.h"
 
 #ifdef _WIN32
     #include "eventcallbackmanager_win.h"
 #elif !defined IS_TVOS
     #include "processmanager.h"
+    #include "icmppingengine_posix.h"
 #endif
 
 namespace wsnet {
@@ -20,16 +23,21 @@ namespace wsnet {
 class PingManager : public WSNetPingManager
 {
 public:
-    explicit PingManager(boost::asio::io_context &io_context, WSNetHttpNetworkManager *httpNetworkManager, WSNetAdvancedParameters *advancedParameters);
+    explicit PingManager(const ComponentExecutor &executor, WSNetHttpNetworkManager *httpNetworkManager, WSNetAdvancedParameters *advancedParameters);
     virtual ~PingManager();
 
     std::shared_ptr<WSNetCancelableCallback> ping(const std::string &ip, const std::string &hostname,
                                                   PingType pingType, WSNetPingCallback callback) override;
+    std::shared_ptr<WSNetCancelableCallback> pingBatch(const std::vector<std::string> &ips, const std::vector<std::string> &hostnames,
+                                                       PingType pingType, WSNetPingCallback callback,
+                                                       WSNetPingBatchFinishedCallback finishedCallback) override;
 
     void setIsConnectedToVpnState(bool isConnected);
+    // Closes the socket of the ICMP engine, whose reading is always pending, so the executor can run out of work on shutdown
+    void stop();
 
 private:
-    boost::asio::io_context &io_context_;
+    ComponentExecutor executor_;
     WSNetHttpNetworkManager *httpNetworkManager_;
     WSNetAdvancedParameters *advancedParameters_;
 
@@ -37,7 +45,8 @@ private:
     // Required for ICMP pings for Windows system
     EventCallbackManager_win eventCallbackManager_;
 #elif !defined IS_TVOS
-    // Required for ICMP pings for posix systems
+    // Required for ICMP pings for posix systems, the process manager is used only if the native engine is not available
+    std::unique_ptr<IcmpPingEngine_posix> icmpPingEngine_;
     std::unique_ptr<ProcessManager> processManager_;
 #endif
     bool isConnectedToVpn_ = false;
@@ -47,12 +56,24 @@ private:
     std::map<std::uint64_t, std::unique_ptr<IPingMethod> > map_;
 
     static constexpr int MAX_PARALLEL_PINGS = 10;
+    // the native ICMP engine does not spawn processes, so much more pings can be in flight
+    static constexpr int MAX_PARALLEL_NATIVE_PINGS = 50;
+    // the parallel pings of the queue and of the batches
     int curParallelPings_ = 0;
 
+    // upper bound of the adaptive window for batches of HTTP pings
+    static constexpr int MAX_PARALLEL_HTTP_BATCH_PINGS = 32;
+    std::uint64_t curBatchId_ = 1;
+    std::map<std::uint64_t, std::shared_ptr<PingBatch> > batches_;
+
 
     void onPingMethodFinished(std::uint64_t id);
     IPingMethod *createPingMethod(std::uint64_t id, const std::string &ip, const std::string &hostname, PingType pingType, PingFinishedCallback callback);
     void processNextPingsInQueue();
+    int maxParallelPings();
+    void processBatch(std::uint64_t batchId);
+    // starts the queued pings and then the ones of the ICMP batches while the parallel pings are below the limit
+    void processParallelPings();
 };
 
 } // namespace wsnet
@@ -5,14 +5,18 @@
 namespace wsnet {
 
 PingMethodIcmp_posix::PingMethodIcmp_posix(std::uint64_t id, const std::string &ip, const std::string &hostname, bool isParallelPing,
-        PingFinishedCallback callback, PingMethodFinishedCallback pingMethodFinishedCallback, ProcessManager *processManager) :
+        PingFinishedCallback callback, PingMethodFinishedCallback pingMethodFinishedCallback,
+        IcmpPingEngine_posix *icmpPingEngine, ProcessManager *processManager) :
     IPingMethod(id, ip, hostname, isParallelPing, callback, pingMethodFinishedCallback),
+    icmpPingEngine_(icmpPingEngine),
     processManager_(processManager)
 {
 }
 
 PingMethodIcmp_posix::~PingMethodIcmp_posix()
 {
+    if (engineRequestId_ != 0)
+        icmpPingEngine_->cancel(engineRequestId_);
 }
 
 void PingMethodIcmp_posix::ping(bool isFromDisconnectedVpnState)
@@ -26,6 +30,23 @@ void PingMethodIcmp_posix::ping(bool isFromDisconnectedVpnState)
     using namespace std::placeholders;
     isFromDisconnectedVpnState_ = isFromDisconnectedVpnState;
 
+    if (icmpPingEngine_ && icmpPingEngine_->isOpen()) {
+        // the engine sets engineRequestId_ before the callback can be called on another thread
+        if (icmpPingEngine_->ping(ip_, PING_TIMEOUT, std::bind(&PingMethodIcmp_posix::onEngineFinished, this, _1, _2, _3), engineRequestId_))
+            return;
+        // the engine may have been closed on a socket error meanwhile
+        if (icmpPingEngine_->isOpen()) {
+            callFinished();
+            return;
+        }
+    }
+
+    pingWithProcess();
+}
+
+void PingMethodIcmp_posix::pingWithProcess()
+{
+    using namespace std::placeholders;
     if (!processManager_->execute("ping", {"-c", "1", "-W", "2000", ip_}, std::bind(&PingMethodIcmp_posix::onProcessFinished, this, _1, _2))) {
         spdlog::error("PingMethodIcmp_posix::ping cannot execute ping command");
         callFinished();
@@ -33,6 +54,19 @@ void PingMethodIcmp_posix::ping(bool isFromDisconnectedVpnState)
     }
 }
 
+void PingMethodIcmp_posix::onEngineFinished(bool isSuccess, std::int32_t timeMs, bool isSocketError)
+{
+    engineRequestId_ = 0;
+    if (isSocketError) {
+        // the echo request may have never left, the engine is closed now
+        pingWithProcess();
+        return;
+    }
+    isSuccess_ = isSuccess;
+    timeMs_ = timeMs;
+    callFinished();
+}
+
 void PingMethodIcmp_posix::onProcessFinished(int exitCode, const std::string &output)
 {
     if (exitCode == 0) {
@@ -2,21 +2,29 @@
 
 #include "ipingmethod.h"
 #include "processmanager.h"
+#include "icmppingengine_posix.h"
 
 namespace wsnet {
 
+// Uses the native ICMP engine if it is available, otherwise falls back to the ping utility
 class PingMethodIcmp_posix : public IPingMethod
 {
 public:
     PingMethodIcmp_posix(std::uint64_t id, const std::string &ip, const std::string &hostname, bool isParallelPing,
-                    PingFinishedCallback callback, PingMethodFinishedCallback pingMethodFinishedCallback, ProcessManager *processManager);
+                    PingFinishedCallback callback, PingMethodFinishedCallback pingMethodFinishedCallback,
+                    IcmpPingEngine_posix *icmpPingEngine, ProcessManager *processManager);
 
     virtual ~PingMethodIcmp_posix();
     void ping(bool isFromDisconnectedVpnState) override;
 
 private:
+    enum { PING_TIMEOUT = 2000 };
+    IcmpPingEngine_posix *icmpPingEngine_;
     ProcessManager *processManager_;
+    std::uint64_t engineRequestId_ = 0;
 
+    void onEngineFinished(bool isSuccess, std::int32_t timeMs, bool isSocketError);
+    void pingWithProcess();
     void onProcessFinished(int exitCode, const std::string &output);
     int extractTimeMs(const std::string &str);
 };
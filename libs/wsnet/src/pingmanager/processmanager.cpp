@@ -3,8 +3,8 @@
 
 namespace wsnet {
 
-ProcessManager::ProcessManager(boost::asio::io_context &io_context) :
-    io_context_(io_context)
+ProcessManager::ProcessManager(const ComponentExecutor &executor) :
+    executor_(executor)
 {
 }
 
@@ -24,7 +24,7 @@ bool ProcessManager::execute(const std::string &cmd, const std::vector<std::stri
         childProcess->callback = callback;
         childProcess->process = boost::process::child(boost::process::search_path(cmd), args,
             boost::process::std_out >  childProcess->data,
-            io_context_,
+            executor_.context(),
             boost::process::on_exit = [this, id = curId_](int exit, std::error_code ec) {
                 // on exit function handler
                 std::string data;
@@ -40,8 +40,10 @@ bool ProcessManager::execute(const std::string &cmd, const std::vector<std::stri
                     callback = it->second->callback;
                     processes_.erase(it);
                 }
-                // call callback
-                callback(exit, data);
+                // the exit handler runs on any thread of the pool, call the callback on the executor
+                boost::asio::post(executor_, [callback, exit, data] {
+                    callback(exit, data);
+                });
             });
 
         {
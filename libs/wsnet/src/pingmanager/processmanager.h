@@ -7,23 +7,25 @@
 #include <functional>
 #include <boost/asio.hpp>
 #include <boost/process.hpp>
+#include "utils/executorpool.h"
 
 namespace wsnet {
 
 typedef std::function<void(int exitCode, const std::string &output)> ProcessManagerCallback;
 
 // Simple process manager. Allows you to start a process and set a callback function that is called after the process is finished.
+// Callbacks are called on the executor.
 // Thread safe
 class ProcessManager
 {
 public:
-    ProcessManager(boost::asio::io_context &io_context);
+    ProcessManager(const ComponentExecutor &executor);
     ~ProcessManager();
 
     bool execute(const std::string &cmd, const std::vector<std::string> &args, ProcessManagerCallback callback);
 
 private:
-    boost::asio::io_context &io_context_;
+    ComponentExecutor executor_;
 
     struct ChildProcess
     {
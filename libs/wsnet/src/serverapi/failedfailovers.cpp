@@ -0,0 +1,72 @@
+#include "failedfailovers.h"
+#include <algorithm>
+#include <rapidjson/document.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+#include <spdlog/spdlog.h>
+
+namespace wsnet {
+
+void FailedFailovers::addSuccess(const std::string &failoverUid, std::uint32_t elapsedMs)
+{
+    addSample(failoverUid, elapsedMs);
+}
+
+void FailedFailovers::addFailure(const std::string &failoverUid)
+{
+    addSample(failoverUid, kFailurePenaltyMs);
+}
+
+std::optional<std::string> FailedFailovers::fastestFailoverId() const
+{
+    auto it = std::min_element(avgTimeMs_.begin(), avgTimeMs_.end(), [](const auto &a, const auto &b) {
+        return a.second < b.second;
+    });
+    if (it == avgTimeMs_.end())
+        return std::nullopt;
+    return it->first;
+}
+
+std::string FailedFailovers::rankingToJson() const
+{
+    using namespace rapidjson;
+    StringBuffer sb;
+    Writer<StringBuffer> writer(sb);
+    writer.StartObject();
+    for (const auto &it : avgTimeMs_) {
+        writer.Key(it.first.c_str());
+        writer.Uint((unsigned int)it.second);
+    }
+    writer.EndObject();
+    return sb.GetString();
+}
+
+void FailedFailovers::rankingFromJson(const std::string &json)
+{
+    avgTimeMs_.clear();
+    if (json.empty())
+        return;
+
+    using namespace rapidjson;
+    Document doc;
+    doc.Parse(json.c_str());
+    if (doc.HasParseError() || !doc.IsObject()) {
+        spdlog::error("FailedFailovers::rankingFromJson, incorrect format");
+        return;
+    }
+    for (const auto &it : doc.GetObj()) {
+        if (it.value.IsUint())
+            avgTimeMs_[it.name.GetString()] = it.value.GetUint();
+    }
+}
+
+void FailedFailovers::addSample(const std::string &failoverUid, double ms)
+{
+    auto it = avgTimeMs_.find(failoverUid);
+    if (it == avgTimeMs_.end())
+        avgTimeMs_[failoverUid] = ms;
+    else
+        it->second = it->second * (1.0 - kAlpha) + ms * kAlpha;
+}
+
+} // namespace wsnet
@@ -1,10 +1,14 @@
 #pragma once
+#include <map>
+#include <optional>
 #include <set>
 #include "failoverdata.h"
 
 namespace wsnet {
 
 // Helper class used by ServerAPI and RequestExecuterViaFailover to manage failed domains (FailoverData objects)
+// Also keeps the ranking of the failovers by the time it took them to execute an API request,
+// the ranking outlives clear() and can be saved to the persistent settings to start the next session from the fastest failover.
 class FailedFailovers
 {
 public:
@@ -16,13 +20,30 @@ public:
     {
         return failedFailovers_.find(failoverData) != failedFailovers_.end();
     }
+    // clears the failed domains only
     void clear()
     {
         failedFailovers_.clear();
     }
 
+    void addSuccess(const std::string &failoverUid, std::uint32_t elapsedMs);
+    void addFailure(const std::string &failoverUid);
+    // the failover with the lowest average time or nullopt if the ranking is empty
+    std::optional<std::string> fastestFailoverId() const;
+
+    std::string rankingToJson() const;
+    void rankingFromJson(const std::string &json);
+
 private:
+    // a failed attempt counts as an attempt of this duration
+    static constexpr double kFailurePenaltyMs = 10000.0;
+    // weight of the last attempt in the moving average
+    static constexpr double kAlpha = 0.3;
+
     std::set<FailoverData> failedFailovers_;
+    std::map<std::string, double> avgTimeMs_;
+
+    void addSample(const std::string &failoverUid, double ms);
 };
 
 } // namespace wsnet
@@ -0,0 +1,212 @@
+#include "failoverracer.h"
+#include <algorithm>
+#include <spdlog/spdlog.h>
+#include "serverapi_utils.h"
+#include "utils/utils.h"
+
+namespace wsnet {
+
+FailoverRacer::FailoverRacer(const ComponentExecutor &executor, WSNetHttpNetworkManager *httpNetworkManager, std::unique_ptr<BaseRequest> request,
+                             std::vector<std::unique_ptr<BaseFailover>> failovers, bool bIgnoreSslErrors, bool isConnectedVpnState,
+                             WSNetAdvancedParameters *advancedParameters, FailedFailovers &failedFailovers,
+                             FailoverRacerStartedCallback startedCallback, FailoverRacerCallback callback) :
+    httpNetworkManager_(httpNetworkManager),
+    advancedParameters_(advancedParameters),
+    failedFailovers_(failedFailovers),
+    startedCallback_(startedCallback),
+    callback_(callback),
+    request_(std::move(request)),
+    bIgnoreSslErrors_(bIgnoreSslErrors),
+    isConnectedVpnState_(isConnectedVpnState),
+    staggerTimer_(executor)
+{
+    attempts_.resize(failovers.size());
+    for (std::size_t i = 0; i < failovers.size(); ++i)
+        attempts_[i].failover = std::move(failovers[i]);
+}
+
+FailoverRacer::~FailoverRacer()
+{
+    for (auto &attempt : attempts_) {
+        if (attempt.asyncCallback)
+            attempt.asyncCallback->cancel();
+    }
+}
+
+void FailoverRacer::start()
+{
+    if (attempts_.empty())
+        finish(RequestExecuterRetCode::kFailoverFailed, FailoverData(""), "");
+    else
+        startNextAttempt();
+}
+
+void FailoverRacer::setIsConnectedToVpnState(bool isConnected)
+{
+    if (isConnectedVpnState_ != isConnected) {
+        isConnectStateChanged_ = true;
+    }
+}
+
+void FailoverRacer::startNextAttempt()
+{
+    assert(!isFinished_ && nextAttemptInd_ < attempts_.size());
+    std::size_t attemptInd = nextAttemptInd_++;
+    Attempt &attempt = attempts_[attemptInd];
+    attempt.isStarted = true;
+    attempt.startTime = std::chrono::steady_clock::now();
+    spdlog::info("Trying: {}", attempt.failover->name());
+    if (startedCallback_)
+        startedCallback_(attemptInd);
+
+    // must be scheduled before getData(), which can finish the race synchronously
+    scheduleNextAttempt();
+
+    // if true then a result is ready immediately
+    // otherwise we are waiting for the onFailoverCallback
+    if (attempt.failover->getData(bIgnoreSslErrors_, attempt.failoverData, std::bind(&FailoverRacer::onFailoverCallback, this, attemptInd, std::placeholders::_1))) {
+        onFailoverCallback(attemptInd, attempt.failoverData);
+    }
+}
+
+void FailoverRacer::scheduleNextAttempt()
+{
+    if (nextAttemptInd_ >= attempts_.size())
+        return;
+
+    staggerTimer_.expires_after(std::chrono::milliseconds(kStaggerMs));
+    std::weak_ptr<bool> token = lifetimeToken_;
+    staggerTimer_.async_wait([this, token](const boost::system::error_code &ec) {
+        if (ec || token.expired() || isFinished_)
+            return;
+        // otherwise the next failover is started when one of the active ones fails
+        if (activeAttemptsCount() < kMaxConcurrentFailovers)
+            startNextAttempt();
+    });
+}
+
+void FailoverRacer::onFailoverCallback(std::size_t attemptInd, const std::vector<FailoverData> &data)
+{
+    if (isFinished_)
+        return;
+
+    // if connect state changed then we can't be sure what failover worked right. Must repeat the request in ServerAPI
+    if (isConnectStateChanged_) {
+        finish(RequestExecuterRetCode::kConnectStateChanged, FailoverData(""), "");
+        return;
+    }
+    if (request_->isCanceled()) {
+        finish(RequestExecuterRetCode::kRequestCanceled, FailoverData(""), "");
+        return;
+    }
+
+    Attempt &attempt = attempts_[attemptInd];
+    attempt.failoverData = data;
+    attempt.curIndFailoverData = 0;
+    executeNextDomain(attemptInd);
+}
+
+void FailoverRacer::executeNextDomain(std::size_t attemptInd)
+{
+    Attempt &attempt = attempts_[attemptInd];
+
+    // if we have already tried this domain and it is failed skip it
+    // keep in mind the failover can contain several domains
+    while (attempt.curIndFailoverData < attempt.failoverData.size() && failedFailovers_.isContains(attempt.failoverData[attempt.curIndFailoverData]))  {
+        spdlog::debug("Got an already failed domain, skip it");
+        attempt.curIndFailoverData++;
+    }
+    if (attempt.curIndFailoverData >= attempt.failoverData.size()) {
+        onAttemptFailed(attemptInd);
+        return;
+    }
+
+    using namespace std::placeholders;
+    auto httpRequest = serverapi_utils::createHttpRequestWithFailoverParameters(httpNetworkManager_, attempt.failoverData[attempt.curIndFailoverData], request_.get(),
+                                                                                bIgnoreSslErrors_, advancedParameters_->isAPIExtraTLSPadding());
+    httpRequest->setIsDebugLogCurlError(true);
+    attempt.asyncCallback = httpNetworkManager_->executeRequestEx(httpRequest, attemptInd, std::bind(&FailoverRacer::onHttpNetworkRequestFinished, this, attemptInd, _2, _3, _4, _5),
+                                                                  std::bind(&FailoverRacer::onHttpNetworkRequestProgressCallback, this, _2, _3));
+}
+
+void FailoverRacer::onHttpNetworkRequestFinished(std::size_t attemptInd, std::uint32_t elapsedMs, NetworkError errCode, const std::string &curlError, const std::string &data)
+{
+    if (isFinished_)
+        return;
+
+    Attempt &attempt = attempts_[attemptInd];
+    attempt.asyncCallback.reset();
+    if (request_->isCanceled()) {
+        finish(RequestExecuterRetCode::kRequestCanceled, FailoverData(""), "");
+        return;
+    }
+
+    // if connect state changed then we can't be sure what failover worked right. Must repeat the request in ServerAPI
+    if (isConnectStateChanged_) {
+        finish(RequestExecuterRetCode::kConnectStateChanged, FailoverData(""), "");
+        return;
+    }
+
+    if (errCode == NetworkError::kSuccess) {
+        // the request may keep the error of a response received from another domain
+        request_->setRetCode(ServerApiRetCode::kSuccess);
+        request_->handle(data);
+        if (advancedParameters_->isLogApiResponce()) {
+            spdlog::info("API request {} finished", request_->name());
+            spdlog::info("{}", data);
+        }
+    }
+
+    if (errCode != NetworkError::kSuccess || request_->retCode() == ServerApiRetCode::kIncorrectJson) {
+        failedFailovers_.add(attempt.failoverData[attempt.curIndFailoverData]);
+        // failover can contain several domains, let's try another one if there is one
+        attempt.curIndFailoverData++;
+        executeNextDomain(attemptInd);
+        return;
+    }
+
+    failedFailovers_.addSuccess(attempt.failover->uniqueId(), utils::since(attempt.startTime).count());
+    finish(RequestExecuterRetCode::kSuccess, attempt.failoverData[attempt.curIndFailoverData], attempt.failover->uniqueId());
+}
+
+void FailoverRacer::onHttpNetworkRequestProgressCallback(std::uint64_t bytesReceived, std::uint64_t bytesTotal)
+{
+    if (!isFinished_ && request_->isCanceled())
+        finish(RequestExecuterRetCode::kRequestCanceled, FailoverData(""), "");
+}
+
+void FailoverRacer::onAttemptFailed(std::size_t attemptInd)
+{
+    Attempt &attempt = attempts_[attemptInd];
+    attempt.isFinished = true;
+    failedFailovers_.addFailure(attempt.failover->uniqueId());
+
+    // do not wait for the stagger timer, there is nothing to race with the failed failover anymore
+    if (nextAttemptInd_ < attempts_.size())
+        startNextAttempt();
+    else if (activeAttemptsCount() == 0)
+        finish(RequestExecuterRetCode::kFailoverFailed, FailoverData(""), "");
+}
+
+int FailoverRacer::activeAttemptsCount() const
+{
+    return std::count_if(attempts_.begin(), attempts_.end(), [](const Attempt &attempt) {
+        return attempt.isStarted && !attempt.isFinished;
+    });
+}
+
+void FailoverRacer::finish(RequestExecuterRetCode retCode, FailoverData failoverData, const std::string &failoverUid)
+{
+    isFinished_ = true;
+    staggerTimer_.cancel();
+    for (auto &attempt : attempts_) {
+        if (attempt.asyncCallback) {
+            attempt.asyncCallback->cancel();
+            attempt.asyncCallback.reset();
+        }
+    }
+    // the object may be destroyed in the callback
+    callback_(retCode, std::move(request_), failoverData, failoverUid);
+}
+
+} // namespace wsnet
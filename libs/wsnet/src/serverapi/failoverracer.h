@@ -0,0 +1,85 @@
+#pragma once
+
+#include <chrono>
+#include <boost/asio.hpp>
+#include "WSNetHttpNetworkManager.h"
+#include "WSNetAdvancedParameters.h"
+#include "baserequest.h"
+#include "failover/basefailover.h"
+#include "failedfailovers.h"
+#include "requestexecuterviafailover.h"
+#include "utils/executorpool.h"
+
+namespace wsnet {
+
+// Helper class used by ServerAPI in the failover racing mode ("happy eyeballs").
+// Starts the failovers in the given order, the next one after kStaggerMs or right after the previous ones have failed,
+// without waiting for the previous ones to time out. The first domain which successfully executes the request wins,
+// the remaining attempts are canceled. Not more than kMaxConcurrentFailovers are in progress at the same time.
+// The domains of each failover are tried one after another as in RequestExecuterViaFailover.
+
+// failoverUid is the unique id of the winner failover for kSuccess
+typedef std::function<void(RequestExecuterRetCode retCode, std::unique_ptr<BaseRequest> request, FailoverData failoverData,
+                           const std::string &failoverUid)> FailoverRacerCallback;
+// called when the failover with index failoverInd in the given list is started
+typedef std::function<void(int failoverInd)> FailoverRacerStartedCallback;
+
+// Not thread safe, must be used on the executor passed to the constructor
+class FailoverRacer
+{
+public:
+    explicit FailoverRacer(const ComponentExecutor &executor, WSNetHttpNetworkManager *httpNetworkManager, std::unique_ptr<BaseRequest> request,
+                           std::vector<std::unique_ptr<BaseFailover>> failovers, bool bIgnoreSslErrors, bool isConnectedVpnState,
+                           WSNetAdvancedParameters *advancedParameters, FailedFailovers &failedFailovers,
+                           FailoverRacerStartedCallback startedCallback, FailoverRacerCallback callback);
+    virtual ~FailoverRacer();
+
+    void start();
+    void setIsConnectedToVpnState(bool isConnected);
+
+private:
+    static constexpr int kStaggerMs = 1500;
+    static constexpr int kMaxConcurrentFailovers = 3;
+
+    struct Attempt
+    {
+        std::unique_ptr<BaseFailover> failover;
+        std::vector<FailoverData> failoverData;
+        std::size_t curIndFailoverData = 0;
+        std::shared_ptr<WSNetCancelableCallback> asyncCallback;
+        std::chrono::steady_clock::time_point startTime;
+        bool isStarted = false;
+        bool isFinished = false;
+    };
+
+    WSNetHttpNetworkManager *httpNetworkManager_;
+    WSNetAdvancedParameters *advancedParameters_;
+    FailedFailovers &failedFailovers_;
+    FailoverRacerStartedCallback startedCallback_;
+    FailoverRacerCallback callback_;
+
+    std::unique_ptr<BaseRequest> request_;
+    std::vector<Attempt> attempts_;
+    std::size_t nextAttemptInd_ = 0;
+    bool bIgnoreSslErrors_;
+    bool isConnectedVpnState_;
+    bool isConnectStateChanged_ = false;
+    bool isFinished_ = false;
+
+    boost::asio::steady_timer staggerTimer_;
+    // the timer handler may already be scheduled when the object is destroyed
+    std::shared_ptr<bool> lifetimeToken_ = std::make_shared<bool>(true);
+
+    void startNextAttempt();
+    void scheduleNextAttempt();
+    void onFailoverCallback(std::size_t attemptInd, const std::vector<FailoverData> &data);
+    void executeNextDomain(std::size_t attemptInd);
+    void onHttpNetworkRequestFinished(std::size_t attemptInd, std::uint32_t elapsedMs, NetworkError errCode, const std::string &curlError, const std::string &data);
+    // This callback function is necessary to cancel the request as quickly as possible if it was canceled on the calling side
+    void onHttpNetworkRequestProgressCallback(std::uint64_t bytesReceived, std::uint64_t bytesTotal);
+    void onAttemptFailed(std::size_t attemptInd);
+    int activeAttemptsCount() const;
+    void finish(RequestExecuterRetCode retCode, FailoverData failoverData, const std::string &failoverUid);
+};
+
+} // namespace wsnet
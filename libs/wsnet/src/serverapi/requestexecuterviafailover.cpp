@@ -28,6 +28,7 @@ RequestExecuterViaFailover::~RequestExecuterViaFailover()
 
 void RequestExecuterViaFailover::start()
 {
+    startTime_ = std::chrono::steady_clock::now();
     // if true then a result is ready immediately
     // otherwise we are waiting for the onFailoverCallback
     if (failover_->getData(bIgnoreSslErrors_, failoverData_, std::bind(&RequestExecuterViaFailover::onFailoverCallback, this, std::placeholders::_1))) {
@@ -50,6 +51,7 @@ void RequestExecuterViaFailover::onFailoverCallback(const std::vector<FailoverDa
         return;
     }
     if (data.empty()) {
+        failedFailovers_.addFailure(failover_->uniqueId());
         callback_(RequestExecuterRetCode::kFailoverFailed, std::move(request_), FailoverData(""));
         return;
     }
@@ -68,10 +70,12 @@ void RequestExecuterViaFailover::onFailoverCallback(const std::vector<FailoverDa
         spdlog::debug("Got an already failed domain, skip it");
         curIndFailoverData_++;
     }
-    if (curIndFailoverData_ >= failoverData_.size())
+    if (curIndFailoverData_ >= failoverData_.size()) {
+        failedFailovers_.addFailure(failover_->uniqueId());
         callback_(RequestExecuterRetCode::kFailoverFailed, std::move(request_), FailoverData(""));
-    else
+    } else {
         executeBaseRequest(failoverData_[curIndFailoverData_]);
+    }
 }
 
 void RequestExecuterViaFailover::executeBaseRequest(const FailoverData &failoverData)
@@ -109,13 +113,16 @@ void RequestExecuterViaFailover::onHttpNetworkRequestFinished(std::uint64_t http
         failedFailovers_.add(failoverData_[curIndFailoverData_]);
         // failover can contain several domains, let's try another one if there is one
         curIndFailoverData_++;
-        if (curIndFailoverData_ >= failoverData_.size())
+        if (curIndFailoverData_ >= failoverData_.size()) {
+            failedFailovers_.addFailure(failover_->uniqueId());
             callback_(RequestExecuterRetCode::kFailoverFailed, std::move(request_), FailoverData(""));
-        else
+        } else {
             executeBaseRequest(failoverData_[curIndFailoverData_]);
+        }
         return;
     }
 
+    failedFailovers_.addSuccess(failover_->uniqueId(), utils::since(startTime_).count());
     callback_(RequestExecuterRetCode::kSuccess, std::move(request_), failoverData_[curIndFailoverData_]);
 }
 
@@ -2,6 +2,7 @@
 
 #include "WSNetHttpNetworkManager.h"
 #include "WSNetAdvancedParameters.h"
+#include <chrono>
 #include <mutex>
 #include <thread>
 #include "baserequest.h"
@@ -42,6 +43,7 @@ private:
     bool bIgnoreSslErrors_;
     bool isConnectedVpnState_;
     bool isConnectStateChanged_;
+    std::chrono::steady_clock::time_point startTime_;
 
     std::shared_ptr<WSNetCancelableCallback> asyncCallback_;
 
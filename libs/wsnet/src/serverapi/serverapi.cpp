@@ -6,14 +6,14 @@
 
 namespace wsnet {
 
-ServerAPI::ServerAPI(boost::asio::io_context &io_context, WSNetHttpNetworkManager *httpNetworkManager, IFailoverContainer *failoverContainer,
+ServerAPI::ServerAPI(const ComponentExecutor &executor, WSNetHttpNetworkManager *httpNetworkManager, IFailoverContainer *failoverContainer,
                      PersistentSettings &persistentSettings, WSNetAdvancedParameters *advancedParameters, ConnectState &connectState) :
-    io_context_(io_context),
+    executor_(executor),
     persistentSettings_(persistentSettings),
     advancedParameters_(advancedParameters),
     connectState_(connectState)
 {
-    impl_ = std::make_unique<ServerAPI_impl>(httpNetworkManager, failoverContainer, persistentSettings_, advancedParameters, connectState);
+    impl_ = std::make_unique<ServerAPI_impl>(executor_, httpNetworkManager, failoverContainer, persistentSettings_, advancedParameters, connectState);
     subscriberId_ = connectState_.subscribeConnectedToVpnState(std::bind(&ServerAPI::onVPNConnectStateChanged, this, std::placeholders::_1));
 }
 
@@ -24,21 +24,21 @@ ServerAPI::~ServerAPI()
 
 void ServerAPI::setApiResolutionsSettings(bool isAutomatic, std::string manualAddress)
 {
-    boost::asio::post(io_context_, [this, isAutomatic, manualAddress] {
+    boost::asio::post(executor_, [this, isAutomatic, manualAddress] {
         impl_->setApiResolutionsSettings(isAutomatic, manualAddress);
     });
 }
 
 void ServerAPI::setIgnoreSslErrors(bool bIgnore)
 {
-    boost::asio::post(io_context_, [this, bIgnore] {
+    boost::asio::post(executor_, [this, bIgnore] {
         impl_->setIgnoreSslErrors(bIgnore);
     });
 }
 
 void ServerAPI::resetFailover()
 {
-    boost::asio::post(io_context_, [this] {
+    boost::asio::post(executor_, [this] {
         impl_->resetFailover();
     });
 }
@@ -46,7 +46,7 @@ void ServerAPI::resetFailover()
 std::shared_ptr<WSNetCancelableCallback> ServerAPI::setTryingBackupEndpointCallback(WSNetTryingBackupEndpointCallback tryingBackupEndpointCallback)
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetTryingBackupEndpointCallback>>(tryingBackupEndpointCallback);
-    boost::asio::post(io_context_, [this, cancelableCallback] {
+    boost::asio::post(executor_, [this, cancelableCallback] {
         impl_->setTryingBackupEndpointCallback(cancelableCallback);
     });
     return cancelableCallback;
@@ -55,13 +55,13 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::setTryingBackupEndpointCallb
 std::shared_ptr<WSNetCancelableCallback> ServerAPI::login(const std::string &username, const std::string &password, const std::string &code2fa, WSNetRequestFinishedCallback callback)
 {
     // For login only request, we reset a failover to the initial state
-    boost::asio::post(io_context_, [this] {
+    boost::asio::post(executor_, [this] {
         impl_->resetFailover();
     });
 
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::login(username, password, code2fa, Settings::instance().sessionTypeId(), cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -69,7 +69,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::session(const std::string &a
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::session(authHash, appleId, gpDeviceId, cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -77,7 +77,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::claimVoucherCode(const std::
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::claimVoucherCode(authHash, voucherCode, cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -85,7 +85,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::deleteSession(const std::str
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::deleteSession(authHash, cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -94,7 +94,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::serverLocations(const std::s
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::serverLocations(persistentSettings_, language, revision, isPro, alcList,
                                                              connectState_, advancedParameters_, cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -102,7 +102,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::serverCredentials(const std:
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::serverCredentials(authHash, isOpenVpnProtocol, cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -110,7 +110,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::serverConfigs(const std::str
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::serverConfigs(authHash, Settings::instance().openVpnVersion(), cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -118,7 +118,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::portMap(const std::string &a
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::portMap(authHash, version, forceProtocols, cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -126,7 +126,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::recordInstall(bool isDesktop
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::recordInstall(isDesktop, Settings::instance().basePlatform(), cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -134,7 +134,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::addEmail(const std::string &
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::addEmail(authHash, email, cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -142,7 +142,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::confirmEmail(const std::stri
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::confirmEmail(authHash, cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -150,7 +150,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::signup(const std::string &us
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::signup(username, password, referringUsername, email, Settings::instance().sessionTypeId(), voucherCode, cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -158,7 +158,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::webSession(const std::string
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::webSession(authHash, cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -167,7 +167,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::checkUpdate(UpdateChannel up
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::checkUpdate(updateChannel, appVersion, appBuild, osVersion, osBuild, cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -175,7 +175,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::debugLog(const std::string &
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::debugLog(username, strLog, cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -183,7 +183,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::speedRating(const std::strin
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::speedRating(authHash, hostname, ip, rating, cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -191,7 +191,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::staticIps(const std::string
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::staticIps(authHash, Settings::instance().basePlatform(), Settings::instance().deviceId(), cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -199,7 +199,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::pingTest(std::uint32_t timeo
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::pingTest(timeoutMs, cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -207,7 +207,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::notifications(const std::str
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::notifications(authHash, pcpid, Settings::instance().language(), cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -215,7 +215,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::getRobertFilters(const std::
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::getRobertFilters(authHash, cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -223,7 +223,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::setRobertFilter(const std::s
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::setRobertFilter(authHash, id, status, cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -231,7 +231,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::syncRobert(const std::string
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::syncRobert(authHash, cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -239,7 +239,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::wgConfigsInit(const std::str
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::wgConfigsInit(authHash, clientPublicKey, deleteOldestKey, cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -247,7 +247,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::wgConfigsConnect(const std::
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::wgConfigsConnect(authHash, clientPublicKey, hostname, deviceId, wgTtl, cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -255,7 +255,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::myIP(WSNetRequestFinishedCal
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::myIP(cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -263,7 +263,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::mobileBillingPlans(const std
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::mobileBillingPlans(authHash, mobilePlanType, promo, version, cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -271,7 +271,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::sendPayment(const std::strin
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::sendPayment(authHash, appleID, appleData, appleSIG, cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -279,7 +279,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::verifyPayment(const std::str
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::verifyPayment(authHash, purchaseToken, gpPackageName, gpProductId, type, amazonUserId, cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -287,7 +287,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::postBillingCpid(const std::s
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::postBillingCpid(authHash, payCpid, cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -295,7 +295,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::getXpressLoginCode(WSNetRequ
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::getXpressLoginCode(cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -303,7 +303,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::verifyXpressLoginCode(const
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::verifyXpressLoginCode(xpressCode, sig, cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -313,7 +313,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::sendSupportTicket(const std:
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::sendSupportTicket(supportEmail, supportName, supportSubject, supportMessage, supportCategory, type, channel, Settings::instance().basePlatform(), cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -321,7 +321,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::regToken(WSNetRequestFinishe
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::regToken(cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -329,7 +329,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::signupUsingToken(const std::
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::signupUsingToken(token, cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -337,7 +337,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::claimAccount(const std::stri
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::claimAccount(authHash, username, password, email, voucherCode, claimAccount, cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -345,7 +345,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::shakeData(const std::string
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::shakeData(authHash, cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -353,7 +353,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::recordShakeForDataScore(cons
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::recordShakeForDataScore(authHash, Settings::instance().basePlatform(), score, signature, cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -361,7 +361,7 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::verifyTvLoginCode(const std:
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::verifyTvLoginCode(authHash, xpressCode, cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
@@ -369,13 +369,13 @@ std::shared_ptr<WSNetCancelableCallback> ServerAPI::cancelAccount(const std::str
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::cancelAccount(authHash, password, cancelableCallback);
-    boost::asio::post(io_context_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, request] { impl_->executeRequest(std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
 void ServerAPI::onVPNConnectStateChanged(bool isConnected)
 {
-    boost::asio::post(io_context_, [this, isConnected] {
+    boost::asio::post(executor_, [this, isConnected] {
         impl_->setIsConnectedToVpnState(isConnected);
     });
 }
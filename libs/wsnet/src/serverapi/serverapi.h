@@ -2,6 +2,7 @@
 
 #include "WSNetServerAPI.h"
 #include <boost/asio.hpp>
+#include "utils/executorpool.h"
 #include "WSNetHttpNetworkManager.h"
 #include "WSNetAdvancedParameters.h"
 #include "failover/ifailovercontainer.h"
@@ -15,7 +16,7 @@ class ServerAPI_impl;
 class ServerAPI : public WSNetServerAPI
 {
 public:
-    explicit ServerAPI(boost::asio::io_context &io_context, WSNetHttpNetworkManager *httpNetworkManager, IFailoverContainer *failoverContainer,
+    explicit ServerAPI(const ComponentExecutor &executor, WSNetHttpNetworkManager *httpNetworkManager, IFailoverContainer *failoverContainer,
                        PersistentSettings &persistentSettings, WSNetAdvancedParameters *advancedParameters, ConnectState &connectState);
     virtual ~ServerAPI();
 
@@ -110,7 +111,7 @@ public:
 
 private:
     std::unique_ptr<ServerAPI_impl> impl_;
-    boost::asio::io_context &io_context_;
+    ComponentExecutor executor_;
     PersistentSettings &persistentSettings_;
     WSNetAdvancedParameters *advancedParameters_;
     ConnectState &connectState_;
@@ -5,8 +5,9 @@
 
 namespace wsnet {
 
-ServerAPI_impl::ServerAPI_impl(WSNetHttpNetworkManager *httpNetworkManager, IFailoverContainer *failoverContainer, PersistentSettings &persistentSettings,
-                               WSNetAdvancedParameters *advancedParameters, ConnectState &connectState) :
+ServerAPI_impl::ServerAPI_impl(const ComponentExecutor &executor, WSNetHttpNetworkManager *httpNetworkManager, IFailoverContainer *failoverContainer,
+                               PersistentSettings &persistentSettings, WSNetAdvancedParameters *advancedParameters, ConnectState &connectState) :
+    executor_(executor),
     httpNetworkManager_(httpNetworkManager),
     advancedParameters_(advancedParameters),
     connectState_(connectState),
@@ -15,8 +16,23 @@ ServerAPI_impl::ServerAPI_impl(WSNetHttpNetworkManager *httpNetworkManager, IFai
     curInternalFailoverInd_(0),
     failoverState_(FailoverState::kUnknown)
 {
-    // try reading a failover from the settings
-    auto failover = failoverContainer_->failoverById(persistentSettings_.failoverId());
+    failedFailovers_.rankingFromJson(persistentSettings_.failoverRanking());
+
+    // try the historically fastest failover first
+    std::unique_ptr<BaseFailover> failover;
+    auto fastestFailoverId = failedFailovers_.fastestFailoverId();
+    if (fastestFailoverId.has_value()) {
+        failover = failoverContainer_->failoverById(fastestFailoverId.value());
+        if (failover)
+            spdlog::info("ServerAPI_impl::ServerAPI_impl, use the fastest failover from the ranking");
+    }
+
+    // then try reading a failover from the settings
+    if (!failover) {
+        failover = failoverContainer_->failoverById(persistentSettings_.failoverId());
+        if (failover)
+            spdlog::info("ServerAPI_impl::ServerAPI_impl, use a failover from settings");
+    }
 
     // if it fails, use the first one
     if (!failover) {
@@ -25,7 +41,6 @@ ServerAPI_impl::ServerAPI_impl(WSNetHttpNetworkManager *httpNetworkManager, IFai
     } else {
         curFailoverUid_ = failover->uniqueId();
         startFailoverUid_ = curFailoverUid_;
-        spdlog::info("ServerAPI_impl::ServerAPI_impl, use a failover from settings");
     }
 }
 
@@ -71,6 +86,8 @@ void ServerAPI_impl::setIsConnectedToVpnState(bool isConnected)
     isConnectedToVpn_ = isConnected;
     if (requestExecutorViaFailover_)
         requestExecutorViaFailover_->setIsConnectedToVpnState(isConnected);
+    if (failoverRacer_)
+        failoverRacer_->setIsConnectedToVpnState(isConnected);
 }
 
 void ServerAPI_impl::setTryingBackupEndpointCallback(std::shared_ptr<CancelableCallback<WSNetTryingBackupEndpointCallback> > tryingBackupEndpointCallback)
@@ -102,7 +119,7 @@ void ServerAPI_impl::executeRequest(std::unique_ptr<BaseRequest> request)
     }
 
     // if failover already in progress then move the request to queue
-    if (requestExecutorViaFailover_) {
+    if (requestExecutorViaFailover_ || failoverRacer_) {
         // take into account priority
         // in particular, wgConfigsInit, wgConfigsConnect and pingTest should have a higher priority in the queue to avoid potential connection delays
         if (request->priority() == RequestPriority::kHigh)
@@ -117,7 +134,7 @@ void ServerAPI_impl::executeRequest(std::unique_ptr<BaseRequest> request)
         executeRequestImpl(std::move(request), FailoverData(hostnameForConnectedState()));
         executeWaitingInQueueRequests();
     } else {
-        assert(requestExecutorViaFailover_ == nullptr);
+        assert(requestExecutorViaFailover_ == nullptr && failoverRacer_ == nullptr);
 
         bool bUseFailover = false;
         if (failoverState_ == FailoverState::kUnknown) {
@@ -131,6 +148,11 @@ void ServerAPI_impl::executeRequest(std::unique_ptr<BaseRequest> request)
         }
 
         if (bUseFailover) {
+            if (advancedParameters_->isFailoverRacing()) {
+                startFailoverRacer(std::move(request));
+                return;
+            }
+
             auto curFailover = failoverContainer_->failoverById(curFailoverUid_);
             spdlog::info("Trying: {}", curFailover->name());
 
@@ -198,6 +220,7 @@ void ServerAPI_impl::onRequestExecuterViaFailoverFinished(RequestExecuterRetCode
 
     std::unique_ptr<RequestExecuterViaFailover> requestExecutorViaFailoverCopy = std::move(requestExecutorViaFailover_);
     requestExecutorViaFailover_.reset();
+    persistentSettings_.setFailoverRanking(failedFailovers_.rankingToJson());
 
     if (retCode == RequestExecuterRetCode::kSuccess) {
         failoverState_ = FailoverState::kReady;
@@ -234,6 +257,66 @@ void ServerAPI_impl::onRequestExecuterViaFailoverFinished(RequestExecuterRetCode
     }
 }
 
+void ServerAPI_impl::startFailoverRacer(std::unique_ptr<BaseRequest> request)
+{
+    // race the failovers from the current one up to the one we started with
+    std::vector<std::unique_ptr<BaseFailover>> failovers;
+    auto failover = failoverContainer_->failoverById(curFailoverUid_);
+    while (failover && (int)failovers.size() < failoverContainer_->count()) {
+        std::string uid = failover->uniqueId();
+        failovers.push_back(std::move(failover));
+        failover = failoverContainer_->next(uid);
+        if (!failover) {
+            // looping
+            failover = failoverContainer_->first();
+        }
+        if (failover->uniqueId() == startFailoverUid_)
+            break;
+    }
+
+    auto onStarted = [this, firstFailoverInd = curInternalFailoverInd_](int failoverInd) {
+        // Do not emit this signal for the first failover
+        if (firstFailoverInd + failoverInd > 0 && tryingBackupEndpointCallback_)
+            tryingBackupEndpointCallback_->call(firstFailoverInd + failoverInd, failoverContainer_->count() - 1);
+    };
+
+    using namespace std::placeholders;
+    failoverRacer_.reset(new FailoverRacer(executor_, httpNetworkManager_, std::move(request), std::move(failovers), bIgnoreSslErrors_, isConnectedToVpn_,
+                                           advancedParameters_, failedFailovers_, onStarted,
+                                           std::bind(&ServerAPI_impl::onFailoverRacerFinished, this, _1, _2, _3, _4)));
+    failoverRacer_->start();
+}
+
+void ServerAPI_impl::onFailoverRacerFinished(RequestExecuterRetCode retCode, std::unique_ptr<BaseRequest> request, FailoverData failoverData, const std::string &failoverUid)
+{
+    assert(failoverState_ == FailoverState::kUnknown);
+
+    std::unique_ptr<FailoverRacer> failoverRacerCopy = std::move(failoverRacer_);
+    failoverRacer_.reset();
+    persistentSettings_.setFailoverRanking(failedFailovers_.rankingToJson());
+
+    if (retCode == RequestExecuterRetCode::kSuccess) {
+        curFailoverUid_ = failoverUid;
+        failoverState_ = FailoverState::kReady;
+        persistentSettings_.setFailovedId(curFailoverUid_);
+        failoverData_ = failoverData;
+        request->callCallback();
+        executeWaitingInQueueRequests();
+    } else if (retCode == RequestExecuterRetCode::kRequestCanceled) {
+        executeWaitingInQueueRequests();
+    } else if (retCode == RequestExecuterRetCode::kFailoverFailed) {
+        failoverState_ = FailoverState::kFailed;
+        logAllFailoversFailed(request.get());
+        setErrorCodeAndEmitRequestFinished(request.get(), ServerApiRetCode::kFailoverFailed);
+        executeWaitingInQueueRequests();
+    } else if (retCode == RequestExecuterRetCode::kConnectStateChanged) {
+        // Repeat the execution of the request via failover
+        executeRequest(std::move(request));
+    } else {
+        assert(false);
+    }
+}
+
 void ServerAPI_impl::onHttpNetworkRequestFinished(std::uint64_t requestId, std::uint32_t elapsedMs, NetworkError errCode, const std::string &curlError, const std::string &data)
 {
     auto it = activeHttpRequests_.find(requestId);
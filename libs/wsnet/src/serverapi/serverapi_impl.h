@@ -13,6 +13,7 @@
 #include "failover/ifailovercontainer.h"
 #include "failover/failoverdata.h"
 #include "requestexecuterviafailover.h"
+#include "failoverracer.h"
 #include "utils/cancelablecallback.h"
 #include "utils/persistentsettings.h"
 #include "connectstate.h"
@@ -23,7 +24,7 @@ namespace wsnet {
 class ServerAPI_impl
 {
 public:
-    explicit ServerAPI_impl(WSNetHttpNetworkManager *httpNetworkManager, IFailoverContainer *failoverContainer,
+    explicit ServerAPI_impl(const ComponentExecutor &executor, WSNetHttpNetworkManager *httpNetworkManager, IFailoverContainer *failoverContainer,
                             PersistentSettings &persistentSettings, WSNetAdvancedParameters *advancedParameters, ConnectState &connectState);
     virtual ~ServerAPI_impl();
 
@@ -36,6 +37,7 @@ public:
     void executeRequest(std::unique_ptr<BaseRequest> request);
 
 private:
+    ComponentExecutor executor_;
     WSNetHttpNetworkManager *httpNetworkManager_;
     WSNetAdvancedParameters *advancedParameters_;
     ConnectState &connectState_;
@@ -71,6 +73,7 @@ private:
     int curInternalFailoverInd_;
     enum class FailoverState { kUnknown, kReady, kFailed } failoverState_;
     std::unique_ptr<RequestExecuterViaFailover> requestExecutorViaFailover_;
+    std::unique_ptr<FailoverRacer> failoverRacer_;      // used instead of requestExecutorViaFailover_ in the failover racing mode
     std::optional<FailoverData> failoverData_;      // valid only in kReady state
     bool isFailoverFailedLogAlreadyDone_ = false;   // log "failover failed: API not ready" only once to avoid spam
     FailedFailovers failedFailovers_;
@@ -82,6 +85,8 @@ private:
     void setErrorCodeAndEmitRequestFinished(BaseRequest *request, ServerApiRetCode retCode);
 
     void onRequestExecuterViaFailoverFinished(RequestExecuterRetCode retCode, std::unique_ptr<BaseRequest> request, FailoverData failoverData);
+    void startFailoverRacer(std::unique_ptr<BaseRequest> request);
+    void onFailoverRacerFinished(RequestExecuterRetCode retCode, std::unique_ptr<BaseRequest> request, FailoverData failoverData, const std::string &failoverUid);
 
     void onHttpNetworkRequestFinished(std::uint64_t requestId, std::uint32_t elapsedMs, NetworkError errCode, const std::string &curlError, const std::string &data);
     // This callback function is necessary to cancel the request as quickly as possible if it was canceled on the calling side
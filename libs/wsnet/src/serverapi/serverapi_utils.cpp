@@ -1,4 +1,6 @@
 #include "serverapi_utils.h"
+#include <set>
+#include "settings.h"
 
 namespace wsnet {
 
@@ -41,5 +43,20 @@ std::shared_ptr<WSNetHttpRequest> serverapi_utils::createHttpRequestWithFailover
     return httpRequest;
 }
 
+std::vector<std::string> serverapi_utils::staticFailoverApiHostnames(IFailoverContainer *failoverContainer)
+{
+    std::set<std::string> hostnames;
+    for (auto failover = failoverContainer->first(); failover; failover = failoverContainer->next(failover->uniqueId())) {
+        for (const auto &failoverData : failover->staticData()) {
+            // the SNI domain is resolved instead of the domain if specified
+            if (!failoverData.sniDomain().empty())
+                hostnames.insert(failoverData.sniDomain());
+            else if (!utils::isIpAddress(failoverData.domain()))
+                hostnames.insert(Settings::instance().serverApiSubdomain() + "." + failoverData.domain());
+        }
+    }
+    return std::vector<std::string>(hostnames.begin(), hostnames.end());
+}
+
 
 } // namespace wsnet
@@ -2,6 +2,7 @@
 
 #include "WSNetHttpNetworkManager.h"
 #include "failover/failoverdata.h"
+#include "failover/ifailovercontainer.h"
 #include "baserequest.h"
 
 namespace wsnet {
@@ -9,6 +10,9 @@ namespace wsnet {
 namespace serverapi_utils {
     std::shared_ptr<WSNetHttpRequest> createHttpRequestWithFailoverParameters(WSNetHttpNetworkManager *httpNetworkManager, const FailoverData &failoverData, BaseRequest *request,
                                                                           bool bIgnoreSslErrors, bool isAPIExtraTLSPadding);
+
+    // hostnames resolved by the API requests made through the static data of the failovers
+    std::vector<std::string> staticFailoverApiHostnames(IFailoverContainer *failoverContainer);
 }
 
 } // namespace wsnet
@@ -3,9 +3,9 @@
 
 namespace wsnet {
 
-WSNetUtils_impl::WSNetUtils_impl(boost::asio::io_context &io_context, WSNetHttpNetworkManager *httpNetworkManager,
+WSNetUtils_impl::WSNetUtils_impl(const ComponentExecutor &executor, WSNetHttpNetworkManager *httpNetworkManager,
                                  IFailoverContainer *failoverContainer, WSNetAdvancedParameters *advancedParameters) :
-    io_context_(io_context),
+    executor_(executor),
     httpNetworkManager_(httpNetworkManager),
     advancedParameters_(advancedParameters),
     failoverContainer_(failoverContainer)
@@ -31,7 +31,7 @@ std::shared_ptr<WSNetCancelableCallback> WSNetUtils_impl::myIPViaFailover(int fa
 {
     auto cancelableCallback = std::make_shared<CancelableCallback<WSNetRequestFinishedCallback>>(callback);
     BaseRequest *request = requests_factory::myIP(cancelableCallback);
-    boost::asio::post(io_context_, [this, failoverInd, request] { myIPViaFailover_impl(failoverInd, std::unique_ptr<BaseRequest>(request)); });
+    boost::asio::post(executor_, [this, failoverInd, request] { myIPViaFailover_impl(failoverInd, std::unique_ptr<BaseRequest>(request)); });
     return cancelableCallback;
 }
 
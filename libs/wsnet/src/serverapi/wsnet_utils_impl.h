@@ -2,6 +2,7 @@
 
 #include "WSNetUtils.h"
 #include <boost/asio.hpp>
+#include "utils/executorpool.h"
 #include "WSNetHttpNetworkManager.h"
 #include "failover/ifailovercontainer.h"
 #include "serverapi/failedfailovers.h"
@@ -12,7 +13,7 @@ namespace wsnet {
 class WSNetUtils_impl : public WSNetUtils
 {
 public:
-    explicit WSNetUtils_impl(boost::asio::io_context &io_context, WSNetHttpNetworkManager *httpNetworkManager,
+    explicit WSNetUtils_impl(const ComponentExecutor &executor, WSNetHttpNetworkManager *httpNetworkManager,
                              IFailoverContainer *failoverContainer, WSNetAdvancedParameters *advancedParameters);
     virtual ~WSNetUtils_impl();
 
@@ -22,7 +23,7 @@ public:
     std::shared_ptr<WSNetCancelableCallback> myIPViaFailover(int failoverInd, WSNetRequestFinishedCallback callback) override;
 
 private:
-    boost::asio::io_context &io_context_;
+    ComponentExecutor executor_;
     WSNetHttpNetworkManager *httpNetworkManager_;
     WSNetAdvancedParameters *advancedParameters_;
     IFailoverContainer *failoverContainer_;
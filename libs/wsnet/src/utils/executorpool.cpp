@@ -0,0 +1,106 @@
+#include "executorpool.h"
+#include <algorithm>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+#include <spdlog/spdlog.h>
+
+namespace wsnet {
+
+namespace {
+template <typename T>
+void updateMax(std::atomic<T> &maxValue, T value)
+{
+    T prev = maxValue.load(std::memory_order_relaxed);
+    while (prev < value && !maxValue.compare_exchange_weak(prev, value, std::memory_order_relaxed)) {}
+}
+}
+
+void ExecutorStats::onScheduled()
+{
+    updateMax(maxQueueDepth, queueDepth.fetch_add(1, std::memory_order_relaxed) + 1);
+}
+
+void ExecutorStats::onStarted(std::uint64_t waitUs)
+{
+    queueDepth.fetch_sub(1, std::memory_order_relaxed);
+    handlersCount.fetch_add(1, std::memory_order_relaxed);
+    totalWaitUs.fetch_add(waitUs, std::memory_order_relaxed);
+    updateMax(maxWaitUs, waitUs);
+}
+
+void ExecutorStats::onFinished(std::uint64_t runUs)
+{
+    totalRunUs.fetch_add(runUs, std::memory_order_relaxed);
+    updateMax(maxRunUs, runUs);
+}
+
+thread_local const ComponentExecutor *ComponentExecutor::current_ = nullptr;
+
+ExecutorPool::ExecutorPool(std::uint32_t threadsCount) : work_(boost::asio::make_work_guard(io_context_))
+{
+    if (threadsCount == 0)
+        threadsCount = std::clamp(std::thread::hardware_concurrency(), 2u, kMaxDefaultThreads);
+    spdlog::info("wsnet executor threads: {}", threadsCount);
+
+    threads_.reserve(threadsCount);
+    for (std::uint32_t i = 0; i < threadsCount; ++i)
+        threads_.emplace_back([this](){ io_context_.run(); });
+}
+
+ExecutorPool::~ExecutorPool()
+{
+    stop();
+}
+
+ComponentExecutor ExecutorPool::makeExecutor(const std::string &componentName)
+{
+    std::lock_guard locker(mutex_);
+    auto stats = std::make_shared<ExecutorStats>(componentName);
+    stats_.push_back(stats);
+    return ComponentExecutor(boost::asio::make_strand(io_context_), stats);
+}
+
+void ExecutorPool::stop()
+{
+    if (threads_.empty())
+        return;
+
+    work_.reset();  // Allow all handlers to be allowed to finish normally
+    for (auto &thread : threads_)
+        thread.join();
+    threads_.clear();
+}
+
+std::string ExecutorPool::statsAsJson() const
+{
+    using namespace rapidjson;
+    StringBuffer buffer;
+    Writer<StringBuffer> writer(buffer);
+
+    std::lock_guard locker(mutex_);
+    writer.StartObject();
+    for (const auto &stats : stats_) {
+        std::uint64_t count = stats->handlersCount;
+        writer.Key(stats->name.c_str());
+        writer.StartObject();
+        writer.Key("queueDepth");
+        writer.Int64(stats->queueDepth);
+        writer.Key("maxQueueDepth");
+        writer.Int64(stats->maxQueueDepth);
+        writer.Key("handlers");
+        writer.Uint64(count);
+        writer.Key("avgWaitUs");
+        writer.Uint64(count ? stats->totalWaitUs / count : 0);
+        writer.Key("maxWaitUs");
+        writer.Uint64(stats->maxWaitUs);
+        writer.Key("avgRunUs");
+        writer.Uint64(count ? stats->totalRunUs / count : 0);
+        writer.Key("maxRunUs");
+        writer.Uint64(stats->maxRunUs);
+        writer.EndObject();
+    }
+    writer.EndObject();
+    return buffer.GetString();
+}
+
+} // namespace wsnet
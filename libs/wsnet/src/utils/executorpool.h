@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/asio.hpp>
+
+namespace wsnet {
+
+// Counters of the handlers executed on behalf of one component, updated lock-free
+struct ExecutorStats
+{
+    explicit ExecutorStats(const std::string &name) : name(name) {}
+
+    const std::string name;
+    std::atomic<std::int64_t> queueDepth = 0;           // the number of handlers scheduled but not yet started
+    std::atomic<std::int64_t> maxQueueDepth = 0;
+    std::atomic<std::uint64_t> handlersCount = 0;
+    std::atomic<std::uint64_t> totalWaitUs = 0;         // time from the scheduling to the start of a handler
+    std::atomic<std::uint64_t> maxWaitUs = 0;
+    std::atomic<std::uint64_t> totalRunUs = 0;          // execution time of a handler
+    std::atomic<std::uint64_t> maxRunUs = 0;
+
+    void onScheduled();
+    void onStarted(std::uint64_t waitUs);
+    void onFinished(std::uint64_t runUs);
+};
+
+// Executor of one component: a strand of the library io_context, so the handlers of the component never run concurrently
+// and keep the order in which they were scheduled. The handlers of different components run in parallel on the thread pool.
+// Usable everywhere instead of the io_context: boost::asio::post, timers and sockets.
+class ComponentExecutor
+{
+public:
+    typedef boost::asio::strand<boost::asio::io_context::executor_type> Strand;
+
+    ComponentExecutor(const Strand &strand, const std::shared_ptr<ExecutorStats> &stats) : strand_(strand), stats_(stats) {}
+
+    // Executor requirements, handlers are never executed inline
+    boost::asio::io_context &query(boost::asio::execution::context_t) const noexcept
+    {
+        return boost::asio::query(strand_, boost::asio::execution::context);
+    }
+    static constexpr boost::asio::execution::blocking_t query(boost::asio::execution::blocking_t) noexcept
+    {
+        return boost::asio::execution::blocking.never;
+    }
+    ComponentExecutor require(boost::asio::execution::blocking_t::never_t) const { return *this; }
+
+    template <typename F>
+    void execute(F &&f) const
+    {
+        stats_->onScheduled();
+        auto scheduledTime = std::chrono::steady_clock::now();
+        boost::asio::require(strand_, boost::asio::execution::blocking.never).execute(
+            [executor = *this, f = std::forward<F>(f), scheduledTime]() mutable {
+                executor.run(f, scheduledTime);
+            });
+    }
+
+    bool operator==(const ComponentExecutor &other) const noexcept { return strand_ == other.strand_; }
+    bool operator!=(const ComponentExecutor &other) const noexcept { return strand_ != other.strand_; }
+
+    boost::asio::io_context &context() const noexcept { return query(boost::asio::execution::context); }
+
+    // The executor of the handler which is running in the current thread or nullptr if the thread is not running any component handler.
+    // Allows a component to deliver callbacks to the executor of the caller.
+    static const ComponentExecutor *current() { return current_; }
+
+private:
+    Strand strand_;
+    std::shared_ptr<ExecutorStats> stats_;
+    static thread_local const ComponentExecutor *current_;
+
+    template <typename F>
+    void run(F &f, std::chrono::steady_clock::time_point scheduledTime) const
+    {
+        auto startTime = std::chrono::steady_clock::now();
+        stats_->onStarted(std::chrono::duration_cast<std::chrono::microseconds>(startTime - scheduledTime).count());
+        {
+            // restores the previous value even if the handler throws
+            struct CurrentGuard {
+                const ComponentExecutor *prev;
+                explicit CurrentGuard(const ComponentExecutor *executor) : prev(current_) { current_ = executor; }
+                ~CurrentGuard() { current_ = prev; }
+            } guard(this);
+            f();
+        }
+        stats_->onFinished(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count());
+    }
+};
+
+// The library io_context with a pool of threads running it, creates an executor with its own counters for each component
+// Thread safe
+class ExecutorPool
+{
+public:
+    // threadsCount == 0 means the default value
+    explicit ExecutorPool(std::uint32_t threadsCount);
+    virtual ~ExecutorPool();
+
+    boost::asio::io_context &io_context() { return io_context_; }
+    ComponentExecutor makeExecutor(const std::string &componentName);
+
+    // Joins the threads once the io_context has run out of work, so the handlers scheduled before the call are executed.
+    // The components must cancel their long-lived operations (e.g. reading of the ICMP socket) before, otherwise it never returns.
+    void stop();
+
+    // Counters of all the components in JSON format
+    std::string statsAsJson() const;
+
+private:
+    static constexpr std::uint32_t kMaxDefaultThreads = 4;
+
+    boost::asio::io_context io_context_;
+    boost::asio::executor_work_guard<boost::asio::io_context::executor_type> work_;
+    std::vector<std::thread> threads_;
+    mutable std::mutex mutex_;
+    std::vector<std::shared_ptr<ExecutorStats> > stats_;
+};
+
+} // namespace wsnet
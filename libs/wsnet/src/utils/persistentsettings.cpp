@@ -1,228 +1,321 @@
 #include "persistentsettings.h"
+#include <charconv>
 #include <rapidjson/document.h>
-#include <rapidjson/stringbuffer.h>
-#include <rapidjson/writer.h>
 #include <spdlog/spdlog.h>
 
 
 namespace wsnet {
 
-PersistentSettings::PersistentSettings(const std::string &settings)
+PersistentSettings::PersistentSettings(const std::string &settings) : data_(settings)
 {
-    using namespace rapidjson;
-
-    if (settings.empty()) {
-        spdlog::info("Use default ServerAPI settings");
-    } else {
-        Document doc;
-        doc.Parse(settings.c_str());
-        if (doc.HasParseError() || !doc.IsObject()) {
-            spdlog::error("ServerAPI settings incorrect format, use default ServerAPI settings");
-            return;
-        }
-
-        auto jsonObject = doc.GetObj();
-        if (!jsonObject.HasMember("version")) {
-            spdlog::error("ServerAPI settings incorrect format, use default ServerAPI settings");
-            return;
-        }
-
-        if (jsonObject.HasMember("flvId"))
-            failoverId_ = jsonObject["flvId"].GetString();
-        if (jsonObject.HasMember("countryOverride"))
-            countryOverride_ = jsonObject["countryOverride"].GetString();
-
-        if (jsonObject.HasMember("authHash"))
-            authHash_ = jsonObject["authHash"].GetString();
-        if (jsonObject.HasMember("sessionStatus"))
-            sessionStatus_ = jsonObject["sessionStatus"].GetString();
-        if (jsonObject.HasMember("locations"))
-            locations_ = jsonObject["locations"].GetString();
-        if (jsonObject.HasMember("serverCredentialsOvpn"))
-            serverCredentialsOvpn_ = jsonObject["serverCredentialsOvpn"].GetString();
-        if (jsonObject.HasMember("serverCredentialsIkev2"))
-            serverCredentialsIkev2_ = jsonObject["serverCredentialsIkev2"].GetString();
-        if (jsonObject.HasMember("serverConfigs"))
-            serverConfigs_ = jsonObject["serverConfigs"].GetString();
-        if (jsonObject.HasMember("portMap"))
-            portMap_ = jsonObject["portMap"].GetString();
-        if (jsonObject.HasMember("staticIps"))
-            staticIps_ = jsonObject["staticIps"].GetString();
-        if (jsonObject.HasMember("notifications"))
-            notifications_ = jsonObject["notifications"].GetString();
-
-        spdlog::info("ServerAPI settings settled sucessfully");
-    }
 }
 
 void PersistentSettings::setFailovedId(const std::string &failoverId)
 {
-    std::lock_guard locker(mutex_);
-    failoverId_ = failoverId;
+    set(kFailoverId, failoverId);
 }
 
 std::string PersistentSettings::failoverId() const
 {
-    std::lock_guard locker(mutex_);
-    return failoverId_;
+    return get(kFailoverId);
+}
+
+void PersistentSettings::setFailoverRanking(const std::string &failoverRanking)
+{
+    set(kFailoverRanking, failoverRanking);
+}
+
+std::string PersistentSettings::failoverRanking() const
+{
+    return get(kFailoverRanking);
 }
 
 void PersistentSettings::setCountryOverride(const std::string &countryOverride)
 {
-    std::lock_guard locker(mutex_);
-    countryOverride_ = countryOverride;
+    set(kCountryOverride, countryOverride);
 }
 
 std::string PersistentSettings::countryOverride() const
 {
-    std::lock_guard locker(mutex_);
-    return countryOverride_;
+    return get(kCountryOverride);
 }
 
 void PersistentSettings::setAuthHash(const std::string &authHash)
 {
-    std::lock_guard locker(mutex_);
-    authHash_ = authHash;
+    set(kAuthHash, authHash);
 }
 
 std::string PersistentSettings::authHash() const
 {
-    std::lock_guard locker(mutex_);
-    return authHash_;
+    return get(kAuthHash);
 }
 
 void PersistentSettings::setSessionStatus(const std::string &sessionStatus)
 {
-    std::lock_guard locker(mutex_);
-    sessionStatus_ = sessionStatus;
+    set(kSessionStatus, sessionStatus);
 }
 
 std::string PersistentSettings::sessionStatus() const
 {
-    std::lock_guard locker(mutex_);
-    return sessionStatus_;
+    return get(kSessionStatus);
 }
 
 void PersistentSettings::setLocations(const std::string &locations)
 {
-    std::lock_guard locker(mutex_);
-    locations_ = locations;
+    set(kLocations, locations);
 }
 
 std::string PersistentSettings::locations() const
 {
-    std::lock_guard locker(mutex_);
-    return locations_;
+    return get(kLocations);
 }
 
 void PersistentSettings::setServerCredentialsOvpn(const std::string &serverCredentials)
 {
-    std::lock_guard locker(mutex_);
-    serverCredentialsOvpn_ = serverCredentials;
+    set(kServerCredentialsOvpn, serverCredentials);
 }
 
 std::string PersistentSettings::serverCredentialsOvpn() const
 {
-    std::lock_guard locker(mutex_);
-    return serverCredentialsOvpn_;
+    return get(kServerCredentialsOvpn);
 }
 
 void PersistentSettings::setServerCredentialsIkev2(const std::string &serverCredentials)
 {
-    std::lock_guard locker(mutex_);
-    serverCredentialsIkev2_ = serverCredentials;
+    set(kServerCredentialsIkev2, serverCredentials);
 }
 
 std::string PersistentSettings::serverCredentialsIkev2() const
 {
-    std::lock_guard locker(mutex_);
-    return serverCredentialsIkev2_;
+    return get(kServerCredentialsIkev2);
 }
 
 void PersistentSettings::setServerConfigs(const std::string &serverConfigs)
 {
-    std::lock_guard locker(mutex_);
-    serverConfigs_ = serverConfigs;
+    set(kServerConfigs, serverConfigs);
 }
 
 std::string PersistentSettings::serverConfigs() const
 {
-    std::lock_guard locker(mutex_);
-    return serverConfigs_;
+    return get(kServerConfigs);
 }
 
 void PersistentSettings::setPortMap(const std::string &portMap)
 {
-    std::lock_guard locker(mutex_);
-    portMap_ = portMap;
+    set(kPortMap, portMap);
 }
 
 std::string PersistentSettings::portMap() const
 {
-    std::lock_guard locker(mutex_);
-    return portMap_;
+    return get(kPortMap);
 }
 
 void PersistentSettings::setStaticIps(const std::string &staticIps)
 {
-    std::lock_guard locker(mutex_);
-    staticIps_ = staticIps;
+    set(kStaticIps, staticIps);
 }
 
 std::string PersistentSettings::staticIps() const
 {
-    std::lock_guard locker(mutex_);
-    return staticIps_;
+    return get(kStaticIps);
 }
 
 void PersistentSettings::setNotifications(const std::string &notifications)
 {
-    std::lock_guard locker(mutex_);
-    notifications_ = notifications;
+    set(kNotifications, notifications);
 }
 
 std::string PersistentSettings::notifications() const
 {
-    std::lock_guard locker(mutex_);
-    return notifications_;
+    return get(kNotifications);
 }
 
 std::string PersistentSettings::getAsString() const
 {
     std::lock_guard locker(mutex_);
-    // serialize to json string
+    decode();
+    return data_;
+}
+
+std::uint64_t PersistentSettings::revision() const
+{
+    std::lock_guard locker(mutex_);
+    return revision_;
+}
+
+void PersistentSettings::decode() const
+{
+    if (isDecoded_)
+        return;
+    isDecoded_ = true;
+
+    // the defaults are saved only if they replace the incorrect settings
+    bool isChanged = false;
+    if (data_.empty()) {
+        spdlog::info("Use default ServerAPI settings");
+    } else if (data_[0] == '{') {
+        std::array<std::string, kKeysCount> values;
+        if (parseLegacyJson(data_, values)) {
+            build(values);
+            revision_++;
+            spdlog::info("ServerAPI settings settled sucessfully (converted from JSON)");
+            return;
+        }
+        spdlog::error("ServerAPI settings incorrect format, use default ServerAPI settings");
+        isChanged = true;
+    } else {
+        std::array<std::string_view, kKeysCount> values;
+        bool isCanonical = false;
+        if (parse(data_, values, records_, isCanonical)) {
+            // otherwise some keys are missing or unknown, e.g. written by another version
+            if (!isCanonical) {
+                build(values);
+                revision_++;
+            }
+            spdlog::info("ServerAPI settings settled sucessfully");
+            return;
+        }
+        spdlog::error("ServerAPI settings incorrect format, use default ServerAPI settings");
+        isChanged = true;
+    }
+    build(std::array<std::string_view, kKeysCount>());
+    if (isChanged)
+        revision_++;
+}
+
+bool PersistentSettings::parse(const std::string &settings, std::array<std::string_view, kKeysCount> &values,
+                               std::array<Record, kKeysCount> &records, bool &isCanonical)
+{
+    std::string_view data(settings);
+    std::size_t pos = 0;
+    auto readLine = [&data, &pos](std::string_view &line) {
+        auto end = data.find('\n', pos);
+        if (end == std::string_view::npos)
+            return false;
+        line = data.substr(pos, end - pos);
+        pos = end + 1;
+        return true;
+    };
+
+    std::string_view line;
+    if (!readLine(line) || line != std::string(kHeader) + " " + std::to_string(kVersion))
+        return false;
+
+    int recordsCount = 0;
+    isCanonical = true;
+    while (pos < data.size()) {
+        std::size_t offset = pos;
+        if (!readLine(line))
+            return false;
+        auto space = line.find(' ');
+        if (space == std::string_view::npos)
+            return false;
+        std::size_t valueSize;
+        auto sizeStr = line.substr(space + 1);
+        auto res = std::from_chars(sizeStr.data(), sizeStr.data() + sizeStr.size(), valueSize);
+        if (res.ec != std::errc() || res.ptr != sizeStr.data() + sizeStr.size())
+            return false;
+        if (valueSize >= data.size() - pos || data[pos + valueSize] != '\n')
+            return false;
+
+        // unknown keys are skipped
+        auto name = line.substr(0, space);
+        for (int i = 0; i < kKeysCount; ++i) {
+            if (name == kKeyNames[i]) {
+                values[i] = data.substr(pos, valueSize);
+                break;
+            }
+        }
+        // the records written by this class go in the order of the keys
+        if (recordsCount < kKeysCount && name == kKeyNames[recordsCount])
+            records[recordsCount] = Record { offset, pos, valueSize };
+        else
+            isCanonical = false;
+        recordsCount++;
+        pos += valueSize + 1;
+    }
+    if (recordsCount != kKeysCount)
+        isCanonical = false;
+    return true;
+}
+
+bool PersistentSettings::parseLegacyJson(const std::string &settings, std::array<std::string, kKeysCount> &values)
+{
     using namespace rapidjson;
     Document doc;
-    doc.SetObject();
-    doc.AddMember("version", kVersion, doc.GetAllocator());
-    if (!failoverId_.empty())
-        doc.AddMember("flvId", StringRef(failoverId_.c_str()), doc.GetAllocator());
-    if (!countryOverride_.empty())
-        doc.AddMember("countryOverride", StringRef(countryOverride_.c_str()), doc.GetAllocator());
-
-    if (!authHash_.empty())
-        doc.AddMember("authHash", StringRef(authHash_.c_str()), doc.GetAllocator());
-    if (!sessionStatus_.empty())
-        doc.AddMember("sessionStatus", StringRef(sessionStatus_.c_str()), doc.GetAllocator());
-    if (!locations_.empty())
-        doc.AddMember("locations", StringRef(locations_.c_str()), doc.GetAllocator());
-    if (!serverCredentialsOvpn_.empty())
-        doc.AddMember("serverCredentialsOvpn", StringRef(serverCredentialsOvpn_.c_str()), doc.GetAllocator());
-    if (!serverCredentialsIkev2_.empty())
-        doc.AddMember("serverCredentialsIkev2", StringRef(serverCredentialsIkev2_.c_str()), doc.GetAllocator());
-    if (!serverConfigs_.empty())
-        doc.AddMember("serverConfigs", StringRef(serverConfigs_.c_str()), doc.GetAllocator());
-    if (!portMap_.empty())
-        doc.AddMember("portMap", StringRef(portMap_.c_str()), doc.GetAllocator());
-    if (!staticIps_.empty())
-        doc.AddMember("staticIps", StringRef(staticIps_.c_str()), doc.GetAllocator());
-    if (!notifications_.empty())
-        doc.AddMember("notifications", StringRef(notifications_.c_str()), doc.GetAllocator());
-
-    StringBuffer sb;
-    Writer<StringBuffer> writer(sb);
-    doc.Accept(writer);
-    return sb.GetString();
+    doc.Parse(settings.c_str());
+    if (doc.HasParseError() || !doc.IsObject())
+        return false;
+
+    auto jsonObject = doc.GetObj();
+    if (!jsonObject.HasMember("version"))
+        return false;
+
+    for (int i = 0; i < kKeysCount; ++i) {
+        if (jsonObject.HasMember(kKeyNames[i]) && jsonObject[kKeyNames[i]].IsString())
+            values[i] = jsonObject[kKeyNames[i]].GetString();
+    }
+    return true;
+}
+
+template<typename T>
+void PersistentSettings::build(const std::array<T, kKeysCount> &values) const
+{
+    std::string header = std::string(kHeader) + " " + std::to_string(kVersion) + "\n";
+    std::size_t size = header.size();
+    for (const auto &value : values)
+        size += value.size() + 32;
+
+    // the values may point to data_
+    std::string data;
+    data.reserve(size);
+    data += header;
+    for (int i = 0; i < kKeysCount; ++i) {
+        records_[i].offset = data.size();
+        data += recordHeader((Key)i, values[i].size());
+        records_[i].valueOffset = data.size();
+        records_[i].valueSize = values[i].size();
+        data.append(values[i]);
+        data += '\n';
+    }
+    data_ = std::move(data);
+}
+
+std::string PersistentSettings::recordHeader(Key key, std::size_t valueSize)
+{
+    return std::string(kKeyNames[key]) + " " + std::to_string(valueSize) + "\n";
+}
+
+void PersistentSettings::set(Key key, const std::string &value)
+{
+    std::lock_guard locker(mutex_);
+    decode();
+    Record &record = records_[key];
+    if (record.valueSize == value.size() && data_.compare(record.valueOffset, record.valueSize, value) == 0)
+        return;
+
+    // rewrite the record of the key only, the following records are shifted
+    std::string header = recordHeader(key, value.size());
+    std::size_t oldSize = record.valueOffset + record.valueSize + 1 - record.offset;
+    std::size_t newSize = header.size() + value.size() + 1;
+    data_.replace(record.offset, oldSize, newSize, '\n');
+    data_.replace(record.offset, header.size(), header);
+    data_.replace(record.offset + header.size(), value.size(), value);
+    record.valueOffset = record.offset + header.size();
+    record.valueSize = value.size();
+
+    for (int i = key + 1; i < kKeysCount; ++i) {
+        records_[i].offset = records_[i].offset - oldSize + newSize;
+        records_[i].valueOffset = records_[i].valueOffset - oldSize + newSize;
+    }
+    revision_++;
+}
+
+std::string PersistentSettings::get(Key key) const
+{
+    std::lock_guard locker(mutex_);
+    decode();
+    return data_.substr(records_[key].valueOffset, records_[key].valueSize);
 }
 
 } // namespace wsnet
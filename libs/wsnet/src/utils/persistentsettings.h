@@ -1,10 +1,24 @@
 #pragma once
+#include <array>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <mutex>
 
 namespace wsnet {
 
-// Stores persistent settings for lib. Uses the json format.
+// Stores persistent settings for lib.
+// The settings are kept serialized as a sequence of records, one per key, with raw (not escaped) values:
+//   wsnet-settings <version>\n
+//   <key> <value size>\n<value>\n
+//   ...
+// The constructor only keeps the string, it is decoded on the first access: the records written by this class are indexed
+// in place, a value is copied out when it is asked for. A setter rewrites the record of its key only, so getAsString()
+// does not serialize anything, and revision() tells the caller whether there is anything new to save.
+// The large and rarely changed values go first to make rewriting of the small ones cheaper.
+// The legacy JSON format is still accepted and converted to the new format on the first access.
+// Downgrade: the builds before the records format read the legacy JSON only, they reject the records and start from
+// the default settings, so the data (locations, credentials, etc.) is fetched from the API again.
 // thread safe
 class PersistentSettings
 {
@@ -15,6 +29,10 @@ public:
     void setFailovedId(const std::string &failoverId);
     std::string failoverId() const;
 
+    // the ranking of the failovers by speed, see FailedFailovers
+    void setFailoverRanking(const std::string &failoverRanking);
+    std::string failoverRanking() const;
+
     void setCountryOverride(const std::string &countryOverride);
     std::string countryOverride() const;
 
@@ -47,25 +65,47 @@ public:
     std::string notifications() const;
 
     std::string getAsString() const;
+    // incremented on every change of the settings, including the conversion of the legacy or incorrect data
+    std::uint64_t revision() const;
 
 private:
     // should increment the version if the data format is changed
-    static constexpr int kVersion = 1;
-
-    std::string failoverId_;
-    std::string countryOverride_;
-
-    std::string authHash_;
-    std::string sessionStatus_;
-    std::string locations_;
-    std::string serverCredentialsOvpn_;
-    std::string serverCredentialsIkev2_;
-    std::string serverConfigs_;
-    std::string portMap_;
-    std::string staticIps_;
-    std::string notifications_;
-
+    static constexpr int kVersion = 2;
+    static constexpr char kHeader[] = "wsnet-settings";
+
+    // the order of the records in the serialized data
+    enum Key { kLocations, kServerConfigs, kStaticIps, kNotifications, kPortMap, kServerCredentialsOvpn, kServerCredentialsIkev2,
+               kSessionStatus, kAuthHash, kCountryOverride, kFailoverRanking, kFailoverId, kKeysCount };
+    // the names are also the keys of the legacy JSON format
+    static constexpr std::array<const char *, kKeysCount> kKeyNames = {
+        "locations", "serverConfigs", "staticIps", "notifications", "portMap", "serverCredentialsOvpn", "serverCredentialsIkev2",
+        "sessionStatus", "authHash", "countryOverride", "flvRanking", "flvId" };
+
+    struct Record
+    {
+        std::size_t offset = 0;         // offset of the record in data_
+        std::size_t valueOffset = 0;    // offset of the value in data_
+        std::size_t valueSize = 0;
+    };
+
+    // the settings as passed to the constructor until decode() is called by the first access
+    mutable std::string data_;
+    mutable std::array<Record, kKeysCount> records_;
+    mutable bool isDecoded_ = false;
+    mutable std::uint64_t revision_ = 0;
     mutable std::mutex mutex_;
+
+    void decode() const;
+    // isCanonical is set if the records are the ones written by this class, then they are indexed to records
+    static bool parse(const std::string &settings, std::array<std::string_view, kKeysCount> &values,
+                      std::array<Record, kKeysCount> &records, bool &isCanonical);
+    static bool parseLegacyJson(const std::string &settings, std::array<std::string, kKeysCount> &values);
+    template<typename T>
+    void build(const std::array<T, kKeysCount> &values) const;
+    static std::string recordHeader(Key key, std::size_t valueSize);
+
+    void set(Key key, const std::string &value);
+    std::string get(Key key) const;
 };
 
 } // namespace wsnet
@@ -6,12 +6,14 @@
 #include "utils/wsnet_callback_sink.h"
 #include "utils/persistentsettings.h"
 #include "utils/spdlog_utils.h"
+#include "utils/executorpool.h"
 #include "dnsresolver/dnsresolver_cares.h"
 #include "httpnetworkmanager/httpnetworkmanager.h"
 #include "settings.h"
 #include "failover/failovercontainer.h"
 #include "serverapi/serverapi.h"
 #include "serverapi/wsnet_utils_impl.h"
+#include "serverapi/serverapi_utils.h"
 #include "apiresourcesmanager/apiresourcesmanager.h"
 #include "emergencyconnect/emergencyconnect.h"
 #include "pingmanager/pingmanager.h"
@@ -28,16 +30,25 @@ namespace wsnet {
 class WSNet_impl : public WSNet
 {
 public:
-    WSNet_impl() : work_(boost::asio::make_work_guard(io_context_))
+    explicit WSNet_impl(std::uint32_t threadsCount) : executorPool_(threadsCount), statsExecutor_(executorPool_.makeExecutor("WSNet")),
+        statsTimer_(statsExecutor_)
     {
-        thread_ = std::thread([this](){ io_context_.run(); });
     }
 
     virtual ~WSNet_impl()
     {
+        boost::asio::post(statsExecutor_, [this] {
+            isStopped_ = true;
+            statsTimer_.cancel();
+        });
         apiResourcesManager_.reset();
-        work_.reset();  // Allow all handlers to be allowed to finish normally
-        thread_.join();
+        // the pool waits for the io_context to run out of work, so cancel the operations which are always pending
+        if (pingManager_)
+            pingManager_->stop();
+        if (httpNetworkManager_)
+            httpNetworkManager_->stop();
+        executorPool_.stop();
+        spdlog::info("wsnet executor stats: {}", executorPool_.statsAsJson());
     }
 
     bool initializeImpl(const std::string &basePlatform,  const std::string &platformName, const std::string &appVersion, const std::string &deviceId,
@@ -52,7 +63,7 @@ public:
             return false;
         }
 
-        httpNetworkManager_ = std::make_shared<HttpNetworkManager>(io_context_, dnsResolver_.get());
+        httpNetworkManager_ = std::make_shared<HttpNetworkManager>(executorPool_.makeExecutor("HttpNetworkManager"), dnsResolver_.get());
         if (!httpNetworkManager_->init()) {
             spdlog::error("Failed to initialize HttpNetworkManager");
             return false;
@@ -77,34 +88,57 @@ public:
         persistentSettings_.reset(new PersistentSettings(persistentSettings));
 
         failoverContainer_ = std::make_unique<FailoverContainer>(httpNetworkManager_.get());
+        failoverApiHostnames_ = serverapi_utils::staticFailoverApiHostnames(failoverContainer_.get());
         advancedParameters_ = std::make_shared<AdvancedParameters>();
-        serverAPI_ = std::make_shared<ServerAPI>(io_context_, httpNetworkManager_.get(), failoverContainer_.get(), *persistentSettings_, advancedParameters_.get(), connectState_);
-        apiResourcesManager_ = std::make_shared<ApiResourcesManager>(io_context_, serverAPI_.get(), *persistentSettings_, connectState_);
-        emergencyConnect_ = std::make_shared<EmergencyConnect>(io_context_, failoverContainer_.get(), dnsResolver_.get());
-        pingManager_ = std::make_shared<PingManager>(io_context_, httpNetworkManager_.get(), advancedParameters_.get());
-        utils_ = std::make_shared<WSNetUtils_impl>(io_context_, httpNetworkManager_.get(), failoverContainer_.get(), advancedParameters_.get());
+        serverAPI_ = std::make_shared<ServerAPI>(executorPool_.makeExecutor("ServerAPI"), httpNetworkManager_.get(), failoverContainer_.get(), *persistentSettings_, advancedParameters_.get(), connectState_);
+        apiResourcesManager_ = std::make_shared<ApiResourcesManager>(executorPool_.makeExecutor("ApiResourcesManager"), serverAPI_.get(), *persistentSettings_, connectState_);
+        emergencyConnect_ = std::make_shared<EmergencyConnect>(executorPool_.makeExecutor("EmergencyConnect"), failoverContainer_.get(), dnsResolver_.get());
+        pingManager_ = std::make_shared<PingManager>(executorPool_.makeExecutor("PingManager"), httpNetworkManager_.get(), advancedParameters_.get());
+        utils_ = std::make_shared<WSNetUtils_impl>(executorPool_.makeExecutor("WSNetUtils"), httpNetworkManager_.get(), failoverContainer_.get(), advancedParameters_.get());
 
+        startStatsTimer();
+        warmUpFailoverDns();
         return true;
     }
 
     void setConnectivityState(bool isOnline) override
     {
-        connectState_.setConnectivityState(isOnline);
+        if (connectState_.isOnline() != isOnline) {
+            connectState_.setConnectivityState(isOnline);
+            httpNetworkManager_->resetConnectionPool();
+            if (isOnline)
+                warmUpFailoverDns();
+        }
     }
     void setIsConnectedToVpnState(bool isConnected) override
     {
         if (connectState_.isVPNConnected() != isConnected) {
             connectState_.setIsConnectedToVpnState(isConnected);
-            // When connecting/disconnecting the VPN clear the DNS cache.
+            // When connecting/disconnecting the VPN clear the DNS cache and drop pooled connections,
+            // they were established through the previous route and firewall state.
             httpNetworkManager_->clearDnsCache();
+            httpNetworkManager_->resetConnectionPool();
+            warmUpFailoverDns();
         }
     }
 
     std::string currentPersistentSettings() override
     {
+        // the revision is taken first, a change made in the meantime is saved once more
+        savedPersistentSettingsRevision_ = persistentSettings_->revision();
         return persistentSettings_->getAsString();
     }
 
+    bool isPersistentSettingsChanged() override
+    {
+        return persistentSettings_->revision() != savedPersistentSettingsRevision_;
+    }
+
+    std::string executorStats() override
+    {
+        return executorPool_.statsAsJson();
+    }
+
     std::shared_ptr<WSNetDnsResolver> dnsResolver() override { return dnsResolver_; }
     std::shared_ptr<WSNetHttpNetworkManager> httpNetworkManager() override { return httpNetworkManager_; }
     std::shared_ptr<WSNetServerAPI> serverAPI() override { return serverAPI_; }
@@ -115,26 +149,62 @@ public:
     std::shared_ptr<WSNetUtils> utils() override { return utils_; }
 
 private:
-    std::thread thread_;
-    boost::asio::io_context io_context_;
-    boost::asio::executor_work_guard<boost::asio::io_context::executor_type> work_;
+    static constexpr int kStatsLogPeriodMin = 30;
+
+    // must be destroyed after all the components
+    ExecutorPool executorPool_;
+    ComponentExecutor statsExecutor_;
+    boost::asio::steady_timer statsTimer_;
+    bool isStopped_ = false;
 
     ConnectState connectState_;
     std::unique_ptr<PersistentSettings> persistentSettings_;
+    std::atomic<std::uint64_t> savedPersistentSettingsRevision_ = 0;
     std::shared_ptr<DnsResolver_cares> dnsResolver_;
     std::shared_ptr<HttpNetworkManager> httpNetworkManager_;
     std::unique_ptr<FailoverContainer> failoverContainer_;
+    std::vector<std::string> failoverApiHostnames_;
     std::shared_ptr<WSNetAdvancedParameters> advancedParameters_;
     std::shared_ptr<ServerAPI> serverAPI_;
     std::shared_ptr<WSNetApiResourcesManager> apiResourcesManager_;
     std::shared_ptr<EmergencyConnect> emergencyConnect_;
     std::shared_ptr<PingManager> pingManager_;
     std::shared_ptr<WSNetUtils_impl> utils_;
+
+    // resolve the API hostnames of all the failovers in advance, so the first API request after a network change
+    // does not wait for the DNS resolution of each domain it tries
+    void warmUpFailoverDns()
+    {
+        if (!failoverApiHostnames_.empty())
+            httpNetworkManager_->prefetchDns(failoverApiHostnames_);
+    }
+
+    void startStatsTimer()
+    {
+        boost::asio::post(statsExecutor_, [this] {
+            scheduleStatsLog();
+        });
+    }
+
+    // runs on statsExecutor_ only
+    void scheduleStatsLog()
+    {
+        if (isStopped_)
+            return;
+        statsTimer_.expires_after(std::chrono::minutes(kStatsLogPeriodMin));
+        statsTimer_.async_wait([this](const boost::system::error_code &ec) {
+            if (ec || isStopped_)
+                return;
+            spdlog::info("wsnet executor stats: {}", executorPool_.statsAsJson());
+            scheduleStatsLog();
+        });
+    }
 };
 
 // static methods of WSNet implementation
 std::shared_ptr<WSNet_impl> g_wsNet;
 std::mutex g_mutex;
+std::uint32_t g_threadsCount = 0;
 
 void WSNet::setLogger(WSNetLoggerFunction loggerFunction, bool debugLog)
 {
@@ -154,13 +224,20 @@ void WSNet::setLogger(WSNetLoggerFunction loggerFunction, bool debugLog)
     }
 }
 
+void WSNet::setThreadsCount(std::uint32_t threadsCount)
+{
+    std::lock_guard locker(g_mutex);
+    assert(g_wsNet == nullptr);
+    g_threadsCount = threadsCount;
+}
+
 bool WSNet::initialize(const std::string &basePlatform,  const std::string &platformName, const std::string &appVersion, const std::string &deviceId,
                        const std::string &openVpnVersion, const std::string &sessionTypeId,
                        bool isUseStagingDomains, const std::string &language, const std::string &persistentSettings)
 {
     std::lock_guard locker(g_mutex);
     assert(g_wsNet == nullptr);
-    g_wsNet.reset(new WSNet_impl);
+    g_wsNet.reset(new WSNet_impl(g_threadsCount));
     return g_wsNet->initializeImpl(basePlatform, platformName, appVersion, deviceId, openVpnVersion,
                                    sessionTypeId, isUseStagingDomains, language, persistentSettings);
 }